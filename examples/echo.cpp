@@ -192,7 +192,7 @@ L"<html>"
         L"<pre>";
                 //! [Files]
                 //! [Dump]
-                dump(file.second.data.get(), file.second.size);
+                dump(file.second.map(), file.second.size);
                 out <<
         L"</pre>";
             }
@@ -0,0 +1,161 @@
+/*!
+ * @file       admission.hpp
+ * @brief      Declares the Fastcgipp::Admission class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_ADMISSION_HPP
+#define FASTCGIPP_ADMISSION_HPP
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "fastcgi++/block.hpp"
+#include "fastcgi++/protocol.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Decides whether or not new requests are let in
+    /*!
+     * Requests beyond the limit are rejected as soon as their BEGIN_REQUEST
+     * record arrives rather than being queued. This keeps the queueing delay
+     * of the requests that are let in bounded under overload and tells the
+     * web server to try elsewhere straight away.
+     *
+     * The limit can optionally adapt itself to the measured queueing delay
+     * with additive increase/multiplicative decrease. Every round of limit()
+     * samples under the target delay raises the limit by one. A sample over
+     * it cuts the limit by a tenth, but no more than once a round so a burst
+     * of slow samples doesn't collapse it.
+     *
+     * All functions are thread safe.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Admission
+    {
+    public:
+        //! Clock used to measure queueing delay
+        typedef std::chrono::steady_clock Clock;
+
+        Admission();
+
+        //! Set the request limit
+        /*!
+         * @param[in] limit Maximum concurrent requests. Zero for no limit.
+         * @param[in] unavailable True to reject requests with a 503 Service
+         *                        Unavailable page rather than the
+         *                        OVERLOADED protocol status.
+         */
+        void configure(unsigned limit, bool unavailable);
+
+        //! Adapt the limit to the measured queueing delay
+        /*!
+         * The limit configured with configure() becomes the maximum.
+         *
+         * @param[in] target Queueing delay to keep under. Zero to stop
+         *                   adapting.
+         * @param[in] minimum Limit never goes below this.
+         */
+        void adapt(Clock::duration target, unsigned minimum=1);
+
+        //! Should a new request be let in?
+        /*!
+         * @param[in] active Requests currently in progress
+         * @return True if it should be let in
+         */
+        bool admit(size_t active);
+
+        //! Account for how long a request waited for a thread
+        void delay(Clock::duration delay);
+
+        //! Build the reply for a rejected request
+        /*!
+         * @param[in] id FastCGI ID of the rejected request
+         * @return Every record needed to end the request
+         */
+        Block rejection(Protocol::FcgiId id) const;
+
+        //! True if there is a limit
+        bool enabled() const
+        {
+            return m_maximum != 0;
+        }
+
+        //! True if the limit is adapting
+        bool adaptive() const
+        {
+            return m_target != Clock::duration::zero();
+        }
+
+        //! Current limit
+        unsigned limit() const
+        {
+            return m_limit;
+        }
+
+        //! Amount of requests that were rejected
+        unsigned long long rejected() const
+        {
+            return m_rejected;
+        }
+
+    private:
+        //! Configured limit and the most an adapting one can reach
+        unsigned m_maximum;
+
+        //! Least an adapting limit can reach
+        unsigned m_minimum;
+
+        //! Current limit
+        std::atomic_uint m_limit;
+
+        //! True to reject with a 503 page
+        bool m_unavailable;
+
+        //! Queueing delay to keep under
+        Clock::duration m_target;
+
+        //! Amount of requests that were rejected
+        std::atomic_ullong m_rejected;
+
+        //! Samples taken so far
+        unsigned long long m_samples;
+
+        //! Sample at which the limit was last cut. Zero for never.
+        unsigned long long m_cut;
+
+        //! Samples under the target since the limit last changed
+        unsigned m_fast;
+
+        //! Thread safe our adapting
+        std::mutex m_mutex;
+    };
+}
+
+#endif
@@ -0,0 +1,184 @@
+/*!
+ * @file       autoscaler.hpp
+ * @brief      Declares the Fastcgipp::Autoscaler class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_AUTOSCALER_HPP
+#define FASTCGIPP_AUTOSCALER_HPP
+
+#include <atomic>
+#include <chrono>
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Decides when a pool should gain or lose a thread
+    /*!
+     * A pool gains a thread when a task has waited in its queue longer than
+     * the target wait. That is either because the pool is busy or because
+     * its threads are blocked in their handlers. It loses a thread when one
+     * has sat idle for the idle period.
+     *
+     * The gap between the two thresholds gives hysteresis and so do two
+     * cooldowns. Only one thread is added per target wait so a new thread
+     * has a chance to drain the queue before another is added. No thread is
+     * removed until the idle period has passed since the last one was added
+     * so a burst doesn't see its threads torn down the moment it ends.
+     *
+     * grow() and shrink() must be serialized by the caller. The metrics can
+     * be read from anywhere.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Autoscaler
+    {
+    public:
+        //! Clock used to measure waits
+        typedef std::chrono::steady_clock Clock;
+
+        //! What the autoscaler has done
+        struct Metrics
+        {
+            //! Threads the pool has now
+            unsigned threads;
+
+            //! Most threads the pool has had
+            unsigned peak;
+
+            //! Times a thread was added
+            unsigned long long grown;
+
+            //! Times a thread was removed
+            unsigned long long shrunk;
+
+            //! Queue wait that last caused a thread to be added
+            Clock::duration trigger;
+        };
+
+        Autoscaler();
+
+        //! Set the bounds and thresholds
+        /*!
+         * @param[in] minimum Least threads to keep
+         * @param[in] maximum Most threads to have. Zero disables scaling.
+         * @param[in] wait Add a thread when a task waits longer than this
+         * @param[in] idle Remove a thread that sat idle this long
+         */
+        void configure(
+                unsigned minimum,
+                unsigned maximum,
+                Clock::duration wait,
+                Clock::duration idle);
+
+        //! Should a thread be added?
+        /*!
+         * A true return is counted as a thread being added.
+         *
+         * @param[in] threads Threads the pool has now
+         * @param[in] waited How long the oldest task has waited
+         * @param[in] now The current time
+         * @return True if a thread should be added
+         */
+        bool grow(
+                unsigned threads,
+                Clock::duration waited,
+                Clock::time_point now=Clock::now());
+
+        //! Should a thread that sat idle for idle() be removed?
+        /*!
+         * A true return is counted as a thread being removed.
+         *
+         * @param[in] threads Threads the pool has now
+         * @param[in] now The current time
+         * @return True if the thread should be removed
+         */
+        bool shrink(unsigned threads, Clock::time_point now=Clock::now());
+
+        //! Note how many threads the pool has
+        void resized(unsigned threads);
+
+        //! True if scaling
+        bool enabled() const
+        {
+            return m_maximum != 0;
+        }
+
+        //! Least threads to keep
+        unsigned minimum() const
+        {
+            return m_minimum;
+        }
+
+        //! Most threads to have
+        unsigned maximum() const
+        {
+            return m_maximum;
+        }
+
+        //! How long a thread sits idle before it is removed
+        Clock::duration idle() const
+        {
+            return m_idle;
+        }
+
+        //! What the autoscaler has done
+        Metrics metrics() const;
+
+    private:
+        //! Least threads to keep
+        unsigned m_minimum;
+
+        //! Most threads to have. Zero if not scaling.
+        unsigned m_maximum;
+
+        //! Add a thread when a task waits longer than this
+        Clock::duration m_wait;
+
+        //! Remove a thread that sat idle this long
+        Clock::duration m_idle;
+
+        //! When a thread was last added
+        Clock::time_point m_grown;
+
+        //! Threads the pool has now
+        std::atomic_uint m_threads;
+
+        //! Most threads the pool has had
+        std::atomic_uint m_peak;
+
+        //! Times a thread was added
+        std::atomic_ullong m_growths;
+
+        //! Times a thread was removed
+        std::atomic_ullong m_shrinks;
+
+        //! Queue wait that last caused a thread to be added
+        std::atomic<Clock::duration::rep> m_trigger;
+    };
+}
+
+#endif
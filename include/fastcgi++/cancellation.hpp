@@ -0,0 +1,113 @@
+/*!
+ * @file       cancellation.hpp
+ * @brief      Declares the Fastcgipp::Cancellation class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_CANCELLATION_HPP
+#define FASTCGIPP_CANCELLATION_HPP
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Lets work queued on behalf of a request be abandoned
+    /*!
+     * Every request can hand out a shared cancellation token with
+     * Request::cancellation(). Attach it to SQL queries and Curl transfers
+     * and they are dropped from the queue or stopped mid flight should the
+     * request be destroyed without finishing its response. That happens when
+     * the web server aborts the request, the connection dies or a deadline
+     * passes. Either way nobody is left to use the result.
+     *
+     * All functions are thread safe.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Cancellation
+    {
+    public:
+        //! Identifies a function to call once cancelled
+        typedef unsigned long long Id;
+
+        Cancellation():
+            m_cancelled(false),
+            m_next(1)
+        {}
+
+        //! Cancel everything
+        /*!
+         * All functions passed to onCancel() are called from within this.
+         * Only the first call does anything.
+         */
+        void cancel();
+
+        //! True once cancelled
+        bool cancelled() const
+        {
+            return m_cancelled;
+        }
+
+        //! Call a function once cancelled
+        /*!
+         * The function is called from whichever thread calls cancel() so
+         * keep it short. If we are already cancelled it is called right
+         * away.
+         *
+         * @param[in] cancel Function to call
+         * @return Identifier for forget(). Zero if the function was already
+         *         called.
+         */
+        Id onCancel(const std::function<void()>& cancel);
+
+        //! Don't call a function after all
+        /*!
+         * Call this once the work the function would stop is done.
+         *
+         * @param[in] id Identifier from onCancel()
+         */
+        void forget(Id id);
+
+    private:
+        //! True once cancelled
+        std::atomic_bool m_cancelled;
+
+        //! Functions to call once cancelled
+        std::map<Id, std::function<void()>> m_functions;
+
+        //! Next identifier to hand out
+        Id m_next;
+
+        //! Thread safe our functions
+        std::mutex m_mutex;
+    };
+}
+
+#endif
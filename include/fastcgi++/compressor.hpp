@@ -0,0 +1,197 @@
+/*!
+ * @file       compressor.hpp
+ * @brief      Declares the Fastcgipp::Compressor class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_COMPRESSOR_HPP
+#define FASTCGIPP_COMPRESSOR_HPP
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "fastcgi++/filter.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Compresses the body of a response on its way to the client
+    /*!
+     * This sits between an FcgiStreambuf and the FastCGI records it sends.
+     * Response data is written in through write() and comes out the other
+     * end as record blocks passed to the sink function.
+     *
+     * The HTTP header block at the start of the response is passed through
+     * uncompressed but is held back until we know whether or not the body
+     * will be compressed. If it is, a Content-Encoding and Vary header are
+     * added to it. Should the header block already contain a Content-Encoding
+     * or Content-Length header, the response is passed through untouched.
+     *
+     * The body is held back until it reaches the threshold size. Should the
+     * response complete before that it is sent uncompressed. An explicit
+     * flush() also ends the wait so that flush points are honoured.
+     *
+     * The compression state itself is taken from a per-thread pool on first
+     * use and returned to it when done. This way the rather large deflate
+     * state isn't allocated and initialized for every response.
+     *
+     * Deflate and gzip are supported if zlib was found at build time, brotli
+     * and zstd if their libraries were. Without any of them every response
+     * is passed through untouched.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Compressor
+    {
+    public:
+        //! Content codings
+        enum class Coding
+        {
+            IDENTITY,
+            DEFLATE,
+            GZIP,
+            BROTLI,
+            ZSTD
+        };
+
+        //! Pick the best content coding the client accepts
+        /*!
+         * Qualities are honoured and a quality of zero excludes a coding.
+         * Among equal qualities, zstd is preferred over brotli, then gzip,
+         * then deflate. Codings not supported by this build are ignored.
+         *
+         * @param[in] acceptEncodings Value of the HTTP Accept-Encoding header
+         * @return Chosen content coding. IDENTITY if none are acceptable.
+         */
+        static Coding negotiate(const std::string& acceptEncodings);
+
+        //! True if this build supports the content coding
+        static bool supported(Coding coding);
+
+        //! The HTTP token for the content coding
+        static const char* name(Coding coding);
+
+        //! Default threshold size for compression
+        static const size_t s_defaultThreshold = 1024;
+
+        //! Function to send complete records with
+        typedef Filter::Records::Sink Sink;
+
+        //! Setup the compressor
+        /*!
+         * @param[in] coding Content coding to compress with
+         * @param[in] threshold Bodies smaller than this, in bytes, are not
+         *                      compressed
+         * @param[in] tailRoom Extra bytes to reserve at the end of record
+         *                     blocks
+         * @param[in] sink Function to send records with
+         */
+        Compressor(
+                Coding coding,
+                size_t threshold,
+                size_t tailRoom,
+                const Sink& sink);
+
+        ~Compressor();
+
+        //! Pass response data into the compressor
+        void write(const char* data, size_t size);
+
+        //! Send everything written so far to the client
+        void flush();
+
+        //! End the response
+        /*!
+         * Anything still held back is sent out and the compression state is
+         * returned to the pool.
+         */
+        void finish();
+
+    private:
+        //! Compression library state
+        struct Codec;
+
+        //! What we do with data written
+        enum class State
+        {
+            HEADERS,     //!< Looking for the end of the header block
+            PENDING,     //!< Waiting for the body to reach the threshold
+            COMPRESSING, //!< Compressing the body
+            PASSTHROUGH, //!< Sending data as is
+            FINISHED     //!< Response is complete
+        };
+
+        //! Operations on the compression state
+        enum class Operation
+        {
+            PROCESS,
+            FLUSH,
+            FINISH
+        };
+
+        //! Returns a Codec to the pool
+        struct Release
+        {
+            void operator()(Codec* codec) const;
+        };
+
+        //! Get a Codec for the coding from this thread's pool
+        static std::unique_ptr<Codec, Release> acquire(Coding coding);
+
+        //! Maximum amount of codecs pooled per coding per thread
+        static const size_t s_poolSize = 4;
+
+        //! Content coding of compressed bodies
+        const Coding m_coding;
+
+        //! Bodies smaller than this aren't compressed
+        const size_t m_threshold;
+
+        //! What we are doing with data written
+        State m_state;
+
+        //! Held back header block and body
+        Filter::Response m_pending;
+
+        //! Compression state while compressing
+        std::unique_ptr<Codec, Release> m_codec;
+
+        //! Packs what we send into records
+        Filter::Records m_records;
+
+        //! Act upon the end of the header block
+        void headers();
+
+        //! Start compressing the body
+        void start();
+
+        //! Pass data through the codec
+        void compress(const char* data, size_t size, Operation operation);
+    };
+}
+
+#endif
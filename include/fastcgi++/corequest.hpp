@@ -0,0 +1,324 @@
+/*!
+ * @file       corequest.hpp
+ * @brief      Declares the Fastcgipp::CoRequest class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_COREQUEST_HPP
+#define FASTCGIPP_COREQUEST_HPP
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "fastcgi++/request.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! %Request handling class with a coroutine for a response
+    /*!
+     * Rather than returning false from response() and decoding the Message
+     * it is called again with, derivations of this class define
+     * coResponse() as a coroutine that can co_await anything that reports
+     * completion through a callback. That is the SQL::Connection, the
+     * Curler, the Mail::Mailer and the Manager's Timers.
+     *
+     * @code
+     * Task coResponse()
+     * {
+     *     const Message message = co_await query(connection, myQuery);
+     *     out << "Content-Type: text/plain\r\n\r\n" << myResults->rows();
+     * }
+     * @endcode
+     *
+     * Completion arrives as a Message through callback() like it always has.
+     * The coroutine is simply resumed from within response() by whichever
+     * handler thread gets that message. Should the operation complete before
+     * the coroutine has even suspended, it is resumed by the same thread
+     * without the request ever being requeued.
+     *
+     * Should the request be destroyed while the coroutine is suspended, the
+     * coroutine is destroyed along with it and any query or transfer it was
+     * awaiting is abandoned through Request::cancellation().
+     *
+     * @tparam charT Character type for internal processing (wchar_t or char)
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    template<class charT> class CoRequest: public Request<charT>
+    {
+    public:
+        //! Return type of coResponse()
+        class Task
+        {
+        public:
+            struct promise_type
+            {
+                //! Exception thrown out of the coroutine
+                std::exception_ptr exception;
+
+                Task get_return_object()
+                {
+                    return Task(Handle::from_promise(*this));
+                }
+
+                //! Don't start until response() resumes us
+                std::suspend_always initial_suspend() noexcept
+                {
+                    return {};
+                }
+
+                //! Stay around so response() can see we're done
+                std::suspend_always final_suspend() noexcept
+                {
+                    return {};
+                }
+
+                void return_void()
+                {}
+
+                void unhandled_exception()
+                {
+                    exception = std::current_exception();
+                }
+            };
+
+            Task(Task&& x):
+                m_handle(std::exchange(x.m_handle, nullptr))
+            {}
+
+            Task& operator=(Task&& x)
+            {
+                if(m_handle)
+                    m_handle.destroy();
+                m_handle = std::exchange(x.m_handle, nullptr);
+                return *this;
+            }
+
+            Task(const Task&) =delete;
+            Task& operator=(const Task&) =delete;
+
+            ~Task()
+            {
+                if(m_handle)
+                    m_handle.destroy();
+            }
+
+        private:
+            typedef std::coroutine_handle<promise_type> Handle;
+
+            //! Our coroutine. nullptr if there isn't one.
+            Handle m_handle;
+
+            Task(Handle handle=nullptr):
+                m_handle(handle)
+            {}
+
+            friend class CoRequest;
+        };
+
+        //! Awaitable for an operation that completes through callback()
+        /*!
+         * @tparam Start Type of function that starts the operation
+         * @sa await()
+         */
+        template<class Start> class Awaiter
+        {
+        public:
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<>)
+            {
+                typedef std::invoke_result_t<
+                    Start&,
+                    const std::function<void(Message)>&> Result;
+                if constexpr(std::is_void_v<Result>)
+                {
+                    m_start(m_request.callback());
+                    m_started = true;
+                }
+                else
+                    m_started = m_start(m_request.callback());
+                return m_started;
+            }
+
+            //! The message the operation completed with
+            /*!
+             * @return The message passed to callback(). If the operation
+             *         failed to start, a message with a type of zero.
+             */
+            Message await_resume()
+            {
+                return m_started?std::move(m_request.m_message):Message();
+            }
+
+            Awaiter(CoRequest& request, Start&& start):
+                m_request(request),
+                m_start(std::move(start)),
+                m_started(false)
+            {}
+
+        private:
+            //! The request we're suspending
+            CoRequest& m_request;
+
+            //! Function that starts the operation
+            Start m_start;
+
+            //! True if the operation was started
+            bool m_started;
+        };
+
+        //! Initializes what it can. configure() to finish.
+        /*!
+         * @sa Request::Request()
+         */
+        CoRequest(
+                const size_t maxPostSize=0,
+                const size_t spoolThreshold=1048576,
+                const size_t inWatermark=262144):
+            Request<charT>(maxPostSize, spoolThreshold, inWatermark)
+        {}
+
+        virtual ~CoRequest() {}
+
+    protected:
+        //! Response generating coroutine
+        /*!
+         * This is the coroutine equivalent of Request::response(). It is
+         * started once all request data has been received and the response
+         * is complete once it returns.
+         */
+        virtual Task coResponse() =0;
+
+        //! Await an operation that completes through callback()
+        /*!
+         * @param[in] start Function called with callback() to start the
+         *                  operation. It may return a bool with false
+         *                  indicating the operation couldn't be started.
+         * @return An awaitable resulting in the Message passed to
+         *         callback().
+         */
+        template<class Start>
+        Awaiter<std::decay_t<Start>> await(Start&& start)
+        {
+            return Awaiter<std::decay_t<Start>>(
+                    *this,
+                    std::decay_t<Start>(std::forward<Start>(start)));
+        }
+
+        //! Await an SQL query
+        /*!
+         * @param[in] connection The SQL::Connection to queue the query in
+         * @param[in] query The SQL::Query. Its callback is set for you as
+         *                  is its cancellation unless it already has one.
+         * @return An awaitable resulting in the Message the connection
+         *         completes the query with. If the query couldn't be
+         *         queued, the message type is zero.
+         */
+        template<class Connection, class Query>
+        auto query(Connection& connection, Query query)
+        {
+            return await([this, &connection, query] (
+                        const std::function<void(Message)>& callback) mutable
+            {
+                query.callback = callback;
+                if(!query.cancellation)
+                    query.cancellation = this->cancellation();
+                return connection.queue(query);
+            });
+        }
+
+        //! Await a Curl transfer
+        /*!
+         * @param[in] curler The Curler to queue the transfer in
+         * @param[in] curl The Curl object. Its callback and cancellation
+         *                 are set for you.
+         * @return An awaitable resulting in the Message the Curler completes
+         *         the transfer with.
+         */
+        template<class Curler, class Curl>
+        auto transfer(Curler& curler, Curl& curl)
+        {
+            return await([this, &curler, &curl] (
+                        const std::function<void(Message)>& callback)
+            {
+                curl.setCallback(callback);
+                curl.setCancellation(this->cancellation());
+                curler.queue(curl);
+            });
+        }
+
+        //! Await an email being sent
+        /*!
+         * @param[in] mailer The Mail::Mailer to queue the email in
+         * @param[in] email The Mail::Email to send
+         * @return An awaitable resulting in the Message the Mailer completes
+         *         the send with.
+         */
+        template<class Mailer, class Email>
+        auto send(Mailer& mailer, Email& email)
+        {
+            return await([&mailer, &email] (
+                        const std::function<void(Message)>& callback)
+            {
+                mailer.queue(email, callback);
+            });
+        }
+
+        //! Await a delay
+        /*!
+         * @param[in] delay How long to wait
+         * @param[in] messageType Type value of the resulting Message
+         * @return An awaitable resulting in the Message the timer delivers.
+         *         If there are no timers, the message type is zero.
+         * @sa Request::after()
+         */
+        auto sleep(Timers::Clock::duration delay, int messageType=1)
+        {
+            return await([this, delay, messageType] (
+                        const std::function<void(Message)>&)
+            {
+                return this->after(delay, Message(messageType)).valid();
+            });
+        }
+
+    private:
+        //! Starts and resumes coResponse()
+        bool response();
+
+        //! The coroutine from coResponse()
+        Task m_task;
+    };
+}
+
+#endif
@@ -35,6 +35,7 @@
 
 #include "fastcgi++/chunkstreambuf.hpp"
 #include "fastcgi++/message.hpp"
+#include "fastcgi++/cancellation.hpp"
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -114,6 +115,12 @@ namespace Fastcgipp
             //! Call function for when the request is complete
             std::function<void(Message)> m_callback;
 
+            //! Token to abandon the request with. nullptr if there is none.
+            std::shared_ptr<Cancellation> m_cancellation;
+
+            //! Our function registered with m_cancellation
+            Cancellation::Id m_cancelId;
+
             //! Curl Error Buffer
             char m_errorBuffer[256];
 
@@ -183,6 +190,19 @@ namespace Fastcgipp
             m_streamBuf->m_callback = callback;
         }
 
+        //! Abandon the request should this token be cancelled
+        /*!
+         * If the token is cancelled before the request is sent, it is
+         * dropped from the queue. If it's in progress, the transfer is
+         * stopped. Either way the callback is never called.
+         *
+         * @param[in] cancellation Token from Request::cancellation()
+         */
+        void setCancellation(const std::shared_ptr<Cancellation>& cancellation)
+        {
+            m_streamBuf->m_cancellation = cancellation;
+        }
+
         //! Add a header to the request
         void addHeader(const char* const header);
 
@@ -29,10 +29,12 @@
 #define FASTCGIPP_CURLER_HPP
 
 #include <queue>
+#include <deque>
 #include <atomic>
 #include <mutex>
 #include <thread>
 #include <map>
+#include <memory>
 
 #include "fastcgi++/poll.hpp"
 #include "fastcgi++/curl.hpp"
@@ -87,6 +89,12 @@ namespace Fastcgipp
         //! Queue up an curl
         void queue(Curl_base& curl);
 
+        //! Amount of requests abandoned through their cancellation token
+        unsigned long long cancelled() const
+        {
+            return m_cancelledCount;
+        }
+
         ~Curler();
 
         //! Construct a Curler object
@@ -132,6 +140,18 @@ namespace Fastcgipp
         //! Associative array linked sockets to handles
         std::map<void*, Curl_base> m_handles;
 
+        //! Requests whose cancellation token was cancelled
+        std::deque<std::weak_ptr<Curl_base::StreamBuf_base>> m_cancelled;
+
+        //! Requests abandoned through their cancellation token
+        std::atomic_ullong m_cancelledCount;
+
+        //! Remove the transfers in m_cancelled
+        /*!
+         * This must be called with m_mutex locked.
+         */
+        inline void abandon();
+
         //! Curl multi handle
         void* const m_multiHandle;
 
@@ -31,8 +31,11 @@
 #include <memory>
 #include <list>
 #include <ostream>
+#include <functional>
+#include <string>
 
 #include "fastcgi++/chunkstreambuf.hpp"
+#include "fastcgi++/message.hpp"
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -78,13 +81,21 @@ namespace Fastcgipp
                 //! From email address
                 std::string from;
 
-                Data()
+                //! Called once the email has been sent
+                std::function<void(Message)> callback;
+
+                //! Type value of the Message passed to callback
+                int messageType;
+
+                Data():
+                    messageType(25)
                 {}
 
                 Data(DataRef&& dataRef):
                     body(std::move(dataRef.body)),
                     to(std::move(dataRef.to)),
-                    from(std::move(dataRef.from))
+                    from(std::move(dataRef.from)),
+                    messageType(25)
                 {}
             };
 
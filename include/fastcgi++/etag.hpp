@@ -0,0 +1,152 @@
+/*!
+ * @file       etag.hpp
+ * @brief      Declares the Fastcgipp::ETagger class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_ETAG_HPP
+#define FASTCGIPP_ETAG_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "fastcgi++/filter.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Buffers a response and tags it with a strong ETag
+    /*!
+     * This sits at the end of the FcgiStreambuf output chain. The entire
+     * response is held back and the body is hashed (XXH64) as it is written.
+     * Once the response is complete an ETag header is added to the header
+     * block and the whole thing is sent. Should the match function say the
+     * client already has the tag, a bodiless 304 Not Modified is sent
+     * instead.
+     *
+     * Responses with a Status header other than 200 are passed through as is.
+     * Should the header block already contain an ETag header, that tag is
+     * used rather than a hash.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class ETagger
+    {
+    public:
+        //! Function to send complete records with
+        typedef Filter::Records::Sink Sink;
+
+        //! Function telling us if a 304 should be sent for a tag
+        /*!
+         * This is where the request method is taken into account. Only a
+         * GET or HEAD request should get a 304.
+         */
+        typedef std::function<bool(const std::string&)> Match;
+
+        //! Setup the tagger
+        /*!
+         * @param[in] match Function telling us if a 304 should be sent for
+         *                  the tag
+         * @param[in] tailRoom Extra bytes to reserve at the end of record
+         *                     blocks
+         * @param[in] sink Function to send records with
+         */
+        ETagger(const Match& match, size_t tailRoom, const Sink& sink);
+
+        //! Pass response data into the tagger
+        void write(const char* data, size_t size);
+
+        //! End the response and send it
+        void finish();
+
+        //! The tag of the response
+        /*!
+         * This is empty until finish() is called and remains empty if the
+         * response was passed through.
+         */
+        const std::string& tag() const
+        {
+            return m_tag;
+        }
+
+        //! True if a 304 Not Modified was sent in place of the response
+        bool notModified() const
+        {
+            return m_notModified;
+        }
+
+        //! Incremental XXH64 hash
+        class Hash
+        {
+        public:
+            Hash(uint64_t seed=0);
+
+            //! Hash more data
+            void update(const char* data, size_t size);
+
+            //! The hash of all data so far
+            uint64_t digest() const;
+
+        private:
+            //! Accumulators
+            uint64_t m_v[4];
+
+            //! Partial stripe
+            unsigned char m_stripe[32];
+
+            //! Bytes in m_stripe
+            size_t m_stripeSize;
+
+            //! Total bytes hashed
+            uint64_t m_length;
+
+            //! Seed value
+            const uint64_t m_seed;
+        };
+
+    private:
+        //! Function telling us if the client already has the tag
+        const Match m_match;
+
+        //! The held back response
+        Filter::Response m_response;
+
+        //! Hash of the body
+        Hash m_hash;
+
+        //! The tag of the response
+        std::string m_tag;
+
+        //! True if a 304 Not Modified was sent
+        bool m_notModified;
+
+        //! Packs what we send into records
+        Filter::Records m_records;
+    };
+}
+
+#endif
@@ -32,9 +32,12 @@
 #include "fastcgi++/protocol.hpp"
 #include "fastcgi++/webstreambuf.hpp"
 #include "fastcgi++/block.hpp"
+#include "fastcgi++/compressor.hpp"
+#include "fastcgi++/etag.hpp"
 
 #include <istream>
 #include <functional>
+#include <memory>
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -45,6 +48,12 @@ namespace Fastcgipp
      * just the same with the added feature of the dump() function but properly
      * flushes into FastCGI records.
      *
+     * With narrow characters the put area is the body of a Block with room
+     * for the record header reserved in front. Flushing simply fills in the
+     * header and hands the Block off to be sent. Room is also reserved at the
+     * end so the stream terminator and END_REQUEST record can be appended in
+     * place by collect().
+     *
      * @tparam charT Character type (char or wchar_t)
      * @tparam traits Character traits
      *
@@ -55,14 +64,16 @@ namespace Fastcgipp
     class FcgiStreambuf: public WebStreambuf<charT, traits>
     {
     public:
-        FcgiStreambuf()
+        FcgiStreambuf():
+            m_bufferSize(s_defaultBufferSize)
         {
-            this->setp(m_buffer, m_buffer+s_buffSize);
+            setBuffer();
         }
 
         ~FcgiStreambuf()
         {
-            emptyBuffer();
+            if(this->pptr() != this->pbase())
+                emptyBuffer();
         }
 
         //! Configure the stream buffer
@@ -108,15 +119,132 @@ namespace Fastcgipp
          */
         void dump(std::basic_istream<char>& stream);
 
+        //! Flush the stream buffer into a block rather than sending it
+        /*!
+         * All buffered data is packed into records and appended to the block
+         * instead of being sent. This allows the tail end of a response to be
+         * transmitted all at once.
+         *
+         * @param[in,out] tail %Block to append the records to
+         * @param[in] terminate True if the empty record terminating the stream
+         *                      should be appended as well
+         */
+        void collect(Block& tail, bool terminate);
+
+        //! See the size of the internal stream buffer in characters
+        size_t bufferSize() const
+        {
+            return m_bufferSize;
+        }
+
+        //! Set the size of the internal stream buffer
+        /*!
+         * Any data currently in the buffer is flushed first. Since a narrow
+         * buffer is flushed into a single record, the size is limited to the
+         * maximum FastCGI content length of 65535. Wide buffers are split
+         * over as many records as their UTF-8 encoding needs. The size is
+         * never less than s_minBufferSize.
+         *
+         * @param[in] size Size in characters
+         */
+        void bufferSize(size_t size);
+
+        //! Compress the response body
+        /*!
+         * This must be called before anything is flushed out of the stream
+         * buffer. See Compressor for details.
+         *
+         * @param[in] coding Content coding to compress with. IDENTITY turns
+         *                   compression off.
+         * @param[in] threshold Bodies smaller than this, in bytes, are not
+         *                      compressed
+         */
+        void compress(Compressor::Coding coding, size_t threshold);
+
+        //! Buffer the response and tag it with a strong ETag
+        /*!
+         * This must be called before anything is flushed out of the stream
+         * buffer. Flush points are ignored from then on. See ETagger for
+         * details.
+         *
+         * @param[in] match Function telling us if the client already has a
+         *                  tag
+         */
+        void etag(const ETagger::Match& match);
+
+        //! Let go of the buffer if nothing is in it
+        /*!
+         * A fresh buffer is allocated as soon as anything is written again.
+         * This keeps requests that sit idle for a long time small.
+         *
+         * @return True if no buffer is allocated now
+         */
+        bool release();
+
+        //! The tagger if the response is being tagged
+        const ETagger* etagger() const
+        {
+            return m_etagger.get();
+        }
+
     private:
         //! Code converts, packages and transmits all data in the stream buffer
         bool emptyBuffer();
 
+        //! Flush point. Compressed output is flushed as well.
+        int sync();
+
+        //! Pass data through the compressor or tagger
+        void filter(const char* data, size_t size);
+
+        //! Send a record or pass its body through the tagger
+        /*!
+         * @param[in] record %Block with the record body after room for the
+         *                   header
+         * @param[in] contentLength Size of the record body
+         */
+        void deliver(Block&& record, size_t contentLength);
+
+        //! Send a record or pass its body through the compressor or tagger
+        /*!
+         * @param[in] record %Block with the record body after room for the
+         *                   header
+         * @param[in] contentLength Size of the record body
+         */
+        void transmit(Block&& record, size_t contentLength);
+
+        //! Fill in the header, size the record and send it
+        void sendRecord(Block&& record, size_t contentLength);
+
+        //! Setup a fresh put area
+        void setBuffer();
+
+        //! Default size of the internal stream buffer
+        static const size_t s_defaultBufferSize = 8192;
+
+        //! Smallest size of the internal stream buffer
+        /*!
+         * An HTML or URL escape sequence is written into the buffer whole,
+         * so it must fit the longest of them.
+         */
+        static const size_t s_minBufferSize = 8;
+
+        //! Extra room at the end of a record for collect()
+        /*!
+         * Enough for an empty stream terminator record and an END_REQUEST
+         * record.
+         */
+        static const size_t s_tailRoom = 2*sizeof(Protocol::Header)
+            +sizeof(Protocol::EndRequest);
+
         //! Size of the internal stream buffer
-        static const int s_buffSize = 8192;
+        size_t m_bufferSize;
+
+        //! The record being built (narrow characters only)
+        Block m_record;
 
-        //! The buffer
-        charT m_buffer[s_buffSize];
+        //! The buffer (wide characters only)
+        std::unique_ptr<charT[]> m_buffer;
 
         //! ID associated with the request
         Protocol::RequestId m_id;
@@ -126,6 +254,12 @@ namespace Fastcgipp
 
         //! Function to actually send the record
         std::function<void(const Socket&, Block&&)> send;
+
+        //! Compresses the output if set
+        std::unique_ptr<Compressor> m_compressor;
+
+        //! Tags the output if set
+        std::unique_ptr<ETagger> m_etagger;
     };
 }
 
@@ -0,0 +1,212 @@
+/*!
+ * @file       filter.hpp
+ * @brief      Declares the Fastcgipp::Filter classes
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_FILTER_HPP
+#define FASTCGIPP_FILTER_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "fastcgi++/block.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Pieces shared by the filters between FcgiStreambuf and its records
+    /*!
+     * Both Compressor and ETagger hold back the start of a response until
+     * they have seen its HTTP header block and both pack what they let
+     * through into records of their own.
+     */
+    namespace Filter
+    {
+        //! A response held back while its header block is looked at
+        /*!
+         * @date    October 18, 2026
+         * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+         */
+        class Response
+        {
+        public:
+            Response():
+                m_blankLine(0),
+                m_body(0)
+            {}
+
+            //! Add data to the end of the response
+            /*!
+             * Until it is found, the data is scanned for the end of the
+             * header block.
+             */
+            void write(const char* data, size_t size);
+
+            //! True once the end of the header block has been found
+            bool complete() const
+            {
+                return m_body != 0;
+            }
+
+            //! Where the blank line ending the header block starts
+            size_t blankLine() const
+            {
+                return m_blankLine;
+            }
+
+            //! Where the body starts. Zero if not found yet.
+            size_t body() const
+            {
+                return m_body;
+            }
+
+            //! The response data
+            const char* data() const
+            {
+                return m_data.data();
+            }
+
+            //! Size of the response data
+            size_t size() const
+            {
+                return m_data.size();
+            }
+
+            //! Find a header field in the header block
+            /*!
+             * @param[in] field Lower case field name including the colon
+             * @param[out] value Set to the field value if found
+             * @return True if the field was found
+             */
+            bool header(const char* field, std::string& value) const;
+
+            //! Find a header field in the header block
+            /*!
+             * @param[in] field Lower case field name including the colon
+             * @return True if the field was found
+             */
+            bool header(const char* field) const;
+
+            //! Does a header line start with a field?
+            /*!
+             * @param[in] line Start of the line
+             * @param[in] end End of the line
+             * @param[in] field Lower case field name including the colon
+             */
+            static bool field(
+                    const char* line,
+                    const char* end,
+                    const char* field);
+
+            //! Let go of the response data
+            void clear();
+
+        private:
+            //! The held back response
+            std::vector<char> m_data;
+
+            //! Where the blank line ending the header block starts
+            size_t m_blankLine;
+
+            //! Where the body starts. Zero if not found yet.
+            size_t m_body;
+
+            //! Look for the end of the header block
+            void scan(size_t from);
+        };
+
+        //! Packs data into FastCGI records and hands them to a sink
+        /*!
+         * @date    October 18, 2026
+         * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+         */
+        class Records
+        {
+        public:
+            //! Function to send complete records with
+            /*!
+             * The record body starts after the room for a header at the
+             * start of the block. The header must be filled in and the block
+             * sized by the sink. The second argument is the content length.
+             */
+            typedef std::function<void(Block&&, size_t)> Sink;
+
+            //! Setup the packer
+            /*!
+             * @param[in] tailRoom Extra bytes to reserve at the end of record
+             *                     blocks
+             * @param[in] sink Function to send records with
+             */
+            Records(size_t tailRoom, const Sink& sink):
+                m_tailRoom(tailRoom),
+                m_sink(sink),
+                m_contentLength(0)
+            {}
+
+            //! Copy data as is into records
+            void copy(const char* data, size_t size);
+
+            //! Free space at the end of the record we are filling
+            /*!
+             * Data written here is added to the record by commit().
+             *
+             * @param[out] size Set to the size of the space
+             * @return Start of the space
+             */
+            char* space(size_t& size);
+
+            //! Add data written to space() to the record
+            /*!
+             * The record is sent once it is full.
+             *
+             * @param[in] size Amount of data written
+             */
+            void commit(size_t size);
+
+            //! Send the record we are filling if it has anything in it
+            void send();
+
+            //! Size of record bodies we send
+            static const size_t s_recordSize = 16384;
+
+        private:
+            //! Extra room at the end of record blocks
+            const size_t m_tailRoom;
+
+            //! Function to send records with
+            const Sink m_sink;
+
+            //! The record we are filling
+            Block m_record;
+
+            //! Amount of content in the record we are filling
+            size_t m_contentLength;
+        };
+    }
+}
+
+#endif
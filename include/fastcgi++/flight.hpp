@@ -0,0 +1,147 @@
+/*!
+ * @file       flight.hpp
+ * @brief      Declares the Fastcgipp::Flight class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_FLIGHT_HPP
+#define FASTCGIPP_FLIGHT_HPP
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "fastcgi++/block.hpp"
+#include "fastcgi++/protocol.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! A response being produced on behalf of several identical requests
+    /*!
+     * When the Manager coalesces requests, the first request for a key
+     * becomes the leader and runs response() as usual. Identical requests
+     * arriving while it is in flight join it as followers instead of being
+     * built. Everything the leader sends is relayed to them as it is
+     * produced, re-stamped with their own request IDs. Followers joining
+     * late first get a copy of everything sent so far.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Flight
+    {
+    public:
+        //! Function to send records with
+        typedef std::function<void(const Socket&, Block&&, bool)> Send;
+
+        //! Sole constructor
+        /*!
+         * @param[in] send Function to send records to followers with
+         * @param[in] land Called once the flight has landed
+         */
+        Flight(const Send& send, const std::function<void()>& land):
+            m_send(send),
+            m_land(land),
+            m_landed(false)
+        {}
+
+        //! Attach a follower
+        /*!
+         * @param[in] id ID of the follower request
+         * @param[in] kill True if the follower's socket should be closed once
+         *                 the response is complete
+         * @return False if the flight has already landed
+         */
+        bool join(const Protocol::RequestId& id, bool kill);
+
+        //! Relay records sent by the leader
+        /*!
+         * @param[in] data Complete records sent by the leader
+         * @param[in] last True if this ends the response
+         */
+        void relay(const Block& data, bool last);
+
+        //! Detach a follower that has been aborted
+        /*!
+         * Nothing more is relayed to it. Should the response not be complete
+         * yet, it gets an END_REQUEST with a non-zero application status.
+         *
+         * @param[in] id ID of the follower request
+         */
+        void leave(const Protocol::RequestId& id);
+
+        //! The leader is gone without finishing
+        /*!
+         * Followers get an END_REQUEST with a non-zero application status.
+         */
+        void abort();
+
+        //! True once the response is complete
+        bool landed()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_landed;
+        }
+
+    private:
+        //! A request waiting on the leader
+        struct Follower
+        {
+            Protocol::RequestId id;
+            bool kill;
+        };
+
+        //! Thread safe the flight
+        std::mutex m_mutex;
+
+        //! Function to send records to followers with
+        const Send m_send;
+
+        //! Called once the flight has landed
+        const std::function<void()> m_land;
+
+        //! Everything the leader has sent so far
+        Block m_history;
+
+        //! The followers
+        std::vector<Follower> m_followers;
+
+        //! True once the response is complete
+        bool m_landed;
+
+        //! End a follower with a non-zero application status
+        void end(const Follower& follower);
+
+        //! Land the flight
+        /*!
+         * Should be called with a lock on m_mutex that is released before
+         * the land callback is called.
+         */
+        void land(std::unique_lock<std::mutex>& lock);
+    };
+}
+
+#endif
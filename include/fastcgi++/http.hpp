@@ -33,13 +33,20 @@
 #include <istream>
 #include <iterator>
 #include <map>
+#include <unordered_map>
+#include <list>
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <cstring>
 #include <ctime>
 #include <atomic>
+#include <functional>
 
 #include "fastcgi++/protocol.hpp"
 #include "fastcgi++/address.hpp"
+#include "fastcgi++/postbuffer.hpp"
+#include "fastcgi++/random.hpp"
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -70,17 +77,60 @@ namespace Fastcgipp
             size_t size;
 
             //! File data
+            /*!
+             * This is only set if the file is stored in memory. Files larger
+             * than Environment::spoolThreshold() are spooled out of memory and
+             * this will be null. Use map() to access the data regardless of
+             * where it is stored.
+             */
             mutable std::unique_ptr<char[]> data;
 
+            //! File descriptor of spooled file data
+            /*!
+             * This is -1 if the file is stored in memory. The file offset is
+             * undefined so use pread() or mmap() with it. The descriptor is
+             * closed when the File is destroyed.
+             */
+            int fd;
+
+            //! Get a pointer to the file data regardless of storage
+            /*!
+             * If the file is spooled, the first call will mmap() it read-only.
+             * The mapping is valid for the lifetime of the File object.
+             *
+             * @return Pointer to the first byte of file data. This will be
+             *         nullptr if the file is empty or the mapping failed.
+             */
+            const char* map() const;
+
             //! Move constructor
             File(File&& x):
                 filename(std::move(x.filename)),
                 contentType(std::move(x.contentType)),
                 size(x.size),
-                data(std::move(x.data))
+                data(std::move(x.data)),
+                fd(x.fd),
+                m_map(x.m_map)
+            {
+                x.size = 0;
+                x.fd = -1;
+                x.m_map = nullptr;
+            }
+
+            //! Move assignment
+            File& operator=(File&& x);
+
+            File():
+                size(0),
+                fd(-1),
+                m_map(nullptr)
             {}
 
-            File() {}
+            ~File();
+
+        private:
+            //! Read-only mapping of the spooled file data
+            mutable void* m_map;
         };
 
         //! The HTTP request method as an enumeration
@@ -140,6 +190,13 @@ namespace Fastcgipp
             //! Character sets the clients accepts
             std::basic_string<charT> acceptCharsets;
 
+            //! Content codings the client accepts
+            /*!
+             * This is the raw HTTP_ACCEPT_ENCODING value. See
+             * Compressor::negotiate().
+             */
+            std::string acceptEncodings;
+
             //! Http authorization string
             std::basic_string<charT> authorization;
 
@@ -165,8 +222,23 @@ namespace Fastcgipp
             std::vector<std::basic_string<charT>> pathInfo;
 
             //! The etag the client assumes this document should have
+            /*!
+             * This is the numeric value of the first entity tag in
+             * ifNoneMatch. It is only of use to applications that tag
+             * documents with plain numbers.
+             */
             unsigned etag;
 
+            //! Entity tags the client already has a copy of
+            /*!
+             * Parsed from HTTP_IF_NONE_MATCH. Each tag is stored in its
+             * quoted form without any weak prefix (W/) since If-None-Match
+             * uses the weak comparison. A lone wildcard is stored as "*".
+             *
+             * @sa etagMatches()
+             */
+            std::vector<std::string> ifNoneMatch;
+
             //! How many seconds the connection should be kept alive
             unsigned keepAlive;
 
@@ -227,10 +299,16 @@ namespace Fastcgipp
                     const char* data,
                     const char* dataEnd);
 
-            //! Consolidates POST data into a single buffer
+            //! Adds a chunk of POST data to the post buffer
             /*!
              * This function will take arbitrarily divided chunks of raw http
-             * post data and consolidate them into m_postBuffer.
+             * post data and chain them together in the post buffer. The data
+             * is copied into a new Block.
+             *
+             * The exception to this is "multipart/form-data" post data. It is
+             * parsed incrementally as it arrives and never lands in the post
+             * buffer. Files larger than spoolThreshold() are written straight
+             * out of memory as they are received.
              *
              * @param[in] start Start of post data.
              * @param[in] end 1+ the last byte of post data
@@ -239,6 +317,21 @@ namespace Fastcgipp
                     const char* start,
                     const char* end);
 
+            //! Adds a received block of POST data to the post buffer
+            /*!
+             * Identical to fillPostBuffer(const char*, const char*) except
+             * that ownership of the block the data resides in is taken so no
+             * copy need be made.
+             *
+             * @param[in] block %Block containing the post data
+             * @param[in] start Start of post data in the block
+             * @param[in] end 1+ the last byte of post data in the block
+             */
+            void fillPostBuffer(
+                    Block&& block,
+                    const char* start,
+                    const char* end);
+
             //! Attempts to parse the POST buffer
             /*!
              * If the content type is recognized, this function will parse the
@@ -250,7 +343,14 @@ namespace Fastcgipp
             bool parsePostBuffer();
 
             //! Get the post buffer
-            const std::vector<char>& postBuffer() const
+            /*!
+             * The post data is held as the chain of blocks it was received
+             * in. Call PostBuffer::data() for a contiguous view.
+             *
+             * Note that this will always be empty for "multipart/form-data"
+             * post data.
+             */
+            const PostBuffer& postBuffer() const
             {
                 return m_postBuffer;
             }
@@ -259,7 +359,64 @@ namespace Fastcgipp
             void clearPostBuffer()
             {
                 m_postBuffer.clear();
-                m_postBuffer.shrink_to_fit();
+                m_multipart.reset();
+            }
+
+            //! Total amount of post data received so far
+            size_t postSize() const
+            {
+                return m_postSize;
+            }
+
+            //! See the size above which uploaded files are spooled
+            size_t spoolThreshold() const
+            {
+                return m_spoolThreshold;
+            }
+
+            //! Set the size above which uploaded files are spooled
+            /*!
+             * Files uploaded as "multipart/form-data" that grow beyond this
+             * size are moved out of memory into an anonymous file (memfd on
+             * Linux). See File::fd and File::map().
+             *
+             * @param [in] threshold Size in bytes
+             */
+            void spoolThreshold(size_t threshold)
+            {
+                m_spoolThreshold = threshold;
+            }
+
+            //! Check an entity tag against If-None-Match
+            /*!
+             * @param[in] tag Entity tag of the document in quoted form. A
+             *                weak prefix is ignored.
+             * @return True if the client already has this version of the
+             *         document
+             */
+            bool etagMatches(const std::string& tag) const
+            {
+                const size_t offset = tag.compare(0, 2, "W/")==0?2:0;
+                for(const auto& x: ifNoneMatch)
+                    if(x == "*" || tag.compare(offset, std::string::npos, x)==0)
+                        return true;
+                return false;
+            }
+
+            //! Should a 304 Not Modified be sent in place of the document?
+            /*!
+             * Only a GET or HEAD request is answered with a 304. Any other
+             * method gets the document whatever If-None-Match says.
+             *
+             * @param[in] tag Entity tag of the document in quoted form
+             * @return True if the request is a GET or HEAD and the client
+             *         already has this version of the document
+             */
+            bool notModified(const std::string& tag) const
+            {
+                return (requestMethod == RequestMethod::GET
+                        || requestMethod == RequestMethod::HEAD)
+                    && etagMatches(tag);
             }
 
             Environment():
@@ -269,11 +426,27 @@ namespace Fastcgipp
                 contentLength(0),
                 serverPort(0),
                 remotePort(0),
-                ifModifiedSince(0)
+                ifModifiedSince(0),
+                m_postSize(0),
+                m_spoolThreshold(1048576)
             {}
         private:
-            //! Parses "multipart/form-data" http post data
-            inline void parsePostsMultipart();
+            //! Count post data and pass it to the multipart parser if needed
+            /*!
+             * @param[in] start Start of post data chunk
+             * @param[in] end 1+ the last byte of post data chunk
+             * @return True if the data was consumed by the multipart parser
+             */
+            inline bool fillMultipart(const char* start, const char* end);
+
+            //! Incrementally parses "multipart/form-data" http post data
+            /*!
+             * @param[in] data Start of post data chunk
+             * @param[in] dataEnd 1+ the last byte of post data chunk
+             */
+            inline void parsePostsMultipart(
+                    const char* data,
+                    const char* const dataEnd);
 
             //! Parses "application/x-www-form-urlencoded" post data
             inline void parsePostsUrlEncoded();
@@ -282,7 +455,80 @@ namespace Fastcgipp
             std::vector<char> boundary;
 
             //! Buffer for processing post data
-            std::vector<char> m_postBuffer;
+            PostBuffer m_postBuffer;
+
+            //! Total amount of post data received so far
+            size_t m_postSize;
+
+            //! Files larger than this are spooled out of memory
+            size_t m_spoolThreshold;
+
+            //! State data for the incremental multipart parser
+            struct Multipart
+            {
+                //! Where in the post data are we?
+                enum State
+                {
+                    BODY,
+                    BOUNDARY,
+                    HEADER,
+                    EPILOGUE
+                } state;
+
+                //! Full part delimiter: CRLF, two dashes and the boundary
+                const std::vector<char> delimiter;
+
+                //! Searcher for the delimiter built once per request
+                const std::boyer_moore_horspool_searcher<
+                    std::vector<char>::const_iterator> searcher;
+
+                //! Bytes carried over from the previous chunk
+                /*!
+                 * In the BODY state this is the tail of the previous chunk
+                 * that might be the start of a delimiter. In the HEADER state
+                 * it is the part header received so far.
+                 */
+                std::vector<char> carry;
+
+                //! Bytes of the header terminator matched so far
+                unsigned matched;
+
+                //! True if we are in a part (not the preamble)
+                bool active;
+
+                //! True if the current part has a name
+                bool named;
+
+                //! True if the current part is a file
+                bool isFile;
+
+                //! Name of the current part
+                std::basic_string<charT> name;
+
+                //! Value of the current part if it isn't a file
+                std::vector<char> value;
+
+                //! The current part if it is a file
+                File<charT> file;
+
+                //! Allocated size of file.data
+                size_t reserve;
+
+                //! Build the delimiter and searcher from the boundary
+                Multipart(const std::vector<char>& boundary);
+            };
+
+            //! Incremental multipart parser (only for multipart post data)
+            std::unique_ptr<Multipart> m_multipart;
+
+            //! Pass body data to the current multipart part
+            inline void multipartData(const char* start, const char* end);
+
+            //! Parse the header of a new multipart part
+            inline void multipartHeader(const char* start, const char* end);
+
+            //! Store the current multipart part in posts or files
+            inline void multipartComplete();
         };
 
         //! Convert a char array to a std::wstring
@@ -310,6 +556,22 @@ namespace Fastcgipp
             string.assign(start, end);
         }
 
+        //! Parse a list of entity tags
+        /*!
+         * This parses the value of an If-Match or If-None-Match header. Tags
+         * are stored in their quoted form with any weak prefix (W/) removed.
+         * Unquoted tags, as sent back by clients for non-conforming ETag
+         * headers, are quoted. A wildcard is stored as "*".
+         *
+         * @param[in] start First byte of the header value
+         * @param[in] end 1+ the last byte of the header value
+         * @param[out] tags Container to append the tags to
+         */
+        void parseETags(
+                const char* start,
+                const char* end,
+                std::vector<std::string>& tags);
+
         //! Convert a char string to an integer
         /*!
          * This function is very similar to std::atoi() except that it takes
@@ -421,14 +683,25 @@ namespace Fastcgipp
 
         //! Defines ID values for HTTP sessions.
         /*!
-         * @date    March 24, 2016
+         * The ID data is filled from the thread's Random generator so making
+         * one doesn't normally involve a system call.
+         *
+         * @tparam idSize Size in bytes of the ID data. Must be a multiple of
+         *                3.
+         *
+         * @date    October 18, 2026
          * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
          */
-        class SessionId
+        template<size_t idSize=15>
+        class BasicSessionId
         {
         public:
-            //! Size in bytes of the ID data. Make sure it is a multiple of 3.
-            static const size_t size=15;
+            static_assert(
+                    idSize%3 == 0,
+                    "Session ID size must be a multiple of 3");
+
+            //! Size in bytes of the ID data
+            static const size_t size=idSize;
 
             //! Size in characters of string representation
             static const size_t stringLength=size*4/3;
@@ -446,12 +719,17 @@ namespace Fastcgipp
                 m_timestamp = std::time(nullptr);
             }
 
-            template<class T> friend class Sessions;
+            template<class T, size_t> friend class Sessions;
+            template<class T, size_t> friend class SharedSessions;
         public:
             //! This constructor initializes the ID data to a random value
-            SessionId();
+            BasicSessionId():
+                m_timestamp(std::time(nullptr))
+            {
+                Random::fill(m_data.data(), size);
+            }
 
-            SessionId(const SessionId& x):
+            BasicSessionId(const BasicSessionId& x):
                 m_timestamp(x.m_timestamp)
             {
                 std::copy(x.m_data.begin(), x.m_data.end(), m_data.begin());
@@ -465,35 +743,49 @@ namespace Fastcgipp
              * @param[in] string Reference to base64 encoded string
              */
             template<class charT>
-            SessionId(const std::basic_string<charT>& string);
+            BasicSessionId(const std::basic_string<charT>& string):
+                m_timestamp(std::time(nullptr))
+            {
+                base64Decode(
+                        string.begin(),
+                        string.begin()+std::min(stringLength, string.size()),
+                        m_data.begin());
+            }
 
-            template<class charT, class Traits>
+            template<class charT, class Traits, size_t x>
             friend std::basic_ostream<charT, Traits>& operator<<(
                     std::basic_ostream<charT, Traits>& os,
-                    const SessionId& x);
+                    const BasicSessionId<x>& id);
 
-            bool operator<(const SessionId& x) const
+            bool operator<(const BasicSessionId& x) const
             {
                 return std::memcmp(
                         m_data.data(),
                         x.m_data.data(),
-                        SessionId::size)<0;
+                        size)<0;
             }
 
-            bool operator==(const SessionId& x) const
+            bool operator==(const BasicSessionId& x) const
             {
                 return std::memcmp(
                         m_data.data(),
                         x.m_data.data(),
-                        SessionId::size)==0;
+                        size)==0;
             }
         };
 
+        template<size_t idSize> const size_t BasicSessionId<idSize>::size;
+        template<size_t idSize>
+        const size_t BasicSessionId<idSize>::stringLength;
+
+        //! The default 120 bit session ID
+        typedef BasicSessionId<> SessionId;
+
         //! Output the ID data in base64 encoding
-        template<class charT, class Traits>
+        template<class charT, class Traits, size_t idSize>
         std::basic_ostream<charT, Traits>& operator<<(
                 std::basic_ostream<charT, Traits>& os,
-                const SessionId& x)
+                const BasicSessionId<idSize>& x)
         {
             base64Encode(
                     x.m_data.begin(),
@@ -502,61 +794,190 @@ namespace Fastcgipp
             return os;
         }
 
+        //! Expiration string for session cookies
+        /*!
+         * Two strings are kept so that one can be rebuilt while the other is
+         * still being read.
+         *
+         * @date    October 18, 2026
+         * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+         */
+        class CookieExpiration
+        {
+        public:
+            CookieExpiration():
+                m_pointer(nullptr)
+            {}
+
+            //! Set the expiration to a point in time
+            void set(std::time_t time);
+
+            //! The current expiration string
+            const char* get() const
+            {
+                return m_pointer;
+            }
+
+        private:
+            //! Length of expiration string (with null terminator)
+            static const size_t s_length = 30;
+
+            //! The expiration strings
+            char m_strings[2][s_length];
+
+            //! The current expiration string
+            std::atomic<const char*> m_pointer;
+        };
+
         //! Container for HTTP sessions
         /*!
          * In many ways this class behaves like an std::map. Additions include
          * a mechanism for clearing out expired sessions based on a keep alive
-         * time and a frequency of deletion, and full thread safety. Basically
-         * it contains all session data and associates it with ID values.
+         * time, and full thread safety. Basically it contains all session data
+         * and associates it with ID values.
          *
          * Session data is only available as constant in order to ensure thread
          * safety when accessing the data. It is not only possible, but very
          * probable, that multiple requests/threads will be accessing the same
          * session data simultaneously.
          *
+         * Sessions are spread over a number of shards, each a hash table with
+         * its own lock, so concurrent requests rarely contend with one
+         * another. Each shard also keeps its sessions in order of last use.
+         * Since every session lives equally long, the expired ones are always
+         * at the tail of that list. Cleaning up is a matter of popping them
+         * off, one shard at a time, rather than sweeping every session.
+         * Every access pops a few from its own shard. Once per keep alive
+         * period, all shards are cleared of expired sessions.
+         *
          * @tparam T Class containing session data.
          *
-         * @date    May 26, 2016
+         * @date    October 18, 2026
          * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
          */
-        template<class T> class Sessions
+        template<class T, size_t idSize=15> class Sessions
         {
+        public:
+            //! Type of session ID
+            typedef BasicSessionId<idSize> Id;
+
+            static_assert(
+                    idSize >= sizeof(size_t),
+                    "Session IDs are too small to hash");
+
         private:
+            //! Hash session IDs by their leading bytes
+            /*!
+             * The ID data is random so there is no need to do any actual
+             * hashing.
+             */
+            struct Hash
+            {
+                size_t operator()(const Id& id) const
+                {
+                    size_t hash;
+                    std::memcpy(&hash, id.m_data.data(), sizeof(hash));
+                    return hash;
+                }
+            };
+
+            //! Sessions in order of last use. Most recent first.
+            typedef std::list<const Id*> Recency;
+
+            //! A session and its position in the order of last use
+            struct Session
+            {
+                //! The session data
+                std::shared_ptr<const T> data;
+
+                //! Last time the session was used
+                std::time_t timestamp;
+
+                //! Position in the order of last use
+                typename Recency::iterator position;
+            };
+
+            //! Hash table of sessions
+            typedef std::unordered_map<Id, Session, Hash> Map;
+
+            //! A separately locked piece of the sessions
+            struct alignas(64) Shard
+            {
+                //! Thread safe the shard
+                std::mutex mutex;
+
+                //! The sessions in this shard
+                Map sessions;
+
+                //! The sessions in order of last use
+                Recency recency;
+            };
+
+            //! Amount of expired sessions popped with each access
+            static const unsigned s_sweepBatch = 8;
+
             //! Amount of seconds to keep sessions around for.
             const unsigned int m_keepAlive;
 
-            //! The time that the next session cleanup should be done.
-            std::time_t m_cleanupTime;
+            //! The time that the next full cleanup should be done.
+            std::atomic<std::time_t> m_cleanupTime;
 
-            //! Actual container of sessions
-            std::map<SessionId, std::shared_ptr<const T>> m_sessions;
+            //! Amount of shards
+            const size_t m_shardCount;
 
-            //! Thread safe all operations
-            mutable std::mutex m_mutex;
+            //! The shards
+            std::unique_ptr<Shard[]> m_shards;
 
-            //! Length of expiration string (with null terminator)
-            static const size_t expirationLength = 30;
+            //! Total amount of sessions
+            std::atomic_size_t m_size;
 
-            //! Internal string for cookie expirations
-            char m_expiration[2][expirationLength];
+            //! Expiration string for setting cookies
+            CookieExpiration m_expiration;
 
-            //! Point for the current expiration string
-            std::atomic<const char*> m_expirationPtr;
+            //! The shard a session belongs in
+            /*!
+             * Picked with different bytes of the ID than those hashed so that
+             * the buckets within a shard are evenly used as well.
+             */
+            Shard& shard(const Id& id) const
+            {
+                size_t index;
+                std::memcpy(
+                        &index,
+                        id.m_data.data()+Id::size-sizeof(index),
+                        sizeof(index));
+                return m_shards[index % m_shardCount];
+            }
+
+            //! Pop expired sessions off the tail of a shard
+            /*!
+             * Should be called with the shard locked.
+             *
+             * @param[in] shard The shard to clean up
+             * @param[in] oldest Sessions last used before this are expired
+             * @param[in] limit Most sessions to pop
+             */
+            void expire(Shard& shard, std::time_t oldest, size_t limit);
 
-            //! Internal helper for building the m_expiration string
-            void setExpiration();
+            //! Clean up every shard if it is time
+            void cleanup(std::time_t now);
 
         public:
             //! Constructor takes session keep alive times
             /*!
              * @param[in] keepAlive Amount of seconds a session will stay alive
              *                      for.
+             * @param[in] shards Amount of separately locked shards to spread
+             *                   the sessions over
              */
-            Sessions(unsigned int keepAlive):
+            Sessions(unsigned int keepAlive, size_t shards=64):
                 m_keepAlive(keepAlive),
-                m_cleanupTime(std::time(nullptr)+keepAlive)
+                m_cleanupTime(std::time(nullptr)+keepAlive),
+                m_shardCount(std::max(shards, size_t(1))),
+                m_shards(new Shard[m_shardCount]),
+                m_size(0)
             {
-                setExpiration();
+                m_expiration.set(m_cleanupTime+m_keepAlive);
             }
 
             //! Get session data from session ID
@@ -565,13 +986,12 @@ namespace Fastcgipp
              * @return Shared pointer to session data. The pointer will evaluate
              *         to false if the session does not actually exist.
              */
-            std::shared_ptr<const T> get(const SessionId& id);
+            std::shared_ptr<const T> get(const Id& id);
 
             //! How many active sessions are there?
             size_t size() const
             {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                return m_sessions.size();
+                return m_size;
             }
 
             //! Generates a new session
@@ -581,22 +1001,18 @@ namespace Fastcgipp
              * @return A session ID for the session. This is not a reference for
              * thread safety purposes.
              */
-            SessionId generate(const std::shared_ptr<const T>& data);
+            Id generate(const std::shared_ptr<const T>& data);
 
             //! Erase a session
             /*!
              * @param[in] id The session we want to erase.
              */
-            void erase(const SessionId& id)
-            {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                m_sessions.erase(id);
-            }
+            void erase(const Id& id);
 
             //! Expiration string for setting cookies
             const char* expiration() const
             {
-                return m_expirationPtr;
+                return m_expiration.get();
             }
         };
     }
@@ -680,70 +1096,117 @@ Out Fastcgipp::Http::base64Encode(In start, In end, Out destination)
     return destination;
 }
 
-template<class T> Fastcgipp::Http::SessionId
-Fastcgipp::Http::Sessions<T>::generate(const std::shared_ptr<const T>& data)
+template<class T, size_t idSize>
+typename Fastcgipp::Http::Sessions<T, idSize>::Id
+Fastcgipp::Http::Sessions<T, idSize>::generate(
+        const std::shared_ptr<const T>& data)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    std::pair<
-            typename std::map<SessionId, std::shared_ptr<const T>>::iterator,
-            bool>
-        retVal;
-    retVal.second=false;
-    while(!retVal.second)
-        retVal=m_sessions.insert(std::pair<SessionId, std::shared_ptr<const T>>(
-                    SessionId(),
-                    data));
-    return retVal.first->first;
+    const std::time_t now = std::time(nullptr);
+    cleanup(now);
+
+    while(true)
+    {
+        Id id;
+        Shard& shard = this->shard(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        expire(shard, now-m_keepAlive, s_sweepBatch);
+
+        const auto session = shard.sessions.emplace(
+                id,
+                Session{data, now, typename Recency::iterator()});
+        if(!session.second)
+            continue;
+
+        shard.recency.push_front(&session.first->first);
+        session.first->second.position = shard.recency.begin();
+        ++m_size;
+        return id;
+    }
 }
 
-template<class T> std::shared_ptr<const T>
-Fastcgipp::Http::Sessions<T>::get(const SessionId& id)
+template<class T, size_t idSize> std::shared_ptr<const T>
+Fastcgipp::Http::Sessions<T, idSize>::get(const Id& id)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
     const std::time_t now = std::time(nullptr);
     const std::time_t oldest(now-m_keepAlive);
+    cleanup(now);
+
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    expire(shard, oldest, s_sweepBatch);
 
-    if(now >= m_cleanupTime)
+    const auto session = shard.sessions.find(id);
+    if(session != shard.sessions.end())
     {
-        auto session = m_sessions.begin();
-        while(session != m_sessions.end())
+        if(session->second.timestamp < oldest)
         {
-            if(session->first.m_timestamp < oldest)
-                session = m_sessions.erase(session);
-            else
-                ++session;
+            shard.recency.erase(session->second.position);
+            shard.sessions.erase(session);
+            --m_size;
         }
-        m_cleanupTime = std::time(nullptr)+m_keepAlive;
-        setExpiration();
-    }
-
-    const auto session = m_sessions.find(id);
-    if(session != m_sessions.cend())
-    {
-        if(session->first.m_timestamp < oldest)
-            m_sessions.erase(session);
         else
         {
             session->first.refresh();
-            return session->second;
+            session->second.timestamp = now;
+            shard.recency.splice(
+                    shard.recency.begin(),
+                    shard.recency,
+                    session->second.position);
+            return session->second.data;
         }
     }
 
     return std::shared_ptr<const T>();
 }
 
-template<class T> void Fastcgipp::Http::Sessions<T>::setExpiration()
+template<class T, size_t idSize>
+void Fastcgipp::Http::Sessions<T, idSize>::erase(const Id& id)
 {
-    char* const newExpiration(
-        m_expirationPtr==m_expiration[0]?m_expiration[1]:m_expiration[0]);
-    const std::time_t expirationTime = m_cleanupTime + m_keepAlive;
-    const auto count = std::strftime(
-            newExpiration,
-            expirationLength,
-            "%a, %d %b %Y %H:%M:%S GMT",
-            std::gmtime(&expirationTime));
-    std::fill(newExpiration+count, newExpiration+expirationLength, 0);
-    m_expirationPtr = newExpiration;
+    Shard& shard = this->shard(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const auto session = shard.sessions.find(id);
+    if(session != shard.sessions.end())
+    {
+        shard.recency.erase(session->second.position);
+        shard.sessions.erase(session);
+        --m_size;
+    }
+}
+
+template<class T, size_t idSize>
+void Fastcgipp::Http::Sessions<T, idSize>::expire(
+        Shard& shard,
+        std::time_t oldest,
+        size_t limit)
+{
+    while(limit-- && !shard.recency.empty())
+    {
+        const auto session = shard.sessions.find(*shard.recency.back());
+        if(session->second.timestamp >= oldest)
+            break;
+        shard.recency.pop_back();
+        shard.sessions.erase(session);
+        --m_size;
+    }
+}
+
+template<class T, size_t idSize>
+void Fastcgipp::Http::Sessions<T, idSize>::cleanup(const std::time_t now)
+{
+    std::time_t cleanupTime = m_cleanupTime;
+    if(now < cleanupTime || !m_cleanupTime.compare_exchange_strong(
+                cleanupTime,
+                now+m_keepAlive))
+        return;
+
+    // Only one shard is ever locked at a time
+    const std::time_t oldest(now-m_keepAlive);
+    for(size_t i=0; i<m_shardCount; ++i)
+    {
+        std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+        expire(m_shards[i], oldest, size_t(-1));
+    }
+    m_expiration.set(m_cleanupTime+m_keepAlive);
 }
 
 #endif
@@ -89,7 +89,18 @@ namespace Fastcgipp
             void join();
 
             //! Queue up an email
-            void queue(Email_base& email);
+            /*!
+             * @param [in] email The email to send
+             * @param [in] callback Function to call once the email has been
+             *                      accepted by the SMTP server.
+             * @param [in] messageType Type value for Message sent via
+             *                         callback.
+             */
+            void queue(
+                    Email_base& email,
+                    const std::function<void(Message)>& callback
+                        = std::function<void(Message)>(),
+                    int messageType=25);
 
             //! Initialize the mailer
             /*!
@@ -172,6 +183,7 @@ namespace Fastcgipp
                 m_email.body.clear();
                 m_email.to.clear();
                 m_email.from.clear();
+                m_email.callback = std::function<void(Message)>();
             }
 
             //! State enumeration
@@ -38,9 +38,20 @@
 #include <memory>
 #include <functional>
 #include <condition_variable>
-
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <queue>
+
+#include "fastcgi++/admission.hpp"
+#include "fastcgi++/autoscaler.hpp"
+#include "fastcgi++/offload.hpp"
+#include "fastcgi++/pools.hpp"
 #include "fastcgi++/protocol.hpp"
+#include "fastcgi++/router.hpp"
 #include "fastcgi++/transceiver.hpp"
+#include "fastcgi++/timers.hpp"
 #include "fastcgi++/request.hpp"
 
 //! Topmost namespace for the fastcgi++ library
@@ -170,6 +181,72 @@ namespace Fastcgipp
             return m_transceiver.listen(interface, service);
         }
 
+        //! Listen to an already listening socket
+        /*!
+         * Use this to listen on a socket inherited from a parent process
+         * that other worker processes are accepting connections from as well.
+         *
+         * @param [in] listener The listening socket.
+         * @return True on success. False on failure.
+         * @sa Supervisor
+         */
+        bool adopt(socket_t listener)
+        {
+            return m_transceiver.adopt(listener);
+        }
+
+        //! Listen to the sockets passed to us by systemd
+        /*!
+         * Use this when started through systemd socket activation.
+         *
+         * @return Amount of sockets adopted.
+         * @sa SocketGroup::inherit()
+         */
+        unsigned inherit()
+        {
+            return m_transceiver.inherit();
+        }
+
+        //! Accept hot restarts on a control socket
+        /*!
+         * This allows a new version of the application to take over our
+         * listeners with takeover() so that not a single connection is
+         * refused during a deploy. Once the new process is accepting
+         * connections we stop() and finish what we have.
+         *
+         * Call before start().
+         *
+         * @param [in] name Name of control socket (path in Unix world).
+         * @return True on success. False on failure.
+         */
+        bool control(const char* name)
+        {
+            return m_transceiver.control(name, [this] () { stop(); });
+        }
+
+        //! Take over the listeners of a running process
+        /*!
+         * Call this before start() and in place of listen(). The process we
+         * take over from is told to stop once we start. If this returns zero
+         * there was no process to take over from so listen() as usual. A hot
+         * restart would usually look like
+         *
+         * @code
+         * if(!manager.takeover("/run/app.control"))
+         *     manager.listen("/run/app.sock");
+         * manager.control("/run/app.control");
+         * manager.start();
+         * @endcode
+         *
+         * @param [in] name Name of the running process's control socket.
+         * @return Amount of listeners taken over.
+         * @sa control()
+         */
+        unsigned takeover(const char* name)
+        {
+            return m_transceiver.takeover(name);
+        }
+
         //! Pass a message to a request
         void push(Protocol::RequestId id, Message&& message);
 
@@ -183,40 +260,596 @@ namespace Fastcgipp
             m_transceiver.reuseAddress(value);
         }
 
-        //! Call before start to change the number of threads
+        //! Change the number of threads in the default pool
         /*!
-         * If the Manager is already running this will do nothing.
+         * If the Manager is already running, new threads are started straight
+         * away and surplus ones exit as soon as they are idle. At least one
+         * thread is kept while running.
          *
          * @param[in] threads Number of threads to use for request handling
          *
          * @sa Manager_base()
-         * @sa start()
+         * @sa autoscale()
          */
         void resizeThreads(unsigned threads);
 
+        //! Grow and shrink a pool's threads with demand
+        /*!
+         * The pool gains a thread when a task waits in its queue longer than
+         * \p wait and loses one when a thread sits idle for \p idle. The
+         * thread count is clamped into the bounds straight away. Call after
+         * pool() and before start().
+         *
+         * @param[in] minimum Least threads to keep
+         * @param[in] maximum Most threads to have. Zero disables scaling.
+         * @param[in] wait Queue wait that adds a thread
+         * @param[in] idle Idle time that removes a thread
+         * @param[in] pool Name of the pool. Empty for the default pool.
+         * @sa Autoscaler
+         */
+        void autoscale(
+                unsigned minimum,
+                unsigned maximum,
+                Autoscaler::Clock::duration wait,
+                Autoscaler::Clock::duration idle,
+                const std::string& pool=std::string());
+
+        //! Run blocking work deferred by requests in separate threads
+        /*!
+         * Requests defer work with Request::defer(). Call before start().
+         *
+         * @param[in] threads Number of threads to run work in. Zero disables
+         *                    deferring.
+         * @param[in] queue Work is turned away while this much of it is
+         *                  waiting. Zero for no limit.
+         * @param[in] timeout Timeout for work that isn't given one. Zero for
+         *                    none.
+         * @sa Offload
+         */
+        void offload(
+                unsigned threads,
+                size_t queue=0,
+                Offload::Clock::duration timeout
+                    =Offload::Clock::duration::zero())
+        {
+            m_offload.configure(threads, queue, timeout);
+        }
+
+        //! The offload pool and its metrics
+        const Offload& offload() const
+        {
+            return m_offload;
+        }
+
+        //! Release the stream buffers of requests waiting on a callback
+        /*!
+         * Requests that return false from Request::response() with nothing
+         * buffered let go of their out and err stream buffers until they
+         * write something again. This keeps the memory of tens of thousands
+         * of long polling or server-sent event requests down at the cost of
+         * an allocation each time one wakes up and writes. Call before
+         * start().
+         *
+         * @param[in] status True to release them
+         */
+        void hibernate(bool status)
+        {
+            m_hibernate = status;
+        }
+
+        //! What the autoscaler has done to a pool
+        /*!
+         * @param[in] pool Name of the pool. Empty for the default pool.
+         */
+        Autoscaler::Metrics autoscaling(
+                const std::string& pool=std::string()) const
+        {
+            return m_queues[m_pools.find(pool)].autoscaler.metrics();
+        }
+
+        //! Enable the response cache
+        /*!
+         * Once enabled, requests can have their responses cached by calling
+         * Request::cache(). Subsequent identical GET and HEAD requests are
+         * then answered straight from the cache as soon as their parameters
+         * have arrived. No request object is even built for them.
+         *
+         * @param[in] maxSize Maximum total size of cached responses in bytes.
+         *                    Zero disables the cache.
+         * @param[in] vary Names of parameters (like HTTP_ACCEPT_ENCODING)
+         *                 whose values the response depends on beyond the
+         *                 method and REQUEST_URI.
+         * @sa ResponseCache
+         */
+        void cache(
+                size_t maxSize,
+                const std::vector<std::string>& vary
+                    = std::vector<std::string>())
+        {
+            m_cache.configure(maxSize, vary);
+        }
+
+        //! The response cache
+        const ResponseCache& cache() const
+        {
+            return m_cache;
+        }
+
+        //! Coalesce identical concurrent requests
+        /*!
+         * Should a GET or HEAD request arrive while an identical one is
+         * already being handled, it is attached to that one as a follower
+         * rather than being built. Everything the leading request sends is
+         * relayed to its followers as it is produced. Requests are identical
+         * if they would have the same cache key so any vary parameters given
+         * to cache() apply. This works with the cache disabled too.
+         *
+         * Call before start().
+         *
+         * @param[in] status True to coalesce requests
+         * @sa Flight
+         */
+        void coalesce(bool status)
+        {
+            m_coalesce = status;
+        }
+
+        //! Amount of requests that were coalesced into another
+        unsigned long long coalesced() const
+        {
+            return m_coalesced;
+        }
+
+        //! Timers for delivering delayed messages to requests
+        /*!
+         * These are driven by the Transceiver thread. Requests should use
+         * Request::after() rather than this directly.
+         */
+        Timers& timers()
+        {
+            return m_timers;
+        }
+
+        //! Limit how long connections and requests can take
+        /*!
+         * Requests that miss a deadline are ended through
+         * Request::timeoutHandler() and destroyed. Connections that are idle
+         * for too long are closed and any requests on them destroyed. All
+         * deadlines are enforced by timers so they cost nothing until they
+         * pass.
+         *
+         * Call before start().
+         *
+         * @param[in] deadlines Deadlines to enforce
+         * @sa timedOut()
+         */
+        void deadlines(const Deadlines& deadlines);
+
+        //! Amount of connections or requests that missed a deadline
+        unsigned long long timedOut(Deadline deadline) const;
+
+        //! Limit how many requests are in progress at once
+        /*!
+         * Past the limit new requests are rejected as soon as their
+         * BEGIN_REQUEST record arrives instead of being queued. The limit is
+         * also what FCGI_MAX_REQS is answered with.
+         *
+         * Call before start().
+         *
+         * @param[in] requests Maximum concurrent requests. Zero for no limit.
+         * @param[in] unavailable True to reject requests with a canned 503
+         *                        Service Unavailable page. False to reject
+         *                        them with the OVERLOADED protocol status.
+         * @sa adapt()
+         * @sa Admission
+         */
+        void limit(unsigned requests, bool unavailable=false)
+        {
+            m_admission.configure(requests, unavailable);
+        }
+
+        //! Adapt the request limit to the measured queueing delay
+        /*!
+         * Queueing delay is how long a request's messages wait for a thread.
+         * The limit given to limit() becomes the most it can adapt up to.
+         *
+         * Call before start() and after limit().
+         *
+         * @param[in] target Queueing delay to keep under. Zero to stop
+         *                   adapting.
+         * @param[in] minimum The limit never goes below this.
+         */
+        void adapt(Timers::Clock::duration target, unsigned minimum=1)
+        {
+            m_admission.adapt(target, minimum);
+        }
+
+        //! Admission control and its metrics
+        const Admission& admission() const
+        {
+            return m_admission;
+        }
+
+        //! Add a pool of threads to handle some requests in
+        /*!
+         * Requests are classified into pools once their parameters have
+         * arrived either by prefix through classify() or by overriding
+         * Request::classify(). From then on they are only handled by their
+         * pool's threads. Calling this with an empty name configures the
+         * default pool that every other request is handled in.
+         *
+         * If the Manager is already running this will do nothing.
+         *
+         * @param[in] name Name of the pool
+         * @param[in] threads Number of threads to handle it with
+         * @param[in] queue Requests classified into the pool are rejected
+         *                  through Request::unavailableHandler() while this
+         *                  many tasks are waiting in its queue. Zero for no
+         *                  limit.
+         * @param[in] priority Should stealing be enabled, idle threads of
+         *                     lower priority pools take tasks from this one.
+         * @sa Pools
+         */
+        void pool(
+                const std::string& name,
+                unsigned threads,
+                size_t queue=0,
+                int priority=0);
+
+        //! Handle requests whose path starts with a prefix in a pool
+        /*!
+         * The path is the script name followed by the path info. Where
+         * prefixes overlap the longest one wins. Call after pool().
+         *
+         * @param[in] prefix Prefix of the path
+         * @param[in] pool Name of the pool
+         */
+        void classify(const std::string& prefix, const std::string& pool)
+        {
+            m_pools.classify(prefix, pool);
+        }
+
+        //! Let idle threads take tasks from higher priority pools
+        /*!
+         * Stealing only ever goes up in priority so a burst of tasks in a
+         * low priority pool never takes threads from a higher one.
+         *
+         * Call before start().
+         *
+         * @param[in] status True to steal tasks
+         */
+        void steal(bool status)
+        {
+            m_steal = status;
+        }
+
+        //! Our pools and their queue wait metrics
+        const Pools& pools() const
+        {
+            return m_pools;
+        }
+
+        //! Patterns requests are routed by
+        /*!
+         * @sa Manager::route()
+         */
+        const Router& router() const
+        {
+            return m_router;
+        }
+
+        //! Stop the manager once it has done enough work
+        /*!
+         * Once either limit is reached stop() is called so the manager stops
+         * accepting connections and finishes what it has. This is intended
+         * for worker processes under a Supervisor so they are replaced before
+         * leaks and heap fragmentation build up.
+         *
+         * @param[in] requests Completed requests to stop after. Zero for no
+         *                     limit.
+         * @param[in] rss Resident set size in bytes to stop after. This is
+         *                only checked every few requests. Zero for no limit.
+         */
+        void recycle(unsigned long long requests, size_t rss=0)
+        {
+            m_recycleRequests = requests;
+            m_recycleRss = rss;
+        }
+
+        //! Amount of requests that have been completed
+        unsigned long long completed() const
+        {
+            return m_completed;
+        }
+
     protected:
         //! Make a request object
+        /*!
+         * @param[in] id ID of the request
+         * @param[in] role Role from the BEGIN_REQUEST record
+         * @param[in] kill Kill flag from the BEGIN_REQUEST record
+         * @param[in] route Index of the route in m_router the request
+         *                  matched. Router::none if none.
+         */
         virtual std::unique_ptr<Request_base> makeRequest(
                 const Protocol::RequestId& id,
                 const Protocol::Role& role,
-                bool kill) =0;
+                bool kill,
+                unsigned route) =0;
 
         //! Handles low level communication with the other side
         Transceiver m_transceiver;
 
+        //! Delivers delayed messages to requests
+        Timers m_timers;
+
+        //! Runs blocking work deferred by requests
+        Offload m_offload;
+
+        //! Configuration and metrics of our pools
+        Pools m_pools;
+
+        //! Patterns requests are routed by
+        Router m_router;
+
+        //! True if idle requests release their stream buffers
+        bool m_hibernate;
+
     private:
-        //! Queue for pending tasks
-        std::queue<Protocol::RequestId> m_tasks;
+        //! The threads and task queue of a pool
+        struct Queue
+        {
+            //! Pending tasks and when they were queued
+            std::queue<std::pair<Protocol::RequestId, Timers::Clock::time_point>>
+                tasks;
+
+            //! Condition variable to wake handler() threads up
+            std::condition_variable wake;
+
+            //! Threads handling the pool
+            std::vector<std::thread> threads;
+
+            //! Threads waiting for a task
+            unsigned idle;
+
+            //! Pools to steal tasks from in order of preference
+            std::vector<unsigned> steal;
+
+            //! Threads that exited while running and are yet to be joined
+            std::vector<std::thread> retired;
+
+            //! Threads that should exit once they are idle
+            unsigned surplus;
+
+            //! Decides when the pool gains or loses a thread
+            Autoscaler autoscaler;
+
+            Queue(unsigned threads_):
+                threads(threads_),
+                idle(0),
+                surplus(0)
+            {}
+        };
+
+        //! Threads and task queue of each pool. Indexed as m_pools.
+        std::deque<Queue> m_queues;
 
         //! Thread safe our tasks
         std::mutex m_tasksMutex;
 
+        //! Running handler() threads. Guarded by m_tasksMutex.
+        unsigned m_handlers;
+
+        //! Signalled when a handler() thread exits
+        std::condition_variable m_exited;
+
+        //! Start another thread in a pool
+        /*!
+         * This must be called with m_tasksMutex locked.
+         *
+         * @param[in] pool Index of the pool
+         */
+        void spawn(unsigned pool);
+
+        //! Have the calling handler() thread leave its pool
+        /*!
+         * This must be called with m_tasksMutex locked. The thread must
+         * return straight after.
+         *
+         * @param[in] pool Index of the thread's pool
+         */
+        void retire(unsigned pool);
+
+        //! True if idle threads steal tasks from higher priority pools
+        bool m_steal;
+
+        //! Queue a task for a request
+        /*!
+         * @param[in] pool Index of the pool to queue it in
+         * @param[in] id ID of the request
+         */
+        void queue(unsigned pool, const Protocol::RequestId& id);
+
+        //! Find the next task for a handler() thread
+        /*!
+         * This must be called with m_tasksMutex locked.
+         *
+         * @param[in] pool Index of the thread's own pool
+         * @param[out] from Index of the pool the task is queued in
+         * @return True if there is a task
+         */
+        inline bool next(unsigned pool, unsigned& from);
+
+        //! Cached responses
+        ResponseCache m_cache;
+
+        //! True if identical requests should be coalesced
+        bool m_coalesce;
+
+        //! Requests that were coalesced into another
+        std::atomic_ullong m_coalesced;
+
+        //! Completed requests to stop after
+        unsigned long long m_recycleRequests;
+
+        //! Resident set size to stop after
+        size_t m_recycleRss;
+
+        //! Requests that have been completed
+        std::atomic_ullong m_completed;
+
+        //! True once we've stopped because of a recycle limit
+        std::atomic_bool m_recycling;
+
+        //! How many completed requests between resident set size checks
+        static const unsigned s_rssInterval = 16;
+
+        //! Count a completed request and stop if it's time to recycle
+        void complete();
+
+        //! Deadlines to enforce
+        Deadlines m_deadlines;
+
+        //! Requests that missed each deadline. Indexed by Deadline.
+        std::atomic_ullong m_timedOut[3];
+
+        //! Decides whether or not new requests are let in
+        Admission m_admission;
+
+        //! Build a request and pass it what it needs
+        /*!
+         * This must be called with m_requestsMutex locked for writing.
+         *
+         * @param[in] id ID of the request
+         * @param[in] role Role from the BEGIN_REQUEST record
+         * @param[in] kill Kill flag from the BEGIN_REQUEST record
+         * @param[in] begun When the BEGIN_REQUEST record arrived
+         * @param[in] route Index of the route the request matched
+         * @return The request's place in m_requests
+         */
+        inline Protocol::Requests<std::unique_ptr<Request_base>>::iterator
+        build(
+                const Protocol::RequestId& id,
+                Protocol::Role role,
+                bool kill,
+                Timers::Clock::time_point begun,
+                unsigned route);
+
+        //! Requests in flight by cache key
+        std::unordered_map<std::string, std::shared_ptr<Flight>> m_flights;
+
+        //! Thread safe our flights
+        std::mutex m_flightsMutex;
+
         //! An associative container for our requests
         Protocol::Requests<std::unique_ptr<Request_base>> m_requests;
 
         //! Thread safe our requests
         std::shared_timed_mutex m_requestsMutex;
 
+        //! A request waiting on its parameters before being built
+        /*!
+         * With the cache enabled we don't build the request until we know
+         * it can't be answered from the cache. With routes we don't know
+         * what type of request to build until then either.
+         */
+        struct Pending
+        {
+            //! Role from the BEGIN_REQUEST record
+            const Protocol::Role role;
+
+            //! Kill flag from the BEGIN_REQUEST record
+            const bool kill;
+
+            //! PARAMS records received so far
+            std::vector<Message> params;
+
+            //! Cache key for the request
+            std::string key;
+
+            //! True if it has been answered from the cache or a flight
+            bool served;
+
+            //! Flight it should lead once built or is following if served
+            std::shared_ptr<Flight> flight;
+
+            //! When the BEGIN_REQUEST record arrived
+            const Timers::Clock::time_point begun;
+
+            //! Index of the route the request matched
+            unsigned route;
+
+            //! Deadline for the rest of the PARAMS records
+            Timers::Id timer;
+
+            Pending(Protocol::Role role_, bool kill_):
+                role(role_),
+                kill(kill_),
+                served(false),
+                begun(Timers::Clock::now()),
+                route(Router::none)
+            {}
+        };
+
+        //! Requests waiting on their parameters. Guarded by m_requestsMutex.
+        Protocol::Requests<Pending> m_pending;
+
+        //! Pending requests that are only swallowing what is left of them.
+        //! Guarded by m_requestsMutex.
+        size_t m_served;
+
+        //! Deal with a message for a pending request
+        /*!
+         * @param[in] id ID of the pending request
+         * @param[in] pending The pending request
+         * @param[in,out] message The message. Taken if we return true.
+         * @return True if the message was dealt with. False if the request
+         *         needs to be built and the message passed on to it.
+         */
+        inline bool pend(
+                const Protocol::RequestId& id,
+                Pending& pending,
+                Message& message);
+
+        //! Find the route a request matches from its raw PARAMS records
+        /*!
+         * @param[in] params The PARAMS records
+         * @return Index of the route. Router::none if nothing matches.
+         */
+        inline unsigned match(const std::vector<Message>& params) const;
+
+        //! Records for a request ID reused before its old request was erased
+        /*!
+         * The web server is free to reuse a request ID as soon as it sees
+         * the END_REQUEST record, which can beat us to erasing the old
+         * request. Guarded by m_requestsMutex.
+         */
+        Protocol::Requests<std::vector<Message>> m_reused;
+
+        //! Pass a message to its request
+        /*!
+         * This must be called with m_requestsMutex locked for writing.
+         *
+         * @param[in] id ID of the request
+         * @param[in] message The message
+         * @param[out] pool Index of the pool to queue the task in
+         * @return True if the request needs a task queued for it
+         */
+        inline bool deliver(
+                const Protocol::RequestId& id,
+                Message&& message,
+                unsigned& pool);
+
+        //! Replay records for a request ID that was reused
+        /*!
+         * This must be called with m_requestsMutex locked for writing and
+         * after the old request has been erased.
+         *
+         * @param[in] id ID of the request
+         * @return True if the new request needs a task queued for it
+         */
+        inline bool reuse(const Protocol::RequestId& id);
+
         //! Local messages
         std::queue<std::pair<Message, Socket>> m_messages;
 
@@ -224,7 +857,10 @@ namespace Fastcgipp
         std::mutex m_messagesMutex;
 
         //! General handling function to have it's own thread
-        void handler();
+        /*!
+         * @param[in] pool Index of the pool the thread belongs to
+         */
+        void handler(unsigned pool);
 
         //! Handles management messages
         /*!
@@ -242,12 +878,6 @@ namespace Fastcgipp
         //! Thread safe starting and stopping
         std::mutex m_startStopMutex;
 
-        //! Threads our manager is running in
-        std::vector<std::thread> m_threads;
-
-        //! Condition variable to wake handler() threads up
-        std::condition_variable m_wake;
-
         //! General function to handler POSIX signals
         static void signalHandler(int signum);
 
@@ -295,6 +925,9 @@ namespace Fastcgipp
      *  - Call start()
      *  - Call stop() or terminate() when you are done.
      *
+     * Further request types can be built for requests matching a path pattern
+     * with route().
+     *
      * @tparam RequestT A class type derived from the Request class with at
      *                  least the Request::response() function defined.
      *
@@ -312,22 +945,72 @@ namespace Fastcgipp
             Manager_base(threads)
         {}
 
+        //! Build a different type of request for paths matching a pattern
+        /*!
+         * The path is the request URI up to any query string, or the script
+         * name should there be no request URI. Requests matching no route
+         * are built as RequestT. The parameters the pattern captures are
+         * available through Request::parameters().
+         *
+         * Call before start().
+         *
+         * @tparam RouteT A class type derived from the Request class with at
+         *                least the Request::response() function defined.
+         * @param[in] pattern The pattern. See Router for the syntax.
+         * @return False if the pattern is invalid or conflicts with another.
+         */
+        template<class RouteT> bool route(std::string_view pattern)
+        {
+            if(m_router.add(pattern) == Router::none)
+                return false;
+            m_factories.push_back(&Manager::make<RouteT>);
+            return true;
+        }
+
     private:
         //! Make a request object
         std::unique_ptr<Request_base> makeRequest(
+                const Protocol::RequestId& id,
+                const Protocol::Role& role,
+                bool kill,
+                unsigned route)
+        {
+            if(route == Router::none)
+                return make<RequestT>(id, role, kill);
+            return (this->*m_factories[route])(id, role, kill);
+        }
+
+        //! Functions making the request object for each route
+        std::vector<std::unique_ptr<Request_base> (Manager::*)(
+                const Protocol::RequestId&,
+                const Protocol::Role&,
+                bool)> m_factories;
+
+        //! Make a request object of a specific type
+        template<class T> std::unique_ptr<Request_base> make(
                 const Protocol::RequestId& id,
                 const Protocol::Role& role,
                 bool kill)
         {
             using namespace std::placeholders;
 
-            std::unique_ptr<RequestT> request(new RequestT);
+            std::unique_ptr<T> request(new T);
             request->configure(
                     id,
                     role,
                     kill,
-                    std::bind(&Transceiver::send, &m_transceiver, _1, _2, _3),
-                    std::bind(&Manager_base::push, this, id, _1));
+                    [this] (const Socket& socket, Block&& data, bool kill)
+                    {
+                        m_transceiver.send(socket, std::move(data), kill);
+                    },
+                    std::bind(&Manager_base::push, this, id, _1),
+                    std::bind(&Transceiver::throttle, &m_transceiver, _1, _2));
+            request->timers(m_timers);
+            request->pools(m_pools);
+            request->offload(m_offload);
+            request->hibernate(m_hibernate);
+            if(!m_router.empty())
+                request->router(m_router);
             return request;
         }
 
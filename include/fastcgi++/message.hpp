@@ -29,6 +29,8 @@
 #ifndef MESSAGE_HPP
 #define MESSAGE_HPP
 
+#include <limits>
+
 #include "fastcgi++/block.hpp"
 
 namespace Fastcgipp
@@ -73,6 +75,13 @@ namespace Fastcgipp
 
         //! The raw data being passed along with the message.
         Block data;
+
+        //! Type reserved for telling a request a deadline has passed
+        /*!
+         * The data holds the Deadline as a single byte. These are dealt with
+         * by the library and never passed up to the user code.
+         */
+        static const int deadline = std::numeric_limits<int>::min();
     };
 }
 
@@ -0,0 +1,249 @@
+/*!
+ * @file       offload.hpp
+ * @brief      Declares the Fastcgipp::Offload class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_OFFLOAD_HPP
+#define FASTCGIPP_OFFLOAD_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "fastcgi++/cancellation.hpp"
+#include "fastcgi++/message.hpp"
+#include "fastcgi++/timers.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Runs blocking work away from the Manager's threads
+    /*!
+     * Work like image resizing, key derivation or calls into a blocking
+     * third party library would otherwise pin a Manager thread for its whole
+     * duration. Here it runs on a separate, bounded set of threads and its
+     * result is delivered as a Message. Requests should use Request::defer()
+     * rather than this directly.
+     *
+     * Should the work have a timeout, the timeout message is armed in
+     * Timers when the work is queued. Whichever of the two comes first is
+     * delivered and the other is dropped. Work whose timeout has passed or
+     * whose request is gone is skipped rather than run. Work that is already
+     * running can't be interrupted so it runs to completion.
+     *
+     * All functions are thread safe.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Offload
+    {
+    public:
+        //! Clock used to measure the work
+        typedef Timers::Clock Clock;
+
+        //! Type of the message delivered by default when work times out
+        /*!
+         * Unlike Message::deadline this is passed up to the user code.
+         */
+        static const int expired = std::numeric_limits<int>::min()+1;
+
+        //! What the offloaded work has been up to
+        struct Metrics
+        {
+            //! Work that ran and had its result delivered
+            unsigned long long completed;
+
+            //! Work turned away because the queue was full
+            unsigned long long rejected;
+
+            //! Work that timed out queued or running
+            unsigned long long timedOut;
+
+            //! Work skipped because its request was gone
+            unsigned long long cancelled;
+
+            //! Total time work waited in the queue
+            Clock::duration waited;
+
+            //! Longest time work waited in the queue
+            Clock::duration longest;
+
+            //! Total time work ran for
+            Clock::duration ran;
+
+            //! Work waiting in the queue now
+            size_t queued;
+        };
+
+        //! Sole constructor
+        /*!
+         * @param[in] timers Timers the timeout messages are armed in
+         */
+        Offload(Timers& timers);
+
+        ~Offload();
+
+        //! Set the threads, queue limit and default timeout
+        /*!
+         * If the threads are already running this will do nothing.
+         *
+         * @param[in] threads Number of threads to run work in. Zero disables
+         *                    offloading.
+         * @param[in] queue Most work waiting in the queue beyond what idle
+         *                  threads are about to pick up. Zero for no limit.
+         * @param[in] timeout Timeout for work that isn't given one. Zero for
+         *                    none.
+         */
+        void configure(
+                unsigned threads,
+                size_t queue,
+                Clock::duration timeout);
+
+        //! Queue work
+        /*!
+         * @param[in] work The work. Its return value is the result.
+         * @param[in] deliver Function to deliver the result with
+         * @param[in] timer Timer for the timeout message. Invalid if the work
+         *                  has no timeout. It is cancelled should the result
+         *                  be delivered.
+         * @param[in] cancellation Token cancelled should the work no longer
+         *                         be wanted. Can be null.
+         * @return False if the queue is full or offloading is disabled.
+         */
+        bool run(
+                std::function<Message()>&& work,
+                const std::function<void(Message)>& deliver,
+                Timers::Id timer,
+                const std::shared_ptr<Cancellation>& cancellation);
+
+        //! Start the threads
+        void start();
+
+        //! Tell the threads to stop once their current work is done
+        void terminate();
+
+        //! Wait for the threads to stop and drop any work left queued
+        void join();
+
+        //! True if work can be offloaded
+        bool enabled() const
+        {
+            return m_size != 0;
+        }
+
+        //! Timeout for work that isn't given one
+        Clock::duration timeout() const
+        {
+            return m_timeout;
+        }
+
+        //! What the offloaded work has been up to
+        Metrics metrics() const;
+
+    private:
+        //! A piece of queued work
+        struct Task
+        {
+            //! The work
+            std::function<Message()> work;
+
+            //! Function to deliver the result with
+            std::function<void(Message)> deliver;
+
+            //! Timer for the timeout message
+            Timers::Id timer;
+
+            //! Token cancelled should the work no longer be wanted
+            std::shared_ptr<Cancellation> cancellation;
+
+            //! When it was queued
+            Clock::time_point queued;
+        };
+
+        //! Timers the timeout messages are armed in
+        Timers& m_timers;
+
+        //! Number of threads to run work in
+        unsigned m_size;
+
+        //! Most work waiting in the queue. Zero for no limit.
+        size_t m_limit;
+
+        //! Timeout for work that isn't given one
+        Clock::duration m_timeout;
+
+        //! Work waiting to run
+        std::queue<Task> m_tasks;
+
+        //! The threads
+        std::vector<std::thread> m_threads;
+
+        //! True when the threads should stop
+        bool m_terminate;
+
+        //! Threads not running any work
+        size_t m_idle;
+
+        //! Thread safe our work
+        mutable std::mutex m_mutex;
+
+        //! Wakes the threads up
+        std::condition_variable m_wake;
+
+        //! Work that ran and had its result delivered
+        std::atomic_ullong m_completed;
+
+        //! Work turned away because the queue was full
+        std::atomic_ullong m_rejected;
+
+        //! Work that timed out queued or running
+        std::atomic_ullong m_timedOut;
+
+        //! Work skipped because its request was gone
+        std::atomic_ullong m_cancelled;
+
+        //! Total time work waited in the queue
+        std::atomic<Clock::duration::rep> m_waited;
+
+        //! Longest time work waited in the queue
+        std::atomic<Clock::duration::rep> m_longest;
+
+        //! Total time work ran for
+        std::atomic<Clock::duration::rep> m_ran;
+
+        //! Run work until told to stop
+        void handler();
+    };
+}
+
+#endif
@@ -72,11 +72,28 @@ namespace Fastcgipp
 
     public:
         //! Add a socket identifier to the poll list
-        bool add(const socket_t socket);
+        /*!
+         * @param[in] socket Socket to poll
+         * @param[in] exclusive Set to true if other processes are polling the
+         *                      same socket and only one of them should be
+         *                      woken for each event. Only input, errors and
+         *                      hang ups are polled for in this case.
+         */
+        bool add(const socket_t socket, bool exclusive=false);
 
         //! Remove a socket identifier to the poll list
         bool del(const socket_t socket);
 
+        //! Start or stop polling a socket for incoming data
+        /*!
+         * While stopped, the socket remains in the poll list but only errors
+         * and hang ups are reported for it.
+         *
+         * @param [in] socket Socket to modify
+         * @param [in] status True to poll for incoming data. False otherwise.
+         */
+        bool pollIn(const socket_t socket, bool status);
+
         //! Type returned from a poll request
         class Result
         {
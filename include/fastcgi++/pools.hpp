@@ -0,0 +1,233 @@
+/*!
+ * @file       pools.hpp
+ * @brief      Declares the Fastcgipp::Pools class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_POOLS_HPP
+#define FASTCGIPP_POOLS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Named pools of threads that requests are handled in
+    /*!
+     * These bulkhead requests from one another. Requests are classified into
+     * a pool once their parameters have arrived and from then on are only
+     * handled by that pool's threads. A burst of slow requests in one pool
+     * can then only exhaust that pool's threads and queue.
+     *
+     * This holds the configuration of the pools along with their metrics.
+     * The Manager owns the threads and queues themselves. Pool 0 is the
+     * default pool. It has an empty name and every request starts out in it.
+     *
+     * Pools are configured before the Manager is started. Everything else is
+     * thread safe.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Pools
+    {
+    public:
+        //! Clock used to measure queue wait
+        typedef std::chrono::steady_clock Clock;
+
+        //! Queue wait and other metrics of a pool
+        struct Metrics
+        {
+            //! Tasks taken off the queue
+            unsigned long long tasks;
+
+            //! Total time tasks waited in the queue
+            Clock::duration waited;
+
+            //! Longest time a task waited in the queue
+            Clock::duration longest;
+
+            //! Tasks in the queue right now
+            size_t queued;
+
+            //! Requests rejected because the queue was full
+            unsigned long long rejected;
+        };
+
+        Pools();
+
+        //! Add a pool or change an existing one
+        /*!
+         * @param[in] name Name of the pool. Empty for the default pool.
+         * @param[in] limit Requests are rejected from the pool while this
+         *                  many tasks are waiting in its queue. Zero for no
+         *                  limit.
+         * @param[in] priority Idle threads of lower priority pools can take
+         *                     tasks from this one if stealing is enabled.
+         * @return Index of the pool
+         */
+        unsigned add(const std::string& name, size_t limit, int priority);
+
+        //! Classify requests whose path starts with a prefix into a pool
+        /*!
+         * The path is the script name followed by the path info. Where
+         * prefixes overlap the longest one wins.
+         *
+         * @param[in] prefix Prefix of the path
+         * @param[in] pool Name of a pool given to add()
+         */
+        void classify(const std::string& prefix, const std::string& pool);
+
+        //! Index of a pool by name. The default pool if there is none.
+        unsigned find(const std::string& name) const;
+
+        //! Name of the pool a path is classified into
+        template<class charT>
+        const std::string& match(const std::basic_string<charT>& path) const
+        {
+            const Rule* best = nullptr;
+            for(const auto& rule: m_rules)
+                if(rule.prefix.size() <= path.size()
+                        && (!best || rule.prefix.size() > best->prefix.size())
+                        && std::equal(
+                            rule.prefix.cbegin(),
+                            rule.prefix.cend(),
+                            path.cbegin(),
+                            [] (char x, charT y)
+                            {
+                                return charT(static_cast<unsigned char>(x))
+                                    == y;
+                            }))
+                    best = &rule;
+            return m_pools[best?best->pool:0].name;
+        }
+
+        //! Amount of pools including the default one
+        unsigned size() const
+        {
+            return m_pools.size();
+        }
+
+        //! Name of a pool
+        const std::string& name(unsigned pool) const
+        {
+            return m_pools[pool].name;
+        }
+
+        //! Priority of a pool
+        int priority(unsigned pool) const
+        {
+            return m_pools[pool].priority;
+        }
+
+        //! Is there room in a pool's queue for another request?
+        /*!
+         * Should there not be the rejection is counted.
+         */
+        bool admit(unsigned pool);
+
+        //! Account for a task being put in a pool's queue
+        void queued(unsigned pool)
+        {
+            ++m_pools[pool].queued;
+        }
+
+        //! Account for a task being taken off a pool's queue
+        /*!
+         * @param[in] pool The pool
+         * @param[in] waited How long the task waited in the queue
+         */
+        void dequeued(unsigned pool, Clock::duration waited);
+
+        //! Metrics of a pool
+        Metrics metrics(unsigned pool) const;
+
+        //! Metrics of a pool by name
+        Metrics metrics(const std::string& name) const
+        {
+            return metrics(find(name));
+        }
+
+    private:
+        //! A single pool
+        struct Pool
+        {
+            //! Name of the pool
+            const std::string name;
+
+            //! Queue limit. Zero for none.
+            size_t limit;
+
+            //! Idle lower priority threads can take tasks from this pool
+            int priority;
+
+            //! Tasks taken off the queue
+            std::atomic_ullong tasks;
+
+            //! Total time tasks waited in the queue
+            std::atomic<Clock::rep> waited;
+
+            //! Longest time a task waited in the queue
+            std::atomic<Clock::rep> longest;
+
+            //! Tasks in the queue right now
+            std::atomic<size_t> queued;
+
+            //! Requests rejected because the queue was full
+            std::atomic_ullong rejected;
+
+            Pool(const std::string& name_, size_t limit_, int priority_):
+                name(name_),
+                limit(limit_),
+                priority(priority_),
+                tasks(0),
+                waited(0),
+                longest(0),
+                queued(0),
+                rejected(0)
+            {}
+        };
+
+        //! The pools indexed as the Manager does its queues
+        std::deque<Pool> m_pools;
+
+        //! Classifies paths starting with a prefix into a pool
+        struct Rule
+        {
+            std::string prefix;
+            unsigned pool;
+        };
+
+        //! Prefixes to classify paths by
+        std::vector<Rule> m_rules;
+    };
+}
+
+#endif
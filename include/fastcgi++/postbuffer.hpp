@@ -0,0 +1,244 @@
+/*!
+ * @file       postbuffer.hpp
+ * @brief      Declares the Fastcgipp::PostBuffer class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+#ifndef FASTCGIPP_POSTBUFFER_HPP
+#define FASTCGIPP_POSTBUFFER_HPP
+
+#include <deque>
+#include <iterator>
+#include <streambuf>
+
+#include "fastcgi++/block.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Raw post data held as a chain of received blocks
+    /*!
+     * Post data arrives in FastCGI IN records that are each received into
+     * their own Block. Rather than copying every record body into one
+     * contiguous buffer, this class takes ownership of the blocks and
+     * presents the bodies as a single sequence of bytes. Read it with the
+     * iterators, chunk by chunk with chunks(), or as a stream through
+     * Streambuf.
+     *
+     * A contiguous copy of the data is only ever made if data() is called and
+     * the data spans more than one chunk.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class PostBuffer
+    {
+    public:
+        //! A piece of post data along with the block that owns it
+        struct Chunk
+        {
+            //! %Block the data is stored in
+            Block block;
+
+            //! First byte of post data in the block
+            const char* begin;
+
+            //! 1+ the last byte of post data in the block
+            const char* end;
+
+            Chunk(Block&& block_, const char* begin_, const char* end_):
+                block(std::move(block_)),
+                begin(begin_),
+                end(end_)
+            {}
+        };
+
+        //! Container type of the chunks
+        typedef std::deque<Chunk> Chunks;
+
+        //! Constant iterator over every byte of post data
+        class const_iterator
+        {
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef char value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const char* pointer;
+            typedef const char& reference;
+
+            reference operator*() const
+            {
+                return *m_byte;
+            }
+
+            pointer operator->() const
+            {
+                return m_byte;
+            }
+
+            const_iterator& operator++()
+            {
+                if(++m_byte == m_chunk->end)
+                    m_byte = ++m_chunk==m_chunksEnd?nullptr:m_chunk->begin;
+                return *this;
+            }
+
+            const_iterator operator++(int)
+            {
+                const_iterator previous(*this);
+                ++*this;
+                return previous;
+            }
+
+            bool operator==(const const_iterator& x) const
+            {
+                return m_byte == x.m_byte;
+            }
+
+            bool operator!=(const const_iterator& x) const
+            {
+                return m_byte != x.m_byte;
+            }
+
+            const_iterator():
+                m_byte(nullptr)
+            {}
+
+        private:
+            //! The chunk we are currently in
+            Chunks::const_iterator m_chunk;
+
+            //! 1+ the last chunk
+            Chunks::const_iterator m_chunksEnd;
+
+            //! The byte we are pointing to. nullptr if at the end.
+            const char* m_byte;
+
+            const_iterator(
+                    Chunks::const_iterator chunk,
+                    Chunks::const_iterator chunksEnd):
+                m_chunk(chunk),
+                m_chunksEnd(chunksEnd),
+                m_byte(chunk==chunksEnd?nullptr:chunk->begin)
+            {}
+
+            friend class PostBuffer;
+        };
+
+        //! Input stream buffer for reading post data
+        /*!
+         * The get area is pointed at each chunk in turn so no data is
+         * copied. The PostBuffer must not be modified while this is in use.
+         */
+        class Streambuf: public std::streambuf
+        {
+        public:
+            Streambuf(const PostBuffer& buffer);
+
+        protected:
+            //! Move the get area to the next chunk
+            int_type underflow();
+
+            //! Bytes left in the post data
+            std::streamsize showmanyc();
+
+        private:
+            //! The post data we are reading
+            const PostBuffer& m_buffer;
+
+            //! The chunk the get area is currently pointing to
+            Chunks::const_iterator m_chunk;
+        };
+
+        //! Take ownership of a block containing post data
+        /*!
+         * @param[in] block %Block to take ownership of
+         * @param[in] begin First byte of post data in the block
+         * @param[in] end 1+ the last byte of post data in the block
+         */
+        void append(Block&& block, const char* begin, const char* end);
+
+        //! Copy post data into a new block
+        /*!
+         * @param[in] begin First byte of post data
+         * @param[in] end 1+ the last byte of post data
+         */
+        void append(const char* begin, const char* end);
+
+        //! Total bytes of post data
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        //! True if there is no post data
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        //! The chunks that make up the post data
+        const Chunks& chunks() const
+        {
+            return m_chunks;
+        }
+
+        //! Iterator to the first byte of post data
+        const_iterator begin() const
+        {
+            return const_iterator(m_chunks.cbegin(), m_chunks.cend());
+        }
+
+        //! Iterator to 1+ the last byte of post data
+        const_iterator end() const
+        {
+            return const_iterator();
+        }
+
+        //! Get a contiguous view of the post data
+        /*!
+         * If the post data is spread over multiple chunks, they are
+         * consolidated into one. This invalidates iterators.
+         *
+         * @return Pointer to the first byte of post data. nullptr if empty.
+         */
+        const char* data() const;
+
+        //! Release all post data
+        void clear();
+
+        PostBuffer():
+            m_size(0)
+        {}
+
+    private:
+        //! The chunks of post data
+        mutable Chunks m_chunks;
+
+        //! Total bytes of post data
+        size_t m_size;
+    };
+}
+
+#endif
@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <map>
 #include <vector>
+#include <string>
 
 #include "fastcgi++/message.hpp"
 #include "fastcgi++/sockets.hpp"
@@ -403,11 +404,16 @@ namespace Fastcgipp
          */
         size_t getRecordSize(size_t contentLength);
 
-        //! The maximum allowed file descriptors open at a time
-        extern const ManagementReply<14, 2> maxConnsReply;
-
-        //! The maximum allowed requests at a time
-        extern const ManagementReply<13, 2> maxReqsReply;
+        //! Build a management reply record with a value only known at runtime
+        /*!
+         * This is what FCGI_MAX_CONNS and FCGI_MAX_REQS are answered with
+         * since they depend on how the Manager is configured.
+         *
+         * @param[in] name Name of the variable. Must be under 128 bytes.
+         * @param[in] value Value of the variable. Must be under 128 bytes.
+         * @return The complete GET_VALUES_RESULT record
+         */
+        Block managementReply(const std::string& name, const std::string& value);
 
         //! Where or not requests can be multiplexed over a single connections
         extern const ManagementReply<15, 1> mpxsConnsReply;
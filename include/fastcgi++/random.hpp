@@ -0,0 +1,83 @@
+/*!
+ * @file       random.hpp
+ * @brief      Declares the Fastcgipp::Random class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_RANDOM_HPP
+#define FASTCGIPP_RANDOM_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Cryptographically secure random bytes
+    /*!
+     * Each thread has its own ChaCha20 generator keyed from getrandom(). The
+     * keystream is produced a buffer at a time and handed out from there so
+     * most calls don't involve a system call or any locking. After every
+     * buffer the generator is rekeyed from its own keystream so earlier
+     * output can't be recovered should the state leak. It is reseeded from
+     * getrandom() periodically and whenever the process has forked.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Random
+    {
+    public:
+        //! Fill a buffer with random bytes
+        /*!
+         * @param[out] data Buffer to fill
+         * @param[in] size Size of the buffer in bytes
+         */
+        static void fill(unsigned char* data, size_t size);
+
+        //! The ChaCha20 block function
+        /*!
+         * As defined in RFC 8439.
+         *
+         * @param[in] key 256 bit key
+         * @param[in] counter %Block counter
+         * @param[in] nonce 96 bit nonce
+         * @param[out] output 64 bytes of keystream
+         */
+        static void chacha20(
+                const uint32_t key[8],
+                uint32_t counter,
+                const uint32_t nonce[3],
+                unsigned char output[64]);
+
+        //! Bytes of keystream buffered at a time
+        static const size_t s_bufferSize = 1024;
+
+        //! Bytes of output before reseeding from the kernel
+        static const size_t s_reseedInterval = 1048576;
+    };
+}
+
+#endif
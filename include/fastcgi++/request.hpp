@@ -32,11 +32,24 @@
 #include "fastcgi++/protocol.hpp"
 #include "fastcgi++/fcgistreambuf.hpp"
 #include "fastcgi++/http.hpp"
-
+#include "fastcgi++/responsecache.hpp"
+#include "fastcgi++/flight.hpp"
+#include "fastcgi++/timers.hpp"
+#include "fastcgi++/cancellation.hpp"
+#include "fastcgi++/pools.hpp"
+#include "fastcgi++/router.hpp"
+#include "fastcgi++/offload.hpp"
+
+#include <atomic>
+#include <memory>
 #include <ostream>
+#include <istream>
+#include <streambuf>
+#include <deque>
 #include <functional>
 #include <queue>
 #include <mutex>
+#include <vector>
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -59,24 +72,419 @@ namespace Fastcgipp
          */
         virtual std::unique_lock<std::mutex> handler() =0;
 
-        virtual ~Request_base() {}
+        virtual ~Request_base();
 
         //! Only one thread is allowed to handle the request at a time
         std::mutex mutex;
 
         //! Send a message to the request
-        inline void push(Message&& message)
+        /*!
+         * The body sizes of IN records are tallied here. Should the amount of
+         * received but unconsumed post data exceed the watermark, receiving
+         * on the socket is throttled until enough of it is consumed.
+         */
+        void push(Message&& message);
+
+        //! Allow the response to be stored in a cache
+        /*!
+         * This is called by the Manager for requests that missed the cache.
+         *
+         * @param[in] cache Cache to store the response in
+         * @param[in] key Key to store the response under
+         */
+        void cacheable(ResponseCache& cache, std::string&& key)
+        {
+            m_cache = &cache;
+            m_cacheKey = std::move(key);
+        }
+
+        //! Make this request the leader of a flight
+        /*!
+         * This is called by the Manager when coalescing requests. Everything
+         * sent is relayed to the flight's followers.
+         *
+         * @param[in] flight The flight to lead
+         */
+        void lead(const std::shared_ptr<Flight>& flight)
+        {
+            m_flight = flight;
+        }
+
+        //! Set the timers to deliver delayed messages with
+        /*!
+         * This is called by the Manager when building the request.
+         *
+         * @param[in] timers Timers to use for Request::after()
+         */
+        void timers(Timers& timers)
+        {
+            m_timers = &timers;
+        }
+
+        //! Set the pools the request can be classified into
+        /*!
+         * This is called by the Manager when building the request.
+         *
+         * @param[in] pools Pools to classify the request into
+         */
+        void pools(Pools& pools)
         {
-            std::lock_guard<std::mutex> lock(m_messagesMutex);
-            m_messages.push(std::move(message));
+            m_pools = &pools;
         }
 
+        //! Index of the pool the request is handled in
+        unsigned pool() const
+        {
+            return m_pool;
+        }
+
+        //! Set the router the request was built by
+        /*!
+         * This is called by the Manager when building the request for a
+         * route. The parameters are captured against it once the environment
+         * is complete.
+         *
+         * @param[in] router Router the request was built by
+         */
+        void router(const Router& router)
+        {
+            m_router = &router;
+        }
+
+        //! Release the stream buffers of idle requests
+        /*!
+         * This is called by the Manager when building the request. Should
+         * response() return false with nothing left buffered in the out and
+         * err streams, their buffers are released until something is
+         * written again.
+         *
+         * @param[in] status True to release them
+         * @sa Manager_base::hibernate()
+         */
+        void hibernate(bool status)
+        {
+            m_hibernate = status;
+        }
+
+        //! Set the pool blocking work is deferred to
+        /*!
+         * This is called by the Manager when building the request.
+         *
+         * @param[in] offload Pool to use for Request::defer()
+         */
+        void offload(Offload& offload)
+        {
+            m_offload = &offload;
+        }
+
+        //! Enforce deadlines on the request
+        /*!
+         * This is called by the Manager when building the request, after
+         * timers(). Once a deadline passes the request is ended through
+         * Request::timeoutHandler().
+         *
+         * @param[in] id ID of the request
+         * @param[in] deadlines Deadlines to enforce. The idle one is ignored.
+         * @param[in] timedOut Counters to increment when a deadline passes.
+         *                     Indexed by Deadline.
+         * @param[in] begun When the BEGIN_REQUEST record arrived
+         */
+        void deadlines(
+                const Protocol::RequestId& id,
+                const Deadlines& deadlines,
+                std::atomic_ullong* timedOut,
+                Timers::Clock::time_point begun);
+
+        //! Build the message telling a request a deadline has passed
+        static Message expiry(Deadline deadline);
+
     protected:
+        //! Initialize the flow control
+        /*!
+         * @param inWatermark Amount of buffered post data, in bytes, above
+         *                    which we stop receiving on the socket.
+         */
+        Request_base(const size_t inWatermark):
+            m_callbackDeadline(0),
+            m_pools(nullptr),
+            m_pool(0),
+            m_router(nullptr),
+            m_offload(nullptr),
+            m_hibernate(false),
+            m_buffered(0),
+            m_watermark(inWatermark),
+            m_throttled(false),
+            m_cache(nullptr),
+            m_caching(false),
+            m_sent(false),
+            m_timers(nullptr),
+            m_timerPrune(16),
+            m_timedOut(nullptr),
+            m_finished(false)
+        {
+            for(auto& due: m_due)
+                due = Timers::Clock::time_point::max();
+        }
+
+        //! Schedule a delayed message for a request
+        /*!
+         * The timer is cancelled if the request is destroyed before it's due.
+         *
+         * @param[in] delay How long to wait
+         * @param[in] id The request to deliver the message to
+         * @param[in] message Message to deliver
+         * @return Identifier for cancelling the timer. Invalid if there are
+         *         no timers.
+         */
+        Timers::Id schedule(
+                Timers::Clock::duration delay,
+                const Protocol::RequestId& id,
+                Message&& message);
+
+        //! Cancel a delayed message
+        /*!
+         * @param[in] id Timer to cancel
+         * @return True if the timer was pending and is now cancelled.
+         */
+        bool cancel(Timers::Id id);
+
+        //! Arm a deadline
+        /*!
+         * Should the deadline already be armed it is replaced.
+         *
+         * @param[in] id ID of the request
+         * @param[in] deadline Which deadline
+         * @param[in] due When it passes
+         */
+        void arm(
+                const Protocol::RequestId& id,
+                Deadline deadline,
+                Timers::Clock::time_point due);
+
+        //! Disarm a deadline if it is armed
+        void disarm(Deadline deadline)
+        {
+            if(m_deadlineTimers[static_cast<unsigned>(deadline)].valid())
+                unarm(deadline);
+        }
+
+        //! Check a deadline message
+        /*!
+         * Messages for deadlines that were since disarmed or pushed back
+         * are stale. If it isn't stale the expiry is counted and the response
+         * won't be cached.
+         *
+         * @param[in] message A message of type Message::deadline
+         * @return True if the deadline has really passed.
+         */
+        bool expired(const Message& message);
+
+        //! Longest to wait on a callback message. Zero for no limit.
+        Timers::Clock::duration m_callbackDeadline;
+
+        //! Token for abandoning work queued on our behalf
+        /*!
+         * Attach this to SQL queries and Curl transfers. It is cancelled
+         * should the request be destroyed before response() finishes it.
+         *
+         * @sa Cancellation
+         */
+        const std::shared_ptr<Cancellation>& cancellation()
+        {
+            if(!m_cancellation)
+                m_cancellation = std::make_shared<Cancellation>();
+            return m_cancellation;
+        }
+
+        //! Note that response() has finished the request
+        void finish()
+        {
+            m_finished = true;
+        }
+
+        //! Pools the request can be classified into. nullptr if none.
+        Pools* m_pools;
+
+        //! Index of the pool the request is handled in
+        std::atomic_uint m_pool;
+
+        //! Router the request was built by. nullptr if none.
+        const Router* m_router;
+
+        //! Pool blocking work is deferred to. nullptr if none.
+        Offload* m_offload;
+
+        //! True if the stream buffers are released while idle
+        bool m_hibernate;
+
+        //! Cache the response
+        /*!
+         * Subsequent identical requests will be answered straight from the
+         * cache by the Manager until the time to live runs out. This only
+         * works for GET and HEAD requests when the Manager's cache is enabled
+         * and must be called before any output is flushed.
+         *
+         * @param[in] ttl How long the response can be served from the cache
+         * @return True if the response will be cached
+         */
+        bool cache(ResponseCache::Duration ttl);
+
+        //! Note that data has been sent to the client
+        /*!
+         * A copy is kept if the response is being cached and it is relayed to
+         * any followers.
+         *
+         * @param[in] data Complete records being sent
+         * @param[in] last True if this ends the response
+         */
+        void sent(const Block& data, bool last);
+
+        //! Store the response in the cache if it is being cached
+        void store();
+
+        //! True if the response is shared with other clients
+        /*!
+         * That is, it is being cached or relayed to coalesced requests.
+         */
+        bool shared() const
+        {
+            return m_caching || m_flight;
+        }
+
         //! A queue of message for the request
         std::queue<Message> m_messages;
 
         //! Thread safe our message queue
         std::mutex m_messagesMutex;
+
+        //! Function to throttle (true) or resume (false) our socket
+        std::function<void(bool)> m_throttle;
+
+        //! Mark buffered post data as consumed
+        /*!
+         * Receiving on the socket is resumed once the amount of buffered post
+         * data drops to half the watermark.
+         *
+         * @param[in] bytes Amount of post data consumed
+         */
+        void consumed(size_t bytes);
+
+        //! Resume receiving on the socket if we have throttled it
+        void unthrottle();
+
+        //! Input stream buffer for streamed post data
+        /*!
+         * The get area is pointed directly at the received records so no data
+         * is copied. Records are released and marked consumed as soon as they
+         * have been read through.
+         */
+        class InStreambuf: public std::streambuf
+        {
+        public:
+            InStreambuf(Request_base& request):
+                m_request(request),
+                m_loaded(false),
+                m_received(0)
+            {}
+
+            //! Add a received block of post data
+            /*!
+             * @param[in] block %Block containing the post data
+             * @param[in] begin First byte of post data in the block
+             * @param[in] end 1+ the last byte of post data in the block
+             */
+            void append(Block&& block, const char* begin, const char* end);
+
+            //! Total bytes of post data appended
+            size_t received() const
+            {
+                return m_received;
+            }
+
+        protected:
+            //! Move the get area to the next record
+            int_type underflow();
+
+            //! Bytes left in the received records
+            std::streamsize showmanyc();
+
+        private:
+            //! Request to report consumption to
+            Request_base& m_request;
+
+            //! Received records not yet fully read
+            std::deque<PostBuffer::Chunk> m_chunks;
+
+            //! True if the get area points to the front chunk
+            bool m_loaded;
+
+            //! Total bytes of post data appended
+            size_t m_received;
+        };
+
+    private:
+        //! Bytes of post data received but not consumed
+        size_t m_buffered;
+
+        //! Throttle the socket above this many buffered bytes
+        const size_t m_watermark;
+
+        //! True if we have throttled the socket
+        bool m_throttled;
+
+        //! Cache to store the response in. nullptr if not cacheable.
+        ResponseCache* m_cache;
+
+        //! Key to store the response under
+        std::string m_cacheKey;
+
+        //! How long the cached response is fresh for
+        ResponseCache::Duration m_cacheTtl;
+
+        //! Copy of the response being cached
+        Block m_cached;
+
+        //! True if the response is being cached
+        bool m_caching;
+
+        //! True once anything has been sent
+        bool m_sent;
+
+        //! Flight we are leading if any
+        std::shared_ptr<Flight> m_flight;
+
+        //! Timers for delayed messages. nullptr if there are none.
+        Timers* m_timers;
+
+        //! Timers we've scheduled that might still be pending
+        std::vector<Timers::Id> m_scheduled;
+
+        //! Prune fired timers out of m_scheduled once it reaches this size
+        size_t m_timerPrune;
+
+        //! Amount of deadlines a request can have
+        static const unsigned s_deadlines = 3;
+
+        //! When each deadline passes. Indexed by Deadline.
+        /*!
+         * Timers::Clock::time_point::max() if it isn't armed.
+         */
+        Timers::Clock::time_point m_due[s_deadlines];
+
+        //! Timer for each armed deadline. Indexed by Deadline.
+        Timers::Id m_deadlineTimers[s_deadlines];
+
+        //! Counters to increment when a deadline passes
+        std::atomic_ullong* m_timedOut;
+
+        //! Disarm an armed deadline
+        void unarm(Deadline deadline);
+
+        //! Token for abandoning work. nullptr until asked for.
+        std::shared_ptr<Cancellation> m_cancellation;
+
+        //! True once response() has finished the request
+        bool m_finished;
     };
 
     //! %Request handling class
@@ -110,16 +518,30 @@ namespace Fastcgipp
          *                    limit as large as possible, pass either
          *                    (size_t)-1, std::string::npos or
          *                    std::numeric_limits<size_t>::max().
+         * @param spoolThreshold Uploaded files larger than this, in bytes, are
+         *                       spooled out of memory into an anonymous file.
+         *                       See Http::Environment::spoolThreshold().
+         * @param inWatermark Should more than this many bytes of post data be
+         *                    received but not yet consumed by the request, we
+         *                    stop receiving on the socket until it is.
          */
-        Request(const size_t maxPostSize=0):
+        Request(
+                const size_t maxPostSize=0,
+                const size_t spoolThreshold=1048576,
+                const size_t inWatermark=262144):
+            Request_base(inWatermark),
             out(&m_outStreamBuffer),
             err(&m_errStreamBuffer),
+            in(&m_inStreamBuffer),
             m_maxPostSize(maxPostSize),
             m_state(Protocol::RecordType::PARAMS),
-            m_status(Protocol::ProtocolStatus::REQUEST_COMPLETE)
+            m_status(Protocol::ProtocolStatus::REQUEST_COMPLETE),
+            m_inStreamBuffer(*this),
+            m_streaming(false)
         {
             out.imbue(std::locale("C"));
             err.imbue(std::locale("C"));
+            m_environment.spoolThreshold(spoolThreshold);
         }
 
         //! Configures the request with the data it needs.
@@ -135,6 +557,8 @@ namespace Fastcgipp
          * @param[in] send Function for sending data out of the stream buffers
          * @param[in] callback Callback function capable of passing messages to
          *                     the request
+         * @param[in] throttle Function to stop (true) or resume (false)
+         *                     receiving on a socket
          */
         void configure(
                 const Protocol::RequestId& id,
@@ -142,7 +566,8 @@ namespace Fastcgipp
                 bool kill,
                 const std::function<void(const Socket&, Block&&, bool)>
                     send,
-                const std::function<void(Message)> callback);
+                const std::function<void(Message)> callback,
+                const std::function<void(const Socket&, bool)> throttle);
 
         std::unique_lock<std::mutex> handler();
 
@@ -167,6 +592,13 @@ namespace Fastcgipp
         //! Output stream to the HTTP server error log
         std::basic_ostream<charT> err;
 
+        //! Input stream of raw post data
+        /*!
+         * This is only used if streamPost() returns true. It reads the raw
+         * post data bytes as they are received, regardless of charT.
+         */
+        std::istream in;
+
         //! Called when a processing error occurs
         /*!
          * This function is called whenever a processing error happens inside
@@ -192,6 +624,55 @@ namespace Fastcgipp
          */
         virtual void unknownContentErrorHandler();
 
+        //! Called when a deadline passes
+        /*!
+         * This function is called when the request has taken too long. By
+         * default it will send a standard 408 Request Timeout message to the
+         * user if the parameters didn't arrive in time and a 504 Gateway
+         * Timeout message otherwise. Override for more specialized purposes.
+         * The request is ended as soon as this returns.
+         *
+         * @param[in] deadline The deadline that passed
+         * @sa Manager_base::deadlines()
+         */
+        virtual void timeoutHandler(Deadline deadline);
+
+        //! Called when the pool a request is classified into is full
+        /*!
+         * By default it will send a standard 503 Service Unavailable message
+         * to the user. Override for more specialized purposes. The request is
+         * ended as soon as this returns.
+         *
+         * @sa Manager_base::pool()
+         */
+        virtual void unavailableHandler();
+
+        //! Choose the pool to handle the request in
+        /*!
+         * This is called once the environment is complete. Until then the
+         * request is handled in the default pool. By default the script name
+         * followed by the path info is matched against the prefixes given to
+         * Manager_base::classify(). Override to classify requests any other
+         * way.
+         *
+         * @return Name of a pool given to Manager_base::pool(). An empty or
+         *         unknown name means the default pool.
+         */
+        virtual std::string classify() const;
+
+        //! Parameters captured by the route the request was built for
+        /*!
+         * These are available once the environment is complete. They are
+         * views into environment().requestUri, or environment().scriptName
+         * if there is no request URI, and are not percent decoded.
+         *
+         * @sa Manager::route()
+         */
+        const Router::Parameters<charT>& parameters() const
+        {
+            return m_parameters;
+        }
+
         //! See the requests role
         Protocol::Role role() const
         {
@@ -216,6 +697,48 @@ namespace Fastcgipp
             return m_callback;
         }
 
+        //! Have a message delivered to us after a delay
+        /*!
+         * The message arrives through response() just as if it were passed
+         * to callback(). Should the request be destroyed first, the timer is
+         * cancelled.
+         *
+         * @param[in] delay How long to wait. The message is never early but
+         *                  may be late by up to Timers::resolution.
+         * @param[in] message Message to deliver
+         * @return Identifier for cancelling the timer with cancel(). Invalid
+         *         if the request wasn't built by a Manager.
+         */
+        Timers::Id after(Timers::Clock::duration delay, Message&& message)
+        {
+            return schedule(delay, m_id, std::move(message));
+        }
+
+        //! Run blocking work away from the Manager's threads
+        /*!
+         * The work runs in the Manager's offload pool and its return value
+         * arrives through response() just as if it were passed to
+         * callback(). Should the timeout pass first, \p expired arrives
+         * instead and the result is dropped. Work is skipped should the
+         * request be destroyed before it runs.
+         *
+         * The work must not touch the request as it runs concurrently with
+         * it. Capture what it needs by value.
+         *
+         * @param[in] work The work. Its return value is the result.
+         * @param[in] expired Message to deliver should the work time out
+         * @param[in] timeout Timeout for the work. Zero for the default
+         *                    given to Manager_base::offload().
+         * @return False if the offload queue is full or there is no offload
+         *         pool. Nothing will arrive.
+         * @sa Offload
+         */
+        bool defer(
+                std::function<Message()>&& work,
+                Message&& expired=Message(Offload::expired),
+                Timers::Clock::duration timeout
+                    =Timers::Clock::duration::zero());
+
         //! Response generator
         /*!
          * This function is called by handler() once all request data has been
@@ -252,13 +775,17 @@ namespace Fastcgipp
          * Override this function should you wish to process non-standard post
          * data. The library will on it's own process post data of the types
          * "multipart/form-data" and "application/x-www-form-urlencoded". To
-         * use this function, your raw post data is fully assembled in
+         * use this function, your raw post data is fully received into
          * environment().postBuffer() and the type string is stored in
          * environment().contentType. Should the content type be what you're
          * looking for and you've processed it, simply return true. Otherwise
          * return false.  Do not worry about freeing the data in the post
          * buffer. Should you return false, the system will try to internally
-         * process it.
+         * process it. The post buffer is a chain of the received records so
+         * read it through its iterators, chunks or PostBuffer::Streambuf to
+         * avoid copying it. Note that "multipart/form-data" post data is parsed
+         * incrementally as it arrives and is never assembled in the post
+         * buffer.
          *
          * @return Return true if you've processed the data.
          */
@@ -267,6 +794,29 @@ namespace Fastcgipp
             return false;
         }
 
+        //! Should post data be streamed through the in stream?
+        /*!
+         * Override this function should you wish to read the post data
+         * yourself as it arrives rather than have it collected into
+         * environment(). It is called once all the environment data has been
+         * received so the decision can be based on it. If true, the post data
+         * is only available through the in stream and none of
+         * inProcessor(), environment().postBuffer(), environment().posts or
+         * environment().files are used.
+         *
+         * Received post data counts against the watermark passed to the
+         * constructor until it is read out of the in stream. Once the
+         * watermark is exceeded we stop receiving on the socket so you must
+         * read from the stream in inHandler() for the data to keep flowing.
+         * Reading it returns EOF when no more data is available <em>yet</em>.
+         *
+         * @return Return true to stream post data.
+         */
+        virtual bool streamPost()
+        {
+            return false;
+        }
+
         //! The message associated with the current handler() call.
         /*!
          * This is only of use to the library user when a non FastCGI (type=0)
@@ -319,6 +869,62 @@ namespace Fastcgipp
             m_outStreamBuffer.dump(stream);
         }
 
+        //! Set the size of the out stream buffer
+        /*!
+         * Each time the buffer fills, its contents are sent as a single
+         * FastCGI record so larger buffers mean fewer records for large
+         * responses. The default is 8192 and the maximum is 65535.
+         *
+         * @param[in] size Size of the buffer in characters
+         */
+        void outBufferSize(size_t size)
+        {
+            m_outStreamBuffer.bufferSize(size);
+        }
+
+        //! Compress the response body if the client accepts it
+        /*!
+         * The content coding is negotiated from
+         * environment().acceptEncodings. Call this before anything is
+         * flushed out of the out stream. The HTTP header block is left
+         * uncompressed and has a Content-Encoding header added to it. Should
+         * it already contain a Content-Encoding or Content-Length header,
+         * nothing is compressed.
+         *
+         * @param[in] threshold Bodies smaller than this, in bytes, are sent
+         *                      uncompressed
+         * @return The content coding being used
+         */
+        Compressor::Coding compress(
+                size_t threshold=Compressor::s_defaultThreshold)
+        {
+            const Compressor::Coding coding = Compressor::negotiate(
+                    m_environment.acceptEncodings);
+            m_outStreamBuffer.compress(coding, threshold);
+            return coding;
+        }
+
+        //! Tag the response with a strong ETag
+        /*!
+         * The whole response is buffered and its body hashed as it is
+         * written. Once response() completes, an ETag header is added to the
+         * header block. Should the client of a GET or HEAD request already
+         * have that tag, as told by environment().notModified(), a bodiless
+         * 304 Not Modified is sent instead. Call this before anything is
+         * flushed out of the out stream as flush points are ignored from
+         * then on.
+         *
+         * Responses headed for the cache or for coalesced requests are always
+         * sent in full since they are shared with other clients.
+         */
+        void etag()
+        {
+            m_outStreamBuffer.etag([this] (const std::string& tag)
+            {
+                return !shared() && m_environment.notModified(tag);
+            });
+        }
+
         //! Pick a locale
         /*!
          * Basically this finds the first language in
@@ -350,6 +956,9 @@ namespace Fastcgipp
         //! The data structure containing all HTTP environment data
         Http::Environment<charT> m_environment;
 
+        //! Parameters captured by the route
+        Router::Parameters<charT> m_parameters;
+
         //! The maximum amount of post data, in bytes, that can be recieved
         const size_t m_maxPostSize;
 
@@ -380,6 +989,12 @@ namespace Fastcgipp
         //! Stream buffer for the err stream
         FcgiStreambuf<charT> m_errStreamBuffer;
 
+        //! Stream buffer for the in stream
+        InStreambuf m_inStreamBuffer;
+
+        //! True if post data is being streamed through the in stream
+        bool m_streaming;
+
         //! Codepage
         inline const char* codepage() const;
     };
@@ -0,0 +1,205 @@
+/*!
+ * @file       responsecache.hpp
+ * @brief      Declares the Fastcgipp::ResponseCache class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_RESPONSECACHE_HPP
+#define FASTCGIPP_RESPONSECACHE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fastcgi++/block.hpp"
+#include "fastcgi++/message.hpp"
+#include "fastcgi++/protocol.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! In-process cache of complete responses
+    /*!
+     * Responses are stored fully framed as the FastCGI records that were
+     * sent for them: OUT records, the OUT terminator and END_REQUEST. They
+     * are held in shared blocks so a cache hit can be queued for transmission
+     * without copying anything.
+     *
+     * Only GET and HEAD requests are cached. They are keyed by method,
+     * REQUEST_URI and the values of any other parameters the cache is told
+     * to vary on. Entries expire after their time to live and the least
+     * recently used entries are evicted to keep the total size of the cache
+     * within its limit.
+     *
+     * The Manager owns one of these. It is disabled until given a maximum
+     * size with Manager_base::cache().
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class ResponseCache
+    {
+    public:
+        //! Time to live of cache entries
+        typedef std::chrono::steady_clock::duration Duration;
+
+        //! Enable the cache
+        /*!
+         * Existing entries are dropped.
+         *
+         * @param[in] maxSize Maximum total size of cached responses in bytes.
+         *                    Zero disables the cache.
+         * @param[in] vary Names of parameters (like HTTP_ACCEPT_ENCODING)
+         *                 whose values should be part of the key
+         */
+        void configure(size_t maxSize, const std::vector<std::string>& vary);
+
+        //! True if the cache is enabled
+        bool enabled() const
+        {
+            return m_maxSize != 0;
+        }
+
+        //! Build the cache key for a request
+        /*!
+         * @param[in] params The PARAMS records of the request
+         * @return The key or an empty string if the request can't be cached.
+         */
+        std::string key(const std::vector<Message>& params) const;
+
+        //! Look up a response
+        /*!
+         * @param[in] key Cache key from key()
+         * @return The response records or nullptr if there is no fresh entry
+         */
+        std::shared_ptr<const Block> find(const std::string& key);
+
+        //! Store a response
+        /*!
+         * @param[in] key Cache key from key()
+         * @param[in] response Complete response records
+         * @param[in] ttl How long the entry is fresh for
+         */
+        void store(const std::string& key, Block&& response, Duration ttl);
+
+        //! Copy a cached response and give it a new FastCGI request ID
+        /*!
+         * Cached records carry the request ID of the request that produced
+         * them. Web servers that don't multiplex always use the same ID so
+         * this should rarely be needed.
+         *
+         * @param[in] response Cached response records
+         * @param[in] id Request ID to put in the record headers
+         * @return Copy of the records with the new request ID
+         */
+        static Block rewrite(const Block& response, Protocol::FcgiId id);
+
+        //! Drop all entries
+        void clear();
+
+        //! Amount of lookups that were served from the cache
+        unsigned long long hits() const
+        {
+            return m_hits;
+        }
+
+        //! Amount of lookups that weren't
+        unsigned long long misses() const
+        {
+            return m_misses;
+        }
+
+        //! Amount of entries evicted to make room
+        unsigned long long evictions() const
+        {
+            return m_evictions;
+        }
+
+        //! Total size of cached responses in bytes
+        size_t size() const;
+
+        //! Amount of cached responses
+        size_t entries() const;
+
+        ResponseCache():
+            m_size(0),
+            m_maxSize(0),
+            m_hits(0),
+            m_misses(0),
+            m_evictions(0)
+        {}
+
+    private:
+        //! A cached response
+        struct Entry
+        {
+            //! The response records
+            std::shared_ptr<const Block> response;
+
+            //! When the entry goes stale
+            std::chrono::steady_clock::time_point expiry;
+
+            //! Position in the LRU list
+            std::list<std::string>::iterator position;
+        };
+
+        //! Cached responses by key
+        std::unordered_map<std::string, Entry> m_entries;
+
+        //! Keys with the most recently used at the front
+        std::list<std::string> m_lru;
+
+        //! Remove an entry
+        void erase(std::unordered_map<std::string, Entry>::iterator entry);
+
+        //! Thread safe the entries
+        mutable std::mutex m_mutex;
+
+        //! Parameters to vary on
+        std::vector<std::string> m_vary;
+
+        //! Total size of cached responses
+        size_t m_size;
+
+        //! Maximum total size of cached responses
+        size_t m_maxSize;
+
+        //! Lookups served from the cache
+        std::atomic_ullong m_hits;
+
+        //! Lookups not served from the cache
+        std::atomic_ullong m_misses;
+
+        //! Entries evicted to make room
+        std::atomic_ullong m_evictions;
+    };
+}
+
+#endif
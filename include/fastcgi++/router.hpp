@@ -0,0 +1,333 @@
+/*!
+ * @file       router.hpp
+ * @brief      Declares the Fastcgipp::Router class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_ROUTER_HPP
+#define FASTCGIPP_ROUTER_HPP
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Matches paths against patterns compiled into a radix tree
+    /*!
+     * Patterns start with a slash and are matched literally except for two
+     * kinds of segments:
+     *  - <tt>:name</tt> captures a single non-empty segment.
+     *  - <tt>*name</tt> captures the rest of the path and must come last. The
+     *    name is optional.
+     *
+     * So <tt>/users/:id/files/\*path</tt> matches
+     * <tt>/users/42/files/a/b.txt</tt> capturing \c id as \c 42 and \c path as
+     * <tt>a/b.txt</tt>. Literal text beats a parameter which beats a
+     * wildcard. Matching is done on the raw path so nothing is percent
+     * decoded.
+     *
+     * Looking a path up allocates nothing. The captured parameters are
+     * string views into the path and the patterns so the router must not be
+     * changed while they are in use.
+     *
+     * Tables of patterns can be checked at compile time with valid().
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Router
+    {
+    public:
+        //! No route
+        static constexpr unsigned none = 0xffffffffU;
+
+        //! Most parameters a pattern can have
+        static constexpr unsigned maxParameters = 8;
+
+        //! Parameters captured by a match
+        template<class charT> class Parameters
+        {
+        public:
+            //! A parameter's name and value
+            typedef std::pair<std::string_view, std::basic_string_view<charT>>
+                Parameter;
+
+            Parameters():
+                m_size(0)
+            {}
+
+            //! Value of a parameter. Empty if there is no such parameter.
+            std::basic_string_view<charT> operator[](std::string_view name) const
+            {
+                for(const auto& parameter: *this)
+                    if(parameter.first == name)
+                        return parameter.second;
+                return std::basic_string_view<charT>();
+            }
+
+            //! Amount of parameters
+            unsigned size() const
+            {
+                return m_size;
+            }
+
+            const Parameter* begin() const
+            {
+                return m_parameters.data();
+            }
+
+            const Parameter* end() const
+            {
+                return m_parameters.data()+m_size;
+            }
+
+        private:
+            friend class Router;
+
+            //! The parameters
+            std::array<Parameter, maxParameters> m_parameters;
+
+            //! Amount of parameters
+            unsigned m_size;
+        };
+
+        //! Check a pattern
+        /*!
+         * This can be used in a static_assert on a constexpr route table.
+         *
+         * @param[in] pattern The pattern
+         * @return True if add() will accept it barring conflicts
+         */
+        static constexpr bool valid(std::string_view pattern)
+        {
+            if(pattern.empty() || pattern[0] != '/')
+                return false;
+
+            unsigned parameters = 0;
+            for(size_t i=1; i<pattern.size(); ++i)
+            {
+                const char x = pattern[i];
+                if(x != ':' && x != '*')
+                    continue;
+                if(pattern[i-1] != '/' || ++parameters > maxParameters)
+                    return false;
+
+                size_t end = i+1;
+                while(end < pattern.size() && pattern[end] != '/')
+                {
+                    const char y = pattern[end++];
+                    if(!((y >= 'a' && y <= 'z')
+                                || (y >= 'A' && y <= 'Z')
+                                || (y >= '0' && y <= '9')
+                                || y == '_'))
+                        return false;
+                }
+
+                if(x == '*' && end != pattern.size())
+                    return false;
+                if(x == ':' && end == i+1)
+                    return false;
+                i = end-1;
+            }
+            return true;
+        }
+
+        //! Extract the path to route by
+        /*!
+         * @param[in] requestUri The REQUEST_URI parameter
+         * @param[in] scriptName The SCRIPT_NAME parameter. Used only if there
+         *                       is no REQUEST_URI.
+         * @return The request URI up to any query string
+         */
+        template<class charT>
+        static std::basic_string_view<charT> path(
+                std::basic_string_view<charT> requestUri,
+                std::basic_string_view<charT> scriptName)
+        {
+            if(requestUri.empty())
+                return scriptName;
+            return requestUri.substr(0, requestUri.find(charT('?')));
+        }
+
+        Router();
+
+        //! Compile a pattern into the tree
+        /*!
+         * @param[in] pattern The pattern
+         * @return Index of the route. Routes are numbered from zero in the
+         *         order they are added. Router::none if the pattern is
+         *         invalid, already added or names a parameter differently
+         *         from a pattern it overlaps.
+         */
+        unsigned add(std::string_view pattern);
+
+        //! Find the route matching a path
+        /*!
+         * @param[in] path The path
+         * @param[out] parameters Parameters captured from the path
+         * @return Index of the route. Router::none if nothing matches.
+         */
+        template<class charT> unsigned match(
+                std::basic_string_view<charT> path,
+                Parameters<charT>& parameters) const
+        {
+            parameters.m_size = 0;
+            return match(0, path, parameters);
+        }
+
+        //! Amount of routes
+        unsigned size() const
+        {
+            return m_routes;
+        }
+
+        //! True if there are no routes
+        bool empty() const
+        {
+            return m_routes == 0;
+        }
+
+    private:
+        //! A node of the tree
+        struct Node
+        {
+            //! Literal text leading to the node
+            std::string prefix;
+
+            //! Name of the parameter or wildcard the node captures
+            std::string name;
+
+            //! Nodes following literal text. No two start alike.
+            std::vector<unsigned> children;
+
+            //! Node capturing a parameter next
+            unsigned parameter;
+
+            //! Node capturing the rest of the path
+            unsigned wildcard;
+
+            //! Route ending at this node
+            unsigned route;
+
+            Node():
+                parameter(none),
+                wildcard(none),
+                route(none)
+            {}
+        };
+
+        //! The tree. The root is first.
+        std::vector<Node> m_nodes;
+
+        //! Amount of routes
+        unsigned m_routes;
+
+        //! Add literal text below a node
+        /*!
+         * @param[in] node Index of the node
+         * @param[in] text Literal text
+         * @return Index of the node the text leads to
+         */
+        unsigned insert(unsigned node, std::string_view text);
+
+        //! Add a node capturing a parameter or wildcard below a node
+        /*!
+         * @param[in] node Index of the node
+         * @param[in] wildcard True for a wildcard
+         * @param[in] name Name of the parameter
+         * @return Index of the capturing node. Router::none if it is named
+         *         differently from an existing one.
+         */
+        unsigned capture(unsigned node, bool wildcard, std::string_view name);
+
+        //! Match what is left of a path below a node
+        template<class charT> unsigned match(
+                unsigned index,
+                std::basic_string_view<charT> path,
+                Parameters<charT>& parameters) const
+        {
+            const Node& node = m_nodes[index];
+            if(path.empty() && node.route != none)
+                return node.route;
+
+            if(!path.empty())
+                for(const unsigned child: node.children)
+                {
+                    const std::string& prefix = m_nodes[child].prefix;
+                    if(charT(static_cast<unsigned char>(prefix[0])) != path[0])
+                        continue;
+                    if(prefix.size() <= path.size() && std::equal(
+                                prefix.cbegin(),
+                                prefix.cend(),
+                                path.cbegin(),
+                                [] (char x, charT y)
+                                {
+                                    return charT(static_cast<unsigned char>(x))
+                                        == y;
+                                }))
+                    {
+                        const unsigned route = match(
+                                child,
+                                path.substr(prefix.size()),
+                                parameters);
+                        if(route != none)
+                            return route;
+                    }
+                    break;
+                }
+
+            if(node.parameter != none && !path.empty() && path[0] != '/')
+            {
+                const size_t end = std::min(path.find(charT('/')), path.size());
+                auto& parameter = parameters.m_parameters[parameters.m_size++];
+                parameter.first = m_nodes[node.parameter].name;
+                parameter.second = path.substr(0, end);
+                const unsigned route = match(
+                        node.parameter,
+                        path.substr(end),
+                        parameters);
+                if(route != none)
+                    return route;
+                --parameters.m_size;
+            }
+
+            if(node.wildcard != none)
+            {
+                auto& parameter = parameters.m_parameters[parameters.m_size++];
+                parameter.first = m_nodes[node.wildcard].name;
+                parameter.second = path;
+                return m_nodes[node.wildcard].route;
+            }
+
+            return none;
+        }
+    };
+}
+
+#endif
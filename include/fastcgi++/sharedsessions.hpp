@@ -0,0 +1,410 @@
+/*!
+ * @file       sharedsessions.hpp
+ * @brief      Declares the Fastcgipp::Http::SharedSessions class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_SHAREDSESSIONS_HPP
+#define FASTCGIPP_SHAREDSESSIONS_HPP
+
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "fastcgi++/http.hpp"
+#include "fastcgi++/log.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Defines classes and functions relating to the HTTP protocol
+    namespace Http
+    {
+        //! Converts session data to and from bytes for SharedSessions
+        /*!
+         * This default works for trivially copyable types. Specialize it for
+         * any other type of session data.
+         *
+         * @tparam T Class containing session data.
+         */
+        template<class T> struct SessionCodec
+        {
+            static_assert(
+                    std::is_trivially_copyable<T>::value,
+                    "Specialize SessionCodec for this session data type");
+
+            //! Append the bytes representing the data to a buffer
+            static void encode(const T& data, std::vector<char>& buffer)
+            {
+                const char* const bytes = reinterpret_cast<const char*>(&data);
+                buffer.insert(buffer.end(), bytes, bytes+sizeof(T));
+            }
+
+            //! Rebuild data from its bytes
+            /*!
+             * @return nullptr if the bytes don't represent valid data
+             */
+            static std::shared_ptr<const T> decode(
+                    const char* data,
+                    size_t size)
+            {
+                if(size != sizeof(T))
+                    return nullptr;
+                std::shared_ptr<T> result(new T);
+                std::memcpy(result.get(), data, sizeof(T));
+                return result;
+            }
+        };
+
+        //! SessionCodec for strings
+        template<class charT> struct SessionCodec<std::basic_string<charT>>
+        {
+            static void encode(
+                    const std::basic_string<charT>& data,
+                    std::vector<char>& buffer)
+            {
+                const char* const bytes
+                    = reinterpret_cast<const char*>(data.data());
+                buffer.insert(
+                        buffer.end(),
+                        bytes,
+                        bytes+data.size()*sizeof(charT));
+            }
+
+            static std::shared_ptr<const std::basic_string<charT>> decode(
+                    const char* data,
+                    size_t size)
+            {
+                if(size % sizeof(charT))
+                    return nullptr;
+                std::shared_ptr<std::basic_string<charT>> result(
+                        new std::basic_string<charT>(size/sizeof(charT), 0));
+                std::memcpy(&(*result)[0], data, size);
+                return result;
+            }
+        };
+
+        //! Fixed size hash table of sessions in a shared memory mapping
+        /*!
+         * This is the untyped storage behind SharedSessions. The table lives
+         * in a file that is mapped into memory. Since it isn't tied to the
+         * process, it survives restarts and can be shared by several worker
+         * processes on one host. Put the file in /dev/shm to keep it in
+         * memory only. It then survives process restarts but not reboots.
+         *
+         * The table uses open addressing with linear probing over a window of
+         * s_window slots. A session is either found within the window of its
+         * home slot or doesn't exist. Should the window be full when a
+         * session is stored, the least recently used session in it is
+         * evicted.
+         *
+         * Each slot has a sequence number that is odd while it is being
+         * written. Readers copy the slot and check that the sequence number
+         * hasn't changed, so they never lock. Writers are serialized by a
+         * robust process shared mutex so a worker dying mid write doesn't
+         * take the table down with it.
+         *
+         * @date    October 18, 2026
+         * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+         */
+        class SharedSessionTable
+        {
+        public:
+            //! Map the table
+            /*!
+             * If the file already contains a table of the same geometry it is
+             * used as is. A fresh table is only created in an empty or new
+             * file. Since the table may be live in other processes, a file
+             * holding anything else is never touched and is a fatal error.
+             *
+             * @param[in] path Path to the file holding the table
+             * @param[in] keepAlive Amount of seconds a session will stay alive
+             *                      for.
+             * @param[in] slots Maximum amount of sessions
+             * @param[in] payloadSize Maximum size in bytes of session data
+             * @param[in] idSize Size in bytes of session IDs
+             */
+            SharedSessionTable(
+                    const std::string& path,
+                    unsigned keepAlive,
+                    size_t slots,
+                    size_t payloadSize,
+                    size_t idSize);
+
+            ~SharedSessionTable();
+
+            SharedSessionTable(const SharedSessionTable&) = delete;
+            SharedSessionTable& operator=(const SharedSessionTable&) = delete;
+
+            //! Store a session
+            /*!
+             * @param[in] id Session ID
+             * @param[in] data Session data
+             * @param[in] size Size of session data
+             * @return False if the data is too big to store
+             */
+            bool store(
+                    const unsigned char* id,
+                    const char* data,
+                    size_t size);
+
+            //! Find a session and mark it used
+            /*!
+             * This never locks. A slot that stays half written for s_spins
+             * yields, because its writer died, is treated as a miss until the
+             * next writer repairs it.
+             *
+             * @param[in] id Session ID
+             * @param[out] data Set to the session data
+             * @return False if there is no such session or it is expired
+             */
+            bool find(const unsigned char* id, std::vector<char>& data);
+
+            //! Erase a session
+            void erase(const unsigned char* id);
+
+            //! Amount of sessions stored, including expired ones not yet
+            //! reclaimed.
+            size_t size() const;
+
+            //! Amount of slots in the table
+            size_t slots() const
+            {
+                return m_slotCount;
+            }
+
+            //! True if the table was already in the file when mapped
+            bool reused() const
+            {
+                return m_reused;
+            }
+
+            //! Slots probed from the home slot of a session
+            static const size_t s_window = 32;
+
+            //! Times a reader yields to a slot being written before giving up
+            static const unsigned s_spins = 1000;
+
+        private:
+            struct Header;
+            struct Slot;
+
+            //! Amount of seconds to keep sessions around for.
+            const unsigned m_keepAlive;
+
+            //! Size in bytes of session IDs
+            const size_t m_idSize;
+
+            //! Maximum size in bytes of session data
+            const size_t m_payloadSize;
+
+            //! Size in bytes of a slot including the ID and payload
+            const size_t m_slotSize;
+
+            //! Amount of slots in the table
+            const size_t m_slotCount;
+
+            //! Size in bytes of the mapping
+            size_t m_mapSize;
+
+            //! File descriptor of the table file
+            int m_fd;
+
+            //! The mapping
+            char* m_map;
+
+            //! True if the table was already in the file when mapped
+            bool m_reused;
+
+            //! The table header at the start of the mapping
+            Header& header() const;
+
+            //! A slot by index
+            Slot& slot(size_t index) const;
+
+            //! ID data of a slot
+            unsigned char* slotId(Slot& slot) const;
+
+            //! Payload of a slot
+            char* slotPayload(Slot& slot) const;
+
+            //! Home slot of a session
+            size_t home(const unsigned char* id) const;
+
+            //! Lock the table for writing
+            void lock();
+
+            //! Unlock the table
+            void unlock();
+
+            //! Recover from a writer that died holding the lock
+            void repair();
+        };
+
+        //! Container for HTTP sessions in shared memory
+        /*!
+         * This is an alternative to Sessions that keeps the sessions in a
+         * SharedSessionTable so they survive restarts and are shared by every
+         * process using the same file. Since session data is stored
+         * serialized, get() returns a fresh copy of it every time and
+         * generate() doesn't store it should it be too big. See
+         * SessionCodec for how to store types other than strings or
+         * trivially copyable ones.
+         *
+         * @tparam T Class containing session data.
+         * @tparam idSize Size in bytes of session IDs
+         *
+         * @date    October 18, 2026
+         * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+         */
+        template<class T, size_t idSize=15> class SharedSessions
+        {
+        public:
+            //! Type of session ID
+            typedef BasicSessionId<idSize> Id;
+
+            //! Map the sessions
+            /*!
+             * @param[in] path Path to the file holding the sessions
+             * @param[in] keepAlive Amount of seconds a session will stay alive
+             *                      for.
+             * @param[in] slots Maximum amount of sessions
+             * @param[in] payloadSize Maximum size in bytes of serialized
+             *                        session data
+             */
+            SharedSessions(
+                    const std::string& path,
+                    unsigned int keepAlive,
+                    size_t slots=65536,
+                    size_t payloadSize=1024):
+                m_keepAlive(keepAlive),
+                m_table(path, keepAlive, slots, payloadSize, idSize),
+                m_expirationTime(0)
+            {
+                setExpiration(std::time(nullptr));
+            }
+
+            //! Get session data from session ID
+            /*!
+             * @param[in] id The session ID we are looking for.
+             * @return Shared pointer to session data. The pointer will evaluate
+             *         to false if the session does not actually exist.
+             */
+            std::shared_ptr<const T> get(const Id& id)
+            {
+                const std::time_t now = std::time(nullptr);
+                if(now >= m_expirationTime)
+                    setExpiration(now);
+
+                std::vector<char> data;
+                if(!m_table.find(id.m_data.data(), data))
+                    return nullptr;
+                return SessionCodec<T>::decode(data.data(), data.size());
+            }
+
+            //! How many sessions are there?
+            size_t size() const
+            {
+                return m_table.size();
+            }
+
+            //! Generates a new session
+            /*!
+             * Should the serialized data be bigger than the payload size, the
+             * session isn't stored and an error is logged. The ID returned
+             * then refers to no session, just like one that has expired.
+             *
+             * @param[in] data Data to store in the session.
+             *
+             * @return A session ID for the session. This is not a reference for
+             * thread safety purposes.
+             */
+            Id generate(const std::shared_ptr<const T>& data)
+            {
+                std::vector<char> buffer;
+                SessionCodec<T>::encode(*data, buffer);
+
+                Id id;
+                if(!m_table.store(
+                            id.m_data.data(),
+                            buffer.data(),
+                            buffer.size()))
+                    ERROR_LOG("Session data too big for SharedSessions: " \
+                            << buffer.size() << " bytes")
+                return id;
+            }
+
+            //! Erase a session
+            /*!
+             * @param[in] id The session we want to erase.
+             */
+            void erase(const Id& id)
+            {
+                m_table.erase(id.m_data.data());
+            }
+
+            //! Expiration string for setting cookies
+            const char* expiration() const
+            {
+                return m_expiration.get();
+            }
+
+            //! The underlying table
+            const SharedSessionTable& table() const
+            {
+                return m_table;
+            }
+
+        private:
+            //! Amount of seconds to keep sessions around for.
+            const unsigned int m_keepAlive;
+
+            //! The sessions
+            SharedSessionTable m_table;
+
+            //! When the expiration string should next be updated
+            std::atomic<std::time_t> m_expirationTime;
+
+            //! Expiration string for setting cookies
+            CookieExpiration m_expiration;
+
+            //! Update the expiration string if it is time
+            void setExpiration(std::time_t now)
+            {
+                std::time_t expirationTime = m_expirationTime;
+                if(m_expirationTime.compare_exchange_strong(
+                            expirationTime,
+                            now+m_keepAlive))
+                    m_expiration.set(now+2*m_keepAlive);
+            }
+        };
+    }
+}
+
+#endif
@@ -36,6 +36,7 @@
 #include <atomic>
 #include <deque>
 #include <string>
+#include <functional>
 
 #include "fastcgi++/poll.hpp"
 
@@ -245,6 +246,16 @@ namespace Fastcgipp
          */
         void close() const;
 
+        //! Start or stop receiving data on the socket
+        /*!
+         * If the socket is valid, this will add or remove it from the set of
+         * sockets polled for incoming data in the associated SocketGroup.
+         * Hang ups and errors are still detected while it is stopped.
+         *
+         * @param [in] status True to receive data. False otherwise.
+         */
+        void receive(bool status) const;
+
         //! Creates an invalid socket with no original.
         Socket();
     };
@@ -316,6 +327,94 @@ namespace Fastcgipp
                 const char* interface,
                 const char* service);
 
+        //! Listen to an already listening socket
+        /*!
+         * Adopt a socket that is already bound and listening. Most likely this
+         * is one inherited from a parent process that other processes are
+         * accepting connections from as well. As such, only one of them is
+         * woken for each new connection and the socket is only ever closed by
+         * this object. It is never shut down.
+         *
+         * @param [in] listener The listening socket.
+         * @return True on success. False on failure.
+         */
+        bool adopt(socket_t listener);
+
+        //! Listen to the sockets passed to us by systemd
+        /*!
+         * Adopts the sockets given by the LISTEN_FDS and LISTEN_PID
+         * environment variables as with sd_listen_fds(). The variables are
+         * unset afterwards.
+         *
+         * @return Amount of sockets adopted.
+         */
+        unsigned inherit();
+
+        //! Accept hot restart requests on a control socket
+        /*!
+         * A new process can connect to this socket with takeover() to receive
+         * all our listeners. Once it confirms that it is accepting connections
+         * on them, we stop polling the control socket, relinquish ownership
+         * of the listeners and call the handedOver function. Should the new
+         * process disconnect without confirming, we carry on as if nothing
+         * happened.
+         *
+         * Should we be taking over the listeners of another process, its
+         * control socket is only replaced once we've confirmed the takeover.
+         *
+         * @param [in] name Name of control socket (path in Unix world). It
+         *                  is only accessible to our user.
+         * @param [in] handedOver Function to call from within poll() once our
+         *                        listeners have been taken over.
+         * @return True on success. False on failure.
+         */
+        bool control(
+                const char* name,
+                const std::function<void()>& handedOver);
+
+        //! Take over the listeners of another process
+        /*!
+         * Connects to the control socket of another process and adopts all
+         * the listeners it passes us. That process is told to stop once we
+         * first poll() with them.
+         *
+         * @param [in] name Name of the other process's control socket.
+         * @return Amount of sockets adopted. Zero if there was nothing to
+         *         take over.
+         * @sa control()
+         */
+        unsigned takeover(const char* name);
+
+        //! Poll an additional file descriptor
+        /*!
+         * This lets things like timers be driven by the same poll as the
+         * sockets. Call before anything is polling.
+         *
+         * @param [in] fd File descriptor to poll
+         * @param [in] ready Function to call from within poll() once the file
+         *                   descriptor is readable.
+         * @return True on success. False on failure.
+         */
+        bool watch(int fd, const std::function<void()>& ready);
+
+        //! Call a function for every new connection
+        /*!
+         * Call before anything is polling.
+         *
+         * @param [in] accepted Function to call from within poll() with each
+         *                      newly accepted socket.
+         */
+        void accepted(const std::function<void(const Socket&)>& accepted)
+        {
+            m_accepted = accepted;
+        }
+
+        //! The sockets we listen for connections on
+        const std::set<socket_t>& listeners() const
+        {
+            return m_listeners;
+        }
+
         //! Connect to a named socket
         /*!
          * Connect to a named socket. In the Unix world this would be a path.
@@ -411,6 +510,9 @@ namespace Fastcgipp
         //! These are the sockets we listen for connections on
         std::set<socket_t> m_listeners;
 
+        //! The listeners that were adopted rather than created by us
+        std::set<socket_t> m_adopted;
+
         //! Our poll object
         Poll m_poll;
 
@@ -438,6 +540,58 @@ namespace Fastcgipp
         //! Accept a new connection and create it's socket
         inline void createSocket(const socket_t listener);
 
+        //! Create, bind and listen on a unix socket
+        /*!
+         * @return The new socket or -1 on failure.
+         */
+        socket_t bindUnix(
+                const char* name,
+                uint32_t permissions,
+                const char* owner,
+                const char* group);
+
+        //! Most listeners we'll hand over or take over
+        static const unsigned s_maxHandover = 64;
+
+        //! Additional file descriptors we poll
+        std::map<int, std::function<void()>> m_watched;
+
+        //! Called with each newly accepted socket
+        std::function<void(const Socket&)> m_accepted;
+
+        //! Control socket for hot restarts. -1 if there isn't one.
+        socket_t m_control;
+
+        //! Connection to the process taking over our listeners. -1 if none.
+        socket_t m_handover;
+
+        //! Connection to the process we took over listeners from. -1 if none.
+        socket_t m_takeover;
+
+        //! Called once our listeners have been taken over
+        std::function<void()> m_handedOver;
+
+        //! Name of the control socket until it is moved into place
+        /*!
+         * The control socket is bound to this name suffixed with our pid.
+         * Should we be taking over from another process, it is only renamed
+         * once we've confirmed the takeover. Until then the other process's
+         * control socket is left alone.
+         */
+        std::string m_controlName;
+
+        //! Rename the control socket to m_controlName
+        void placeControl();
+
+        //! Pass our listeners to a process connecting to the control socket
+        void handover();
+
+        //! Finish handing over our listeners
+        /*!
+         * @param[in] confirmed True if the new process has data for us
+         */
+        void handedOver(bool confirmed);
+
         //! Filenames to cleanup when we're done
         std::deque<std::string> m_filenames;
 
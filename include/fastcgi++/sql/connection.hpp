@@ -38,6 +38,7 @@
 
 #include "fastcgi++/sockets.hpp"
 #include "fastcgi++/message.hpp"
+#include "fastcgi++/cancellation.hpp"
 #include "fastcgi++/sql/parameters.hpp"
 #include "fastcgi++/sql/results.hpp"
 
@@ -61,6 +62,15 @@ namespace Fastcgipp
 
             //! Callback function to call when query is complete
             std::function<void(Message)> callback;
+
+            //! Token to abandon the query with
+            /*!
+             * If this is cancelled before the query is sent it is dropped
+             * from the queue. If it's in progress, the server is asked to
+             * cancel it. Either way the callback is never called. Leave it
+             * as nullptr if the query must run regardless.
+             */
+            std::shared_ptr<Cancellation> cancellation;
         };
 
         //! Handles low level communication with "the other side"
@@ -111,6 +121,12 @@ namespace Fastcgipp
             //! Queue up a query
             bool queue(const Query& query);
 
+            //! Amount of queries abandoned through their cancellation token
+            unsigned long long cancelled() const
+            {
+                return m_cancelled;
+            }
+
             //! Initialize the connection
             /*!
              * Note that this function can only be called _once_.
@@ -139,7 +155,8 @@ namespace Fastcgipp
             ~Connection();
 
             Connection():
-                m_initialized(false)
+                m_initialized(false),
+                m_cancelled(0)
             {}
 
         private:
@@ -166,6 +183,9 @@ namespace Fastcgipp
                 bool idle;
                 void* connection;
                 Query query;
+
+                //! Our function registered with the query's cancellation
+                Cancellation::Id cancelId;
             };
 
             //! Container associating sockets with their receive buffers
@@ -221,6 +241,22 @@ namespace Fastcgipp
 
             //! The poll group
             Poll m_poll;
+
+            //! Queries abandoned through their cancellation token
+            std::atomic_ullong m_cancelled;
+
+            //! Connections whose query's cancellation token was cancelled
+            /*!
+             * The token is kept so we don't cancel a query that has since
+             * replaced it.
+             */
+            std::deque<std::pair<socket_t, const Cancellation*>> m_cancels;
+
+            //! Ask the server to cancel the queries in m_cancels
+            void abandon();
+
+            //! Stop calling our function once a query's token is cancelled
+            void forget(Conn& conn);
         };
     }
 }
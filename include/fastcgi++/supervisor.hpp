@@ -0,0 +1,228 @@
+/*!
+ * @file       supervisor.hpp
+ * @brief      Declares the Fastcgipp::Supervisor class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_SUPERVISOR_HPP
+#define FASTCGIPP_SUPERVISOR_HPP
+
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/sockets.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Runs managers in a set of forked worker processes
+    /*!
+     * The supervisor binds the listen sockets once and then forks a number of
+     * worker processes that each run their own Manager on the inherited
+     * sockets. All workers accept connections from the same sockets with only
+     * one of them being woken for each new connection. Should a worker crash
+     * or exit it is replaced by a freshly forked one. Coupled with
+     * Manager::recycle() this keeps a fatal error or heap corruption from
+     * taking down anything but the requests of a single worker and keeps
+     * memory fragmentation from building up over time.
+     *
+     * The supervisor process itself should be single threaded and not run a
+     * manager. Sending it SIGUSR1 stops the workers gracefully and SIGTERM
+     * terminates them. In both cases run() returns once they have all
+     * exited.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Supervisor
+    {
+    public:
+        //! Sole constructor
+        /*!
+         * @param[in] workers Amount of worker processes to run
+         */
+        Supervisor(unsigned workers);
+
+        //! Listen to the default Fastcgi socket
+        /*!
+         * @return True on success. False on failure.
+         * @sa SocketGroup::listen()
+         */
+        bool listen()
+        {
+            return m_sockets.listen();
+        }
+
+        //! Listen to a named socket
+        /*!
+         * @param [in] name Name of socket (path in Unix world).
+         * @param [in] permissions Permissions of socket.
+         * @param [in] owner Owner (username) of socket.
+         * @param [in] group Group (group name) of socket.
+         * @return True on success. False on failure.
+         * @sa SocketGroup::listen(const char*, uint32_t, const char*, const char*)
+         */
+        bool listen(
+                const char* name,
+                uint32_t permissions = 0xffffffffUL,
+                const char* owner = nullptr,
+                const char* group = nullptr)
+        {
+            return m_sockets.listen(name, permissions, owner, group);
+        }
+
+        //! Listen to a TCP port
+        /*!
+         * @param [in] interface Interface to listen on.
+         * @param [in] service Port or service to listen on.
+         * @return True on success. False on failure.
+         * @sa SocketGroup::listen(const char*, const char*)
+         */
+        bool listen(
+                const char* interface,
+                const char* service)
+        {
+            return m_sockets.listen(interface, service);
+        }
+
+        //! Listen to the sockets passed to us by systemd
+        /*!
+         * @return Amount of sockets adopted.
+         * @sa SocketGroup::inherit()
+         */
+        unsigned inherit()
+        {
+            return m_sockets.inherit();
+        }
+
+        //! Should we set socket option to reuse address
+        /*!
+         * @param [in] status Set to true if you want to reuse address.
+         *                    False otherwise (default).
+         */
+        void reuseAddress(bool value)
+        {
+            m_sockets.reuseAddress(value);
+        }
+
+        //! The sockets workers should listen on
+        const std::set<socket_t>& listeners() const
+        {
+            return m_sockets.listeners();
+        }
+
+        //! Recycle workers once they've done enough work
+        /*!
+         * These limits are applied to the managers built by run<RequestT>().
+         *
+         * @param[in] requests Completed requests to recycle after. Zero for no
+         *                     limit.
+         * @param[in] rss Resident set size in bytes to recycle after. Zero for
+         *                no limit.
+         * @sa Manager_base::recycle()
+         */
+        void recycle(unsigned long long requests, size_t rss=0)
+        {
+            m_recycleRequests = requests;
+            m_recycleRss = rss;
+        }
+
+        //! Fork the workers and supervise them until they are stopped
+        /*!
+         * This function blocks until the supervisor receives SIGUSR1 or
+         * SIGTERM and all the workers have exited.
+         *
+         * @param[in] worker Function to call in each worker process. Its
+         *                   return value becomes the exit status of the
+         *                   worker. It should listen on listeners() with
+         *                   Manager_base::adopt().
+         */
+        void run(const std::function<int()>& worker);
+
+        //! Fork workers that each run a Manager<RequestT>
+        /*!
+         * @param[in] threads Amount of threads each worker manager runs
+         * @tparam RequestT Request type to pass to the Manager
+         */
+        template<class RequestT>
+        void run(unsigned threads = std::thread::hardware_concurrency())
+        {
+            run([this, threads] () -> int
+            {
+                Manager<RequestT> manager(threads);
+                for(const auto listener: listeners())
+                    if(!manager.adopt(listener))
+                        return EXIT_FAILURE;
+                manager.recycle(m_recycleRequests, m_recycleRss);
+                manager.setupSignals();
+                manager.start();
+                manager.join();
+                return EXIT_SUCCESS;
+            });
+        }
+
+    private:
+        //! Our listen sockets
+        SocketGroup m_sockets;
+
+        //! Amount of workers to run
+        const unsigned m_workers;
+
+        //! Completed requests to recycle workers after
+        unsigned long long m_recycleRequests;
+
+        //! Resident set size to recycle workers after
+        size_t m_recycleRss;
+
+        //! Running workers and when they were forked
+        std::map<pid_t, std::chrono::steady_clock::time_point> m_running;
+
+        //! Workers that exit sooner than this after forking are throttled
+        static const std::chrono::seconds s_minimumUptime;
+
+        //! Fork a worker process
+        /*!
+         * @param[in] worker Function to call in the worker
+         * @param[in] mask Signal mask to restore in the worker
+         */
+        void fork(const std::function<int()>& worker, const sigset_t& mask);
+
+        //! Set to the last stop or terminate signal received
+        static volatile std::sig_atomic_t s_signal;
+
+        //! Flag signals for run()
+        static void signalHandler(int signum);
+    };
+}
+
+#endif
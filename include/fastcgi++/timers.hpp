@@ -0,0 +1,282 @@
+/*!
+ * @file       timers.hpp
+ * @brief      Declares the Fastcgipp::Timers class and deadlines
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#ifndef FASTCGIPP_TIMERS_HPP
+#define FASTCGIPP_TIMERS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "fastcgi++/message.hpp"
+#include "fastcgi++/protocol.hpp"
+
+//! Topmost namespace for the fastcgi++ library
+namespace Fastcgipp
+{
+    //! Delivers messages to requests after a delay
+    /*!
+     * This is a hierarchical timing wheel with four levels of 256 slots and
+     * a resolution of one millisecond. Adding and cancelling a timer are
+     * constant time operations and pending timers cost nothing until they
+     * are due, so millions of them can be pending at once. Timers further
+     * than about 49 days out are parked in the top level until they come
+     * into range.
+     *
+     * The wheel is driven by a timerfd that is always armed for the next
+     * tick at which something needs to happen. That is either a timer
+     * coming due or the first occupied slot of an upper level cascading
+     * down, so a process with only distant timers pending sleeps until they
+     * are close. Poll it and call expire() once it's readable. The Manager
+     * does this in its Transceiver thread.
+     *
+     * All functions are thread safe.
+     *
+     * @date    October 18, 2026
+     * @author  Eddie Carle &lt;eddie@isatec.ca&gt;
+     */
+    class Timers
+    {
+    public:
+        //! Clock used for all timers
+        typedef std::chrono::steady_clock Clock;
+
+        //! Identifies a pending timer
+        struct Id
+        {
+            //! Index of the timer's node
+            uint32_t index;
+
+            //! Generation of the node. Zero is invalid.
+            uint32_t generation;
+
+            //! True if this refers to a timer
+            bool valid() const
+            {
+                return generation != 0;
+            }
+
+            Id():
+                index(0),
+                generation(0)
+            {}
+        };
+
+        //! Time between ticks
+        static const std::chrono::milliseconds resolution;
+
+        //! Sole constructor
+        /*!
+         * @param[in] deliver Function to pass messages to requests with once
+         *                    they are due
+         */
+        Timers(
+                const std::function<void(Protocol::RequestId, Message&&)>&
+                    deliver);
+
+        ~Timers();
+
+        //! Deliver a message to a request after a delay
+        /*!
+         * @param[in] delay How long to wait. The message is never delivered
+         *                  early but may be late by up to the resolution.
+         * @param[in] id Request to deliver the message to
+         * @param[in] message Message to deliver
+         * @return Identifier for cancelling the timer.
+         */
+        Id after(
+                Clock::duration delay,
+                const Protocol::RequestId& id,
+                Message&& message);
+
+        //! Cancel a pending timer
+        /*!
+         * @param[in] id Timer to cancel
+         * @return True if the timer was pending and is now cancelled.
+         */
+        bool cancel(Id id);
+
+        //! True if the timer is still pending
+        bool pending(Id id) const;
+
+        //! Amount of pending timers
+        size_t size() const;
+
+        //! File descriptor that is readable once timers might be due
+        int fd() const
+        {
+            return m_fd;
+        }
+
+        //! Deliver every message that is due
+        void expire();
+
+    private:
+        //! A pending or free timer
+        struct Node
+        {
+            //! Tick the timer is due at
+            uint64_t expiry;
+
+            //! Next node in the slot or free list
+            uint32_t next;
+
+            //! Previous node in the slot
+            uint32_t prev;
+
+            //! Current generation of this node
+            uint32_t generation;
+
+            //! Slot the node is in. s_free if it isn't in one.
+            uint32_t slot;
+
+            //! Request to deliver to
+            Protocol::RequestId id;
+
+            //! Message to deliver
+            Message message;
+        };
+
+        //! Bits of the tick used by each level
+        static const unsigned s_bits = 8;
+
+        //! Slots per level
+        static const unsigned s_slots = 1<<s_bits;
+
+        //! Mask for a slot index within a level
+        static const uint64_t s_mask = s_slots-1;
+
+        //! Amount of levels
+        static const unsigned s_levels = 4;
+
+        //! Marks the end of a list and nodes that aren't in a slot
+        static const uint32_t s_free = 0xffffffff;
+
+        //! Value for "never"
+        static const uint64_t s_never = ~uint64_t(0);
+
+        //! All nodes ever allocated
+        std::deque<Node> m_nodes;
+
+        //! First free node
+        uint32_t m_freeNodes;
+
+        //! First node in each slot
+        uint32_t m_slots[s_levels*s_slots];
+
+        //! Bitmap of non-empty slots for each level
+        uint64_t m_occupied[s_levels][s_slots/64];
+
+        //! Amount of pending timers
+        size_t m_size;
+
+        //! The tick we've advanced to
+        uint64_t m_now;
+
+        //! Tick the timerfd is armed for. s_never if disarmed.
+        uint64_t m_armed;
+
+        //! Time of tick zero
+        const Clock::time_point m_epoch;
+
+        //! Our timerfd
+        const int m_fd;
+
+        //! Function to deliver messages with
+        const std::function<void(Protocol::RequestId, Message&&)> m_deliver;
+
+        //! Thread safe everything
+        mutable std::mutex m_mutex;
+
+        //! Put a node into the slot for its expiry
+        void link(uint32_t index);
+
+        //! Take a node out of its slot
+        void unlink(uint32_t index);
+
+        //! Put a node on the free list
+        void release(uint32_t index);
+
+        //! Move the nodes in a slot down a level
+        void cascade(unsigned level);
+
+        //! Next tick at which a timer is due or a slot needs cascading
+        uint64_t next() const;
+
+        //! Arm the timerfd for next() if it isn't already
+        void arm();
+
+        //! First occupied slot in a level within [first, last]
+        /*!
+         * @return The slot index or s_slots if there isn't one.
+         */
+        unsigned occupied(unsigned level, unsigned first, unsigned last) const;
+    };
+
+    //! Kinds of deadlines for connections and requests
+    enum class Deadline: char
+    {
+        PARAMS,   //!< From BEGIN_REQUEST until all parameters have arrived
+        REQUEST,  //!< From BEGIN_REQUEST until the request is complete
+        CALLBACK, //!< Waiting on a callback message after response()
+        IDLE      //!< Nothing sent or received on a connection
+    };
+
+    //! Limits on how long connections and requests can take
+    /*!
+     * A zero duration means there is no limit.
+     *
+     * @sa Manager_base::deadlines()
+     */
+    struct Deadlines
+    {
+        //! Longest a request can take to send all its parameters
+        Timers::Clock::duration params;
+
+        //! Longest a request can take in total
+        Timers::Clock::duration request;
+
+        //! Longest a request can wait on a callback message
+        Timers::Clock::duration callback;
+
+        //! Longest a connection can go without sending or receiving
+        Timers::Clock::duration idle;
+
+        Deadlines():
+            params(0),
+            request(0),
+            callback(0),
+            idle(0)
+        {}
+    };
+}
+
+#endif
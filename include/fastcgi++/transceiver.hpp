@@ -42,6 +42,7 @@
 
 #include <fastcgi++/protocol.hpp>
 #include "fastcgi++/block.hpp"
+#include "fastcgi++/timers.hpp"
 
 //! Topmost namespace for the fastcgi++ library
 namespace Fastcgipp
@@ -105,6 +106,34 @@ namespace Fastcgipp
          */
         void send(const Socket& socket, Block&& data, bool kill);
 
+        //! Queue up a shared block of data for transmission
+        /*!
+         * The block is not copied so it must not be modified while it may
+         * still be queued.
+         *
+         * @param[in] socket Socket to write the data out
+         * @param[in] data Block of data to send out
+         * @param[in] kill True if the socket should be closed once everything
+         *                 is sent.
+         */
+        void send(
+                const Socket& socket,
+                std::shared_ptr<const Block> data,
+                bool kill);
+
+        //! Stop or resume receiving data on a socket
+        /*!
+         * This is how flow control is applied to the other side. While a
+         * socket is throttled we stop reading from it so the kernel buffers
+         * fill and the web server is forced to wait. The change is applied
+         * from within the handler() thread so this can be called from any
+         * thread.
+         *
+         * @param[in] socket Socket to throttle
+         * @param[in] throttle True to stop receiving. False to resume.
+         */
+        void throttle(const Socket& socket, bool throttle);
+
         //! Constructor
         /*!
          * Construct a transceiver object based on an initial file descriptor to
@@ -173,6 +202,66 @@ namespace Fastcgipp
             return m_sockets.listen(interface, service);
         }
 
+        //! Listen to an already listening socket
+        /*!
+         * @param [in] listener The listening socket.
+         * @return True on success. False on failure.
+         * @sa SocketGroup::adopt()
+         */
+        bool adopt(socket_t listener)
+        {
+            return m_sockets.adopt(listener);
+        }
+
+        //! Poll an additional file descriptor
+        /*!
+         * @param [in] fd File descriptor to poll
+         * @param [in] ready Function to call from the handler() thread once
+         *                   the file descriptor is readable.
+         * @return True on success. False on failure.
+         * @sa SocketGroup::watch()
+         */
+        bool watch(int fd, const std::function<void()>& ready)
+        {
+            return m_sockets.watch(fd, ready);
+        }
+
+        //! Listen to the sockets passed to us by systemd
+        /*!
+         * @return Amount of sockets adopted.
+         * @sa SocketGroup::inherit()
+         */
+        unsigned inherit()
+        {
+            return m_sockets.inherit();
+        }
+
+        //! Accept hot restart requests on a control socket
+        /*!
+         * @param [in] name Name of control socket (path in Unix world).
+         * @param [in] handedOver Function to call once our listeners have
+         *                        been taken over.
+         * @return True on success. False on failure.
+         * @sa SocketGroup::control()
+         */
+        bool control(
+                const char* name,
+                const std::function<void()>& handedOver)
+        {
+            return m_sockets.control(name, handedOver);
+        }
+
+        //! Take over the listeners of another process
+        /*!
+         * @param [in] name Name of the other process's control socket.
+         * @return Amount of sockets adopted.
+         * @sa SocketGroup::takeover()
+         */
+        unsigned takeover(const char* name)
+        {
+            return m_sockets.takeover(name);
+        }
+
         //! Should we set socket option to reuse address
         /*!
          * @param [in] status Set to true if you want to reuse address.
@@ -183,6 +272,26 @@ namespace Fastcgipp
             m_sockets.reuseAddress(value);
         }
 
+        //! Close connections that go quiet
+        /*!
+         * Connections that neither send nor receive anything for this long
+         * are closed just as if the other side hung up. Each connection has
+         * a single timer that is only pushed back once it fires so this costs
+         * next to nothing per record.
+         *
+         * Call before start().
+         *
+         * @param [in] timeout How long a connection can be idle. Zero for no
+         *                     limit.
+         */
+        void idle(Timers::Clock::duration timeout);
+
+        //! Amount of connections closed for being idle
+        unsigned long long idled() const
+        {
+            return m_idled;
+        }
+
     private:
         //! Container associating sockets with their receive buffers
         std::map<Socket, Block> m_receiveBuffers;
@@ -192,7 +301,12 @@ namespace Fastcgipp
         {
             const Socket socket;
             const Block data;
+
+            //! Data shared with others. Sent instead of data if set.
+            const std::shared_ptr<const Block> shared;
+
             const char* read;
+            const char* const end;
             const bool kill;
 
             Record(
@@ -202,6 +316,18 @@ namespace Fastcgipp
                 socket(socket_),
                 data(std::move(data_)),
                 read(data.begin()),
+                end(data.end()),
+                kill(kill_)
+            {}
+
+            Record(
+                    const Socket& socket_,
+                    std::shared_ptr<const Block>&& shared_,
+                    bool kill_):
+                socket(socket_),
+                shared(std::move(shared_)),
+                read(shared->begin()),
+                end(shared->end()),
                 kill(kill_)
             {}
         };
@@ -212,6 +338,15 @@ namespace Fastcgipp
         //! Thread safe the send buffer
         std::mutex m_sendBufferMutex;
 
+        //! Throttle changes waiting to be applied to sockets
+        std::deque<std::pair<Socket, bool>> m_throttles;
+
+        //! Thread safe the throttle changes
+        std::mutex m_throttlesMutex;
+
+        //! Apply all pending throttle changes
+        inline void applyThrottles();
+
         //! Function to call to pass messages to requests
         const std::function<void(Protocol::RequestId, Message&&)> m_sendMessage;
 
@@ -239,6 +374,28 @@ namespace Fastcgipp
         //! Cleanup a dead socket
         void cleanupSocket(const Socket& socket);
 
+        //! How long a connection can be idle. Zero for no limit.
+        Timers::Clock::duration m_idle;
+
+        //! Timers for idle connections. Only built if there is a limit.
+        std::unique_ptr<Timers> m_idleTimers;
+
+        //! When each connection last sent or received anything
+        std::map<Socket, Timers::Clock::time_point> m_active;
+
+        //! Connections closed for being idle
+        std::atomic_ullong m_idled;
+
+        //! Note activity on a connection
+        inline void active(const Socket& socket);
+
+        //! Close a connection if it has been idle for too long
+        /*!
+         * This is called from within poll() once the connection's timer
+         * fires. Should it have been active since, the timer is reset.
+         */
+        void reap(const Socket& socket);
+
 #if FASTCGIPP_LOG_LEVEL > 3
         //! Debug counter for locally killed sockets
         std::atomic_ullong m_connectionKillCount;
@@ -254,6 +411,9 @@ namespace Fastcgipp
 
         //! Debug counter for bytes received
         std::atomic_ullong m_recordsReceived;
+
+        //! Debug counter for sockets throttled
+        std::atomic_ullong m_throttleCount;
 #endif
     };
 }
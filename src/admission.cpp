@@ -0,0 +1,165 @@
+/*!
+ * @file       admission.cpp
+ * @brief      Defines the Fastcgipp::Admission class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/admission.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+Fastcgipp::Admission::Admission():
+    m_maximum(0),
+    m_minimum(1),
+    m_limit(0),
+    m_unavailable(false),
+    m_target(Clock::duration::zero()),
+    m_rejected(0),
+    m_samples(0),
+    m_cut(0),
+    m_fast(0)
+{}
+
+void Fastcgipp::Admission::configure(unsigned limit, bool unavailable)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maximum = limit;
+    m_limit = limit;
+    m_unavailable = unavailable;
+}
+
+void Fastcgipp::Admission::adapt(Clock::duration target, unsigned minimum)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_target = target;
+    m_minimum = std::max(1U, std::min(minimum, m_maximum));
+    m_limit = m_maximum;
+    m_samples = 0;
+    m_cut = 0;
+    m_fast = 0;
+}
+
+bool Fastcgipp::Admission::admit(size_t active)
+{
+    if(!enabled() || active < m_limit)
+        return true;
+    ++m_rejected;
+    return false;
+}
+
+void Fastcgipp::Admission::delay(Clock::duration delay)
+{
+    if(!enabled() || !adaptive())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const unsigned limit = m_limit;
+    ++m_samples;
+    if(delay > m_target)
+    {
+        m_fast = 0;
+        if(m_cut != 0 && m_samples-m_cut < limit)
+            return;
+        m_cut = m_samples;
+        m_limit = std::max(m_minimum, limit-std::max(1U, limit/10));
+    }
+    else if(++m_fast >= limit)
+    {
+        m_fast = 0;
+        m_limit = std::min(m_maximum, limit+1);
+    }
+}
+
+Fastcgipp::Block Fastcgipp::Admission::rejection(Protocol::FcgiId id) const
+{
+    static const char page[] =
+"Status: 503 Service Unavailable\r\n"\
+"Retry-After: 1\r\n"\
+"Content-Type: text/html; charset=utf-8\r\n\r\n"\
+"<!DOCTYPE html>"\
+"<html lang='en'>"\
+    "<head>"\
+        "<title>503 Service Unavailable</title>"\
+    "</head>"\
+    "<body>"\
+        "<h1>503 Service Unavailable</h1>"\
+    "</body>"\
+"</html>";
+
+    const size_t pageSize = m_unavailable?
+        Protocol::getRecordSize(sizeof(page)-1)+sizeof(Protocol::Header):0;
+    Block record(pageSize+sizeof(Protocol::Header)+sizeof(Protocol::EndRequest));
+    std::memset(record.begin(), 0, record.size());
+
+    const auto header = [&record, id] (
+            size_t position,
+            Protocol::RecordType type,
+            size_t length,
+            size_t recordSize)
+    {
+        Protocol::Header& header
+            = *reinterpret_cast<Protocol::Header*>(record.begin()+position);
+        header.version = Protocol::version;
+        header.type = type;
+        header.fcgiId = id;
+        header.contentLength = length;
+        header.paddingLength = recordSize-length-sizeof(Protocol::Header);
+    };
+
+    size_t position = 0;
+    if(m_unavailable)
+    {
+        const size_t size = Protocol::getRecordSize(sizeof(page)-1);
+        header(position, Protocol::RecordType::OUT, sizeof(page)-1, size);
+        std::copy_n(
+                page,
+                sizeof(page)-1,
+                record.begin()+position+sizeof(Protocol::Header));
+        position += size;
+
+        // An empty record ends the stream
+        header(
+                position,
+                Protocol::RecordType::OUT,
+                0,
+                sizeof(Protocol::Header));
+        position += sizeof(Protocol::Header);
+    }
+
+    header(
+            position,
+            Protocol::RecordType::END_REQUEST,
+            sizeof(Protocol::EndRequest),
+            sizeof(Protocol::Header)+sizeof(Protocol::EndRequest));
+    Protocol::EndRequest& body = *reinterpret_cast<Protocol::EndRequest*>(
+            record.begin()+position+sizeof(Protocol::Header));
+    body.appStatus = 0;
+    body.protocolStatus = m_unavailable?
+        Protocol::ProtocolStatus::REQUEST_COMPLETE:
+        Protocol::ProtocolStatus::OVERLOADED;
+
+    return record;
+}
@@ -0,0 +1,100 @@
+/*!
+ * @file       autoscaler.cpp
+ * @brief      Defines the Fastcgipp::Autoscaler class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+
+#include "fastcgi++/autoscaler.hpp"
+
+#include <algorithm>
+
+Fastcgipp::Autoscaler::Autoscaler():
+    m_minimum(0),
+    m_maximum(0),
+    m_wait(Clock::duration::zero()),
+    m_idle(Clock::duration::zero()),
+    m_threads(0),
+    m_peak(0),
+    m_growths(0),
+    m_shrinks(0),
+    m_trigger(0)
+{}
+
+void Fastcgipp::Autoscaler::configure(
+        unsigned minimum,
+        unsigned maximum,
+        Clock::duration wait,
+        Clock::duration idle)
+{
+    m_maximum = maximum;
+    m_minimum = std::min(std::max(minimum, 1U), maximum);
+    m_wait = wait;
+    m_idle = idle;
+    m_grown = Clock::time_point();
+}
+
+bool Fastcgipp::Autoscaler::grow(
+        unsigned threads,
+        Clock::duration waited,
+        Clock::time_point now)
+{
+    if(!enabled()
+            || threads >= m_maximum
+            || waited <= m_wait
+            || now-m_grown < m_wait)
+        return false;
+
+    m_grown = now;
+    m_trigger = waited.count();
+    ++m_growths;
+    return true;
+}
+
+bool Fastcgipp::Autoscaler::shrink(unsigned threads, Clock::time_point now)
+{
+    if(!enabled() || threads <= m_minimum || now-m_grown < m_idle)
+        return false;
+
+    ++m_shrinks;
+    return true;
+}
+
+void Fastcgipp::Autoscaler::resized(unsigned threads)
+{
+    m_threads = threads;
+    if(threads > m_peak)
+        m_peak = threads;
+}
+
+Fastcgipp::Autoscaler::Metrics Fastcgipp::Autoscaler::metrics() const
+{
+    return Metrics{
+        m_threads,
+        m_peak,
+        m_growths,
+        m_shrinks,
+        Clock::duration(m_trigger)};
+}
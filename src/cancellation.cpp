@@ -0,0 +1,67 @@
+/*!
+ * @file       cancellation.cpp
+ * @brief      Defines the Fastcgipp::Cancellation class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/cancellation.hpp"
+
+void Fastcgipp::Cancellation::cancel()
+{
+    std::map<Id, std::function<void()>> functions;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_cancelled)
+            return;
+        m_cancelled = true;
+        functions.swap(m_functions);
+    }
+
+    for(const auto& function: functions)
+        function.second();
+}
+
+Fastcgipp::Cancellation::Id Fastcgipp::Cancellation::onCancel(
+        const std::function<void()>& cancel)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_cancelled)
+        {
+            const Id id = m_next++;
+            m_functions.emplace(id, cancel);
+            return id;
+        }
+    }
+
+    cancel();
+    return 0;
+}
+
+void Fastcgipp::Cancellation::forget(Id id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_functions.erase(id);
+}
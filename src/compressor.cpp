@@ -0,0 +1,659 @@
+/*!
+ * @file       compressor.cpp
+ * @brief      Defines the Fastcgipp::Compressor class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/compressor.hpp"
+#include "fastcgi++/log.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#ifdef FASTCGIPP_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FASTCGIPP_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef FASTCGIPP_ZSTD
+#include <zstd.h>
+#endif
+
+struct Fastcgipp::Compressor::Codec
+{
+    //! The content coding this codec produces
+    const Coding coding;
+
+    //! Run input through the compression library
+    /*!
+     * @param[in,out] in First byte of input. Advanced past whatever was
+     *                   consumed.
+     * @param[in] inEnd 1+ the last byte of input
+     * @param[in,out] out First byte of output space. Advanced past whatever
+     *                    was produced.
+     * @param[in] outEnd 1+ the last byte of output space
+     * @param[in] operation What to do
+     * @return True if the operation is complete. False if more output space
+     *         is needed.
+     */
+    virtual bool process(
+            const char*& in,
+            const char* inEnd,
+            char*& out,
+            char* outEnd,
+            Operation operation) =0;
+
+    //! Reset the state for reuse. False on failure.
+    virtual bool reset() =0;
+
+    virtual ~Codec() {}
+
+    //! Build a new codec. nullptr on failure.
+    static Codec* make(Coding coding);
+
+    //! This thread's pool of codecs for the coding
+    static std::vector<std::unique_ptr<Codec>>& pool(Coding coding)
+    {
+        thread_local std::vector<std::unique_ptr<Codec>> pools[5];
+        return pools[static_cast<unsigned>(coding)];
+    }
+
+    Codec(Coding coding_):
+        coding(coding_)
+    {}
+
+    struct Zlib;
+    struct Brotli;
+    struct Zstd;
+};
+
+#ifdef FASTCGIPP_ZLIB
+//! Deflate and gzip through zlib
+struct Fastcgipp::Compressor::Codec::Zlib: public Codec
+{
+    z_stream m_stream;
+    bool m_initialized;
+
+    Zlib(Coding coding):
+        Codec(coding)
+    {
+        m_stream.zalloc = Z_NULL;
+        m_stream.zfree = Z_NULL;
+        m_stream.opaque = Z_NULL;
+        // Adding 16 to the window bits gives us a gzip wrapper
+        m_initialized = deflateInit2(
+                &m_stream,
+                Z_DEFAULT_COMPRESSION,
+                Z_DEFLATED,
+                coding==Coding::GZIP?15+16:15,
+                8,
+                Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~Zlib()
+    {
+        if(m_initialized)
+            deflateEnd(&m_stream);
+    }
+
+    bool reset()
+    {
+        return deflateReset(&m_stream) == Z_OK;
+    }
+
+    bool process(
+            const char*& in,
+            const char* inEnd,
+            char*& out,
+            char* outEnd,
+            Operation operation)
+    {
+        m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        m_stream.avail_in = inEnd-in;
+        m_stream.next_out = reinterpret_cast<Bytef*>(out);
+        m_stream.avail_out = outEnd-out;
+
+        const int result = deflate(
+                &m_stream,
+                operation==Operation::PROCESS?Z_NO_FLUSH:
+                    operation==Operation::FLUSH?Z_SYNC_FLUSH:Z_FINISH);
+
+        in = reinterpret_cast<const char*>(m_stream.next_in);
+        out = reinterpret_cast<char*>(m_stream.next_out);
+
+        if(result == Z_STREAM_ERROR)
+        {
+            ERROR_LOG("zlib deflate() failed")
+            return true;
+        }
+
+        switch(operation)
+        {
+            case Operation::PROCESS:
+                return in == inEnd;
+            case Operation::FLUSH:
+                return in == inEnd && m_stream.avail_out != 0;
+            default:
+                return result == Z_STREAM_END;
+        }
+    }
+};
+#endif
+
+#ifdef FASTCGIPP_BROTLI
+//! Brotli through libbrotlienc
+struct Fastcgipp::Compressor::Codec::Brotli: public Codec
+{
+    BrotliEncoderState* m_state;
+
+    //! Quality suited to dynamic content
+    static const uint32_t s_quality = 5;
+
+    Brotli():
+        Codec(Coding::BROTLI),
+        m_state(nullptr)
+    {
+        reset();
+    }
+
+    ~Brotli()
+    {
+        if(m_state != nullptr)
+            BrotliEncoderDestroyInstance(m_state);
+    }
+
+    bool reset()
+    {
+        // There is no way to reset a brotli encoder so we start over
+        if(m_state != nullptr)
+            BrotliEncoderDestroyInstance(m_state);
+        m_state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        return m_state != nullptr && BrotliEncoderSetParameter(
+                m_state,
+                BROTLI_PARAM_QUALITY,
+                s_quality);
+    }
+
+    bool process(
+            const char*& in,
+            const char* inEnd,
+            char*& out,
+            char* outEnd,
+            Operation operation)
+    {
+        size_t availableIn = inEnd-in;
+        const uint8_t* nextIn = reinterpret_cast<const uint8_t*>(in);
+        size_t availableOut = outEnd-out;
+        uint8_t* nextOut = reinterpret_cast<uint8_t*>(out);
+
+        const bool result = BrotliEncoderCompressStream(
+                m_state,
+                operation==Operation::PROCESS?BROTLI_OPERATION_PROCESS:
+                    operation==Operation::FLUSH?BROTLI_OPERATION_FLUSH:
+                        BROTLI_OPERATION_FINISH,
+                &availableIn,
+                &nextIn,
+                &availableOut,
+                &nextOut,
+                nullptr);
+
+        in = reinterpret_cast<const char*>(nextIn);
+        out = reinterpret_cast<char*>(nextOut);
+
+        if(!result)
+        {
+            ERROR_LOG("BrotliEncoderCompressStream() failed")
+            return true;
+        }
+
+        if(operation == Operation::FINISH)
+            return BrotliEncoderIsFinished(m_state);
+        return in == inEnd && !BrotliEncoderHasMoreOutput(m_state);
+    }
+};
+#endif
+
+#ifdef FASTCGIPP_ZSTD
+//! Zstandard through libzstd
+struct Fastcgipp::Compressor::Codec::Zstd: public Codec
+{
+    ZSTD_CCtx* const m_context;
+
+    Zstd():
+        Codec(Coding::ZSTD),
+        m_context(ZSTD_createCCtx())
+    {}
+
+    ~Zstd()
+    {
+        ZSTD_freeCCtx(m_context);
+    }
+
+    bool reset()
+    {
+        return !ZSTD_isError(
+                ZSTD_CCtx_reset(m_context, ZSTD_reset_session_only));
+    }
+
+    bool process(
+            const char*& in,
+            const char* inEnd,
+            char*& out,
+            char* outEnd,
+            Operation operation)
+    {
+        ZSTD_inBuffer input = {in, static_cast<size_t>(inEnd-in), 0};
+        ZSTD_outBuffer output = {out, static_cast<size_t>(outEnd-out), 0};
+
+        const size_t remaining = ZSTD_compressStream2(
+                m_context,
+                &output,
+                &input,
+                operation==Operation::PROCESS?ZSTD_e_continue:
+                    operation==Operation::FLUSH?ZSTD_e_flush:ZSTD_e_end);
+
+        in += input.pos;
+        out += output.pos;
+
+        if(ZSTD_isError(remaining))
+        {
+            ERROR_LOG("ZSTD_compressStream2() failed: " \
+                    << ZSTD_getErrorName(remaining))
+            return true;
+        }
+
+        if(operation == Operation::PROCESS)
+            return in == inEnd;
+        return remaining == 0;
+    }
+};
+#endif
+
+Fastcgipp::Compressor::Codec* Fastcgipp::Compressor::Codec::make(
+        Coding coding)
+{
+    Codec* codec = nullptr;
+    switch(coding)
+    {
+#ifdef FASTCGIPP_ZLIB
+        case Coding::DEFLATE:
+        case Coding::GZIP:
+        {
+            Zlib* const zlib = new Zlib(coding);
+            if(zlib->m_initialized)
+                codec = zlib;
+            else
+                delete zlib;
+            break;
+        }
+#endif
+#ifdef FASTCGIPP_BROTLI
+        case Coding::BROTLI:
+        {
+            Brotli* const brotli = new Brotli;
+            if(brotli->m_state != nullptr)
+                codec = brotli;
+            else
+                delete brotli;
+            break;
+        }
+#endif
+#ifdef FASTCGIPP_ZSTD
+        case Coding::ZSTD:
+        {
+            Zstd* const zstd = new Zstd;
+            if(zstd->m_context != nullptr)
+                codec = zstd;
+            else
+                delete zstd;
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+
+    if(codec == nullptr)
+        ERROR_LOG("Unable to initialize " << name(coding) << " compression")
+    return codec;
+}
+
+void Fastcgipp::Compressor::Release::operator()(Codec* codec) const
+{
+    auto& pool = Codec::pool(codec->coding);
+    if(pool.size() < s_poolSize && codec->reset())
+        pool.emplace_back(codec);
+    else
+        delete codec;
+}
+
+std::unique_ptr<Fastcgipp::Compressor::Codec, Fastcgipp::Compressor::Release>
+Fastcgipp::Compressor::acquire(Coding coding)
+{
+    auto& pool = Codec::pool(coding);
+    if(pool.empty())
+        return std::unique_ptr<Codec, Release>(Codec::make(coding));
+
+    std::unique_ptr<Codec, Release> codec(pool.back().release());
+    pool.pop_back();
+    return codec;
+}
+
+bool Fastcgipp::Compressor::supported(Coding coding)
+{
+    switch(coding)
+    {
+        case Coding::IDENTITY:
+            return true;
+#ifdef FASTCGIPP_ZLIB
+        case Coding::DEFLATE:
+        case Coding::GZIP:
+            return true;
+#endif
+#ifdef FASTCGIPP_BROTLI
+        case Coding::BROTLI:
+            return true;
+#endif
+#ifdef FASTCGIPP_ZSTD
+        case Coding::ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+const char* Fastcgipp::Compressor::name(Coding coding)
+{
+    switch(coding)
+    {
+        case Coding::DEFLATE:
+            return "deflate";
+        case Coding::GZIP:
+            return "gzip";
+        case Coding::BROTLI:
+            return "br";
+        case Coding::ZSTD:
+            return "zstd";
+        default:
+            return "identity";
+    }
+}
+
+Fastcgipp::Compressor::Coding Fastcgipp::Compressor::negotiate(
+        const std::string& acceptEncodings)
+{
+    // In order of preference
+    const Coding codings[] =
+    {
+        Coding::ZSTD,
+        Coding::BROTLI,
+        Coding::GZIP,
+        Coding::DEFLATE
+    };
+    const unsigned codingCount = sizeof(codings)/sizeof(Coding);
+
+    // Qualities in thousandths. -1 means not mentioned.
+    int qualities[codingCount] = {-1, -1, -1, -1};
+    int wildcard = -1;
+
+    auto groupStart = acceptEncodings.cbegin();
+    while(groupStart < acceptEncodings.cend())
+    {
+        const auto groupEnd = std::find(
+                groupStart,
+                acceptEncodings.cend(),
+                ',');
+
+        auto tokenStart = groupStart;
+        auto tokenEnd = std::find(groupStart, groupEnd, ';');
+        while(tokenStart != tokenEnd && std::isspace(*tokenStart))
+            ++tokenStart;
+        while(tokenEnd != tokenStart && std::isspace(*(tokenEnd-1)))
+            --tokenEnd;
+        const std::string token(tokenStart, tokenEnd);
+
+        // Parse the quality into thousandths
+        int quality = 1000;
+        for(auto parameter = tokenEnd; parameter != groupEnd;)
+        {
+            ++parameter;
+            const auto parameterEnd = std::find(parameter, groupEnd, ';');
+            while(parameter != parameterEnd && std::isspace(*parameter))
+                ++parameter;
+            if(parameterEnd-parameter >= 2
+                    && std::tolower(*parameter) == 'q'
+                    && *(parameter+1) == '=')
+            {
+                quality = 0;
+                int scale = 1000;
+                bool fraction = false;
+                for(auto digit = parameter+2; digit != parameterEnd; ++digit)
+                {
+                    if(*digit == '.')
+                        fraction = true;
+                    else if(std::isdigit(*digit))
+                    {
+                        if(!fraction)
+                            quality = (*digit-'0')*1000;
+                        else if(scale > 1)
+                        {
+                            scale /= 10;
+                            quality += (*digit-'0')*scale;
+                        }
+                    }
+                    else
+                        break;
+                }
+                quality = std::min(quality, 1000);
+            }
+            parameter = parameterEnd;
+        }
+
+        if(token == "*")
+            wildcard = quality;
+        else
+            for(unsigned i=0; i<codingCount; ++i)
+                if(token.size() == std::strlen(name(codings[i]))
+                        && std::equal(
+                            token.cbegin(),
+                            token.cend(),
+                            name(codings[i]),
+                            [] (char x, char y)
+                            {
+                                return std::tolower(x) == y;
+                            }))
+                    qualities[i] = quality;
+
+        groupStart = groupEnd;
+        if(groupStart != acceptEncodings.cend())
+            ++groupStart;
+    }
+
+    Coding best = Coding::IDENTITY;
+    int bestQuality = 0;
+    for(unsigned i=0; i<codingCount; ++i)
+    {
+        const int quality = qualities[i]==-1?wildcard:qualities[i];
+        if(supported(codings[i]) && quality > bestQuality)
+        {
+            best = codings[i];
+            bestQuality = quality;
+        }
+    }
+    return best;
+}
+
+Fastcgipp::Compressor::Compressor(
+        Coding coding,
+        size_t threshold,
+        size_t tailRoom,
+        const Sink& sink):
+    m_coding(coding),
+    m_threshold(threshold),
+    m_state(State::HEADERS),
+    m_records(tailRoom, sink)
+{}
+
+Fastcgipp::Compressor::~Compressor()
+{}
+
+void Fastcgipp::Compressor::write(const char* data, size_t size)
+{
+    switch(m_state)
+    {
+        case State::HEADERS:
+        {
+            m_pending.write(data, size);
+            if(m_pending.complete())
+                headers();
+            break;
+        }
+        case State::PENDING:
+        {
+            m_pending.write(data, size);
+            if(m_pending.size()-m_pending.body() >= m_threshold)
+                start();
+            break;
+        }
+        case State::COMPRESSING:
+        {
+            compress(data, size, Operation::PROCESS);
+            break;
+        }
+        default:
+        {
+            m_records.copy(data, size);
+            break;
+        }
+    }
+}
+
+void Fastcgipp::Compressor::flush()
+{
+    if(m_state == State::PENDING)
+        start();
+
+    if(m_state == State::COMPRESSING)
+        compress(nullptr, 0, Operation::FLUSH);
+
+    if(m_state != State::HEADERS)
+        m_records.send();
+}
+
+void Fastcgipp::Compressor::finish()
+{
+    switch(m_state)
+    {
+        case State::HEADERS:
+        case State::PENDING:
+        {
+            m_records.copy(m_pending.data(), m_pending.size());
+            m_pending.clear();
+            break;
+        }
+        case State::COMPRESSING:
+        {
+            compress(nullptr, 0, Operation::FINISH);
+            m_codec.reset();
+            break;
+        }
+        default:
+            break;
+    }
+    m_records.send();
+    m_state = State::FINISHED;
+}
+
+void Fastcgipp::Compressor::headers()
+{
+    // Leave responses that already specify an encoding or length alone
+    if(m_pending.header("content-encoding:")
+            || m_pending.header("content-length:"))
+    {
+        m_state = State::PASSTHROUGH;
+        m_records.copy(m_pending.data(), m_pending.size());
+        m_pending.clear();
+        return;
+    }
+
+    m_state = State::PENDING;
+    if(m_pending.size()-m_pending.body() >= m_threshold)
+        start();
+}
+
+void Fastcgipp::Compressor::start()
+{
+    m_codec = acquire(m_coding);
+    if(!m_codec)
+    {
+        m_state = State::PASSTHROUGH;
+        m_records.copy(m_pending.data(), m_pending.size());
+    }
+    else
+    {
+        m_state = State::COMPRESSING;
+        const std::string headers = std::string("Content-Encoding: ")
+            + name(m_coding)
+            + "\r\nVary: Accept-Encoding\r\n";
+        const size_t blankLine = m_pending.blankLine();
+        const size_t body = m_pending.body();
+        m_records.copy(m_pending.data(), blankLine);
+        m_records.copy(headers.data(), headers.size());
+        m_records.copy(m_pending.data()+blankLine, body-blankLine);
+        compress(
+                m_pending.data()+body,
+                m_pending.size()-body,
+                Operation::PROCESS);
+    }
+    m_pending.clear();
+}
+
+void Fastcgipp::Compressor::compress(
+        const char* data,
+        size_t size,
+        Operation operation)
+{
+    const char* const end = data+size;
+    while(true)
+    {
+        size_t space;
+        char* const begin = m_records.space(space);
+        char* out = begin;
+
+        const bool complete = m_codec->process(
+                data,
+                end,
+                out,
+                begin+space,
+                operation);
+        m_records.commit(out-begin);
+
+        if(complete)
+            break;
+    }
+}
@@ -47,6 +47,8 @@ void Fastcgipp::SQL::Connection::handler()
         // Get connected
         if(!connected()) connect();
 
+        abandon();
+
         // Do we have a free connection?
         for(
                 auto connection=m_connections.begin();
@@ -62,6 +64,13 @@ void Fastcgipp::SQL::Connection::handler()
 
                 {
                     std::lock_guard<std::mutex> lock(m_mutex);
+                    while(!m_queue.empty()
+                            && m_queue.front().cancellation
+                            && m_queue.front().cancellation->cancelled())
+                    {
+                        m_queue.pop_front();
+                        ++m_cancelled;
+                    }
                     if(m_queue.empty())
                         break;
                     query = m_queue.front();
@@ -100,6 +109,23 @@ void Fastcgipp::SQL::Connection::handler()
                 {
                     PQflush(conn);
                     idle = false;
+                    if(query.cancellation)
+                    {
+                        const socket_t socket = connection->first;
+                        const Cancellation* const cancellation
+                            = query.cancellation.get();
+                        connection->second.cancelId
+                            = query.cancellation->onCancel(
+                                    [this, socket, cancellation] ()
+                                    {
+                                        std::lock_guard<std::mutex> lock(
+                                                m_mutex);
+                                        m_cancels.emplace_back(
+                                                socket,
+                                                cancellation);
+                                        wake();
+                                    });
+                    }
                 }
             }
         }
@@ -159,14 +185,16 @@ void Fastcgipp::SQL::Connection::handler()
                             {
                                 // Query is complete
                                 idle = true;
+                                forget(connection->second);
+                                const bool cancelled = query.cancellation
+                                    && query.cancellation->cancelled();
+                                query.cancellation.reset();
                                 query.statement = nullptr;
                                 query.parameters.reset();
                                 query.results.reset();
-                                if(query.callback)
-                                {
+                                if(query.callback && !cancelled)
                                     query.callback(m_messageType);
-                                    query.callback=std::function<void(Message)>();
-                                }
+                                query.callback=std::function<void(Message)>();
                                 break;
                             }
 
@@ -335,6 +363,7 @@ void Fastcgipp::SQL::Connection::kill(std::map<socket_t, Conn>::iterator& conn)
     m_poll.del(conn->first);
     if(!conn->second.idle)
     {
+        forget(conn->second);
         std::lock_guard<std::mutex> lock(m_mutex);
         m_queue.push_front(conn->second.query);
     }
@@ -345,6 +374,8 @@ void Fastcgipp::SQL::Connection::killAll()
 {
     for(auto& connection: m_connections)
     {
+        if(!connection.second.idle)
+            forget(connection.second);
         PQfinish(reinterpret_cast<PGconn*>(connection.second.connection));
         m_poll.del(connection.first);
     }
@@ -352,3 +383,38 @@ void Fastcgipp::SQL::Connection::killAll()
     std::lock_guard<std::mutex> lock(m_mutex);
     m_queue.clear();
 }
+
+void Fastcgipp::SQL::Connection::forget(Conn& conn)
+{
+    if(conn.query.cancellation)
+        conn.query.cancellation->forget(conn.cancelId);
+}
+
+void Fastcgipp::SQL::Connection::abandon()
+{
+    std::deque<std::pair<socket_t, const Cancellation*>> cancels;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cancels.swap(m_cancels);
+    }
+
+    for(const auto& cancel: cancels)
+    {
+        const auto connection = m_connections.find(cancel.first);
+        if(connection == m_connections.end()
+                || connection->second.idle
+                || connection->second.query.cancellation.get() != cancel.second)
+            continue;
+
+        PGcancel* const pgCancel = PQgetCancel(
+                reinterpret_cast<PGconn*>(connection->second.connection));
+        char error[256];
+        if(pgCancel == nullptr || PQcancel(pgCancel, error, sizeof(error)) != 1)
+            WARNING_LOG("Unable to cancel SQL query: " \
+                    << (pgCancel?error:"no cancel object"))
+        else
+            ++m_cancelled;
+        if(pgCancel)
+            PQfreeCancel(pgCancel);
+    }
+}
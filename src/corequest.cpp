@@ -0,0 +1,53 @@
+/*!
+ * @file       corequest.cpp
+ * @brief      Defines the Fastcgipp::CoRequest class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/corequest.hpp"
+
+template<class charT> bool Fastcgipp::CoRequest<charT>::response()
+{
+    if(!m_task.m_handle)
+    {
+        m_task = coResponse();
+        if(!m_task.m_handle)
+            return true;
+    }
+
+    m_task.m_handle.resume();
+    if(!m_task.m_handle.done())
+        return false;
+
+    const std::exception_ptr exception
+        = m_task.m_handle.promise().exception;
+    m_task = Task();
+    if(exception)
+        std::rethrow_exception(exception);
+    return true;
+}
+
+template class Fastcgipp::CoRequest<char>;
+template class Fastcgipp::CoRequest<wchar_t>;
@@ -199,7 +199,8 @@ Fastcgipp::Curl_base::StreamBuf_base::StreamBuf_base(
         std::list<Fastcgipp::ChunkStreamBuf_base::Chunk>& data):
     m_handle(curl_easy_init()),
     m_headers(nullptr),
-    m_data(data)
+    m_data(data),
+    m_cancelId(0)
 {
     m_errorBuffer[0] = 0;
 }
@@ -41,10 +41,19 @@ void Fastcgipp::Curler::handler()
 
     while(!m_terminate && !(m_stop && m_queue.empty() && m_handles.empty()))
     {
+        abandon();
         if(!m_queue.empty() && m_handles.size() < m_concurrency)
         {
             while(!m_queue.empty() && m_handles.size() < m_concurrency)
             {
+                const auto& cancellation
+                    = m_queue.front().m_streamBuf->m_cancellation;
+                if(cancellation && cancellation->cancelled())
+                {
+                    m_queue.pop();
+                    ++m_cancelledCount;
+                    continue;
+                }
                 CURL* const& handle(reinterpret_cast<CURL* const&>(
                             m_queue.front().handle()));
                 m_handles.emplace(handle, m_queue.front());
@@ -100,6 +109,12 @@ void Fastcgipp::Curler::handler()
                 Curl_base curl = curlIt->second;
                 m_handles.erase(curlIt);
                 curl_multi_remove_handle(multiHandle, curl.handle());
+                if(curl.m_streamBuf->m_cancellation)
+                {
+                    curl.m_streamBuf->m_cancellation->forget(
+                            curl.m_streamBuf->m_cancelId);
+                    curl.m_streamBuf->m_cancellation.reset();
+                }
                 curl.callback();
             }
         }
@@ -107,6 +122,29 @@ void Fastcgipp::Curler::handler()
         lock.lock();
     }
 }
+
+void Fastcgipp::Curler::abandon()
+{
+    CURLM* const& multiHandle(reinterpret_cast<CURL* const&>(m_multiHandle));
+    for(const auto& cancelled: m_cancelled)
+    {
+        const auto streamBuf = cancelled.lock();
+        if(!streamBuf)
+            continue;
+        const auto curl = m_handles.find(streamBuf->m_handle);
+        if(curl != m_handles.end() && curl->second.m_streamBuf == streamBuf)
+        {
+            curl_multi_remove_handle(
+                    multiHandle,
+                    reinterpret_cast<CURL*>(streamBuf->m_handle));
+            streamBuf->m_cancellation.reset();
+            m_handles.erase(curl);
+            ++m_cancelledCount;
+        }
+    }
+    m_cancelled.clear();
+}
+
 int Fastcgipp::Curler::socketCallback(
         void* handle,
         int socket,
@@ -124,6 +162,7 @@ int Fastcgipp::Curler::socketCallback(
 
 Fastcgipp::Curler::Curler(unsigned concurrency):
     m_concurrency(concurrency),
+    m_cancelledCount(0),
     m_multiHandle(curl_multi_init())
 {
     socketpair(AF_UNIX, SOCK_STREAM, 0, m_wakeSockets);
@@ -182,6 +221,19 @@ void Fastcgipp::Curler::join()
 void Fastcgipp::Curler::queue(Curl_base& curl)
 {
     curl.prepare();
+    const auto& cancellation = curl.m_streamBuf->m_cancellation;
+    if(cancellation)
+    {
+        const std::weak_ptr<Curl_base::StreamBuf_base> streamBuf(
+                curl.m_streamBuf);
+        curl.m_streamBuf->m_cancelId = cancellation->onCancel(
+                [this, streamBuf] ()
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_cancelled.push_back(streamBuf);
+                    wake();
+                });
+    }
     std::lock_guard<std::mutex> lock(m_mutex);
     m_queue.push(curl);
     wake();
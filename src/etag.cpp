@@ -0,0 +1,234 @@
+/*!
+ * @file       etag.cpp
+ * @brief      Defines the Fastcgipp::ETagger class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/etag.hpp"
+
+#include <algorithm>
+
+namespace
+{
+    const uint64_t prime1 = 11400714785074694791ULL;
+    const uint64_t prime2 = 14029467366897019727ULL;
+    const uint64_t prime3 = 1609587929392839161ULL;
+    const uint64_t prime4 = 9650029242287828579ULL;
+    const uint64_t prime5 = 2870177450012600261ULL;
+
+    inline uint64_t rotate(uint64_t x, unsigned bits)
+    {
+        return (x << bits) | (x >> (64-bits));
+    }
+
+    //! Little endian read regardless of the host
+    template<class T> inline T read(const unsigned char* data)
+    {
+        T result = 0;
+        for(unsigned i=0; i<sizeof(T); ++i)
+            result |= T(data[i]) << (8*i);
+        return result;
+    }
+
+    inline uint64_t round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input*prime2;
+        accumulator = rotate(accumulator, 31);
+        return accumulator*prime1;
+    }
+
+    inline uint64_t merge(uint64_t accumulator, uint64_t value)
+    {
+        accumulator ^= round(0, value);
+        return accumulator*prime1 + prime4;
+    }
+}
+
+Fastcgipp::ETagger::Hash::Hash(uint64_t seed):
+    m_v{seed+prime1+prime2, seed+prime2, seed, seed-prime1},
+    m_stripeSize(0),
+    m_length(0),
+    m_seed(seed)
+{}
+
+void Fastcgipp::ETagger::Hash::update(const char* data, size_t size)
+{
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* const end = input+size;
+    m_length += size;
+
+    if(m_stripeSize != 0)
+    {
+        const size_t count = std::min(size, sizeof(m_stripe)-m_stripeSize);
+        std::copy(input, input+count, m_stripe+m_stripeSize);
+        m_stripeSize += count;
+        input += count;
+        if(m_stripeSize < sizeof(m_stripe))
+            return;
+        for(unsigned i=0; i<4; ++i)
+            m_v[i] = round(m_v[i], read<uint64_t>(m_stripe+8*i));
+        m_stripeSize = 0;
+    }
+
+    while(end-input >= 32)
+    {
+        for(unsigned i=0; i<4; ++i)
+            m_v[i] = round(m_v[i], read<uint64_t>(input+8*i));
+        input += 32;
+    }
+
+    std::copy(input, end, m_stripe);
+    m_stripeSize = end-input;
+}
+
+uint64_t Fastcgipp::ETagger::Hash::digest() const
+{
+    uint64_t hash;
+    if(m_length >= 32)
+    {
+        hash = rotate(m_v[0], 1) + rotate(m_v[1], 7)
+            + rotate(m_v[2], 12) + rotate(m_v[3], 18);
+        for(unsigned i=0; i<4; ++i)
+            hash = merge(hash, m_v[i]);
+    }
+    else
+        hash = m_seed + prime5;
+
+    hash += m_length;
+
+    const unsigned char* input = m_stripe;
+    const unsigned char* const end = m_stripe+m_stripeSize;
+    for(; end-input >= 8; input += 8)
+    {
+        hash ^= round(0, read<uint64_t>(input));
+        hash = rotate(hash, 27)*prime1 + prime4;
+    }
+    if(end-input >= 4)
+    {
+        hash ^= uint64_t(read<uint32_t>(input))*prime1;
+        hash = rotate(hash, 23)*prime2 + prime3;
+        input += 4;
+    }
+    for(; input != end; ++input)
+    {
+        hash ^= *input*prime5;
+        hash = rotate(hash, 11)*prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+Fastcgipp::ETagger::ETagger(
+        const Match& match,
+        size_t tailRoom,
+        const Sink& sink):
+    m_match(match),
+    m_notModified(false),
+    m_records(tailRoom, sink)
+{}
+
+void Fastcgipp::ETagger::write(const char* data, size_t size)
+{
+    const bool body = m_response.complete();
+    m_response.write(data, size);
+
+    if(body)
+        m_hash.update(data, size);
+    else if(m_response.complete())
+        m_hash.update(
+                m_response.data()+m_response.body(),
+                m_response.size()-m_response.body());
+}
+
+void Fastcgipp::ETagger::finish()
+{
+    std::string status;
+    if(!m_response.complete()
+            || (m_response.header("status:", status)
+                && status.compare(0, 3, "200")!=0))
+    {
+        m_records.copy(m_response.data(), m_response.size());
+        m_records.send();
+        return;
+    }
+
+    std::string added;
+    if(!m_response.header("etag:", m_tag))
+    {
+        static const char hex[] = "0123456789abcdef";
+        const uint64_t hash = m_hash.digest();
+        m_tag.assign(18, '"');
+        for(unsigned i=0; i<16; ++i)
+            m_tag[16-i] = hex[(hash >> 4*i) & 0xf];
+        added = "ETag: " + m_tag + "\r\n";
+    }
+
+    const size_t blankLine = m_response.blankLine();
+    if(m_match && m_match(m_tag))
+    {
+        // Keep everything but the status and what describes the body
+        static const char statusLine[] = "Status: 304 Not Modified\r\n";
+        m_records.copy(statusLine, sizeof(statusLine)-1);
+
+        const char* const headersEnd = m_response.data()+blankLine;
+        const char* line = m_response.data();
+        while(line < headersEnd)
+        {
+            const char* const lineEnd = std::find(line, headersEnd, '\n')+1;
+            bool keep = true;
+            for(const char* field: {
+                    "status:",
+                    "content-type:",
+                    "content-length:",
+                    "content-encoding:"})
+                if(Filter::Response::field(line, lineEnd, field))
+                {
+                    keep = false;
+                    break;
+                }
+            if(keep)
+                m_records.copy(line, lineEnd-line);
+            line = lineEnd;
+        }
+        m_records.copy(added.data(), added.size());
+        m_records.copy("\r\n", 2);
+        m_notModified = true;
+    }
+    else
+    {
+        m_records.copy(m_response.data(), blankLine);
+        m_records.copy(added.data(), added.size());
+        m_records.copy(
+                m_response.data()+blankLine,
+                m_response.size()-blankLine);
+    }
+    m_records.send();
+    m_response.clear();
+}
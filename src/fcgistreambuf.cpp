@@ -33,6 +33,21 @@
 
 namespace Fastcgipp
 {
+    template <>
+    void Fastcgipp::FcgiStreambuf<wchar_t, std::char_traits<wchar_t>>::setBuffer()
+    {
+        m_buffer.reset(new wchar_t[m_bufferSize]);
+        this->setp(m_buffer.get(), m_buffer.get()+m_bufferSize);
+    }
+
+    template <>
+    void Fastcgipp::FcgiStreambuf<char, std::char_traits<char>>::setBuffer()
+    {
+        m_record.reserve(Protocol::getRecordSize(m_bufferSize)+s_tailRoom);
+        char* const body = m_record.begin()+sizeof(Protocol::Header);
+        this->setp(body, body+m_bufferSize);
+    }
+
     template <> bool
     Fastcgipp::FcgiStreambuf<wchar_t, std::char_traits<wchar_t>>::emptyBuffer()
     {
@@ -44,19 +59,19 @@ namespace Fastcgipp
         char* toNext;
         const wchar_t* from = this->pbase();
         const wchar_t* const fromEnd = this->pptr();
+        // Most characters we can fit in a single record
+        const size_t limit = 0xffffU/converter.max_length();
 
         while((count = fromEnd - from) != 0)
         {
+            count = std::min(count, limit);
             record.reserve(
                     Protocol::getRecordSize(count*converter.max_length()));
 
-            Protocol::Header& header
-                = *reinterpret_cast<Protocol::Header*>(record.begin());
-
             result = converter.out(
                     state,
                     from,
-                    fromEnd,
+                    from+count,
                     from,
                     record.begin()+sizeof(Protocol::Header),
                     &*record.end(),
@@ -66,65 +81,208 @@ namespace Fastcgipp
                     || result == std::codecvt_base::noconv)
             {
                 ERROR_LOG("FcgiStreambuf code conversion failed")
-                pbump(-count);
+                pbump(-(fromEnd-from));
                 return false;
             }
-            header.contentLength = std::distance(
+
+            const size_t contentLength = std::distance(
                     record.begin()+sizeof(Protocol::Header),
                     toNext);
-            record.size(Protocol::getRecordSize(header.contentLength));
-
-            header.version = Protocol::version;
-            header.type = m_type;
-            header.fcgiId = m_id.m_id;
-            header.paddingLength =
-                record.size()-header.contentLength-sizeof(Protocol::Header);
-
-            send(m_id.m_socket, std::move(record));
+            transmit(std::move(record), contentLength);
         }
 
-        this->setp(m_buffer, m_buffer+s_buffSize);
+        if(m_buffer)
+            this->setp(m_buffer.get(), m_buffer.get()+m_bufferSize);
+        else
+            setBuffer();
         return true;
     }
 
     template <>
     bool Fastcgipp::FcgiStreambuf<char, std::char_traits<char>>::emptyBuffer()
     {
-        Block record;
-        size_t count;
+        const size_t count = this->pptr() - this->pbase();
+        if(count == 0)
+        {
+            if(this->pbase() == nullptr)
+                setBuffer();
+            return true;
+        }
 
-        const char* from = this->pbase();
-        const char* const fromEnd = this->pptr();
+        if(m_compressor || m_etagger)
+        {
+            // The put area can be reused as is
+            filter(this->pbase(), count);
+            this->setp(this->pbase(), this->epptr());
+            return true;
+        }
 
-        while((count = fromEnd - from) != 0)
+        sendRecord(std::move(m_record), count);
+
+        // The next put area is only allocated if more data is written
+        this->setp(nullptr, nullptr);
+        return true;
+    }
+}
+
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::collect(
+        Block& tail,
+        bool terminate)
+{
+    const auto sendRecord = send;
+    send = [&tail] (const Socket&, Block&& record)
+    {
+        if(tail.size() == 0)
+            tail = std::move(record);
+        else
         {
-            record.size(Protocol::getRecordSize(count));
+            const size_t size = tail.size();
+            tail.size(size+record.size());
+            std::copy(record.begin(), record.end(), tail.begin()+size);
+        }
+    };
+    // An empty put area needs no flushing, and nothing reallocated for it
+    if(this->pptr() != this->pbase())
+        emptyBuffer();
+    if(terminate && m_compressor)
+        m_compressor->finish();
+    if(terminate && m_etagger)
+        m_etagger->finish();
+    send = sendRecord;
+
+    if(terminate)
+    {
+        const size_t size = tail.size();
+        tail.size(size+sizeof(Protocol::Header));
 
-            Protocol::Header& header
-                = *reinterpret_cast<Protocol::Header*>(record.begin());
-            header.contentLength = std::min(
-                    count,
-                    static_cast<size_t>(0xffffU));
+        Protocol::Header& header
+            = *reinterpret_cast<Protocol::Header*>(tail.begin()+size);
+        header.version = Protocol::version;
+        header.type = m_type;
+        header.fcgiId = m_id.m_id;
+        header.contentLength = 0;
+        header.paddingLength = 0;
+    }
+}
 
-            std::copy(
-                    from,
-                    from+header.contentLength,
-                    record.begin()+sizeof(Protocol::Header));
+template <class charT, class traits>
+int Fastcgipp::FcgiStreambuf<charT, traits>::sync()
+{
+    const bool result = this->pptr() == this->pbase() || emptyBuffer();
+    if(m_compressor)
+        m_compressor->flush();
+    return result?0:-1;
+}
+
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::filter(
+        const char* data,
+        size_t size)
+{
+    if(m_compressor)
+        m_compressor->write(data, size);
+    else
+        m_etagger->write(data, size);
+}
 
-            from += header.contentLength;
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::deliver(
+        Block&& record,
+        size_t contentLength)
+{
+    if(m_etagger)
+        m_etagger->write(
+                record.begin()+sizeof(Protocol::Header),
+                contentLength);
+    else
+        sendRecord(std::move(record), contentLength);
+}
 
-            header.version = Protocol::version;
-            header.type = m_type;
-            header.fcgiId = m_id.m_id;
-            header.paddingLength =
-                record.size()-header.contentLength-sizeof(Protocol::Header);
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::transmit(
+        Block&& record,
+        size_t contentLength)
+{
+    if(m_compressor)
+        m_compressor->write(
+                record.begin()+sizeof(Protocol::Header),
+                contentLength);
+    else
+        deliver(std::move(record), contentLength);
+}
 
-            send(m_id.m_socket, std::move(record));
-        }
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::sendRecord(
+        Block&& record,
+        size_t contentLength)
+{
+    record.size(Protocol::getRecordSize(contentLength));
+
+    Protocol::Header& header
+        = *reinterpret_cast<Protocol::Header*>(record.begin());
+    header.version = Protocol::version;
+    header.type = m_type;
+    header.fcgiId = m_id.m_id;
+    header.contentLength = contentLength;
+    header.paddingLength =
+        record.size()-contentLength-sizeof(Protocol::Header);
+
+    send(m_id.m_socket, std::move(record));
+}
 
-        this->setp(m_buffer, m_buffer+s_buffSize);
-        return true;
-    }
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::compress(
+        Compressor::Coding coding,
+        size_t threshold)
+{
+    if(coding == Compressor::Coding::IDENTITY
+            || !Compressor::supported(coding))
+        m_compressor.reset();
+    else
+        m_compressor.reset(new Compressor(
+                    coding,
+                    threshold,
+                    s_tailRoom,
+                    [this] (Block&& record, size_t contentLength)
+                    {
+                        deliver(std::move(record), contentLength);
+                    }));
+}
+
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::etag(
+        const ETagger::Match& match)
+{
+    m_etagger.reset(new ETagger(
+                match,
+                s_tailRoom,
+                [this] (Block&& record, size_t contentLength)
+                {
+                    sendRecord(std::move(record), contentLength);
+                }));
+}
+
+template <class charT, class traits>
+bool Fastcgipp::FcgiStreambuf<charT, traits>::release()
+{
+    if(this->pptr() != this->pbase())
+        return false;
+
+    m_record = Block();
+    m_buffer.reset();
+    this->setp(nullptr, nullptr);
+    return true;
+}
+
+template <class charT, class traits>
+void Fastcgipp::FcgiStreambuf<charT, traits>::bufferSize(size_t size)
+{
+    emptyBuffer();
+    m_bufferSize = std::max(
+            std::min(size, size_t(0xffffU)),
+            size_t(s_minBufferSize));
+    setBuffer();
 }
 
 template <class charT, class traits>
@@ -133,6 +291,11 @@ void Fastcgipp::FcgiStreambuf<charT, traits>::dump(
         size_t size)
 {
     emptyBuffer();
+    if(m_compressor || m_etagger)
+    {
+        filter(data, size);
+        return;
+    }
     Block record;
 
     while(size != 0)
@@ -173,23 +336,12 @@ void Fastcgipp::FcgiStreambuf<charT, traits>::dump(
     {
         record.reserve(Protocol::getRecordSize(maxContentLength));
 
-        Protocol::Header& header
-            = *reinterpret_cast<Protocol::Header*>(record.begin());
-
         stream.read(record.begin()+sizeof(Protocol::Header), maxContentLength);
-        header.contentLength = stream.gcount();
-        if(header.contentLength == 0)
+        const size_t contentLength = stream.gcount();
+        if(contentLength == 0)
             break;
 
-        record.size(Protocol::getRecordSize(header.contentLength));
-
-        header.version = Protocol::version;
-        header.type = m_type;
-        header.fcgiId = m_id.m_id;
-        header.paddingLength =
-            record.size()-header.contentLength-sizeof(Protocol::Header);
-
-        send(m_id.m_socket, std::move(record));
+        transmit(std::move(record), contentLength);
     }
 }
 
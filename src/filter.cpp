@@ -0,0 +1,176 @@
+/*!
+ * @file       filter.cpp
+ * @brief      Defines the Fastcgipp::Filter classes
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/filter.hpp"
+#include "fastcgi++/protocol.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+void Fastcgipp::Filter::Response::write(const char* data, size_t size)
+{
+    const size_t scanned = m_data.size();
+    m_data.insert(m_data.end(), data, data+size);
+    if(m_body == 0)
+        scan(scanned);
+}
+
+void Fastcgipp::Filter::Response::scan(size_t from)
+{
+    // Back up enough to catch a blank line split across writes
+    size_t position = from<2?0:from-2;
+    if(position == 0 && !m_data.empty())
+    {
+        // No headers at all
+        if(m_data[0] == '\n')
+            m_body = 1;
+        else if(m_data.size() >= 2
+                && m_data[0] == '\r'
+                && m_data[1] == '\n')
+            m_body = 2;
+    }
+
+    while(m_body == 0)
+    {
+        const char* const begin = m_data.data();
+        const char* const newline = static_cast<const char*>(std::memchr(
+                    begin+position,
+                    '\n',
+                    m_data.size()-position));
+        if(newline == nullptr)
+            return;
+        position = newline-begin+1;
+
+        if(position < m_data.size() && m_data[position] == '\n')
+        {
+            m_blankLine = position;
+            m_body = position+1;
+        }
+        else if(position+1 < m_data.size()
+                && m_data[position] == '\r'
+                && m_data[position+1] == '\n')
+        {
+            m_blankLine = position;
+            m_body = position+2;
+        }
+    }
+}
+
+bool Fastcgipp::Filter::Response::field(
+        const char* line,
+        const char* end,
+        const char* field)
+{
+    const size_t length = std::strlen(field);
+    return size_t(end-line) >= length && std::equal(
+            field,
+            field+length,
+            line,
+            [] (char x, char y)
+            {
+                return x == std::tolower(y);
+            });
+}
+
+bool Fastcgipp::Filter::Response::header(
+        const char* field,
+        std::string& value) const
+{
+    const char* const headersEnd = m_data.data()+m_blankLine;
+    const char* line = m_data.data();
+    while(line < headersEnd)
+    {
+        const char* const lineEnd = std::find(line, headersEnd, '\n');
+        if(Response::field(line, lineEnd, field))
+        {
+            const char* valueBegin = line+std::strlen(field);
+            const char* valueEnd = lineEnd;
+            while(valueBegin < valueEnd && *valueBegin == ' ')
+                ++valueBegin;
+            while(valueEnd > valueBegin
+                    && (*(valueEnd-1) == '\r' || *(valueEnd-1) == ' '))
+                --valueEnd;
+            value.assign(valueBegin, valueEnd);
+            return true;
+        }
+        line = lineEnd+1;
+    }
+    return false;
+}
+
+bool Fastcgipp::Filter::Response::header(const char* field) const
+{
+    std::string value;
+    return header(field, value);
+}
+
+void Fastcgipp::Filter::Response::clear()
+{
+    m_data.clear();
+    m_data.shrink_to_fit();
+}
+
+void Fastcgipp::Filter::Records::copy(const char* data, size_t size)
+{
+    while(size != 0)
+    {
+        size_t count;
+        char* const space = this->space(count);
+        count = std::min(size, count);
+        std::copy(data, data+count, space);
+        commit(count);
+        data += count;
+        size -= count;
+    }
+}
+
+char* Fastcgipp::Filter::Records::space(size_t& size)
+{
+    if(m_record.reserve() == 0)
+        m_record.reserve(Protocol::getRecordSize(s_recordSize)+m_tailRoom);
+    size = s_recordSize-m_contentLength;
+    return m_record.begin()+sizeof(Protocol::Header)+m_contentLength;
+}
+
+void Fastcgipp::Filter::Records::commit(size_t size)
+{
+    m_contentLength += size;
+    if(m_contentLength == s_recordSize)
+        send();
+}
+
+void Fastcgipp::Filter::Records::send()
+{
+    if(m_contentLength == 0)
+        return;
+    m_sink(std::move(m_record), m_contentLength);
+    m_contentLength = 0;
+}
+
+const size_t Fastcgipp::Filter::Records::s_recordSize;
@@ -0,0 +1,128 @@
+/*!
+ * @file       flight.cpp
+ * @brief      Defines the Fastcgipp::Flight class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/flight.hpp"
+#include "fastcgi++/responsecache.hpp"
+
+#include <algorithm>
+
+bool Fastcgipp::Flight::join(const Protocol::RequestId& id, bool kill)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_landed)
+        return false;
+
+    if(m_history.size() != 0)
+        m_send(id.m_socket, ResponseCache::rewrite(m_history, id.m_id), false);
+    m_followers.push_back({id, kill});
+    return true;
+}
+
+void Fastcgipp::Flight::relay(const Block& data, bool last)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_landed)
+        return;
+
+    for(const auto& follower: m_followers)
+        m_send(
+                follower.id.m_socket,
+                ResponseCache::rewrite(data, follower.id.m_id),
+                last && follower.kill);
+
+    if(last)
+        land(lock);
+    else
+    {
+        const size_t size = m_history.size();
+        if(size+data.size() > m_history.reserve())
+            m_history.reserve(std::max(size+data.size(), 2*m_history.reserve()));
+        m_history.size(size+data.size());
+        std::copy(data.begin(), data.end(), m_history.begin()+size);
+    }
+}
+
+void Fastcgipp::Flight::leave(const Protocol::RequestId& id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto follower = std::find_if(
+            m_followers.begin(),
+            m_followers.end(),
+            [&id] (const Follower& follower)
+            {
+                return follower.id.m_id == id.m_id
+                    && follower.id.m_socket == id.m_socket;
+            });
+    if(follower == m_followers.end())
+        return;
+
+    end(*follower);
+    m_followers.erase(follower);
+}
+
+void Fastcgipp::Flight::abort()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if(m_landed)
+        return;
+
+    for(const auto& follower: m_followers)
+        end(follower);
+
+    land(lock);
+}
+
+void Fastcgipp::Flight::end(const Follower& follower)
+{
+    Block record(sizeof(Protocol::Header)+sizeof(Protocol::EndRequest));
+
+    Protocol::Header& header
+        = *reinterpret_cast<Protocol::Header*>(record.begin());
+    header.version = Protocol::version;
+    header.type = Protocol::RecordType::END_REQUEST;
+    header.fcgiId = follower.id.m_id;
+    header.contentLength = sizeof(Protocol::EndRequest);
+    header.paddingLength = 0;
+
+    Protocol::EndRequest& body = *reinterpret_cast<Protocol::EndRequest*>(
+            record.begin()+sizeof(header));
+    body.appStatus = 1;
+    body.protocolStatus = Protocol::ProtocolStatus::REQUEST_COMPLETE;
+
+    m_send(follower.id.m_socket, std::move(record), follower.kill);
+}
+
+void Fastcgipp::Flight::land(std::unique_lock<std::mutex>& lock)
+{
+    m_landed = true;
+    m_followers.clear();
+    m_history.clear();
+    lock.unlock();
+    if(m_land)
+        m_land();
+}
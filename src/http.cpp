@@ -25,12 +25,16 @@
 * along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
 *******************************************************************************/
 
+#include <algorithm>
 #include <locale>
 #include <codecvt>
 #include <utility>
 #include <sstream>
 #include <iomanip>
-#include <random>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "fastcgi++/log.hpp"
 #include "fastcgi++/http.hpp"
@@ -76,6 +80,54 @@ intT Fastcgipp::Http::atoi(const charT* start, const charT* end)
     return neg?-result:result;
 }
 
+void Fastcgipp::Http::parseETags(
+        const char* start,
+        const char* const end,
+        std::vector<std::string>& tags)
+{
+    while(start < end)
+    {
+        if(*start == ' ' || *start == '\t' || *start == ',')
+        {
+            ++start;
+            continue;
+        }
+
+        if(*start == '*')
+        {
+            tags.emplace_back("*");
+            ++start;
+            continue;
+        }
+
+        if(end-start >= 2 && start[0] == 'W' && start[1] == '/')
+            start += 2;
+
+        const char* tagEnd;
+        if(start < end && *start == '"')
+        {
+            tagEnd = std::find(start+1, end, '"');
+            if(tagEnd == end)
+                break;
+            ++tagEnd;
+            tags.emplace_back(start, tagEnd);
+        }
+        else
+        {
+            tagEnd = start;
+            while(tagEnd < end && *tagEnd != ',' && *tagEnd != ' '
+                    && *tagEnd != '\t')
+                ++tagEnd;
+            if(tagEnd == start)
+                continue;
+            tags.emplace_back(1, '"');
+            tags.back().append(start, tagEnd);
+            tags.back() += '"';
+        }
+        start = tagEnd;
+    }
+}
+
 template float Fastcgipp::Http::atof<char>(const char* start, const char* end);
 template float Fastcgipp::Http::atof<wchar_t>(
         const wchar_t* start,
@@ -358,7 +410,14 @@ template<class charT> void Fastcgipp::Http::Environment<charT>::fill(
             break;
         case 18:
             if(std::equal(name, value, "HTTP_IF_NONE_MATCH"))
-                etag=atoi(&*value, &*end);
+            {
+                parseETags(value, end, ifNoneMatch);
+                if(!ifNoneMatch.empty() && ifNoneMatch.front().size() > 2)
+                    etag=atoi(
+                            ifNoneMatch.front().data()+1,
+                            ifNoneMatch.front().data()
+                                +ifNoneMatch.front().size()-1);
+            }
             else if(std::equal(name, value, "HTTP_AUTHORIZATION"))
                 vecToString(value, end, authorization);
             else
@@ -401,6 +460,8 @@ template<class charT> void Fastcgipp::Http::Environment<charT>::fill(
                     groupStart = groupEnd+1;
                 }
             }
+            else if(std::equal(name, value, "HTTP_ACCEPT_ENCODING"))
+                acceptEncodings.assign(&*value, &*end);
             else
                 processed=false;
             break;
@@ -438,21 +499,117 @@ template<class charT> void Fastcgipp::Http::Environment<charT>::fill(
     }
 }
 
+namespace
+{
+    const std::string multipartStr("multipart/form-data");
+    const std::string urlEncodedStr("application/x-www-form-urlencoded");
+
+    //! Write an entire chunk of data out to a file descriptor
+    bool writeAll(int fd, const char* start, const char* const end)
+    {
+        while(start != end)
+        {
+            const ssize_t written = ::write(fd, start, end-start);
+            if(written < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            start += written;
+        }
+        return true;
+    }
+
+    //! Build a multipart delimiter: CRLF, two dashes and the boundary
+    /*!
+     * The post data is treated as though it is preceded by a CRLF so the
+     * first boundary is found like any other delimiter.
+     */
+    std::vector<char> makeDelimiter(const std::vector<char>& boundary)
+    {
+        static const char prefix[] = "\r\n--";
+        std::vector<char> delimiter(prefix, prefix+sizeof(prefix)-1);
+        delimiter.insert(delimiter.end(), boundary.cbegin(), boundary.cend());
+        return delimiter;
+    }
+
+    //! Create an anonymous file to spool upload data into
+    int spoolFile()
+    {
+#ifdef FASTCGIPP_LINUX
+        return memfd_create("fastcgi++", MFD_CLOEXEC);
+#else
+        char name[] = "/tmp/fastcgi++XXXXXX";
+        const int fd = mkstemp(name);
+        if(fd != -1)
+            unlink(name);
+        return fd;
+#endif
+    }
+}
+
+template<class charT>
+Fastcgipp::Http::Environment<charT>::Multipart::Multipart(
+        const std::vector<char>& boundary):
+    state(BODY),
+    delimiter(makeDelimiter(boundary)),
+    searcher(delimiter.cbegin(), delimiter.cend()),
+    carry(delimiter.cbegin(), delimiter.cbegin()+2),
+    matched(0),
+    active(false),
+    named(false),
+    isFile(false),
+    reserve(0)
+{}
+
+template<class charT>
+bool Fastcgipp::Http::Environment<charT>::fillMultipart(
+        const char* const start,
+        const char* const end)
+{
+    if(m_postSize == 0 && std::equal(
+                multipartStr.cbegin(),
+                multipartStr.cend(),
+                contentType.cbegin(),
+                contentType.cend()))
+        m_multipart.reset(new Multipart(boundary));
+    m_postSize += end-start;
+
+    if(!m_multipart)
+        return false;
+    parsePostsMultipart(start, end);
+    return true;
+}
+
+template<class charT>
+void Fastcgipp::Http::Environment<charT>::fillPostBuffer(
+        const char* const start,
+        const char* const end)
+{
+    if(!fillMultipart(start, end))
+        m_postBuffer.append(start, end);
+}
+
 template<class charT>
 void Fastcgipp::Http::Environment<charT>::fillPostBuffer(
+        Block&& block,
         const char* const start,
         const char* const end)
 {
-    if(m_postBuffer.empty())
-        m_postBuffer.reserve(contentLength);
-    m_postBuffer.insert(m_postBuffer.end(), start, end);
+    if(!fillMultipart(start, end))
+        m_postBuffer.append(std::move(block), start, end);
 }
 
 template<class charT>
 bool Fastcgipp::Http::Environment<charT>::parsePostBuffer()
 {
-    static const std::string multipartStr("multipart/form-data");
-    static const std::string urlEncodedStr("application/x-www-form-urlencoded");
+    if(m_multipart)
+    {
+        // Anything still in progress at this point is truncated
+        m_multipart.reset();
+        return true;
+    }
 
     if(!m_postBuffer.size())
         return true;
@@ -460,15 +617,6 @@ bool Fastcgipp::Http::Environment<charT>::parsePostBuffer()
     bool parsed = false;
 
     if(std::equal(
-                multipartStr.cbegin(),
-                multipartStr.cend(),
-                contentType.cbegin(),
-                contentType.cend()))
-    {
-        parsePostsMultipart();
-        parsed = true;
-    }
-    else if(std::equal(
                 urlEncodedStr.cbegin(),
                 urlEncodedStr.cend(),
                 contentType.cbegin(),
@@ -482,220 +630,436 @@ bool Fastcgipp::Http::Environment<charT>::parsePostBuffer()
 }
 
 template<class charT>
-void Fastcgipp::Http::Environment<charT>::parsePostsMultipart()
+void Fastcgipp::Http::Environment<charT>::parsePostsMultipart(
+        const char* data,
+        const char* const dataEnd)
 {
-    static const std::string cName("name=\"");
-    static const std::string cFilename("filename=\"");
-    static const std::string cContentType("Content-Type: ");
-    static const std::string cBody("\r\n\r\n");
-
-    const char* const postBufferStart = m_postBuffer.data();
-    const char* const postBufferEnd = m_postBuffer.data() + m_postBuffer.size();
+    static const char cTerminator[] = "\r\n\r\n";
+    static const size_t maxHeaderSize = 0x10000;
 
-    auto nameStart(postBufferEnd);
-    auto nameEnd(postBufferEnd);
-    auto filenameStart(postBufferEnd);
-    auto filenameEnd(postBufferEnd);
-    auto contentTypeStart(postBufferEnd);
-    auto contentTypeEnd(postBufferEnd);
-    auto bodyStart(postBufferEnd);
-    auto bodyEnd(postBufferEnd);
+    Multipart& multipart = *m_multipart;
+    const auto delimiterBegin = multipart.delimiter.cbegin();
+    const size_t delimiterSize = multipart.delimiter.size();
 
-    enum State
+    // Length of the longest suffix of [start, end) that could be the start of
+    // a delimiter. Every delimiter starts with a CR so only those positions
+    // need be verified.
+    const auto partialDelimiter = [&] (const char* start, const char* end)
     {
-        HEADER,
-        NAME,
-        FILENAME,
-        CONTENT_TYPE,
-        BODY
-    } state=HEADER;
-
-    for(auto byte = postBufferStart; byte < postBufferEnd; ++byte)
+        if(size_t(end-start) > delimiterSize-1)
+            start = end-(delimiterSize-1);
+        while((start = static_cast<const char*>(
+                        std::memchr(start, '\r', end-start))))
+        {
+            if(std::equal(start, end, delimiterBegin))
+                return size_t(end-start);
+            ++start;
+        }
+        return size_t(0);
+    };
+
+    while(data != dataEnd)
     {
-        switch(state)
+        switch(multipart.state)
         {
-            case HEADER:
+            case Multipart::BODY:
             {
-                const size_t bytesLeft = size_t(postBufferEnd-byte);
-
-                if(
-                        nameEnd == postBufferEnd &&
-                        bytesLeft >= cName.size() &&
-                        std::equal(cName.begin(), cName.end(), byte))
-                {
-                    byte += cName.size()-1;
-                    nameStart = byte+1;
-                    state = NAME;
-                }
-                else if(
-                        filenameEnd == postBufferEnd &&
-                        bytesLeft >= cFilename.size() &&
-                        std::equal(cFilename.begin(), cFilename.end(), byte))
+                auto& carry = multipart.carry;
+                if(!carry.empty())
                 {
-                    byte += cFilename.size()-1;
-                    filenameStart = byte+1;
-                    state = FILENAME;
+                    // A delimiter might start in the carried over bytes
+                    const size_t carried = carry.size();
+                    const size_t borrowed = std::min(
+                            size_t(dataEnd-data),
+                            delimiterSize-1);
+                    carry.insert(carry.end(), data, data+borrowed);
+
+                    const auto match = multipart.searcher(
+                            carry.cbegin(),
+                            carry.cend()).first;
+                    if(match != carry.cend())
+                    {
+                        const size_t position = match-carry.cbegin();
+                        multipartData(carry.data(), carry.data()+position);
+                        data += position+delimiterSize-carried;
+                        carry.clear();
+                        multipartComplete();
+                        multipart.state = Multipart::BOUNDARY;
+                    }
+                    else if(data+borrowed == dataEnd)
+                    {
+                        const size_t partial = partialDelimiter(
+                                carry.data(),
+                                carry.data()+carry.size());
+                        multipartData(
+                                carry.data(),
+                                carry.data()+carry.size()-partial);
+                        carry.erase(carry.begin(), carry.end()-partial);
+                        data = dataEnd;
+                    }
+                    else
+                    {
+                        // No delimiter can start in the carried bytes
+                        multipartData(carry.data(), carry.data()+carried);
+                        carry.clear();
+                    }
+                    break;
                 }
-                else if(
-                        contentTypeEnd == postBufferEnd &&
-                        bytesLeft >= cContentType.size() &&
-                        std::equal(cContentType.begin(), cContentType.end(), byte))
+
+                const char* const match = multipart.searcher(
+                        data,
+                        dataEnd).first;
+                if(match != dataEnd)
                 {
-                    byte += cContentType.size()-1;
-                    contentTypeStart = byte+1;
-                    state = CONTENT_TYPE;
+                    multipartData(data, match);
+                    data = match+delimiterSize;
+                    multipartComplete();
+                    multipart.state = Multipart::BOUNDARY;
                 }
-                else if(
-                        bodyEnd == postBufferEnd &&
-                        bytesLeft >= cBody.size() &&
-                        std::equal(cBody.begin(), cBody.end(), byte))
+                else
                 {
-                    byte += cBody.size()-1;
-                    bodyStart = byte+1;
-                    state = BODY;
+                    const size_t partial = partialDelimiter(data, dataEnd);
+                    multipartData(data, dataEnd-partial);
+                    carry.assign(dataEnd-partial, dataEnd);
+                    data = dataEnd;
                 }
-
                 break;
             }
 
-            case NAME:
+            case Multipart::BOUNDARY:
             {
-                if(*byte == '"')
+                if(*data == '-')
+                    multipart.state = Multipart::EPILOGUE;
+                else if(*data == '\n')
                 {
-                    nameEnd=byte;
-                    state=HEADER;
+                    // Start as though a CRLF was already matched so an empty
+                    // header is properly terminated.
+                    multipart.matched = 2;
+                    multipart.state = Multipart::HEADER;
                 }
+                ++data;
                 break;
             }
 
-            case FILENAME:
+            case Multipart::HEADER:
             {
-                if(*byte == '"')
+                const char* byte = data;
+                while(byte != dataEnd && multipart.matched != 4)
                 {
-                    filenameEnd=byte;
-                    state=HEADER;
+                    if(multipart.matched == 0)
+                    {
+                        // Skip straight to the next possible terminator
+                        byte = static_cast<const char*>(
+                                std::memchr(byte, '\r', dataEnd-byte));
+                        if(byte == nullptr)
+                        {
+                            byte = dataEnd;
+                            break;
+                        }
+                    }
+
+                    if(*byte == cTerminator[multipart.matched])
+                        ++multipart.matched;
+                    else
+                        multipart.matched = *byte=='\r'?1:0;
+                    ++byte;
+                }
+                multipart.carry.insert(multipart.carry.end(), data, byte);
+                data = byte;
+
+                if(multipart.matched == 4)
+                {
+                    multipartHeader(
+                            multipart.carry.data(),
+                            multipart.carry.data()+multipart.carry.size());
+                    multipart.carry.clear();
+                    multipart.state = Multipart::BODY;
+                }
+                else if(multipart.carry.size() > maxHeaderSize)
+                {
+                    WARNING_LOG("Multipart header too large. Discarding "\
+                            "remaining post data.")
+                    multipart.carry.clear();
+                    multipart.state = Multipart::EPILOGUE;
                 }
                 break;
             }
 
-            case CONTENT_TYPE:
+            case Multipart::EPILOGUE:
             {
-                if(*byte == '\r' || *byte == '\n')
-                {
-                    contentTypeEnd = byte--;
-                    state=HEADER;
-                }
+                data = dataEnd;
                 break;
             }
+        }
+    }
+}
+
+template<class charT>
+void Fastcgipp::Http::Environment<charT>::multipartHeader(
+        const char* const headerStart,
+        const char* const headerEnd)
+{
+    static const std::string cName("name=");
+    static const std::string cFilename("filename=");
+    static const std::string cContentType("Content-Type: ");
+
+    Multipart& multipart = *m_multipart;
 
-            case BODY:
+    const char* nameStart = nullptr;
+    const char* nameEnd = nullptr;
+    const char* filenameStart = nullptr;
+    const char* filenameEnd = nullptr;
+    const char* contentTypeStart = nullptr;
+    const char* contentTypeEnd = nullptr;
+
+    // True if [start, end) ends with the token as a whole parameter name
+    const auto endsWith = [] (
+            const char* start,
+            const char* end,
+            const std::string& token)
+    {
+        if(size_t(end-start) < token.size()
+                || !std::equal(token.cbegin(), token.cend(), end-token.size()))
+            return false;
+        const char* const before = end-token.size();
+        return before == start
+            || *(before-1) == ';'
+            || *(before-1) == ' '
+            || *(before-1) == '\t';
+    };
+
+    for(const char* line = headerStart; line < headerEnd;)
+    {
+        const char* lineEnd = static_cast<const char*>(
+                std::memchr(line, '\n', headerEnd-line));
+        if(lineEnd == nullptr)
+            lineEnd = headerEnd;
+        const char* const valueEnd =
+            lineEnd != line && *(lineEnd-1) == '\r' ? lineEnd-1 : lineEnd;
+
+        if(
+                contentTypeEnd == nullptr &&
+                size_t(valueEnd-line) >= cContentType.size() &&
+                std::equal(cContentType.cbegin(), cContentType.cend(), line))
+        {
+            contentTypeStart = line+cContentType.size();
+            contentTypeEnd = valueEnd;
+        }
+        else
+        {
+            // Jump from quote to quote looking at what precedes each value
+            const char* quote = line;
+            while((quote = static_cast<const char*>(
+                            std::memchr(quote, '"', valueEnd-quote))))
             {
-                const size_t bytesLeft = size_t(postBufferEnd-byte);
+                const char* const start = quote+1;
+                const char* const end = static_cast<const char*>(
+                        std::memchr(start, '"', valueEnd-start));
+                if(end == nullptr)
+                    break;
 
-                if(
-                        bytesLeft >= boundary.size() &&
-                        std::equal(boundary.begin(), boundary.end(), byte))
+                if(endsWith(line, quote, cFilename))
                 {
-                    bodyEnd = byte-2;
-                    if(bodyEnd<bodyStart)
-                        bodyEnd = bodyStart;
-                    else if(
-                            bodyEnd-bodyStart>=2
-                            && *(bodyEnd-1)=='\n'
-                            && *(bodyEnd-2)=='\r')
-                        bodyEnd -= 2;
-
-                    if(nameEnd != postBufferEnd)
+                    if(filenameEnd == nullptr)
                     {
-                        std::basic_string<charT> name;
-                        vecToString(nameStart, nameEnd, name);
-
-                        if(contentTypeEnd != postBufferEnd)
-                        {
-                            File<charT> file;
-                            vecToString(
-                                    contentTypeStart,
-                                    contentTypeEnd,
-                                    file.contentType);
-                            if(filenameEnd != postBufferEnd)
-                                vecToString(
-                                        filenameStart,
-                                        filenameEnd,
-                                        file.filename);
-
-                            file.size = bodyEnd-bodyStart;
-                            file.data.reset(new char[file.size]);
-                            std::copy(bodyStart, bodyEnd, file.data.get());
-
-                            files.insert(std::make_pair(
-                                        std::move(name),
-                                        std::move(file)));
-                        }
-                        else
-                        {
-                            std::basic_string<charT> value;
-                            vecToString(bodyStart, bodyEnd, value);
-                            posts.insert(std::make_pair(
-                                        std::move(name),
-                                        std::move(value)));
-                        }
+                        filenameStart = start;
+                        filenameEnd = end;
                     }
-
-                    state=HEADER;
-                    nameStart = postBufferEnd;
-                    nameEnd = postBufferEnd;
-                    filenameStart = postBufferEnd;
-                    filenameEnd = postBufferEnd;
-                    contentTypeStart = postBufferEnd;
-                    contentTypeEnd = postBufferEnd;
-                    bodyStart = postBufferEnd;
-                    bodyEnd = postBufferEnd;
                 }
-
-                break;
+                else if(endsWith(line, quote, cName))
+                {
+                    if(nameEnd == nullptr)
+                    {
+                        nameStart = start;
+                        nameEnd = end;
+                    }
+                }
+                quote = end+1;
             }
         }
+
+        line = lineEnd==headerEnd ? headerEnd : lineEnd+1;
+    }
+
+    multipart.active = true;
+    multipart.named = nameEnd != nullptr;
+    multipart.isFile = contentTypeEnd != nullptr;
+    multipart.name.clear();
+    multipart.value.clear();
+    multipart.file = File<charT>();
+    multipart.reserve = 0;
+
+    if(multipart.named)
+        vecToString(nameStart, nameEnd, multipart.name);
+    if(multipart.isFile)
+    {
+        vecToString(
+                contentTypeStart,
+                contentTypeEnd,
+                multipart.file.contentType);
+        if(filenameEnd != nullptr)
+            vecToString(
+                    filenameStart,
+                    filenameEnd,
+                    multipart.file.filename);
     }
 }
 
+template<class charT>
+void Fastcgipp::Http::Environment<charT>::multipartData(
+        const char* const start,
+        const char* const end)
+{
+    Multipart& multipart = *m_multipart;
+    if(!multipart.active || !multipart.named || start == end)
+        return;
+
+    const size_t size = end-start;
+
+    if(!multipart.isFile)
+    {
+        multipart.value.insert(multipart.value.end(), start, end);
+        return;
+    }
+
+    File<charT>& file = multipart.file;
+
+    if(file.fd == -1 && file.size+size > m_spoolThreshold)
+    {
+        file.fd = spoolFile();
+        if(file.fd == -1)
+            ERROR_LOG("Unable to create spool file for upload: " \
+                    << std::strerror(errno))
+        else if(!writeAll(file.fd, file.data.get(), file.data.get()+file.size))
+        {
+            ERROR_LOG("Unable to write to upload spool file: " \
+                    << std::strerror(errno))
+            close(file.fd);
+            file.fd = -1;
+        }
+        else
+        {
+            file.data.reset();
+            multipart.reserve = 0;
+        }
+    }
+
+    if(file.fd != -1)
+    {
+        if(!writeAll(file.fd, start, end))
+        {
+            ERROR_LOG("Unable to write to upload spool file: " \
+                    << std::strerror(errno))
+            multipart.active = false;
+            return;
+        }
+    }
+    else
+    {
+        if(file.size+size > multipart.reserve)
+        {
+            size_t reserve = std::max(
+                    multipart.reserve*2,
+                    file.size+size);
+            if(m_spoolThreshold >= file.size+size)
+                reserve = std::min(reserve, m_spoolThreshold);
+            std::unique_ptr<char[]> data(new char[reserve]);
+            std::copy(file.data.get(), file.data.get()+file.size, data.get());
+            file.data = std::move(data);
+            multipart.reserve = reserve;
+        }
+        std::copy(start, end, file.data.get()+file.size);
+    }
+    file.size += size;
+}
+
+template<class charT>
+void Fastcgipp::Http::Environment<charT>::multipartComplete()
+{
+    Multipart& multipart = *m_multipart;
+    if(!multipart.active || !multipart.named)
+        return;
+
+    if(multipart.isFile)
+        files.insert(std::make_pair(
+                    std::move(multipart.name),
+                    std::move(multipart.file)));
+    else
+    {
+        std::basic_string<charT> value;
+        vecToString(
+                multipart.value.data(),
+                multipart.value.data()+multipart.value.size(),
+                value);
+        posts.insert(std::make_pair(
+                    std::move(multipart.name),
+                    std::move(value)));
+    }
+    multipart.active = false;
+}
+
 template<class charT>
 void Fastcgipp::Http::Environment<charT>::parsePostsUrlEncoded()
 {
+    const char* const data = m_postBuffer.data();
     decodeUrlEncoded(
-            m_postBuffer.data(),
-            m_postBuffer.data()+m_postBuffer.size(),
+            data,
+            data+m_postBuffer.size(),
             posts);
 }
 
 template struct Fastcgipp::Http::Environment<char>;
 template struct Fastcgipp::Http::Environment<wchar_t>;
 
-Fastcgipp::Http::SessionId::SessionId()
+template<class charT> const char* Fastcgipp::Http::File<charT>::map() const
 {
-    std::random_device device;
-    std::uniform_int_distribution<unsigned short> distribution(0, 255);
+    if(fd == -1)
+        return data.get();
 
-    for(unsigned char& byte: m_data)
-        byte = static_cast<unsigned char>(distribution(device));
-    m_timestamp = std::time(nullptr);
+    if(m_map == nullptr && size != 0)
+    {
+        void* const mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping == MAP_FAILED)
+            ERROR_LOG("Unable to mmap() spooled upload: " \
+                    << std::strerror(errno))
+        else
+            m_map = mapping;
+    }
+    return static_cast<const char*>(m_map);
 }
 
-template Fastcgipp::Http::SessionId::SessionId(
-        const std::basic_string<char>& string);
-template Fastcgipp::Http::SessionId::SessionId(
-        const std::basic_string<wchar_t>& string);
-template<class charT> Fastcgipp::Http::SessionId::SessionId(
-        const std::basic_string<charT>& string)
+template<class charT> Fastcgipp::Http::File<charT>::~File()
 {
-    base64Decode(
-            string.begin(),
-            string.begin()+std::min(stringLength, string.size()),
-            m_data.begin());
-    m_timestamp = std::time(nullptr);
+    if(m_map != nullptr)
+        munmap(m_map, size);
+    if(fd != -1)
+        close(fd);
 }
 
-const size_t Fastcgipp::Http::SessionId::stringLength;
-const size_t Fastcgipp::Http::SessionId::size;
+template<class charT> Fastcgipp::Http::File<charT>&
+Fastcgipp::Http::File<charT>::operator=(File&& x)
+{
+    if(this != &x)
+    {
+        if(m_map != nullptr)
+            munmap(m_map, size);
+        if(fd != -1)
+            close(fd);
+        filename = std::move(x.filename);
+        contentType = std::move(x.contentType);
+        size = x.size;
+        data = std::move(x.data);
+        fd = x.fd;
+        m_map = x.m_map;
+        x.size = 0;
+        x.fd = -1;
+        x.m_map = nullptr;
+    }
+    return *this;
+}
+
+template struct Fastcgipp::Http::File<char>;
+template struct Fastcgipp::Http::File<wchar_t>;
 
 template void Fastcgipp::Http::decodeUrlEncoded<char>(
         const char* data,
@@ -766,6 +1130,20 @@ template<class charT> void Fastcgipp::Http::decodeUrlEncoded(
     }
 }
 
+void Fastcgipp::Http::CookieExpiration::set(std::time_t time)
+{
+    char* const string(
+        m_pointer==m_strings[0]?m_strings[1]:m_strings[0]);
+    std::tm tm;
+    const auto count = std::strftime(
+            string,
+            s_length,
+            "%a, %d %b %Y %H:%M:%S GMT",
+            gmtime_r(&time, &tm));
+    std::fill(string+count, string+s_length, 0);
+    m_pointer = string;
+}
+
 extern const std::array<const char, 64> Fastcgipp::Http::base64Characters =
 {{
     'A','B','C','D','E','F','G','H','I','J','K','L','M','N','O','P','Q','R','S',
@@ -273,7 +273,11 @@ void Fastcgipp::Mail::Mailer::handler()
                     {
                         if(m_line.size() >= 4 && m_line.substr(0,4) == "250 ")
                         {
+                            const auto callback = std::move(m_email.callback);
+                            const int messageType = m_email.messageType;
                             purgeEmail();
+                            if(callback)
+                                callback(Message(messageType));
                             if(m_socket.write("QUIT\n", 5) != 5)
                             {
                                 ERROR_LOG("Error sending QUIT command to SMTP "\
@@ -374,9 +378,14 @@ void Fastcgipp::Mail::Mailer::init(
     }
 }
 
-void Fastcgipp::Mail::Mailer::queue(Email_base& email)
+void Fastcgipp::Mail::Mailer::queue(
+        Email_base& email,
+        const std::function<void(Message)>& callback,
+        int messageType)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_queue.push(email.data());
+    m_queue.back().callback = callback;
+    m_queue.back().messageType = messageType;
     m_socketGroup.wake();
 }
@@ -29,6 +29,24 @@
 #include "fastcgi++/log.hpp"
 #include "fastcgi++/manager.hpp"
 
+#include <fstream>
+#include <numeric>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace
+{
+    //! The most connections we can have open at once
+    unsigned long long maxConnections()
+    {
+        rlimit limit;
+        if(getrlimit(RLIMIT_NOFILE, &limit) != 0
+                || limit.rlim_cur == RLIM_INFINITY)
+            return 0xffffffffULL;
+        return limit.rlim_cur;
+    }
+}
+
 Fastcgipp::Manager_base* Fastcgipp::Manager_base::instance=nullptr;
 
 Fastcgipp::Manager_base::Manager_base(unsigned threads):
@@ -37,9 +55,23 @@ Fastcgipp::Manager_base::Manager_base(unsigned threads):
                 this,
                 std::placeholders::_1,
                 std::placeholders::_2)),
+    m_timers([this] (Protocol::RequestId id, Message&& message)
+            {
+                push(id, std::move(message));
+            }),
+    m_offload(m_timers),
+    m_hibernate(false),
+    m_handlers(0),
+    m_steal(false),
+    m_coalesce(false),
+    m_coalesced(0),
+    m_recycleRequests(0),
+    m_recycleRss(0),
+    m_completed(0),
+    m_recycling(false),
+    m_served(0),
     m_terminate(true),
-    m_stop(true),
-    m_threads(threads)
+    m_stop(true)
 #if FASTCGIPP_LOG_LEVEL > 3
     ,m_requestCount(0),
     m_maxRequests(0),
@@ -54,6 +86,10 @@ Fastcgipp::Manager_base::Manager_base(unsigned threads):
     if(instance != nullptr)
         FAIL_LOG("You're not allowed to have multiple manager instances")
     instance = this;
+    m_queues.emplace_back(threads);
+    for(auto& count: m_timedOut)
+        count = 0;
+    m_transceiver.watch(m_timers.fd(), [this] () { m_timers.expire(); });
     DIAG_LOG("Manager_base::Manager_base(): Initialized")
 }
 
@@ -62,7 +98,9 @@ void Fastcgipp::Manager_base::terminate()
     std::lock_guard<std::mutex> lock(m_tasksMutex);
     m_terminate=true;
     m_transceiver.terminate();
-    m_wake.notify_all();
+    m_offload.terminate();
+    for(auto& queue: m_queues)
+        queue.wake.notify_all();
 }
 
 void Fastcgipp::Manager_base::stop()
@@ -70,7 +108,62 @@ void Fastcgipp::Manager_base::stop()
     std::lock_guard<std::mutex> lock(m_tasksMutex);
     m_stop=true;
     m_transceiver.stop();
-    m_wake.notify_all();
+    for(auto& queue: m_queues)
+        queue.wake.notify_all();
+}
+
+void Fastcgipp::Manager_base::complete()
+{
+    const unsigned long long count = ++m_completed;
+    bool recycle = m_recycleRequests && count >= m_recycleRequests;
+    if(!recycle && m_recycleRss && count%s_rssInterval == 0)
+    {
+        std::ifstream statm("/proc/self/statm");
+        size_t pages = 0;
+        size_t resident = 0;
+        statm >> pages >> resident;
+        recycle = resident*size_t(sysconf(_SC_PAGESIZE)) > m_recycleRss;
+    }
+
+    if(recycle && !m_recycling.exchange(true))
+    {
+        INFO_LOG("Recycling fastcgi++ manager after " << count << " requests")
+        stop();
+    }
+}
+
+void Fastcgipp::Manager_base::deadlines(const Deadlines& deadlines)
+{
+    m_deadlines = deadlines;
+    m_transceiver.idle(deadlines.idle);
+}
+
+unsigned long long Fastcgipp::Manager_base::timedOut(Deadline deadline) const
+{
+    if(deadline == Deadline::IDLE)
+        return m_transceiver.idled();
+    return m_timedOut[static_cast<unsigned>(deadline)];
+}
+
+Fastcgipp::Protocol::Requests<std::unique_ptr<Fastcgipp::Request_base>>::iterator
+Fastcgipp::Manager_base::build(
+        const Protocol::RequestId& id,
+        Protocol::Role role,
+        bool kill,
+        Timers::Clock::time_point begun,
+        unsigned route)
+{
+    const auto request = m_requests.emplace(
+            std::piecewise_construct,
+            std::forward_as_tuple(id),
+            std::forward_as_tuple()).first;
+    request->second = makeRequest(id, role, kill, route);
+    request->second->deadlines(id, m_deadlines, m_timedOut, begun);
+#if FASTCGIPP_LOG_LEVEL > 3
+    ++m_requestCount;
+    m_maxRequests = std::max(m_maxRequests, m_requests.size());
+#endif
+    return request;
 }
 
 void Fastcgipp::Manager_base::start()
@@ -80,22 +173,156 @@ void Fastcgipp::Manager_base::start()
     m_stop=false;
     m_terminate=false;
     m_transceiver.start();
-    for(auto& thread: m_threads)
-        if(!thread.joinable())
-        {
-            std::thread newThread(&Fastcgipp::Manager_base::handler, this);
-            thread.swap(newThread);
-        }
+    m_offload.start();
+    for(unsigned pool=0; pool<m_queues.size(); ++pool)
+    {
+        Queue& queue = m_queues[pool];
+        queue.steal.clear();
+        for(unsigned other=0; other<m_queues.size(); ++other)
+            if(m_pools.priority(other) > m_pools.priority(pool))
+                queue.steal.push_back(other);
+        std::stable_sort(
+                queue.steal.begin(),
+                queue.steal.end(),
+                [this] (unsigned x, unsigned y)
+                {
+                    return m_pools.priority(x) > m_pools.priority(y);
+                });
+
+        queue.surplus = 0;
+        for(auto& thread: queue.threads)
+            if(!thread.joinable())
+            {
+                std::thread newThread(
+                        &Fastcgipp::Manager_base::handler,
+                        this,
+                        pool);
+                thread.swap(newThread);
+                ++m_handlers;
+            }
+        queue.autoscaler.resized(queue.threads.size());
+    }
 }
 
 void Fastcgipp::Manager_base::join()
 {
-    for(auto& thread: m_threads)
-        if(thread.joinable())
+    {
+        // Threads can come and go until they have all exited
+        std::unique_lock<std::mutex> lock(m_tasksMutex);
+        m_exited.wait(lock, [this] () { return m_handlers == 0; });
+    }
+
+    for(auto& queue: m_queues)
+    {
+        for(auto& thread: queue.threads)
+            if(thread.joinable())
+                thread.join();
+        for(auto& thread: queue.retired)
             thread.join();
+        queue.retired.clear();
+    }
+    m_offload.terminate();
+    m_offload.join();
     m_transceiver.join();
 }
 
+void Fastcgipp::Manager_base::spawn(unsigned pool)
+{
+    Queue& queue = m_queues[pool];
+
+    // These have already returned from handler()
+    for(auto& thread: queue.retired)
+        thread.join();
+    queue.retired.clear();
+
+    queue.threads.emplace_back(&Fastcgipp::Manager_base::handler, this, pool);
+    ++m_handlers;
+    queue.autoscaler.resized(queue.threads.size()-queue.surplus);
+#if FASTCGIPP_LOG_LEVEL > 3
+    ++m_activeThreads;
+    m_maxActiveThreads = std::max(m_activeThreads, m_maxActiveThreads);
+#endif
+    DIAG_LOG("Pool \"" << m_pools.name(pool) << "\" grew to " \
+            << queue.threads.size()-queue.surplus << " threads")
+}
+
+void Fastcgipp::Manager_base::retire(unsigned pool)
+{
+    Queue& queue = m_queues[pool];
+    const auto self = std::find_if(
+            queue.threads.begin(),
+            queue.threads.end(),
+            [] (const std::thread& thread)
+            {
+                return thread.get_id() == std::this_thread::get_id();
+            });
+    if(self != queue.threads.end())
+    {
+        queue.retired.push_back(std::move(*self));
+        queue.threads.erase(self);
+    }
+    --m_handlers;
+    m_exited.notify_all();
+    queue.autoscaler.resized(queue.threads.size()-queue.surplus);
+    DIAG_LOG("Pool \"" << m_pools.name(pool) << "\" shrank to " \
+            << queue.threads.size()-queue.surplus << " threads")
+}
+
+void Fastcgipp::Manager_base::queue(
+        unsigned pool,
+        const Protocol::RequestId& id)
+{
+    std::lock_guard<std::mutex> lock(m_tasksMutex);
+    Queue& queue = m_queues[pool];
+    const auto now = Timers::Clock::now();
+    queue.tasks.emplace(id, now);
+    m_pools.queued(pool);
+
+    // Every thread may be blocked so check how long the oldest task waited
+    if(queue.idle == 0
+            && !m_stop
+            && !m_terminate
+            && queue.autoscaler.grow(
+                queue.threads.size()-queue.surplus,
+                now-queue.tasks.front().second,
+                now))
+        spawn(pool);
+
+    if(m_steal && queue.idle == 0)
+    {
+        // Wake an idle thread that will steal it instead
+        for(auto& other: m_queues)
+            if(other.idle != 0 && std::find(
+                        other.steal.cbegin(),
+                        other.steal.cend(),
+                        pool) != other.steal.cend())
+            {
+                other.wake.notify_one();
+                return;
+            }
+    }
+    queue.wake.notify_one();
+}
+
+bool Fastcgipp::Manager_base::next(unsigned pool, unsigned& from)
+{
+    if(!m_queues[pool].tasks.empty())
+    {
+        from = pool;
+        return true;
+    }
+
+    if(m_steal)
+        for(const unsigned other: m_queues[pool].steal)
+            if(!m_queues[other].tasks.empty())
+            {
+                from = other;
+                return true;
+            }
+
+    return false;
+}
+
 #include <signal.h>
 void Fastcgipp::Manager_base::setupSignals()
 {
@@ -162,44 +389,42 @@ void Fastcgipp::Manager_base::localHandler()
                 const char* name;
                 const char* value;
                 const char* end;
+                const char* data = message.data.begin()+sizeof(header);
+                const char* const dataEnd = data+header.contentLength;
 
                 while(Protocol::processParamHeader(
-                        message.data.begin()+sizeof(header),
-                        message.data.end(),
+                        data,
+                        dataEnd,
                         name,
                         value,
                         end))
                 {
+                    data = end;
                     switch(value-name)
                     {
                         case 14:
                         {
                             if(std::equal(name, value, "FCGI_MAX_CONNS"))
-                            {
-                                Block record(
-                                        reinterpret_cast<const char*>(
-                                            &Protocol::maxConnsReply),
-                                        sizeof(Protocol::maxConnsReply));
                                 m_transceiver.send(
                                         socket,
-                                        std::move(record),
+                                        Protocol::managementReply(
+                                            "FCGI_MAX_CONNS",
+                                            std::to_string(maxConnections())),
                                         false);
-                            }
                             break;
                         }
                         case 13:
                         {
                             if(std::equal(name, value, "FCGI_MAX_REQS"))
-                            {
-                                Block record(
-                                        reinterpret_cast<const char*>(
-                                            &Protocol::maxReqsReply),
-                                        sizeof(Protocol::maxReqsReply));
                                 m_transceiver.send(
                                         socket,
-                                        std::move(record),
+                                        Protocol::managementReply(
+                                            "FCGI_MAX_REQS",
+                                            std::to_string(
+                                                m_admission.enabled()?
+                                                m_admission.limit():
+                                                maxConnections())),
                                         false);
-                            }
                             break;
                         }
                         case 15:
@@ -251,8 +476,9 @@ void Fastcgipp::Manager_base::localHandler()
         ERROR_LOG("Got a non-FastCGI record destined for the manager")
 }
 
-void Fastcgipp::Manager_base::handler()
+void Fastcgipp::Manager_base::handler(unsigned pool)
 {
+    Queue& queue = m_queues[pool];
     std::unique_lock<std::shared_timed_mutex> requestsWriteLock(
             m_requestsMutex,
             std::defer_lock);
@@ -262,11 +488,25 @@ void Fastcgipp::Manager_base::handler()
     while(!m_terminate && !(m_stop && m_requests.empty()))
     {
         requestsReadLock.unlock();
-        while(!m_tasks.empty())
+        unsigned from;
+        while(next(pool, from))
         {
-            auto id = m_tasks.front();
-            m_tasks.pop();
+            Queue& source = m_queues[from];
+            const auto id = source.tasks.front().first;
+            const auto waited
+                = Timers::Clock::now()-source.tasks.front().second;
+            source.tasks.pop();
+            m_pools.dequeued(from, waited);
+            if(!source.tasks.empty()
+                    && !m_stop
+                    && !m_terminate
+                    && source.autoscaler.grow(
+                        source.threads.size()-source.surplus,
+                        waited))
+                spawn(from);
             tasksLock.unlock();
+            if(m_admission.adaptive())
+                m_admission.delay(waited);
 
             if(id.m_id == 0)
                 localHandler();
@@ -281,7 +521,14 @@ void Fastcgipp::Manager_base::handler()
                             std::try_to_lock);
                     requestsReadLock.unlock();
 
-                    if(requestLock)
+                    if(requestLock && request->second->pool() != from)
+                    {
+                        // Left over from before it was classified. Whatever
+                        // it was for is covered by the task queued when the
+                        // request moved.
+                        requestLock.unlock();
+                    }
+                    else if(requestLock)
                     {
                         auto lock = request->second->handler();
                         if(!lock || !id.m_socket.valid())
@@ -295,12 +542,20 @@ void Fastcgipp::Manager_base::handler()
                             requestsWriteLock.lock();
                             requestLock.unlock();
                             m_requests.erase(request);
+                            const bool reused = reuse(id);
                             requestsWriteLock.unlock();
+                            complete();
+                            if(reused)
+                                this->queue(0, id);
                         }
                         else
                         {
+                            // It may have been classified into another pool
+                            const unsigned moved = request->second->pool();
                             requestLock.unlock();
                             lock.unlock();
+                            if(moved != from)
+                                this->queue(moved, id);
                         }
                     }
                 }
@@ -313,14 +568,41 @@ void Fastcgipp::Manager_base::handler()
         requestsReadLock.lock();
         if(m_terminate || (m_stop && m_requests.empty()))
         {
-            m_wake.notify_all();
+            for(auto& x: m_queues)
+                x.wake.notify_all();
             break;
         }
         requestsReadLock.unlock();
 #if FASTCGIPP_LOG_LEVEL > 3
         --m_activeThreads;
 #endif
-        m_wake.wait(tasksLock);
+        if(queue.surplus != 0)
+        {
+            --queue.surplus;
+            retire(pool);
+            return;
+        }
+
+        ++queue.idle;
+        bool timedOut = false;
+        if(queue.autoscaler.enabled())
+            timedOut = queue.wake.wait_for(
+                    tasksLock,
+                    queue.autoscaler.idle()) == std::cv_status::timeout;
+        else
+            queue.wake.wait(tasksLock);
+        --queue.idle;
+
+        if(timedOut
+                && !m_stop
+                && !m_terminate
+                && !next(pool, from)
+                && queue.autoscaler.shrink(
+                    queue.threads.size()-queue.surplus))
+        {
+            retire(pool);
+            return;
+        }
 #if FASTCGIPP_LOG_LEVEL > 3
         if(!m_stop && !m_terminate)
         {
@@ -330,10 +612,300 @@ void Fastcgipp::Manager_base::handler()
 #endif
         requestsReadLock.lock();
     }
+
+    --m_handlers;
+    m_exited.notify_all();
+}
+
+bool Fastcgipp::Manager_base::pend(
+        const Protocol::RequestId& id,
+        Pending& pending,
+        Message& message)
+{
+    if(pending.served)
+    {
+        // Swallow what is left of the request
+        if(message.type == 0)
+        {
+            const Protocol::Header& header
+                = *reinterpret_cast<Protocol::Header*>(message.data.begin());
+            if((header.type == Protocol::RecordType::IN
+                        && header.contentLength == 0)
+                    || header.type == Protocol::RecordType::ABORT_REQUEST)
+            {
+                // Stop relaying to an aborted follower
+                if(header.type == Protocol::RecordType::ABORT_REQUEST
+                        && pending.flight)
+                    pending.flight->leave(id);
+                m_pending.erase(id);
+                --m_served;
+            }
+        }
+        return true;
+    }
+
+    if(message.type != 0)
+        return false;
+
+    const Protocol::Header& header
+        = *reinterpret_cast<Protocol::Header*>(message.data.begin());
+
+    if(header.type != Protocol::RecordType::PARAMS)
+        return false;
+
+    if(header.contentLength != 0)
+    {
+        pending.params.push_back(std::move(message));
+        return true;
+    }
+
+    // Built requests arm their own deadline and served ones don't need it
+    m_timers.cancel(pending.timer);
+
+    if(!m_router.empty())
+        pending.route = match(pending.params);
+
+    if(!m_cache.enabled() && !m_coalesce)
+        return false;
+
+    pending.key = m_cache.key(pending.params);
+    if(pending.key.empty())
+        return false;
+
+    const auto served = [this, &id, &pending] ()
+    {
+        if(pending.kill)
+            m_pending.erase(id);
+        else
+        {
+            pending.served = true;
+            pending.params.clear();
+            ++m_served;
+        }
+        return true;
+    };
+
+    if(m_cache.enabled())
+    {
+        const auto response = m_cache.find(pending.key);
+        if(response)
+        {
+            const Protocol::Header& cachedHeader
+                = *reinterpret_cast<const Protocol::Header*>(
+                        response->begin());
+            if(cachedHeader.fcgiId == id.m_id)
+                m_transceiver.send(id.m_socket, response, pending.kill);
+            else
+                m_transceiver.send(
+                        id.m_socket,
+                        ResponseCache::rewrite(*response, id.m_id),
+                        pending.kill);
+            return served();
+        }
+    }
+
+    if(m_coalesce)
+    {
+        std::lock_guard<std::mutex> lock(m_flightsMutex);
+        auto& flight = m_flights[pending.key];
+        if(flight && flight->join(id, pending.kill))
+        {
+            ++m_coalesced;
+            pending.flight = flight;
+            return served();
+        }
+
+        const std::string key(pending.key);
+        flight.reset(new Flight(
+                    [this] (const Socket& socket, Block&& data, bool kill)
+                    {
+                        m_transceiver.send(socket, std::move(data), kill);
+                    },
+                    [this, key] ()
+                    {
+                        std::lock_guard<std::mutex> lock(m_flightsMutex);
+                        const auto flight = m_flights.find(key);
+                        if(flight != m_flights.end()
+                                && flight->second->landed())
+                            m_flights.erase(flight);
+                    }));
+        pending.flight = flight;
+    }
+
+    return false;
+}
+
+unsigned Fastcgipp::Manager_base::match(
+        const std::vector<Message>& params) const
+{
+    std::string_view requestUri;
+    std::string_view scriptName;
+
+    for(const auto& message: params)
+    {
+        const Protocol::Header& header
+            = *reinterpret_cast<const Protocol::Header*>(message.data.begin());
+        const char* data = message.data.begin()+sizeof(header);
+        const char* const dataEnd = data+header.contentLength;
+        const char* name;
+        const char* value;
+        const char* end;
+
+        while(Protocol::processParamHeader(data, dataEnd, name, value, end))
+        {
+            const size_t nameSize = value-name;
+            if(nameSize == 11 && std::equal(name, value, "REQUEST_URI"))
+                requestUri = std::string_view(value, end-value);
+            else if(nameSize == 11 && std::equal(name, value, "SCRIPT_NAME"))
+                scriptName = std::string_view(value, end-value);
+            data = end;
+        }
+    }
+
+    Router::Parameters<char> parameters;
+    return m_router.match(
+            Router::path(requestUri, scriptName),
+            parameters);
+}
+
+bool Fastcgipp::Manager_base::deliver(
+        const Protocol::RequestId& id,
+        Message&& message,
+        unsigned& pool)
+{
+    pool = 0;
+    const auto reused = m_reused.find(id);
+    if(reused != m_reused.end())
+    {
+        reused->second.push_back(std::move(message));
+        return false;
+    }
+
+    auto request = m_requests.find(id);
+    if(request == m_requests.end())
+    {
+        const auto pending = m_pending.find(id);
+        if(pending != m_pending.end())
+        {
+            if(pend(id, pending->second, message))
+                return false;
+
+            m_timers.cancel(pending->second.timer);
+            request = build(
+                    id,
+                    pending->second.role,
+                    pending->second.kill,
+                    pending->second.begun,
+                    pending->second.route);
+            if(pending->second.flight)
+                request->second->lead(pending->second.flight);
+            if(m_cache.enabled() && !pending->second.key.empty())
+                request->second->cacheable(
+                        m_cache,
+                        std::move(pending->second.key));
+            for(auto& params: pending->second.params)
+                request->second->push(std::move(params));
+            m_pending.erase(pending);
+            request->second->push(std::move(message));
+        }
+        else if(message.type == 0)
+        {
+            const Protocol::Header& header=
+                *reinterpret_cast<Protocol::Header*>(message.data.begin());
+            if(header.type == Protocol::RecordType::BEGIN_REQUEST)
+            {
+                const Protocol::BeginRequest& body
+                    = *reinterpret_cast<Protocol::BeginRequest*>(
+                            message.data.begin()
+                            +sizeof(header));
+
+                if(!m_admission.admit(
+                            m_requests.size()+m_pending.size()-m_served))
+                {
+                    m_transceiver.send(
+                            id.m_socket,
+                            m_admission.rejection(id.m_id),
+                            body.kill());
+                    if(!body.kill())
+                    {
+                        // Swallow what is left of the request
+                        m_pending.emplace(
+                                std::piecewise_construct,
+                                std::forward_as_tuple(id),
+                                std::forward_as_tuple(
+                                    body.role,
+                                    body.kill())).first->second.served = true;
+                        ++m_served;
+                    }
+                    return false;
+                }
+
+                if(m_cache.enabled() || m_coalesce || !m_router.empty())
+                {
+                    Pending& pending = m_pending.emplace(
+                            std::piecewise_construct,
+                            std::forward_as_tuple(id),
+                            std::forward_as_tuple(
+                                body.role,
+                                body.kill())).first->second;
+                    if(m_deadlines.params
+                            != Timers::Clock::duration::zero())
+                        pending.timer = m_timers.after(
+                                m_deadlines.params,
+                                id,
+                                Request_base::expiry(Deadline::PARAMS));
+                    return false;
+                }
+
+                build(
+                        id,
+                        body.role,
+                        body.kill(),
+                        Timers::Clock::now(),
+                        Router::none);
+            }
+            else
+                WARNING_LOG("Got a non BEGIN_REQUEST record for a request"\
+                        " that doesn't exist")
+            return false;
+        }
+        else
+            return false;
+    }
+    else if(message.type == 0
+            && reinterpret_cast<const Protocol::Header*>(
+                message.data.begin())->type
+            == Protocol::RecordType::BEGIN_REQUEST)
+    {
+        m_reused[id].push_back(std::move(message));
+        return false;
+    }
+    else
+    {
+        request->second->push(std::move(message));
+        pool = request->second->pool();
+    }
+    return true;
+}
+
+bool Fastcgipp::Manager_base::reuse(const Protocol::RequestId& id)
+{
+    const auto reused = m_reused.find(id);
+    if(reused == m_reused.end())
+        return false;
+
+    std::vector<Message> messages(std::move(reused->second));
+    m_reused.erase(reused);
+    bool queue = false;
+    unsigned pool;
+    for(auto& message: messages)
+        queue = deliver(id, std::move(message), pool) || queue;
+    return queue;
 }
 
 void Fastcgipp::Manager_base::push(Protocol::RequestId id, Message&& message)
 {
+    unsigned pool = 0;
     if(id.m_id == 0)
     {
 #if FASTCGIPP_LOG_LEVEL > 3
@@ -348,6 +920,16 @@ void Fastcgipp::Manager_base::push(Protocol::RequestId id, Message&& message)
         ++m_badSocketMessageCount;
 #endif
         std::lock_guard<std::shared_timed_mutex> lock(m_requestsMutex);
+        const auto pending = m_pending.equal_range(id.m_socket);
+        for(auto i=pending.first; i!=pending.second; ++i)
+        {
+            m_timers.cancel(i->second.timer);
+            if(i->second.served)
+                --m_served;
+        }
+        m_pending.erase(pending.first, pending.second);
+        const auto reused = m_reused.equal_range(id.m_socket);
+        m_reused.erase(reused.first, reused.second);
         const auto range = m_requests.equal_range(id.m_socket);
         auto request = range.first;
         while(request != range.second)
@@ -374,56 +956,86 @@ void Fastcgipp::Manager_base::push(Protocol::RequestId id, Message&& message)
         ++m_messageCount;
 #endif
         std::unique_lock<std::shared_timed_mutex> lock(m_requestsMutex);
-        auto request = m_requests.find(id);
-        if(request == m_requests.end())
-        {
-            if(message.type == 0)
-            {
-                const Protocol::Header& header=
-                    *reinterpret_cast<Protocol::Header*>(message.data.begin());
-                if(header.type == Protocol::RecordType::BEGIN_REQUEST)
-                {
-                    const Protocol::BeginRequest& body
-                        = *reinterpret_cast<Protocol::BeginRequest*>(
-                                message.data.begin()
-                                +sizeof(header));
-
-                    request = m_requests.emplace(
-                            std::piecewise_construct,
-                            std::forward_as_tuple(id),
-                            std::forward_as_tuple()).first;
+        if(!deliver(id, std::move(message), pool))
+            return;
+    }
+    queue(pool, id);
+}
 
-                    request->second = makeRequest(
-                            id,
-                            body.role,
-                            body.kill());
-                    lock.unlock();
+void Fastcgipp::Manager_base::resizeThreads(unsigned threads)
+{
+    std::lock_guard<std::mutex> lock(m_tasksMutex);
+    Queue& queue = m_queues.front();
+    if(m_stop)
+    {
+        queue.threads.resize(threads);
 #if FASTCGIPP_LOG_LEVEL > 3
-                    ++m_requestCount;
-                    m_maxRequests = std::max(m_maxRequests, m_requests.size());
+        m_activeThreads = 0;
+        for(const auto& x: m_queues)
+            m_activeThreads += x.threads.size();
 #endif
-                }
-                else
-                    WARNING_LOG("Got a non BEGIN_REQUEST record for a request"\
-                            " that doesn't exist")
-            }
-            return;
-        }
+        return;
+    }
+
+    threads = std::max(threads, 1U);
+    while(queue.threads.size()-queue.surplus < threads)
+    {
+        if(queue.surplus != 0)
+            --queue.surplus;
         else
-            request->second->push(std::move(message));
+            spawn(0);
     }
+    if(queue.threads.size()-queue.surplus > threads)
+    {
+        queue.surplus = queue.threads.size()-threads;
+        queue.wake.notify_all();
+    }
+    queue.autoscaler.resized(threads);
+}
+
+void Fastcgipp::Manager_base::autoscale(
+        unsigned minimum,
+        unsigned maximum,
+        Autoscaler::Clock::duration wait,
+        Autoscaler::Clock::duration idle,
+        const std::string& pool)
+{
     std::lock_guard<std::mutex> lock(m_tasksMutex);
-    m_tasks.push(id);
-    m_wake.notify_one();
+    if(m_stop)
+    {
+        Queue& queue = m_queues[m_pools.find(pool)];
+        queue.autoscaler.configure(minimum, maximum, wait, idle);
+        if(queue.autoscaler.enabled())
+            queue.threads.resize(std::clamp(
+                        unsigned(queue.threads.size()),
+                        queue.autoscaler.minimum(),
+                        queue.autoscaler.maximum()));
+        queue.autoscaler.resized(queue.threads.size());
+#if FASTCGIPP_LOG_LEVEL > 3
+        m_activeThreads = 0;
+        for(const auto& x: m_queues)
+            m_activeThreads += x.threads.size();
+#endif
+    }
 }
 
-void Fastcgipp::Manager_base::resizeThreads(unsigned threads)
+void Fastcgipp::Manager_base::pool(
+        const std::string& name,
+        unsigned threads,
+        size_t queue,
+        int priority)
 {
     if(m_stop)
     {
-        m_threads.resize(threads);
+        const unsigned pool = m_pools.add(name, queue, priority);
+        if(pool == m_queues.size())
+            m_queues.emplace_back(threads);
+        else
+            m_queues[pool].threads.resize(threads);
 #if FASTCGIPP_LOG_LEVEL > 3
-        m_activeThreads = threads;
+        m_activeThreads = 0;
+        for(const auto& x: m_queues)
+            m_activeThreads += x.threads.size();
 #endif
     }
 }
@@ -449,7 +1061,18 @@ Fastcgipp::Manager_base::~Manager_base()
     DIAG_LOG("Manager_base::~Manager_base(): Remaining requests ======== " \
             << m_requests.size())
     DIAG_LOG("Manager_base::~Manager_base(): Remaining tasks =========== " \
-            << m_tasks.size())
+            << std::accumulate(
+                m_queues.cbegin(),
+                m_queues.cend(),
+                size_t(0),
+                [] (size_t size, const Queue& queue)
+                {
+                    return size+queue.tasks.size();
+                }))
     DIAG_LOG("Manager_base::~Manager_base(): Remaining local messages == " \
             << m_messages.size())
+    DIAG_LOG("Manager_base::~Manager_base(): Cache hits ================ " \
+            << m_cache.hits())
+    DIAG_LOG("Manager_base::~Manager_base(): Cache misses ============== " \
+            << m_cache.misses())
 }
@@ -0,0 +1,189 @@
+/*!
+ * @file       offload.cpp
+ * @brief      Defines the Fastcgipp::Offload class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+
+#include "fastcgi++/offload.hpp"
+
+Fastcgipp::Offload::Offload(Timers& timers):
+    m_timers(timers),
+    m_size(0),
+    m_limit(0),
+    m_timeout(Clock::duration::zero()),
+    m_terminate(true),
+    m_idle(0),
+    m_completed(0),
+    m_rejected(0),
+    m_timedOut(0),
+    m_cancelled(0),
+    m_waited(0),
+    m_longest(0),
+    m_ran(0)
+{}
+
+Fastcgipp::Offload::~Offload()
+{
+    terminate();
+    join();
+}
+
+void Fastcgipp::Offload::configure(
+        unsigned threads,
+        size_t queue,
+        Clock::duration timeout)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_threads.empty())
+    {
+        m_size = threads;
+        m_limit = queue;
+        m_timeout = timeout;
+    }
+}
+
+bool Fastcgipp::Offload::run(
+        std::function<Message()>&& work,
+        const std::function<void(Message)>& deliver,
+        Timers::Id timer,
+        const std::shared_ptr<Cancellation>& cancellation)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Work an idle thread is about to pick up isn't waiting
+    if(!enabled() || (m_limit != 0 && m_tasks.size() >= m_limit+m_idle))
+    {
+        ++m_rejected;
+        return false;
+    }
+
+    m_tasks.push(Task{
+            std::move(work),
+            deliver,
+            timer,
+            cancellation,
+            Clock::now()});
+    m_wake.notify_one();
+    return true;
+}
+
+void Fastcgipp::Offload::start()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_threads.empty())
+        return;
+    m_terminate = false;
+    m_idle = m_size;
+    for(unsigned i=0; i<m_size; ++i)
+        m_threads.emplace_back(&Fastcgipp::Offload::handler, this);
+}
+
+void Fastcgipp::Offload::terminate()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_terminate = true;
+    m_wake.notify_all();
+}
+
+void Fastcgipp::Offload::join()
+{
+    for(auto& thread: m_threads)
+        if(thread.joinable())
+            thread.join();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads.clear();
+    while(!m_tasks.empty())
+    {
+        if(m_tasks.front().timer.valid())
+            m_timers.cancel(m_tasks.front().timer);
+        m_tasks.pop();
+        ++m_cancelled;
+    }
+}
+
+void Fastcgipp::Offload::handler()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_terminate)
+    {
+        if(m_tasks.empty())
+        {
+            m_wake.wait(lock);
+            continue;
+        }
+
+        Task task(std::move(m_tasks.front()));
+        m_tasks.pop();
+        --m_idle;
+        lock.unlock();
+
+        const auto start = Clock::now();
+        const auto waited = (start-task.queued).count();
+        m_waited += waited;
+        if(waited > m_longest)
+            m_longest = waited;
+
+        if(task.cancellation && task.cancellation->cancelled())
+        {
+            if(task.timer.valid())
+                m_timers.cancel(task.timer);
+            ++m_cancelled;
+        }
+        else if(task.timer.valid() && !m_timers.pending(task.timer))
+            ++m_timedOut;
+        else
+        {
+            Message result(task.work());
+            m_ran += (Clock::now()-start).count();
+
+            // Only if we beat the timeout message
+            if(!task.timer.valid() || m_timers.cancel(task.timer))
+            {
+                task.deliver(std::move(result));
+                ++m_completed;
+            }
+            else
+                ++m_timedOut;
+        }
+
+        lock.lock();
+        ++m_idle;
+    }
+}
+
+Fastcgipp::Offload::Metrics Fastcgipp::Offload::metrics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return Metrics{
+        m_completed,
+        m_rejected,
+        m_timedOut,
+        m_cancelled,
+        Clock::duration(m_waited),
+        Clock::duration(m_longest),
+        Clock::duration(m_ran),
+        m_tasks.size()};
+}
@@ -111,12 +111,13 @@ Fastcgipp::Poll::Result Fastcgipp::Poll::poll(int timeout)
     return result;
 }
 
-bool Fastcgipp::Poll::add(const socket_t socket)
+bool Fastcgipp::Poll::add(const socket_t socket, bool exclusive)
 {
 #ifdef FASTCGIPP_LINUX
     epoll_event event;
     event.data.fd = socket;
-    event.events = EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+    event.events = exclusive?
+        EPOLLIN | EPOLLEXCLUSIVE : EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP;
     return epoll_ctl(m_poll, EPOLL_CTL_ADD, socket, &event) != -1;
 #elif defined FASTCGIPP_UNIX
     const auto fd = std::find_if(
@@ -136,6 +137,30 @@ bool Fastcgipp::Poll::add(const socket_t socket)
 #endif
 }
 
+bool Fastcgipp::Poll::pollIn(const socket_t socket, bool status)
+{
+#ifdef FASTCGIPP_LINUX
+    epoll_event event;
+    event.data.fd = socket;
+    event.events = status?
+        EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP : EPOLLERR | EPOLLHUP;
+    return epoll_ctl(m_poll, EPOLL_CTL_MOD, socket, &event) != -1;
+#elif defined FASTCGIPP_UNIX
+    const auto fd = std::find_if(
+            m_poll.begin(),
+            m_poll.end(),
+            [&socket] (const pollfd& x)
+            {
+                return x.fd == socket;
+            });
+    if(fd == m_poll.end())
+        return false;
+
+    fd->events = status?POLLIN | POLLRDHUP | POLLERR | POLLHUP:POLLERR | POLLHUP;
+    return true;
+#endif
+}
+
 bool Fastcgipp::Poll::del(const socket_t socket)
 {
 #ifdef FASTCGIPP_LINUX
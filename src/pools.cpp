@@ -0,0 +1,97 @@
+/*!
+ * @file       pools.cpp
+ * @brief      Defines the Fastcgipp::Pools class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+
+#include "fastcgi++/pools.hpp"
+
+Fastcgipp::Pools::Pools()
+{
+    m_pools.emplace_back(std::string(), 0, 0);
+}
+
+unsigned Fastcgipp::Pools::add(
+        const std::string& name,
+        size_t limit,
+        int priority)
+{
+    unsigned pool = find(name);
+    if(pool == 0 && !name.empty())
+    {
+        pool = m_pools.size();
+        m_pools.emplace_back(name, limit, priority);
+    }
+    m_pools[pool].limit = limit;
+    m_pools[pool].priority = priority;
+    return pool;
+}
+
+void Fastcgipp::Pools::classify(
+        const std::string& prefix,
+        const std::string& pool)
+{
+    m_rules.push_back({prefix, find(pool)});
+}
+
+unsigned Fastcgipp::Pools::find(const std::string& name) const
+{
+    for(unsigned pool=1; pool<m_pools.size(); ++pool)
+        if(m_pools[pool].name == name)
+            return pool;
+    return 0;
+}
+
+bool Fastcgipp::Pools::admit(unsigned pool)
+{
+    Pool& x = m_pools[pool];
+    if(x.limit == 0 || x.queued < x.limit)
+        return true;
+    ++x.rejected;
+    return false;
+}
+
+void Fastcgipp::Pools::dequeued(unsigned pool, Clock::duration waited)
+{
+    Pool& x = m_pools[pool];
+    --x.queued;
+    ++x.tasks;
+    x.waited += waited.count();
+    Clock::rep longest = x.longest;
+    while(waited.count() > longest
+            && !x.longest.compare_exchange_weak(longest, waited.count()));
+}
+
+Fastcgipp::Pools::Metrics Fastcgipp::Pools::metrics(unsigned pool) const
+{
+    const Pool& x = m_pools[pool];
+    return Metrics{
+        x.tasks,
+        Clock::duration(x.waited),
+        Clock::duration(x.longest),
+        x.queued,
+        x.rejected};
+}
@@ -0,0 +1,116 @@
+/*!
+ * @file       postbuffer.cpp
+ * @brief      Defines the Fastcgipp::PostBuffer class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+#include "fastcgi++/postbuffer.hpp"
+
+#include <algorithm>
+
+void Fastcgipp::PostBuffer::append(
+        Block&& block,
+        const char* const begin,
+        const char* const end)
+{
+    if(begin == end)
+        return;
+    m_chunks.emplace_back(std::move(block), begin, end);
+    m_size += end-begin;
+}
+
+void Fastcgipp::PostBuffer::append(
+        const char* const begin,
+        const char* const end)
+{
+    if(begin == end)
+        return;
+    Block block(begin, end-begin);
+    const char* const blockBegin = block.begin();
+    m_chunks.emplace_back(std::move(block), blockBegin, blockBegin+(end-begin));
+    m_size += end-begin;
+}
+
+const char* Fastcgipp::PostBuffer::data() const
+{
+    if(m_chunks.empty())
+        return nullptr;
+
+    if(m_chunks.size() > 1)
+    {
+        Block block(m_size);
+        char* destination = block.begin();
+        for(const auto& chunk: m_chunks)
+            destination = std::copy(chunk.begin, chunk.end, destination);
+
+        m_chunks.clear();
+        const char* const blockBegin = block.begin();
+        m_chunks.emplace_back(std::move(block), blockBegin, blockBegin+m_size);
+    }
+
+    return m_chunks.front().begin;
+}
+
+void Fastcgipp::PostBuffer::clear()
+{
+    m_chunks.clear();
+    m_chunks.shrink_to_fit();
+    m_size = 0;
+}
+
+Fastcgipp::PostBuffer::Streambuf::Streambuf(const PostBuffer& buffer):
+    m_buffer(buffer),
+    m_chunk(buffer.m_chunks.cbegin())
+{
+    if(m_chunk != m_buffer.m_chunks.cend())
+    {
+        char* const begin = const_cast<char*>(m_chunk->begin);
+        setg(begin, begin, const_cast<char*>(m_chunk->end));
+    }
+}
+
+Fastcgipp::PostBuffer::Streambuf::int_type
+Fastcgipp::PostBuffer::Streambuf::underflow()
+{
+    if(m_chunk == m_buffer.m_chunks.cend()
+            || ++m_chunk == m_buffer.m_chunks.cend())
+        return traits_type::eof();
+
+    char* const begin = const_cast<char*>(m_chunk->begin);
+    setg(begin, begin, const_cast<char*>(m_chunk->end));
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize Fastcgipp::PostBuffer::Streambuf::showmanyc()
+{
+    if(m_chunk == m_buffer.m_chunks.cend())
+        return -1;
+
+    std::streamsize available = egptr()-gptr();
+    for(auto chunk = std::next(m_chunk);
+            chunk != m_buffer.m_chunks.cend();
+            ++chunk)
+        available += chunk->end-chunk->begin;
+    return available==0?-1:available;
+}
@@ -79,11 +79,28 @@ bool Fastcgipp::Protocol::processParamHeader(
         return true;
 }
 
-const Fastcgipp::Protocol::ManagementReply<14, 2>
-Fastcgipp::Protocol::maxConnsReply("FCGI_MAX_CONNS", "10");
-
-const Fastcgipp::Protocol::ManagementReply<13, 2>
-Fastcgipp::Protocol::maxReqsReply("FCGI_MAX_REQS", "50");
+Fastcgipp::Block Fastcgipp::Protocol::managementReply(
+        const std::string& name,
+        const std::string& value)
+{
+    const size_t length = 2+name.size()+value.size();
+    Block record(getRecordSize(length));
+    std::fill(record.begin(), record.end(), 0);
+
+    Header& header = *reinterpret_cast<Header*>(record.begin());
+    header.version = version;
+    header.type = RecordType::GET_VALUES_RESULT;
+    header.fcgiId = 0;
+    header.contentLength = length;
+    header.paddingLength = record.size()-length-sizeof(Header);
+
+    char* body = record.begin()+sizeof(Header);
+    *body++ = name.size();
+    *body++ = value.size();
+    body = std::copy(name.cbegin(), name.cend(), body);
+    std::copy(value.cbegin(), value.cend(), body);
+    return record;
+}
 
 const Fastcgipp::Protocol::ManagementReply<15, 1>
 Fastcgipp::Protocol::mpxsConnsReply("FCGI_MPXS_CONNS", "1");
@@ -0,0 +1,244 @@
+/*!
+ * @file       random.cpp
+ * @brief      Defines the Fastcgipp::Random class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/random.hpp"
+#include "fastcgi++/log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <pthread.h>
+#include <sys/random.h>
+
+namespace
+{
+    //! Amount of times the process has forked
+    std::atomic<unsigned> forks(0);
+
+    void forked()
+    {
+        ++forks;
+    }
+
+    inline uint32_t rotate(uint32_t x, unsigned bits)
+    {
+        return (x << bits) | (x >> (32-bits));
+    }
+
+    inline void quarterRound(uint32_t* x, int a, int b, int c, int d)
+    {
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = rotate(x[d], 16);
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = rotate(x[b], 12);
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = rotate(x[d], 8);
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = rotate(x[b], 7);
+    }
+
+    //! Fill a buffer straight from the kernel
+    void getRandom(unsigned char* data, size_t size)
+    {
+        while(size != 0)
+        {
+            const ssize_t count = getrandom(data, size, 0);
+            if(count < 0)
+            {
+                if(errno == EINTR)
+                    continue;
+                FAIL_LOG("Unable to get random bytes from the kernel: " \
+                        << std::strerror(errno))
+            }
+            data += count;
+            size -= count;
+        }
+    }
+
+    //! A thread's generator
+    class Generator
+    {
+    public:
+        Generator():
+            m_position(Fastcgipp::Random::s_bufferSize),
+            m_output(Fastcgipp::Random::s_reseedInterval),
+            m_forks(forks)
+        {
+            static const bool registered
+                = pthread_atfork(nullptr, nullptr, forked) == 0;
+            if(!registered)
+                FAIL_LOG("Unable to register the random fork handler")
+        }
+
+        ~Generator()
+        {
+            std::fill(m_key, m_key+8, 0);
+            std::fill(m_buffer, m_buffer+sizeof(m_buffer), 0);
+        }
+
+        void fill(unsigned char* data, size_t size)
+        {
+            // We are in the child of a fork. The parent hands out what is
+            // left in the buffer so throw it away and reseed.
+            if(m_forks != forks)
+            {
+                std::fill(m_buffer+m_position, m_buffer+sizeof(m_buffer), 0);
+                m_position = sizeof(m_buffer);
+            }
+
+            while(size != 0)
+            {
+                if(m_position == sizeof(m_buffer))
+                    refill();
+
+                const size_t count = std::min(
+                        size,
+                        sizeof(m_buffer)-m_position);
+                std::copy(
+                        m_buffer+m_position,
+                        m_buffer+m_position+count,
+                        data);
+
+                // Don't keep what has been handed out
+                std::fill(m_buffer+m_position, m_buffer+m_position+count, 0);
+                m_position += count;
+                data += count;
+                size -= count;
+            }
+        }
+
+    private:
+        //! Current key
+        uint32_t m_key[8];
+
+        //! Current nonce
+        uint32_t m_nonce[3];
+
+        //! Buffered keystream
+        unsigned char m_buffer[Fastcgipp::Random::s_bufferSize];
+
+        //! Next unused byte in m_buffer
+        size_t m_position;
+
+        //! Bytes produced since the last reseed
+        size_t m_output;
+
+        //! Value of forks when the generator was seeded
+        unsigned m_forks;
+
+        //! Produce a new buffer of keystream
+        void refill()
+        {
+            const unsigned generation = forks;
+            if(generation != m_forks
+                    || m_output >= Fastcgipp::Random::s_reseedInterval)
+            {
+                getRandom(
+                        reinterpret_cast<unsigned char*>(m_key),
+                        sizeof(m_key));
+                getRandom(
+                        reinterpret_cast<unsigned char*>(m_nonce),
+                        sizeof(m_nonce));
+                m_forks = generation;
+                m_output = 0;
+            }
+
+            // The first 32 bytes become the next key. It only replaces the
+            // current one once the whole buffer is made so it can't be used
+            // to regenerate any of it.
+            unsigned char block[64];
+            uint32_t key[8];
+            Fastcgipp::Random::chacha20(m_key, 0, m_nonce, block);
+            std::memcpy(key, block, sizeof(key));
+            std::copy(block+sizeof(key), block+sizeof(block), m_buffer);
+            size_t filled = sizeof(block)-sizeof(m_key);
+
+            for(uint32_t counter=1; filled < sizeof(m_buffer); ++counter)
+            {
+                Fastcgipp::Random::chacha20(m_key, counter, m_nonce, block);
+                const size_t count = std::min(
+                        sizeof(block),
+                        sizeof(m_buffer)-filled);
+                std::copy(block, block+count, m_buffer+filled);
+                filled += count;
+            }
+            std::memcpy(m_key, key, sizeof(m_key));
+            std::fill(key, key+8, 0);
+            std::fill(block, block+sizeof(block), 0);
+
+            m_position = 0;
+            m_output += sizeof(m_buffer);
+        }
+    };
+}
+
+void Fastcgipp::Random::chacha20(
+        const uint32_t key[8],
+        uint32_t counter,
+        const uint32_t nonce[3],
+        unsigned char output[64])
+{
+    const uint32_t input[16] =
+    {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3],
+        key[4], key[5], key[6], key[7],
+        counter, nonce[0], nonce[1], nonce[2]
+    };
+
+    uint32_t x[16];
+    std::copy(input, input+16, x);
+    for(unsigned i=0; i<10; ++i)
+    {
+        quarterRound(x, 0, 4, 8, 12);
+        quarterRound(x, 1, 5, 9, 13);
+        quarterRound(x, 2, 6, 10, 14);
+        quarterRound(x, 3, 7, 11, 15);
+        quarterRound(x, 0, 5, 10, 15);
+        quarterRound(x, 1, 6, 11, 12);
+        quarterRound(x, 2, 7, 8, 13);
+        quarterRound(x, 3, 4, 9, 14);
+    }
+
+    // Serialize little endian regardless of the host
+    for(unsigned i=0; i<16; ++i)
+    {
+        const uint32_t word = x[i]+input[i];
+        output[4*i] = word;
+        output[4*i+1] = word >> 8;
+        output[4*i+2] = word >> 16;
+        output[4*i+3] = word >> 24;
+    }
+}
+
+void Fastcgipp::Random::fill(unsigned char* data, size_t size)
+{
+    thread_local Generator generator;
+    generator.fill(data, size);
+}
+
+const size_t Fastcgipp::Random::s_bufferSize;
+const size_t Fastcgipp::Random::s_reseedInterval;
@@ -29,27 +29,271 @@
 #include "fastcgi++/request.hpp"
 #include "fastcgi++/log.hpp"
 
+#include <algorithm>
+
+void Fastcgipp::Request_base::push(Message&& message)
+{
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    if(message.type == 0)
+    {
+        const Protocol::Header& header =
+            *reinterpret_cast<Protocol::Header*>(message.data.begin());
+        if(header.type == Protocol::RecordType::IN)
+        {
+            m_buffered += header.contentLength;
+            if(!m_throttled && m_buffered > m_watermark && m_throttle)
+            {
+                m_throttled = true;
+                m_throttle(true);
+            }
+        }
+    }
+    m_messages.push(std::move(message));
+}
+
+void Fastcgipp::Request_base::consumed(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    m_buffered -= std::min(bytes, m_buffered);
+    if(m_throttled && m_buffered <= m_watermark/2)
+    {
+        m_throttled = false;
+        m_throttle(false);
+    }
+}
+
+void Fastcgipp::Request_base::unthrottle()
+{
+    std::lock_guard<std::mutex> lock(m_messagesMutex);
+    if(m_throttled)
+    {
+        m_throttled = false;
+        m_throttle(false);
+    }
+}
+
+Fastcgipp::Request_base::~Request_base()
+{
+    if(m_cancellation && !m_finished)
+        m_cancellation->cancel();
+    if(m_flight)
+        m_flight->abort();
+    if(m_timers)
+    {
+        for(const auto& id: m_scheduled)
+            m_timers->cancel(id);
+        for(const auto& id: m_deadlineTimers)
+            if(id.valid())
+                m_timers->cancel(id);
+    }
+}
+
+void Fastcgipp::Request_base::deadlines(
+        const Protocol::RequestId& id,
+        const Deadlines& deadlines,
+        std::atomic_ullong* timedOut,
+        Timers::Clock::time_point begun)
+{
+    m_timedOut = timedOut;
+    m_callbackDeadline = deadlines.callback;
+    if(deadlines.params != Timers::Clock::duration::zero())
+        arm(id, Deadline::PARAMS, begun+deadlines.params);
+    if(deadlines.request != Timers::Clock::duration::zero())
+        arm(id, Deadline::REQUEST, begun+deadlines.request);
+}
+
+Fastcgipp::Message Fastcgipp::Request_base::expiry(Deadline deadline)
+{
+    Message message(Message::deadline);
+    message.data.size(1);
+    *message.data.begin() = static_cast<char>(deadline);
+    return message;
+}
+
+void Fastcgipp::Request_base::arm(
+        const Protocol::RequestId& id,
+        Deadline deadline,
+        Timers::Clock::time_point due)
+{
+    if(m_timers == nullptr)
+        return;
+    disarm(deadline);
+    const unsigned index = static_cast<unsigned>(deadline);
+    m_due[index] = due;
+    m_deadlineTimers[index] = m_timers->after(
+            due-Timers::Clock::now(),
+            id,
+            expiry(deadline));
+}
+
+void Fastcgipp::Request_base::unarm(Deadline deadline)
+{
+    const unsigned index = static_cast<unsigned>(deadline);
+    m_timers->cancel(m_deadlineTimers[index]);
+    m_deadlineTimers[index] = Timers::Id();
+    m_due[index] = Timers::Clock::time_point::max();
+}
+
+bool Fastcgipp::Request_base::expired(const Message& message)
+{
+    const unsigned index = static_cast<unsigned>(*message.data.begin());
+    if(message.data.size() != 1
+            || index >= s_deadlines
+            || m_due[index] == Timers::Clock::time_point::max()
+            || Timers::Clock::now() < m_due[index])
+        return false;
+
+    m_deadlineTimers[index] = Timers::Id();
+    m_due[index] = Timers::Clock::time_point::max();
+    if(m_timedOut)
+        ++m_timedOut[index];
+    m_caching = false;
+    return true;
+}
+
+Fastcgipp::Timers::Id Fastcgipp::Request_base::schedule(
+        Timers::Clock::duration delay,
+        const Protocol::RequestId& id,
+        Message&& message)
+{
+    if(m_timers == nullptr)
+    {
+        ERROR_LOG("Request has no timers to schedule a message with")
+        return Timers::Id();
+    }
+
+    if(m_scheduled.size() >= m_timerPrune)
+    {
+        m_scheduled.erase(
+                std::remove_if(
+                    m_scheduled.begin(),
+                    m_scheduled.end(),
+                    [this] (const Timers::Id& id)
+                    {
+                        return !m_timers->pending(id);
+                    }),
+                m_scheduled.end());
+        m_timerPrune = std::max(size_t(16), m_scheduled.size()*2);
+    }
+
+    const auto timer = m_timers->after(delay, id, std::move(message));
+    m_scheduled.push_back(timer);
+    return timer;
+}
+
+bool Fastcgipp::Request_base::cancel(Timers::Id id)
+{
+    return m_timers && m_timers->cancel(id);
+}
+
+bool Fastcgipp::Request_base::cache(ResponseCache::Duration ttl)
+{
+    if(m_cache == nullptr || m_sent)
+        return false;
+    m_cacheTtl = ttl;
+    m_caching = true;
+    return true;
+}
+
+void Fastcgipp::Request_base::sent(const Block& data, bool last)
+{
+    m_sent = true;
+    if(m_flight)
+    {
+        m_flight->relay(data, last);
+        if(last)
+            m_flight.reset();
+    }
+    if(m_caching)
+    {
+        const size_t size = m_cached.size();
+        if(size+data.size() > m_cached.reserve())
+            m_cached.reserve(std::max(size+data.size(), 2*m_cached.reserve()));
+        m_cached.size(size+data.size());
+        std::copy(data.begin(), data.end(), m_cached.begin()+size);
+    }
+}
+
+void Fastcgipp::Request_base::store()
+{
+    if(m_caching)
+    {
+        m_caching = false;
+        m_cache->store(m_cacheKey, std::move(m_cached), m_cacheTtl);
+    }
+}
+
+void Fastcgipp::Request_base::InStreambuf::append(
+        Block&& block,
+        const char* const begin,
+        const char* const end)
+{
+    if(begin == end)
+        return;
+    m_chunks.emplace_back(std::move(block), begin, end);
+    m_received += end-begin;
+}
+
+Fastcgipp::Request_base::InStreambuf::int_type
+Fastcgipp::Request_base::InStreambuf::underflow()
+{
+    if(m_loaded)
+    {
+        const size_t size = m_chunks.front().end-m_chunks.front().begin;
+        m_chunks.pop_front();
+        m_loaded = false;
+        setg(nullptr, nullptr, nullptr);
+        m_request.consumed(size);
+    }
+
+    if(m_chunks.empty())
+        return traits_type::eof();
+
+    char* const begin = const_cast<char*>(m_chunks.front().begin);
+    setg(begin, begin, const_cast<char*>(m_chunks.front().end));
+    m_loaded = true;
+    return traits_type::to_int_type(*gptr());
+}
+
+std::streamsize Fastcgipp::Request_base::InStreambuf::showmanyc()
+{
+    std::streamsize available = egptr()-gptr();
+    for(
+            auto chunk = m_chunks.cbegin()+(m_loaded?1:0);
+            chunk != m_chunks.cend();
+            ++chunk)
+        available += chunk->end-chunk->begin;
+    return available==0?-1:available;
+}
+
 template<class charT> void Fastcgipp::Request<charT>::complete()
 {
-    out.flush();
-    err.flush();
+    // Everything left goes out in a single block
+    Block record;
+    m_outStreamBuffer.collect(record, true);
+    m_errStreamBuffer.collect(record, false);
 
-    Block record(sizeof(Protocol::Header)+sizeof(Protocol::EndRequest));
+    const size_t size = record.size();
+    record.size(size+sizeof(Protocol::Header)+sizeof(Protocol::EndRequest));
 
     Protocol::Header& header
-        = *reinterpret_cast<Protocol::Header*>(record.begin());
+        = *reinterpret_cast<Protocol::Header*>(record.begin()+size);
     header.version = Protocol::version;
     header.type = Protocol::RecordType::END_REQUEST;
     header.fcgiId = m_id.m_id;
     header.contentLength = sizeof(Protocol::EndRequest);
     header.paddingLength = 0;
 
-    Protocol::EndRequest& body =
-        *reinterpret_cast<Protocol::EndRequest*>(record.begin()+sizeof(header));
+    Protocol::EndRequest& body = *reinterpret_cast<Protocol::EndRequest*>(
+            record.begin()+size+sizeof(header));
     body.appStatus = 0;
     body.protocolStatus = m_status;
 
+    sent(record, true);
+    if(m_status == Protocol::ProtocolStatus::REQUEST_COMPLETE)
+        store();
     m_send(m_id.m_socket, std::move(record), m_kill);
+    unthrottle();
 }
 
 template<class charT>
@@ -62,6 +306,20 @@ std::unique_lock<std::mutex>Fastcgipp::Request<charT>::handler()
         m_messages.pop();
         lock.unlock();
 
+        if(message.type == Message::deadline)
+        {
+            if(expired(message))
+            {
+                WARNING_LOG("Request timed out")
+                timeoutHandler(static_cast<Deadline>(*message.data.begin()));
+                complete();
+                goto exit;
+            }
+            lock.lock();
+            continue;
+        }
+        disarm(Deadline::CALLBACK);
+
         if(message.type == 0)
         {
             const Protocol::Header& header =
@@ -100,13 +358,41 @@ std::unique_lock<std::mutex>Fastcgipp::Request<charT>::handler()
 
                     if(header.contentLength == 0)
                     {
+                        disarm(Deadline::PARAMS);
                         if(environment().contentLength > m_maxPostSize)
                         {
                             bigPostErrorHandler();
                             complete();
                             goto exit;
                         }
+                        m_streaming = streamPost();
                         m_state = Protocol::RecordType::IN;
+
+                        if(m_router)
+                            m_router->match(
+                                    Router::path<charT>(
+                                        environment().requestUri,
+                                        environment().scriptName),
+                                    m_parameters);
+
+                        if(m_pools && m_pools->size() > 1)
+                        {
+                            const unsigned pool = m_pools->find(classify());
+                            if(pool != m_pool)
+                            {
+                                if(!m_pools->admit(pool))
+                                {
+                                    unavailableHandler();
+                                    complete();
+                                    goto exit;
+                                }
+
+                                // The rest is handled by the pool's threads
+                                m_pool = pool;
+                                lock.lock();
+                                goto exit;
+                            }
+                        }
                         lock.lock();
                         continue;
                     }
@@ -119,6 +405,12 @@ std::unique_lock<std::mutex>Fastcgipp::Request<charT>::handler()
                 {
                     if(header.contentLength==0)
                     {
+                        if(m_streaming)
+                        {
+                            m_state = Protocol::RecordType::OUT;
+                            break;
+                        }
+
                         if(!inProcessor() && !m_environment.parsePostBuffer())
                         {
                             WARNING_LOG("Unknown content type from client")
@@ -132,16 +424,30 @@ std::unique_lock<std::mutex>Fastcgipp::Request<charT>::handler()
                         break;
                     }
 
-                    if(m_environment.postBuffer().size()+(bodyEnd-body)
-                            > environment().contentLength)
+                    const size_t size = bodyEnd-body;
+                    const size_t received = m_streaming?
+                        m_inStreamBuffer.received():m_environment.postSize();
+                    if(received+size > environment().contentLength)
                     {
                         bigPostErrorHandler();
                         complete();
                         goto exit;
                     }
 
-                    m_environment.fillPostBuffer(body, bodyEnd);
-                    inHandler(header.contentLength);
+                    if(m_streaming)
+                        m_inStreamBuffer.append(
+                                std::move(message.data),
+                                body,
+                                bodyEnd);
+                    else
+                    {
+                        m_environment.fillPostBuffer(
+                                std::move(message.data),
+                                body,
+                                bodyEnd);
+                        consumed(size);
+                    }
+                    inHandler(size);
                     lock.lock();
                     continue;
                 }
@@ -159,9 +465,20 @@ std::unique_lock<std::mutex>Fastcgipp::Request<charT>::handler()
         m_message = std::move(message);
         if(response())
         {
+            finish();
             complete();
             break;
         }
+        if(m_hibernate)
+        {
+            m_outStreamBuffer.release();
+            m_errStreamBuffer.release();
+        }
+        if(m_callbackDeadline != Timers::Clock::duration::zero())
+            arm(
+                    m_id,
+                    Deadline::CALLBACK,
+                    Timers::Clock::now()+m_callbackDeadline);
         lock.lock();
     }
 exit:
@@ -216,12 +533,103 @@ template<class charT> void Fastcgipp::Request<charT>::unknownContentErrorHandler
 "</html>";
 }
 
+template<class charT>
+void Fastcgipp::Request<charT>::timeoutHandler(Deadline deadline)
+{
+    if(deadline == Deadline::PARAMS)
+        out << \
+"Status: 408 Request Timeout\n"\
+"Content-Type: text/html; charset=utf-8\r\n\r\n"\
+"<!DOCTYPE html>"\
+"<html lang='en'>"\
+    "<head>"\
+        "<title>408 Request Timeout</title>"\
+    "</head>"\
+    "<body>"\
+        "<h1>408 Request Timeout</h1>"\
+    "</body>"\
+"</html>";
+    else
+        out << \
+"Status: 504 Gateway Timeout\n"\
+"Content-Type: text/html; charset=utf-8\r\n\r\n"\
+"<!DOCTYPE html>"\
+"<html lang='en'>"\
+    "<head>"\
+        "<title>504 Gateway Timeout</title>"\
+    "</head>"\
+    "<body>"\
+        "<h1>504 Gateway Timeout</h1>"\
+    "</body>"\
+"</html>";
+}
+
+template<class charT> void Fastcgipp::Request<charT>::unavailableHandler()
+{
+    out << \
+"Status: 503 Service Unavailable\n"\
+"Retry-After: 1\n"\
+"Content-Type: text/html; charset=utf-8\r\n\r\n"\
+"<!DOCTYPE html>"\
+"<html lang='en'>"\
+    "<head>"\
+        "<title>503 Service Unavailable</title>"\
+    "</head>"\
+    "<body>"\
+        "<h1>503 Service Unavailable</h1>"\
+    "</body>"\
+"</html>";
+}
+
+template<class charT> bool Fastcgipp::Request<charT>::defer(
+        std::function<Message()>&& work,
+        Message&& expired,
+        Timers::Clock::duration timeout)
+{
+    if(m_offload == nullptr || !m_offload->enabled())
+    {
+        ERROR_LOG("Request has no offload pool to defer work to")
+        return false;
+    }
+
+    if(timeout == Timers::Clock::duration::zero())
+        timeout = m_offload->timeout();
+
+    Timers::Id timer;
+    if(timeout != Timers::Clock::duration::zero())
+    {
+        timer = schedule(timeout, m_id, std::move(expired));
+        if(!timer.valid())
+            return false;
+    }
+
+    if(!m_offload->run(std::move(work), m_callback, timer, cancellation()))
+    {
+        if(timer.valid())
+            cancel(timer);
+        return false;
+    }
+    return true;
+}
+
+template<class charT> std::string Fastcgipp::Request<charT>::classify() const
+{
+    std::basic_string<charT> path(environment().scriptName);
+    for(const auto& element: environment().pathInfo)
+    {
+        path += '/';
+        path += element;
+    }
+    return m_pools->match(path);
+}
+
 template<class charT> void Fastcgipp::Request<charT>::configure(
         const Protocol::RequestId& id,
         const Protocol::Role& role,
         bool kill,
         const std::function<void(const Socket&, Block&&, bool)> send,
-        const std::function<void(Message)> callback)
+        const std::function<void(Message)> callback,
+        const std::function<void(const Socket&, bool)> throttle)
 {
     using namespace std::placeholders;
 
@@ -230,15 +638,15 @@ template<class charT> void Fastcgipp::Request<charT>::configure(
     m_role=role;
     m_callback=callback;
     m_send=send;
+    m_throttle=std::bind(throttle, id.m_socket, _1);
 
-    m_outStreamBuffer.configure(
-            id,
-            Protocol::RecordType::OUT,
-            std::bind(send, _1, _2, false));
-    m_errStreamBuffer.configure(
-            id,
-            Protocol::RecordType::ERR,
-            std::bind(send, _1, _2, false));
+    const auto sendStream = [this] (const Socket& socket, Block&& data)
+    {
+        sent(data, false);
+        m_send(socket, std::move(data), false);
+    };
+    m_outStreamBuffer.configure(id, Protocol::RecordType::OUT, sendStream);
+    m_errStreamBuffer.configure(id, Protocol::RecordType::ERR, sendStream);
 }
 
 template<class charT> unsigned Fastcgipp::Request<charT>::pickLocale(
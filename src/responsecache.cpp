@@ -0,0 +1,188 @@
+/*!
+ * @file       responsecache.cpp
+ * @brief      Defines the Fastcgipp::ResponseCache class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/responsecache.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void Fastcgipp::ResponseCache::configure(
+        size_t maxSize,
+        const std::vector<std::string>& vary)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_size = 0;
+    m_maxSize = maxSize;
+    m_vary = vary;
+}
+
+std::string Fastcgipp::ResponseCache::key(
+        const std::vector<Message>& params) const
+{
+    std::string method;
+    std::string uri;
+    std::vector<std::string> values(m_vary.size());
+
+    for(const auto& message: params)
+    {
+        const Protocol::Header& header
+            = *reinterpret_cast<const Protocol::Header*>(message.data.begin());
+        const char* data = message.data.begin()+sizeof(header);
+        const char* const dataEnd = data+header.contentLength;
+        const char* name;
+        const char* value;
+        const char* end;
+
+        while(Protocol::processParamHeader(data, dataEnd, name, value, end))
+        {
+            const size_t nameSize = value-name;
+            if(nameSize == 14 && std::equal(name, value, "REQUEST_METHOD"))
+                method.assign(value, end);
+            else if(nameSize == 11 && std::equal(name, value, "REQUEST_URI"))
+                uri.assign(value, end);
+            else
+                for(unsigned i=0; i<m_vary.size(); ++i)
+                    if(nameSize == m_vary[i].size()
+                            && std::equal(name, value, m_vary[i].cbegin()))
+                        values[i].assign(value, end);
+            data = end;
+        }
+    }
+
+    if(method != "GET" && method != "HEAD")
+        return std::string();
+
+    std::string key(method);
+    key += '\0';
+    key += uri;
+    for(const auto& value: values)
+    {
+        key += '\0';
+        key += value;
+    }
+    return key;
+}
+
+std::shared_ptr<const Fastcgipp::Block> Fastcgipp::ResponseCache::find(
+        const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto entry = m_entries.find(key);
+    if(entry == m_entries.end())
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    if(entry->second.expiry <= std::chrono::steady_clock::now())
+    {
+        erase(entry);
+        ++m_misses;
+        return nullptr;
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, entry->second.position);
+    ++m_hits;
+    return entry->second.response;
+}
+
+void Fastcgipp::ResponseCache::store(
+        const std::string& key,
+        Block&& response,
+        Duration ttl)
+{
+    // Let go of any slack at the end of the block
+    response.reserve(response.size());
+    const size_t size = response.size()+key.size();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(size > m_maxSize)
+        return;
+
+    const auto existing = m_entries.find(key);
+    if(existing != m_entries.end())
+        erase(existing);
+
+    while(m_size+size > m_maxSize)
+    {
+        erase(m_entries.find(m_lru.back()));
+        ++m_evictions;
+    }
+
+    m_lru.push_front(key);
+    Entry& entry = m_entries[key];
+    entry.response = std::make_shared<const Block>(std::move(response));
+    entry.expiry = std::chrono::steady_clock::now()+ttl;
+    entry.position = m_lru.begin();
+    m_size += size;
+}
+
+void Fastcgipp::ResponseCache::erase(
+        std::unordered_map<std::string, Entry>::iterator entry)
+{
+    m_size -= entry->second.response->size()+entry->first.size();
+    m_lru.erase(entry->second.position);
+    m_entries.erase(entry);
+}
+
+Fastcgipp::Block Fastcgipp::ResponseCache::rewrite(
+        const Block& response,
+        Protocol::FcgiId id)
+{
+    Block copy(response.begin(), response.size());
+    char* record = copy.begin();
+    while(record < copy.end())
+    {
+        Protocol::Header& header = *reinterpret_cast<Protocol::Header*>(record);
+        header.fcgiId = id;
+        record += sizeof(header) + header.contentLength + header.paddingLength;
+    }
+    return copy;
+}
+
+void Fastcgipp::ResponseCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_size = 0;
+}
+
+size_t Fastcgipp::ResponseCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+size_t Fastcgipp::ResponseCache::entries() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
@@ -0,0 +1,155 @@
+/*!
+ * @file       router.cpp
+ * @brief      Defines the Fastcgipp::Router class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+
+#include "fastcgi++/router.hpp"
+#include "fastcgi++/log.hpp"
+
+Fastcgipp::Router::Router():
+    m_nodes(1),
+    m_routes(0)
+{}
+
+unsigned Fastcgipp::Router::add(std::string_view pattern)
+{
+    if(!valid(pattern))
+    {
+        ERROR_LOG("Invalid route pattern: " << std::string(pattern).c_str())
+        return none;
+    }
+
+    unsigned node = 0;
+    size_t position = 0;
+    while(position < pattern.size())
+    {
+        const char x = pattern[position];
+        if(x == ':' || x == '*')
+        {
+            const size_t end = std::min(
+                    pattern.find('/', position),
+                    pattern.size());
+            node = capture(
+                    node,
+                    x == '*',
+                    pattern.substr(position+1, end-position-1));
+            if(node == none)
+            {
+                ERROR_LOG("Route pattern " << std::string(pattern).c_str() \
+                        << " names a parameter differently from another")
+                return none;
+            }
+            position = end;
+        }
+        else
+        {
+            const size_t end = std::min(
+                    pattern.find_first_of(":*", position),
+                    pattern.size());
+            node = insert(node, pattern.substr(position, end-position));
+            position = end;
+        }
+    }
+
+    if(m_nodes[node].route != none)
+    {
+        ERROR_LOG("Route pattern " << std::string(pattern).c_str() \
+                << " was already added")
+        return none;
+    }
+    m_nodes[node].route = m_routes;
+    return m_routes++;
+}
+
+unsigned Fastcgipp::Router::insert(unsigned node, std::string_view text)
+{
+    while(!text.empty())
+    {
+        unsigned next = none;
+        for(const unsigned child: m_nodes[node].children)
+            if(m_nodes[child].prefix[0] == text[0])
+            {
+                next = child;
+                break;
+            }
+
+        if(next == none)
+        {
+            const unsigned child = m_nodes.size();
+            m_nodes.emplace_back();
+            m_nodes[child].prefix = text;
+            m_nodes[node].children.push_back(child);
+            return child;
+        }
+
+        const std::string& prefix = m_nodes[next].prefix;
+        const size_t common = std::mismatch(
+                prefix.cbegin(),
+                prefix.cend(),
+                text.cbegin(),
+                text.cend()).first - prefix.cbegin();
+
+        if(common < prefix.size())
+        {
+            // Split the child where the text leaves it
+            const unsigned split = m_nodes.size();
+            m_nodes.emplace_back();
+            m_nodes[split].prefix = m_nodes[next].prefix.substr(0, common);
+            m_nodes[split].children.push_back(next);
+            m_nodes[next].prefix.erase(0, common);
+            for(auto& child: m_nodes[node].children)
+                if(child == next)
+                    child = split;
+            next = split;
+        }
+
+        node = next;
+        text.remove_prefix(common);
+    }
+    return node;
+}
+
+unsigned Fastcgipp::Router::capture(
+        unsigned node,
+        bool wildcard,
+        std::string_view name)
+{
+    const unsigned existing = wildcard?
+        m_nodes[node].wildcard:
+        m_nodes[node].parameter;
+    if(existing != none)
+        return m_nodes[existing].name == name?existing:none;
+
+    const unsigned child = m_nodes.size();
+    m_nodes.emplace_back();
+    m_nodes[child].name = name;
+    if(wildcard)
+        m_nodes[node].wildcard = child;
+    else
+        m_nodes[node].parameter = child;
+    return child;
+}
@@ -0,0 +1,423 @@
+/*!
+ * @file       sharedsessions.cpp
+ * @brief      Defines the Fastcgipp::Http::SharedSessionTable class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/sharedsessions.hpp"
+#include "fastcgi++/log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//! Identifies a table file and its layout
+struct Fastcgipp::Http::SharedSessionTable::Header
+{
+    //! Always "fcgippst"
+    char magic[8];
+
+    //! Layout version
+    uint32_t version;
+
+    //! Size in bytes of session IDs
+    uint32_t idSize;
+
+    //! Amount of slots
+    uint64_t slotCount;
+
+    //! Size in bytes of a slot
+    uint64_t slotSize;
+
+    //! Serializes writers across processes
+    pthread_mutex_t mutex;
+
+    //! Amount of slots in use
+    std::atomic<uint64_t> size;
+};
+
+//! Fixed part of a slot. The ID and payload follow it.
+struct Fastcgipp::Http::SharedSessionTable::Slot
+{
+    //! Odd while the slot is being written
+    std::atomic<uint32_t> sequence;
+
+    //! One of EMPTY, USED or ERASED
+    std::atomic<uint32_t> state;
+
+    //! Last time the session was used
+    std::atomic<int64_t> timestamp;
+
+    //! Size of the payload
+    std::atomic<uint32_t> size;
+
+    uint32_t padding;
+
+    static const uint32_t EMPTY = 0;
+    static const uint32_t USED = 1;
+    static const uint32_t ERASED = 2;
+};
+
+namespace
+{
+    const char magic[8] = {'f', 'c', 'g', 'i', 'p', 'p', 's', 't'};
+    const uint32_t tableVersion = 1;
+
+    //! Round up to a multiple of 64 bytes
+    inline size_t cacheLines(size_t size)
+    {
+        return (size+63) & ~size_t(63);
+    }
+
+    static_assert(
+            std::atomic<uint32_t>::is_always_lock_free
+            && std::atomic<int64_t>::is_always_lock_free
+            && std::atomic<uint64_t>::is_always_lock_free,
+            "Shared session tables need lock free atomics");
+}
+
+Fastcgipp::Http::SharedSessionTable::SharedSessionTable(
+        const std::string& path,
+        unsigned keepAlive,
+        size_t slots,
+        size_t payloadSize,
+        size_t idSize):
+    m_keepAlive(keepAlive),
+    m_idSize(idSize),
+    m_payloadSize(payloadSize),
+    m_slotSize((sizeof(Slot)+idSize+payloadSize+7) & ~size_t(7)),
+    m_slotCount(std::max(slots, s_window)),
+    m_mapSize(cacheLines(sizeof(Header))+m_slotSize*m_slotCount),
+    m_fd(-1),
+    m_map(nullptr),
+    m_reused(false)
+{
+    m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(m_fd == -1)
+        FAIL_LOG("Unable to open shared session table " << path.c_str() \
+                << ": " << std::strerror(errno))
+
+    // Only one process gets to check and initialize the table
+    if(flock(m_fd, LOCK_EX) == -1)
+        FAIL_LOG("Unable to lock shared session table: " \
+                << std::strerror(errno))
+
+    struct stat status;
+    if(fstat(m_fd, &status) == -1)
+        FAIL_LOG("Unable to stat shared session table: " \
+                << std::strerror(errno))
+    // Another process may be using whatever is in the file so it is never
+    // reinitialized unless it is empty
+    if(status.st_size == 0 && ftruncate(m_fd, m_mapSize) == -1)
+        FAIL_LOG("Unable to size shared session table: " \
+                << std::strerror(errno))
+    else if(status.st_size != 0 && size_t(status.st_size) != m_mapSize)
+        FAIL_LOG("Shared session table " << path.c_str() << " is " \
+                << status.st_size << " bytes where " << m_mapSize \
+                << " were expected. Its geometry doesn't match so remove it "\
+                "or use another path.")
+
+    m_map = static_cast<char*>(mmap(
+                nullptr,
+                m_mapSize,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                m_fd,
+                0));
+    if(m_map == MAP_FAILED)
+        FAIL_LOG("Unable to map shared session table: " \
+                << std::strerror(errno))
+
+    Header& header = this->header();
+    m_reused = std::equal(magic, magic+sizeof(magic), header.magic);
+    if(m_reused && (header.version != tableVersion
+                || header.idSize != m_idSize
+                || header.slotCount != m_slotCount
+                || header.slotSize != m_slotSize))
+        FAIL_LOG("Shared session table " << path.c_str() << " has a "\
+                "different geometry. Remove it or use another path.")
+
+    if(!m_reused)
+    {
+        // Either freshly sized or left half initialized by a process that
+        // died holding the file lock. Nobody uses it before the magic is set.
+        std::fill(m_map, m_map+m_mapSize, 0);
+        header.version = tableVersion;
+        header.idSize = m_idSize;
+        header.slotCount = m_slotCount;
+        header.slotSize = m_slotSize;
+
+        pthread_mutexattr_t attributes;
+        pthread_mutexattr_init(&attributes);
+        pthread_mutexattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attributes, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&header.mutex, &attributes);
+        pthread_mutexattr_destroy(&attributes);
+
+        // Only mark the table valid once it is completely initialized
+        std::copy(magic, magic+sizeof(magic), header.magic);
+        msync(m_map, m_mapSize, MS_ASYNC);
+    }
+
+    flock(m_fd, LOCK_UN);
+}
+
+Fastcgipp::Http::SharedSessionTable::~SharedSessionTable()
+{
+    if(m_map != nullptr && m_map != MAP_FAILED)
+        munmap(m_map, m_mapSize);
+    if(m_fd != -1)
+        close(m_fd);
+}
+
+Fastcgipp::Http::SharedSessionTable::Header&
+Fastcgipp::Http::SharedSessionTable::header() const
+{
+    return *reinterpret_cast<Header*>(m_map);
+}
+
+Fastcgipp::Http::SharedSessionTable::Slot&
+Fastcgipp::Http::SharedSessionTable::slot(size_t index) const
+{
+    return *reinterpret_cast<Slot*>(
+            m_map+cacheLines(sizeof(Header))+(index%m_slotCount)*m_slotSize);
+}
+
+unsigned char* Fastcgipp::Http::SharedSessionTable::slotId(Slot& slot) const
+{
+    return reinterpret_cast<unsigned char*>(&slot)+sizeof(Slot);
+}
+
+char* Fastcgipp::Http::SharedSessionTable::slotPayload(Slot& slot) const
+{
+    return reinterpret_cast<char*>(&slot)+sizeof(Slot)+m_idSize;
+}
+
+size_t Fastcgipp::Http::SharedSessionTable::home(
+        const unsigned char* id) const
+{
+    // The ID data is random so there is no need to do any actual hashing
+    uint64_t hash = 0;
+    std::memcpy(&hash, id, std::min(sizeof(hash), m_idSize));
+    return hash % m_slotCount;
+}
+
+void Fastcgipp::Http::SharedSessionTable::lock()
+{
+    const int result = pthread_mutex_lock(&header().mutex);
+    if(result == EOWNERDEAD)
+    {
+        WARNING_LOG("A process died while writing to the shared session "\
+                "table. Repairing it.")
+        repair();
+        pthread_mutex_consistent(&header().mutex);
+    }
+    else if(result != 0)
+        FAIL_LOG("Unable to lock shared session table: " \
+                << std::strerror(result))
+}
+
+void Fastcgipp::Http::SharedSessionTable::unlock()
+{
+    pthread_mutex_unlock(&header().mutex);
+}
+
+void Fastcgipp::Http::SharedSessionTable::repair()
+{
+    uint64_t size = 0;
+    for(size_t i=0; i<m_slotCount; ++i)
+    {
+        Slot& slot = this->slot(i);
+        const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        if(sequence & 1)
+        {
+            // Half written so it can't be trusted
+            slot.state.store(Slot::ERASED, std::memory_order_relaxed);
+            slot.sequence.store(sequence+1, std::memory_order_release);
+        }
+        if(slot.state.load(std::memory_order_relaxed) == Slot::USED)
+            ++size;
+    }
+    header().size = size;
+}
+
+bool Fastcgipp::Http::SharedSessionTable::store(
+        const unsigned char* id,
+        const char* data,
+        size_t size)
+{
+    if(size > m_payloadSize)
+        return false;
+
+    const std::time_t oldest = std::time(nullptr)-m_keepAlive;
+    const size_t home = this->home(id);
+
+    lock();
+
+    // Take the first free or expired slot in the window. If there are none,
+    // evict the least recently used.
+    Slot* target = nullptr;
+    Slot* leastRecent = nullptr;
+    for(size_t i=0; i<s_window; ++i)
+    {
+        Slot& slot = this->slot(home+i);
+        const uint32_t state = slot.state.load(std::memory_order_relaxed);
+        const int64_t timestamp
+            = slot.timestamp.load(std::memory_order_relaxed);
+        if(state != Slot::USED || timestamp < oldest)
+        {
+            target = &slot;
+            break;
+        }
+        if(leastRecent == nullptr
+                || timestamp < leastRecent->timestamp.load(
+                    std::memory_order_relaxed))
+            leastRecent = &slot;
+    }
+    if(target == nullptr)
+        target = leastRecent;
+
+    if(target->state.load(std::memory_order_relaxed) != Slot::USED)
+        ++header().size;
+
+    const uint32_t sequence = target->sequence.load(std::memory_order_relaxed);
+    target->sequence.store(sequence+1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::copy(id, id+m_idSize, slotId(*target));
+    std::copy(data, data+size, slotPayload(*target));
+    target->size.store(size, std::memory_order_relaxed);
+    target->timestamp.store(std::time(nullptr), std::memory_order_relaxed);
+    target->state.store(Slot::USED, std::memory_order_relaxed);
+
+    target->sequence.store(sequence+2, std::memory_order_release);
+
+    unlock();
+    return true;
+}
+
+bool Fastcgipp::Http::SharedSessionTable::find(
+        const unsigned char* id,
+        std::vector<char>& data)
+{
+    const std::time_t now = std::time(nullptr);
+    const size_t home = this->home(id);
+
+    for(size_t i=0; i<s_window; ++i)
+    {
+        Slot& slot = this->slot(home+i);
+        unsigned spins = 0;
+        while(true)
+        {
+            const uint32_t sequence
+                = slot.sequence.load(std::memory_order_acquire);
+            if(sequence & 1)
+            {
+                // Its writer might have died so don't wait forever
+                if(++spins > s_spins)
+                    break;
+                std::this_thread::yield();
+                continue;
+            }
+
+            const uint32_t state = slot.state.load(std::memory_order_relaxed);
+            if(state == Slot::EMPTY)
+                return false;
+
+            const bool match = state == Slot::USED
+                && std::equal(id, id+m_idSize, slotId(slot));
+            int64_t timestamp = 0;
+            if(match)
+            {
+                timestamp = slot.timestamp.load(std::memory_order_relaxed);
+                const size_t size = std::min(
+                        size_t(slot.size.load(std::memory_order_relaxed)),
+                        m_payloadSize);
+                data.assign(slotPayload(slot), slotPayload(slot)+size);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(slot.sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            if(!match)
+                break;
+
+            if(timestamp < now-int64_t(m_keepAlive))
+                return false;
+
+            // Mark it used. Should the slot have been rewritten meanwhile, the
+            // worst that happens is another session living a bit longer.
+            if(timestamp != now)
+                slot.timestamp.compare_exchange_strong(
+                        timestamp,
+                        now,
+                        std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Fastcgipp::Http::SharedSessionTable::erase(const unsigned char* id)
+{
+    const size_t home = this->home(id);
+    lock();
+    for(size_t i=0; i<s_window; ++i)
+    {
+        Slot& slot = this->slot(home+i);
+        const uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if(state == Slot::EMPTY)
+            break;
+        if(state == Slot::USED && std::equal(id, id+m_idSize, slotId(slot)))
+        {
+            const uint32_t sequence
+                = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence+1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.state.store(Slot::ERASED, std::memory_order_relaxed);
+            slot.sequence.store(sequence+2, std::memory_order_release);
+            --header().size;
+            break;
+        }
+    }
+    unlock();
+}
+
+size_t Fastcgipp::Http::SharedSessionTable::size() const
+{
+    return header().size;
+}
+
+const size_t Fastcgipp::Http::SharedSessionTable::s_window;
+const unsigned Fastcgipp::Http::SharedSessionTable::s_spins;
@@ -39,6 +39,9 @@
 #include <fcntl.h>
 #include <pwd.h>
 #include <grp.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 
 Fastcgipp::Socket::Socket(
@@ -126,6 +129,13 @@ void Fastcgipp::Socket::close() const
     }
 }
 
+void Fastcgipp::Socket::receive(bool status) const
+{
+    if(valid() && !m_data->m_group.m_poll.pollIn(m_data->m_socket, status))
+        ERROR_LOG("Unable to modify socket " << m_data->m_socket \
+                << " in the poll list: " << std::strerror(errno))
+}
+
 Fastcgipp::Socket::~Socket()
 {
     if(m_original && valid())
@@ -141,7 +151,10 @@ Fastcgipp::SocketGroup::SocketGroup():
     m_waking(false),
     m_reuse(false),
     m_accept(true),
-    m_refreshListeners(false)
+    m_refreshListeners(false),
+    m_control(-1),
+    m_handover(-1),
+    m_takeover(-1)
 #if FASTCGIPP_LOG_LEVEL > 3
     ,m_incomingConnectionCount(0),
     m_outgoingConnectionCount(0),
@@ -161,9 +174,13 @@ Fastcgipp::SocketGroup::~SocketGroup()
 {
     close(m_wakeSockets[0]);
     close(m_wakeSockets[1]);
+    for(const auto& socket: {m_control, m_handover, m_takeover})
+        if(socket != -1)
+            ::close(socket);
     for(const auto& listener: m_listeners)
     {
-        ::shutdown(listener, SHUT_RDWR);
+        if(m_adopted.find(listener) == m_adopted.end())
+            ::shutdown(listener, SHUT_RDWR);
         ::close(listener);
     }
     for(const auto& filename: m_filenames)
@@ -226,7 +243,7 @@ bool Fastcgipp::SocketGroup::listen()
     }
 }
 
-bool Fastcgipp::SocketGroup::listen(
+Fastcgipp::socket_t Fastcgipp::SocketGroup::bindUnix(
         const char* name,
         uint32_t permissions,
         const char* owner,
@@ -236,14 +253,14 @@ bool Fastcgipp::SocketGroup::listen(
     {
         ERROR_LOG("Unable to delete file \"" << name << "\": " \
                 << std::strerror(errno))
-        return false;
+        return -1;
     }
 
     const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
     if(fd == -1)
     {
         ERROR_LOG("Unable to create unix socket: " << std::strerror(errno))
-        return false;
+        return -1;
 
     }
 
@@ -263,7 +280,7 @@ bool Fastcgipp::SocketGroup::listen(
                 << std::strerror(errno));
         close(fd);
         std::remove(name);
-        return false;
+        return -1;
     }
 
     // Set the user and group of the socket
@@ -277,7 +294,7 @@ bool Fastcgipp::SocketGroup::listen(
                     << " on the unix socket \"" << name << "\": " \
                     << std::strerror(errno));
             close(fd);
-            return false;
+            return -1;
         }
     }
 
@@ -290,7 +307,7 @@ bool Fastcgipp::SocketGroup::listen(
                     << std::dec << " on \"" << name << "\": " \
                     << std::strerror(errno));
             close(fd);
-            return false;
+            return -1;
         }
     }
 
@@ -299,10 +316,23 @@ bool Fastcgipp::SocketGroup::listen(
         ERROR_LOG("Unable to listen on unix socket :\"" << name << "\": "\
                 << std::strerror(errno));
         close(fd);
-        return false;
+        return -1;
     }
 
     m_filenames.emplace_back(name);
+    return fd;
+}
+
+bool Fastcgipp::SocketGroup::listen(
+        const char* name,
+        uint32_t permissions,
+        const char* owner,
+        const char* group)
+{
+    const auto fd = bindUnix(name, permissions, owner, group);
+    if(fd == -1)
+        return false;
+
     m_listeners.insert(fd);
     m_refreshListeners = true;
     return true;
@@ -367,6 +397,302 @@ bool Fastcgipp::SocketGroup::listen(
     return true;
 }
 
+bool Fastcgipp::SocketGroup::adopt(socket_t listener)
+{
+    if(m_listeners.find(listener) != m_listeners.end())
+    {
+        ERROR_LOG("Socket " << listener << " already being listened to")
+        return false;
+    }
+
+    int listening = 0;
+    socklen_t size = sizeof(listening);
+    if(getsockopt(listener, SOL_SOCKET, SO_ACCEPTCONN, &listening, &size) < 0
+            || !listening)
+    {
+        ERROR_LOG("Socket " << listener << " isn't listening")
+        return false;
+    }
+
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL)|O_NONBLOCK);
+
+    m_listeners.insert(listener);
+    m_adopted.insert(listener);
+    m_refreshListeners = true;
+    return true;
+}
+
+bool Fastcgipp::SocketGroup::watch(
+        int fd,
+        const std::function<void()>& ready)
+{
+    if(!m_poll.add(fd))
+    {
+        ERROR_LOG("Unable to add fd " << fd << " to the poll list: " \
+                << std::strerror(errno))
+        return false;
+    }
+    m_watched[fd] = ready;
+    return true;
+}
+
+unsigned Fastcgipp::SocketGroup::inherit()
+{
+    const char* const pid = std::getenv("LISTEN_PID");
+    const char* const fds = std::getenv("LISTEN_FDS");
+    if(pid == nullptr || fds == nullptr
+            || std::strtol(pid, nullptr, 10) != getpid())
+        return 0;
+
+    const int count = std::atoi(fds);
+    unsetenv("LISTEN_PID");
+    unsetenv("LISTEN_FDS");
+    unsetenv("LISTEN_FDNAMES");
+
+    // systemd passes its sockets starting after stderr
+    const int first = 3;
+
+    unsigned adopted = 0;
+    for(int fd=first; fd<first+count; ++fd)
+    {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if(adopt(fd))
+            ++adopted;
+    }
+    return adopted;
+}
+
+bool Fastcgipp::SocketGroup::control(
+        const char* name,
+        const std::function<void()>& handedOver)
+{
+    if(m_control != -1)
+    {
+        ERROR_LOG("SocketGroup already has a control socket")
+        return false;
+    }
+
+    // Don't touch the control socket of a process we're taking over from
+    // until it has handed over.
+    const std::string temporary
+        = std::string(name) + '.' + std::to_string(getpid());
+    const auto fd = bindUnix(temporary.c_str(), 0600, nullptr, nullptr);
+    if(fd == -1)
+        return false;
+    m_controlName = name;
+    if(m_takeover == -1)
+        placeControl();
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL)|O_NONBLOCK);
+    if(!m_poll.add(fd))
+        FAIL_LOG("Unable to add control socket " << fd \
+                << " to the poll list: " << std::strerror(errno))
+
+    m_control = fd;
+    m_handedOver = handedOver;
+    return true;
+}
+
+unsigned Fastcgipp::SocketGroup::takeover(const char* name)
+{
+    if(m_takeover != -1)
+    {
+        ERROR_LOG("SocketGroup is already taking over listeners")
+        return 0;
+    }
+
+    const auto fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if(fd == -1)
+    {
+        ERROR_LOG("Unable to create unix socket: " << std::strerror(errno))
+        return 0;
+    }
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, name, sizeof(address.sun_path) - 1);
+
+    if(::connect(
+                fd,
+                reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address)) == -1)
+    {
+        DIAG_LOG("No process to take over on control socket \"" << name \
+                << "\": " << std::strerror(errno))
+        close(fd);
+        return 0;
+    }
+
+    uint32_t count;
+    iovec data;
+    data.iov_base = &count;
+    data.iov_len = sizeof(count);
+    char control[CMSG_SPACE(sizeof(socket_t)*s_maxHandover)];
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if(recvmsg(fd, &message, MSG_CMSG_CLOEXEC) != sizeof(count))
+    {
+        ERROR_LOG("Unable to receive listeners over control socket \"" \
+                << name << "\": " << std::strerror(errno))
+        close(fd);
+        return 0;
+    }
+
+    unsigned adopted = 0;
+    for(cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header != nullptr;
+            header = CMSG_NXTHDR(&message, header))
+    {
+        if(header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        const socket_t* const begin
+            = reinterpret_cast<const socket_t*>(CMSG_DATA(header));
+        const socket_t* const end = begin
+            + (header->cmsg_len-CMSG_LEN(0))/sizeof(socket_t);
+        for(auto listener = begin; listener != end; ++listener)
+        {
+            if(!adopt(*listener))
+            {
+                close(*listener);
+                continue;
+            }
+            ++adopted;
+
+            // We're responsible for the file of a unix socket now
+            sockaddr_un local;
+            socklen_t size = sizeof(local);
+            if(getsockname(
+                        *listener,
+                        reinterpret_cast<sockaddr*>(&local),
+                        &size) == 0
+                    && local.sun_family == AF_UNIX
+                    && local.sun_path[0] != 0)
+                m_filenames.emplace_back(local.sun_path);
+        }
+    }
+
+    if(adopted != count)
+        WARNING_LOG("Only took over " << adopted << " of " << count \
+                << " listeners")
+
+    if(adopted == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    m_takeover = fd;
+    INFO_LOG("Took over " << adopted << " listeners from control socket \"" \
+            << name << "\"")
+    return adopted;
+}
+
+void Fastcgipp::SocketGroup::handover()
+{
+    const socket_t socket = ::accept4(m_control, nullptr, nullptr, SOCK_CLOEXEC);
+    if(socket<0)
+    {
+        if(errno != EAGAIN && errno != EWOULDBLOCK)
+            ERROR_LOG("Unable to accept() on control socket: " \
+                    << std::strerror(errno))
+        return;
+    }
+
+    if(m_handover != -1
+            || m_listeners.empty()
+            || m_listeners.size() > s_maxHandover)
+    {
+        WARNING_LOG("Refusing to hand over listeners")
+        close(socket);
+        return;
+    }
+
+    uint32_t count = m_listeners.size();
+    iovec data;
+    data.iov_base = &count;
+    data.iov_len = sizeof(count);
+    char control[CMSG_SPACE(sizeof(socket_t)*s_maxHandover)];
+    std::memset(control, 0, sizeof(control));
+    msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = CMSG_SPACE(sizeof(socket_t)*count);
+
+    cmsghdr* const header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(socket_t)*count);
+    std::copy(
+            m_listeners.cbegin(),
+            m_listeners.cend(),
+            reinterpret_cast<socket_t*>(CMSG_DATA(header)));
+
+    if(sendmsg(socket, &message, MSG_NOSIGNAL) != sizeof(count))
+    {
+        ERROR_LOG("Unable to hand over listeners: " << std::strerror(errno))
+        close(socket);
+        return;
+    }
+
+    if(!m_poll.add(socket))
+        FAIL_LOG("Unable to add handover socket " << socket \
+                << " to the poll list: " << std::strerror(errno))
+    m_handover = socket;
+    INFO_LOG("Handing over " << count << " listeners")
+}
+
+void Fastcgipp::SocketGroup::handedOver(bool confirmed)
+{
+    char x;
+    confirmed = confirmed && ::read(m_handover, &x, 1) == 1;
+    m_poll.del(m_handover);
+    close(m_handover);
+    m_handover = -1;
+
+    if(!confirmed)
+    {
+        WARNING_LOG("Listener handover was abandoned by the new process")
+        return;
+    }
+
+    m_poll.del(m_control);
+    close(m_control);
+    m_control = -1;
+
+    // The listeners and their files belong to the new process now
+    m_adopted = m_listeners;
+    m_filenames.clear();
+
+    INFO_LOG("Listeners have been taken over")
+    if(m_handedOver)
+        m_handedOver();
+}
+
+void Fastcgipp::SocketGroup::placeControl()
+{
+    const std::string temporary
+        = m_controlName + '.' + std::to_string(getpid());
+    if(std::rename(temporary.c_str(), m_controlName.c_str()) != 0)
+        ERROR_LOG("Unable to move control socket to \"" \
+                << m_controlName.c_str() << "\": " << std::strerror(errno))
+    else
+        std::replace(
+                m_filenames.begin(),
+                m_filenames.end(),
+                temporary,
+                m_controlName);
+    m_controlName.clear();
+}
+
 Fastcgipp::Socket Fastcgipp::SocketGroup::connect(const char* name)
 {
     const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
@@ -473,13 +799,28 @@ Fastcgipp::Socket Fastcgipp::SocketGroup::poll(bool block)
             for(auto& listener: m_listeners)
             {
                 m_poll.del(listener);
-                if(m_accept && !m_poll.add(listener))
+                if(m_accept && !m_poll.add(
+                            listener,
+                            m_adopted.find(listener) != m_adopted.end()))
                     FAIL_LOG("Unable to add listen socket " << listener \
                             << " to the poll list: " << std::strerror(errno))
             }
             m_refreshListeners=false;
         }
 
+        // Tell the process we took over from that we're accepting now
+        if(m_takeover != -1 && m_accept)
+        {
+            const char x = 1;
+            if(::write(m_takeover, &x, 1) != 1)
+                ERROR_LOG("Unable to confirm the listener takeover: " \
+                        << std::strerror(errno))
+            else if(!m_controlName.empty())
+                placeControl();
+            close(m_takeover);
+            m_takeover = -1;
+        }
+
         const auto result = m_poll.poll(block?-1:0);
 
         if(result)
@@ -488,7 +829,9 @@ Fastcgipp::Socket Fastcgipp::SocketGroup::poll(bool block)
             {
                 if(result.onlyIn())
                 {
-                    createSocket(result.socket());
+                    // Leave it for another process if we've stopped accepting
+                    if(m_accept)
+                        createSocket(result.socket());
                     continue;
                 }
                 else if(result.err())
@@ -499,6 +842,21 @@ Fastcgipp::Socket Fastcgipp::SocketGroup::poll(bool block)
                     FAIL_LOG("Got a weird event 0x" << std::hex \
                             << result.events() << " on listen poll." )
             }
+            else if(m_watched.find(result.socket()) != m_watched.end())
+            {
+                m_watched[result.socket()]();
+                continue;
+            }
+            else if(result.socket() == m_control)
+            {
+                handover();
+                continue;
+            }
+            else if(result.socket() == m_handover)
+            {
+                handedOver(result.in());
+                continue;
+            }
             else if(result.socket() == m_wakeSockets[1])
             {
                 if(result.onlyIn())
@@ -597,9 +955,11 @@ void Fastcgipp::SocketGroup::createSocket(const socket_t listener)
 
     if(m_accept)
     {
-        m_sockets.emplace(
+        const auto created = m_sockets.emplace(
                 socket,
-                Socket(socket, *this));
+                Socket(socket, *this)).first;
+        if(m_accepted)
+            m_accepted(created->second);
 #if FASTCGIPP_LOG_LEVEL > 3
         ++m_incomingConnectionCount;
 #endif
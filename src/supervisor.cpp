@@ -0,0 +1,186 @@
+/*!
+ * @file       supervisor.cpp
+ * @brief      Defines the Fastcgipp::Supervisor class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/supervisor.hpp"
+#include "fastcgi++/log.hpp"
+
+#include <cstring>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+const std::chrono::seconds Fastcgipp::Supervisor::s_minimumUptime(1);
+
+volatile std::sig_atomic_t Fastcgipp::Supervisor::s_signal = 0;
+
+Fastcgipp::Supervisor::Supervisor(unsigned workers):
+    m_workers(workers),
+    m_recycleRequests(0),
+    m_recycleRss(0)
+{
+    DIAG_LOG("Supervisor::Supervisor(): Initialized")
+}
+
+void Fastcgipp::Supervisor::signalHandler(int signum)
+{
+    if(signum != SIGCHLD)
+        s_signal = signum;
+}
+
+void Fastcgipp::Supervisor::fork(
+        const std::function<int()>& worker,
+        const sigset_t& mask)
+{
+    const pid_t pid = ::fork();
+    if(pid < 0)
+    {
+        ERROR_LOG("Unable to fork a worker: " << std::strerror(errno))
+        return;
+    }
+
+    if(pid == 0)
+    {
+        struct sigaction sigAction;
+        sigAction.sa_handler=SIG_DFL;
+        sigemptyset(&sigAction.sa_mask);
+        sigAction.sa_flags=0;
+        sigaction(SIGCHLD, &sigAction, nullptr);
+        sigaction(SIGUSR1, &sigAction, nullptr);
+        sigaction(SIGTERM, &sigAction, nullptr);
+        sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+        _exit(worker());
+    }
+
+    DIAG_LOG("Supervisor forked worker " << pid)
+    m_running[pid] = std::chrono::steady_clock::now();
+}
+
+void Fastcgipp::Supervisor::run(const std::function<int()>& worker)
+{
+    // Our signals are only ever delivered inside sigsuspend()
+    sigset_t signals;
+    sigset_t mask;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, &mask);
+
+    struct sigaction sigAction;
+    struct sigaction previous[3];
+    sigAction.sa_handler=Fastcgipp::Supervisor::signalHandler;
+    sigemptyset(&sigAction.sa_mask);
+    sigAction.sa_flags=0;
+    sigaction(SIGCHLD, &sigAction, &previous[0]);
+    sigaction(SIGUSR1, &sigAction, &previous[1]);
+    sigaction(SIGTERM, &sigAction, &previous[2]);
+
+    s_signal = 0;
+    int forwarded = 0;
+    bool throttle = false;
+
+    INFO_LOG("Supervising " << m_workers << " fastcgi++ workers")
+
+    while(true)
+    {
+        int status;
+        pid_t pid;
+        while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            const auto running = m_running.find(pid);
+            if(running == m_running.end())
+                continue;
+
+            const bool crashed = WIFSIGNALED(status)
+                || (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS);
+            if(!s_signal)
+            {
+                if(WIFSIGNALED(status))
+                    ERROR_LOG("Worker " << pid << " was killed by signal " \
+                            << WTERMSIG(status) << ". Replacing it.")
+                else if(crashed)
+                    ERROR_LOG("Worker " << pid << " exited with status " \
+                            << WEXITSTATUS(status) << ". Replacing it.")
+                else
+                    DIAG_LOG("Worker " << pid << " exited. Replacing it.")
+            }
+
+            if(crashed && std::chrono::steady_clock::now()-running->second
+                    < s_minimumUptime)
+                throttle = true;
+            m_running.erase(running);
+        }
+
+        if(s_signal)
+        {
+            if(forwarded != s_signal)
+            {
+                forwarded = s_signal;
+                for(const auto& running: m_running)
+                    kill(running.first, forwarded);
+            }
+
+            if(m_running.empty())
+                break;
+        }
+        else
+        {
+            if(throttle)
+            {
+                // Don't fork bomb ourselves with workers that die on startup
+                std::this_thread::sleep_for(s_minimumUptime);
+                throttle = false;
+                continue;
+            }
+
+            while(m_running.size() < m_workers)
+            {
+                const auto size = m_running.size();
+                fork(worker, mask);
+                if(m_running.size() == size)
+                {
+                    throttle = true;
+                    break;
+                }
+            }
+
+            if(throttle)
+                continue;
+        }
+
+        sigsuspend(&mask);
+    }
+
+    sigaction(SIGCHLD, &previous[0], nullptr);
+    sigaction(SIGUSR1, &previous[1], nullptr);
+    sigaction(SIGTERM, &previous[2], nullptr);
+    sigprocmask(SIG_SETMASK, &mask, nullptr);
+
+    INFO_LOG("All fastcgi++ workers have exited")
+}
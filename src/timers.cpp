@@ -0,0 +1,335 @@
+/*!
+ * @file       timers.cpp
+ * @brief      Defines the Fastcgipp::Timers class
+ * @author     Eddie Carle &lt;eddie@isatec.ca&gt;
+ * @date       October 18, 2026
+ * @copyright  Copyright &copy; 2026 Eddie Carle. This project is released under
+ *             the GNU Lesser General Public License Version 3.
+ */
+/*******************************************************************************
+* Copyright (C) 2026 Eddie Carle [eddie@isatec.ca]                             *
+*                                                                              *
+* This file is part of fastcgi++.                                              *
+*                                                                              *
+* fastcgi++ is free software: you can redistribute it and/or modify it under   *
+* the terms of the GNU Lesser General Public License as  published by the Free *
+* Software Foundation, either version 3 of the License, or (at your option)    *
+* any later version.                                                           *
+*                                                                              *
+* fastcgi++ is distributed in the hope that it will be useful, but WITHOUT ANY *
+* WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS    *
+* FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for     *
+* more details.                                                                *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with fastcgi++.  If not, see <http://www.gnu.org/licenses/>.           *
+*******************************************************************************/
+
+
+#include "fastcgi++/timers.hpp"
+#include "fastcgi++/log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+const std::chrono::milliseconds Fastcgipp::Timers::resolution(1);
+const uint32_t Fastcgipp::Timers::s_free;
+const uint64_t Fastcgipp::Timers::s_never;
+
+Fastcgipp::Timers::Timers(
+        const std::function<void(Protocol::RequestId, Message&&)>& deliver):
+    m_freeNodes(s_free),
+    m_size(0),
+    m_now(0),
+    m_armed(s_never),
+    m_epoch(Clock::now()),
+    m_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC)),
+    m_deliver(deliver)
+{
+    if(m_fd == -1)
+        FAIL_LOG("Unable to create timerfd: " << std::strerror(errno))
+    std::fill(std::begin(m_slots), std::end(m_slots), s_free);
+    std::memset(m_occupied, 0, sizeof(m_occupied));
+}
+
+Fastcgipp::Timers::~Timers()
+{
+    close(m_fd);
+}
+
+Fastcgipp::Timers::Id Fastcgipp::Timers::after(
+        Clock::duration delay,
+        const Protocol::RequestId& id,
+        Message&& message)
+{
+    // Round up so we're never early
+    const auto since = Clock::now()+delay-m_epoch;
+    const uint64_t due = since.count()<=0?0:(since+resolution
+            -Clock::duration(1))/resolution;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    uint32_t index;
+    if(m_freeNodes == s_free)
+    {
+        index = m_nodes.size();
+        m_nodes.emplace_back();
+        m_nodes.back().generation = 1;
+    }
+    else
+    {
+        index = m_freeNodes;
+        m_freeNodes = m_nodes[index].next;
+    }
+
+    Node& node = m_nodes[index];
+    node.expiry = std::max(due, m_now+1);
+    node.id = id;
+    node.message = std::move(message);
+    link(index);
+    ++m_size;
+
+    if(node.expiry < m_armed)
+        arm();
+
+    Id result;
+    result.index = index;
+    result.generation = node.generation;
+    return result;
+}
+
+bool Fastcgipp::Timers::cancel(Id id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(id.index >= m_nodes.size()
+            || m_nodes[id.index].generation != id.generation
+            || m_nodes[id.index].slot == s_free)
+        return false;
+
+    unlink(id.index);
+    release(id.index);
+    --m_size;
+    return true;
+}
+
+bool Fastcgipp::Timers::pending(Id id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return id.index < m_nodes.size()
+        && m_nodes[id.index].generation == id.generation
+        && m_nodes[id.index].slot != s_free;
+}
+
+size_t Fastcgipp::Timers::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+void Fastcgipp::Timers::expire()
+{
+    uint64_t expirations;
+    while(read(m_fd, &expirations, sizeof(expirations)) > 0);
+
+    std::vector<std::pair<Protocol::RequestId, Message>> due;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const uint64_t target = (Clock::now()-m_epoch)/resolution;
+        m_armed = s_never;
+
+        while(m_now < target)
+        {
+            const uint64_t tick = next();
+            if(tick > target)
+            {
+                m_now = target;
+                break;
+            }
+            m_now = tick;
+
+            if((m_now & s_mask) == 0)
+                cascade(1);
+
+            const uint32_t slot = m_now & s_mask;
+            uint32_t index = m_slots[slot];
+            m_slots[slot] = s_free;
+            m_occupied[0][slot/64] &= ~(uint64_t(1) << slot%64);
+            while(index != s_free)
+            {
+                Node& node = m_nodes[index];
+                const uint32_t next = node.next;
+                node.slot = s_free;
+                if(node.expiry > m_now)
+                    link(index);
+                else
+                {
+                    due.emplace_back(node.id, std::move(node.message));
+                    release(index);
+                    --m_size;
+                }
+                index = next;
+            }
+        }
+
+        arm();
+    }
+
+    for(auto& message: due)
+        m_deliver(message.first, std::move(message.second));
+}
+
+void Fastcgipp::Timers::link(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    const uint64_t delta = node.expiry>m_now?node.expiry-m_now:0;
+
+    unsigned level = 0;
+    while(level+1 < s_levels && delta >> s_bits*(level+1))
+        ++level;
+
+    // Park anything out of range in the furthest slot of the top level
+    uint64_t position = m_now+delta;
+    if(delta >> s_bits*s_levels)
+        position = m_now + (uint64_t(1) << s_bits*s_levels) - 1;
+
+    const unsigned offset = (position >> s_bits*level) & s_mask;
+    const uint32_t slot = level*s_slots + offset;
+    node.slot = slot;
+    node.prev = s_free;
+    node.next = m_slots[slot];
+    if(node.next != s_free)
+        m_nodes[node.next].prev = index;
+    m_slots[slot] = index;
+    m_occupied[level][offset/64] |= uint64_t(1) << offset%64;
+}
+
+void Fastcgipp::Timers::unlink(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    if(node.prev == s_free)
+        m_slots[node.slot] = node.next;
+    else
+        m_nodes[node.prev].next = node.next;
+    if(node.next != s_free)
+        m_nodes[node.next].prev = node.prev;
+
+    if(m_slots[node.slot] == s_free)
+    {
+        const unsigned level = node.slot/s_slots;
+        const unsigned slot = node.slot%s_slots;
+        m_occupied[level][slot/64] &= ~(uint64_t(1) << slot%64);
+    }
+    node.slot = s_free;
+}
+
+void Fastcgipp::Timers::release(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    node.slot = s_free;
+    node.id = Protocol::RequestId();
+    node.message = Message();
+    if(++node.generation == 0)
+        node.generation = 1;
+    node.next = m_freeNodes;
+    m_freeNodes = index;
+}
+
+void Fastcgipp::Timers::cascade(unsigned level)
+{
+    const unsigned slot = (m_now >> s_bits*level) & s_mask;
+    if(slot == 0 && level+1 < s_levels)
+        cascade(level+1);
+
+    uint32_t index = m_slots[level*s_slots + slot];
+    m_slots[level*s_slots + slot] = s_free;
+    m_occupied[level][slot/64] &= ~(uint64_t(1) << slot%64);
+    while(index != s_free)
+    {
+        const uint32_t next = m_nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+unsigned Fastcgipp::Timers::occupied(
+        unsigned level,
+        unsigned first,
+        unsigned last) const
+{
+    while(first <= last)
+    {
+        const uint64_t word = m_occupied[level][first/64]
+            & (~uint64_t(0) << first%64);
+        if(word)
+        {
+            const unsigned slot = (first & ~63u) + __builtin_ctzll(word);
+            return slot<=last?slot:s_slots;
+        }
+        first = (first & ~63u) + 64;
+    }
+    return s_slots;
+}
+
+uint64_t Fastcgipp::Timers::next() const
+{
+    if(m_size == 0)
+        return s_never;
+
+    // A slot in an upper level needs cascading once every level below it
+    // rolls over to zero, so each level is only looked at for its first
+    // occupied slot.
+    uint64_t tick = s_never;
+    for(unsigned level=0; level<s_levels; ++level)
+    {
+        const unsigned shift = s_bits*level;
+        const unsigned current = (m_now >> shift) & s_mask;
+        const uint64_t base = m_now >> (shift+s_bits) << (shift+s_bits);
+
+        // Later in this turn of the level
+        unsigned slot = current<s_mask?occupied(level, current+1, s_mask)
+            :s_slots;
+        uint64_t candidate = base + (uint64_t(slot) << shift);
+
+        // In the next turn of the level
+        if(slot == s_slots)
+        {
+            slot = occupied(level, 0, current);
+            if(slot == s_slots)
+                continue;
+            candidate = base + (uint64_t(s_slots+slot) << shift);
+        }
+
+        tick = std::min(tick, candidate);
+    }
+    return tick;
+}
+
+void Fastcgipp::Timers::arm()
+{
+    const uint64_t tick = next();
+    if(tick == m_armed)
+        return;
+    m_armed = tick;
+
+    itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    if(tick != s_never)
+    {
+        const auto time = (m_epoch + tick*resolution).time_since_epoch();
+        const auto seconds
+            = std::chrono::duration_cast<std::chrono::seconds>(time);
+        spec.it_value.tv_sec = seconds.count();
+        spec.it_value.tv_nsec
+            = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    time-seconds).count();
+        // Zero would disarm it
+        if(spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+            spec.it_value.tv_nsec = 1;
+    }
+
+    if(timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1)
+        ERROR_LOG("Unable to arm timerfd: " << std::strerror(errno))
+}
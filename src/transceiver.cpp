@@ -43,11 +43,13 @@ bool Fastcgipp::Transceiver::transmit()
 
         const ssize_t sent = record->socket.write(
                 record->read,
-                record->data.end()-record->read);
+                record->end-record->read);
         if(sent>=0)
         {
+            if(sent > 0)
+                active(record->socket);
             record->read += sent;
-            if(record->read != record->data.end())
+            if(record->read != record->end)
             {
                 {
                     std::lock_guard<std::mutex> lock(m_sendBufferMutex);
@@ -62,6 +64,7 @@ bool Fastcgipp::Transceiver::transmit()
             {
                 record->socket.close();
                 m_receiveBuffers.erase(record->socket);
+                m_active.erase(record->socket);
 #if FASTCGIPP_LOG_LEVEL > 3
                 ++m_connectionKillCount;
 #endif
@@ -79,6 +82,7 @@ void Fastcgipp::Transceiver::handler()
 
     while(!m_terminate && !(m_stop && m_sockets.size()==0))
     {
+        applyThrottles();
         socket = m_sockets.poll(flushed);
         receive(socket);
         flushed = transmit();
@@ -119,13 +123,16 @@ void Fastcgipp::Transceiver::join()
 
 Fastcgipp::Transceiver::Transceiver(
         const std::function<void(Protocol::RequestId, Message&&)> sendMessage):
-    m_sendMessage(sendMessage)
+    m_sendMessage(sendMessage),
+    m_idle(0),
+    m_idled(0)
 #if FASTCGIPP_LOG_LEVEL > 3
     ,m_connectionKillCount(0),
     m_connectionRDHupCount(0),
     m_recordsSent(0),
     m_recordsQueued(0),
-    m_recordsReceived(0)
+    m_recordsReceived(0),
+    m_throttleCount(0)
 #endif
 {
     DIAG_LOG("Transceiver::Transciever(): Initialized")
@@ -150,6 +157,8 @@ void Fastcgipp::Transceiver::receive(Socket& socket)
                 cleanupSocket(socket);
                 return;
             }
+            if(read > 0)
+                active(socket);
             buffer.size(buffer.size() + read);
             if(buffer.size() < sizeof(Protocol::Header))
                 return;
@@ -174,6 +183,8 @@ void Fastcgipp::Transceiver::receive(Socket& socket)
             cleanupSocket(socket);
             return;
         }
+        if(read > 0)
+            active(socket);
         buffer.size(buffer.size() + read);
         if(buffer.size() < buffer.reserve())
             return;
@@ -193,6 +204,7 @@ void Fastcgipp::Transceiver::receive(Socket& socket)
 void Fastcgipp::Transceiver::cleanupSocket(const Socket& socket)
 {
     m_receiveBuffers.erase(socket);
+    m_active.erase(socket);
     m_sendMessage(
             Fastcgipp::Protocol::RequestId(Protocol::badFcgiId, socket),
             Message());
@@ -221,6 +233,115 @@ void Fastcgipp::Transceiver::send(
 #endif
 }
 
+void Fastcgipp::Transceiver::send(
+        const Socket& socket,
+        std::shared_ptr<const Block> data,
+        bool kill)
+{
+    std::unique_ptr<Record> record(new Record(
+                socket,
+                std::move(data),
+                kill));
+    {
+        std::lock_guard<std::mutex> lock(m_sendBufferMutex);
+        m_sendBuffer.push_back(std::move(record));
+    }
+    m_sockets.wake();
+#if FASTCGIPP_LOG_LEVEL > 3
+    ++m_recordsQueued;
+#endif
+}
+
+void Fastcgipp::Transceiver::throttle(const Socket& socket, bool throttle)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_throttlesMutex);
+        m_throttles.emplace_back(socket, throttle);
+    }
+    m_sockets.wake();
+}
+
+void Fastcgipp::Transceiver::applyThrottles()
+{
+    std::lock_guard<std::mutex> lock(m_throttlesMutex);
+    while(!m_throttles.empty())
+    {
+        const auto& throttle = m_throttles.front();
+        throttle.first.receive(!throttle.second);
+#if FASTCGIPP_LOG_LEVEL > 3
+        if(throttle.second)
+            ++m_throttleCount;
+#endif
+        m_throttles.pop_front();
+    }
+}
+
+void Fastcgipp::Transceiver::idle(Timers::Clock::duration timeout)
+{
+    m_idle = timeout;
+    if(m_idle == Timers::Clock::duration::zero() || m_idleTimers)
+        return;
+
+    m_idleTimers.reset(new Timers(
+                [this] (Protocol::RequestId id, Message&&)
+                {
+                    reap(id.m_socket);
+                }));
+    m_sockets.watch(m_idleTimers->fd(), [this] () { m_idleTimers->expire(); });
+    m_sockets.accepted([this] (const Socket& socket)
+            {
+                m_active[socket] = Timers::Clock::now();
+                m_idleTimers->after(
+                        m_idle,
+                        Protocol::RequestId(0, socket),
+                        Message());
+            });
+}
+
+void Fastcgipp::Transceiver::active(const Socket& socket)
+{
+    if(m_idleTimers)
+    {
+        const auto active = m_active.find(socket);
+        if(active != m_active.end())
+            active->second = Timers::Clock::now();
+    }
+}
+
+void Fastcgipp::Transceiver::reap(const Socket& socket)
+{
+    const auto active = m_active.find(socket);
+    if(active == m_active.end())
+        return;
+    if(!socket.valid())
+    {
+        m_active.erase(active);
+        return;
+    }
+
+    const auto idle = Timers::Clock::now()-active->second;
+    if(idle < m_idle)
+    {
+        m_idleTimers->after(
+                m_idle-idle,
+                Protocol::RequestId(0, socket),
+                Message());
+        return;
+    }
+
+    DIAG_LOG("Closing idle socket")
+    ++m_idled;
+    m_active.erase(active);
+    m_receiveBuffers.erase(socket);
+    m_sendMessage(
+            Fastcgipp::Protocol::RequestId(Protocol::badFcgiId, socket),
+            Message());
+    socket.close();
+#if FASTCGIPP_LOG_LEVEL > 3
+    ++m_connectionKillCount;
+#endif
+}
+
 Fastcgipp::Transceiver::~Transceiver()
 {
     terminate();
@@ -236,4 +357,6 @@ Fastcgipp::Transceiver::~Transceiver()
             << m_recordsSent)
     DIAG_LOG("Transceiver::~Transceiver(): Records received = " \
             << m_recordsReceived)
+    DIAG_LOG("Transceiver::~Transceiver(): Sockets throttled = " \
+            << m_throttleCount)
 }
@@ -192,7 +192,7 @@ std::streamsize Fastcgipp::WebStreambuf<charT, traits>::xsputn(
         }
 
         if(s<end)
-            this->sync();
+            emptyBuffer();
         else
             break;
     }
@@ -0,0 +1,265 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/admission.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fixture.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+//! Never finishes
+class Held: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        return false;
+    }
+};
+
+//! A record pulled apart
+struct Record
+{
+    Fastcgipp::Protocol::RecordType type;
+    Fastcgipp::Protocol::FcgiId id;
+    std::string body;
+};
+
+//! Split a buffer into its records
+std::vector<Record> records(const char* data, size_t size)
+{
+    std::vector<Record> records;
+    const char* const end = data+size;
+    while(data+sizeof(Fastcgipp::Protocol::Header) <= end)
+    {
+        const Fastcgipp::Protocol::Header& header
+            = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(data);
+        const char* const body = data+sizeof(header);
+        if(body+header.contentLength+header.paddingLength > end)
+            break;
+        records.push_back({
+                header.type,
+                header.fcgiId,
+                std::string(body, header.contentLength)});
+        data = body+header.contentLength+header.paddingLength;
+    }
+    return records;
+}
+
+//! Read records until one of the given type arrives
+std::vector<Record> receive(int fd, Fastcgipp::Protocol::RecordType type)
+{
+    std::string received;
+    while(true)
+    {
+        char chunk[4096];
+        const ssize_t size = read(fd, chunk, sizeof(chunk));
+        if(size <= 0)
+            FAIL_LOG("Connection lost waiting for a reply")
+        received.append(chunk, size);
+
+        const auto parsed = records(received.data(), received.size());
+        for(const auto& record: parsed)
+            if(record.type == type)
+                return parsed;
+    }
+}
+
+int main()
+{
+    using Fastcgipp::Protocol::RecordType;
+    using Fastcgipp::Protocol::ProtocolStatus;
+
+    // Limits
+    {
+        Fastcgipp::Admission admission;
+        if(!admission.admit(1000000) || admission.rejected() != 0)
+            FAIL_LOG("Fastcgipp::Admission rejected without a limit")
+
+        admission.configure(2, false);
+        if(!admission.admit(0) || !admission.admit(1) || admission.admit(2))
+            FAIL_LOG("Fastcgipp::Admission didn't enforce its limit")
+        if(admission.rejected() != 1)
+            FAIL_LOG("Fastcgipp::Admission rejection count is wrong")
+    }
+
+    // Rejections
+    {
+        Fastcgipp::Admission admission;
+        admission.configure(1, false);
+        Fastcgipp::Block block = admission.rejection(7);
+        auto parsed = records(block.begin(), block.size());
+        if(parsed.size() != 1
+                || parsed[0].type != RecordType::END_REQUEST
+                || parsed[0].id != 7
+                || reinterpret_cast<const Fastcgipp::Protocol::EndRequest*>(
+                    parsed[0].body.data())->protocolStatus
+                    != ProtocolStatus::OVERLOADED)
+            FAIL_LOG("Fastcgipp::Admission OVERLOADED rejection is wrong")
+
+        admission.configure(1, true);
+        block = admission.rejection(9);
+        parsed = records(block.begin(), block.size());
+        if(parsed.size() != 3
+                || parsed[0].type != RecordType::OUT
+                || parsed[0].body.find("Status: 503 Service Unavailable\r\n")
+                    != 0
+                || parsed[1].type != RecordType::OUT
+                || !parsed[1].body.empty()
+                || parsed[2].type != RecordType::END_REQUEST
+                || parsed[2].id != 9
+                || reinterpret_cast<const Fastcgipp::Protocol::EndRequest*>(
+                    parsed[2].body.data())->protocolStatus
+                    != ProtocolStatus::REQUEST_COMPLETE)
+            FAIL_LOG("Fastcgipp::Admission 503 rejection is wrong")
+    }
+
+    // Adapting
+    {
+        const auto slow = std::chrono::milliseconds(20);
+        const auto fast = std::chrono::milliseconds(1);
+
+        Fastcgipp::Admission admission;
+        admission.configure(100, false);
+        admission.adapt(std::chrono::milliseconds(10), 10);
+
+        admission.delay(slow);
+        if(admission.limit() != 90)
+            FAIL_LOG("Fastcgipp::Admission didn't cut its limit")
+        for(int i=0; i<89; ++i)
+            admission.delay(slow);
+        if(admission.limit() != 90)
+            FAIL_LOG("Fastcgipp::Admission cut its limit twice in a round")
+        admission.delay(slow);
+        if(admission.limit() != 81)
+            FAIL_LOG("Fastcgipp::Admission didn't cut its limit next round")
+
+        for(int i=0; i<80; ++i)
+            admission.delay(fast);
+        if(admission.limit() != 81)
+            FAIL_LOG("Fastcgipp::Admission raised its limit early")
+        admission.delay(fast);
+        if(admission.limit() != 82)
+            FAIL_LOG("Fastcgipp::Admission didn't raise its limit")
+
+        for(int i=0; i<10000; ++i)
+            admission.delay(slow);
+        if(admission.limit() != 10)
+            FAIL_LOG("Fastcgipp::Admission went past its minimum")
+        for(int i=0; i<100000; ++i)
+            admission.delay(fast);
+        if(admission.limit() != 100)
+            FAIL_LOG("Fastcgipp::Admission went past its maximum: " \
+                    << admission.limit())
+    }
+
+    // Management replies
+    {
+        const Fastcgipp::Block block = Fastcgipp::Protocol::managementReply(
+                "FCGI_MAX_REQS",
+                "1234");
+        const auto parsed = records(block.begin(), block.size());
+        if(block.size()%Fastcgipp::Protocol::chunkSize != 0
+                || parsed.size() != 1
+                || parsed[0].type != RecordType::GET_VALUES_RESULT
+                || parsed[0].id != 0
+                || parsed[0].body != std::string("\x0d\x04" "FCGI_MAX_REQS1234"))
+            FAIL_LOG("Fastcgipp::Protocol::managementReply() is wrong")
+    }
+
+    // Overloading the manager
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Held> manager(2);
+        manager.limit(1);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const std::string sent = request({{"REQUEST_URI", "/"}}, 1, true);
+
+        // This one takes the only place
+        const int held = send(port, sent);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // So this one is rejected
+        const int rejected = send(port, sent);
+        auto parsed = receive(rejected, RecordType::END_REQUEST);
+        if(parsed.size() != 1
+                || reinterpret_cast<const Fastcgipp::Protocol::EndRequest*>(
+                    parsed[0].body.data())->protocolStatus
+                    != ProtocolStatus::OVERLOADED)
+            FAIL_LOG("Manager didn't reject a request past its limit")
+
+        // The rest of the rejected request is swallowed and the connection
+        // still works
+        std::string values;
+        values += char(13);
+        values += char(0);
+        values += "FCGI_MAX_REQS";
+        const std::string getValues = record(RecordType::GET_VALUES, values, 0);
+        if(write(rejected, getValues.data(), getValues.size())
+                != ssize_t(getValues.size()))
+            FAIL_LOG("Unable to write GET_VALUES")
+        parsed = receive(rejected, RecordType::GET_VALUES_RESULT);
+        if(parsed.size() != 1
+                || parsed[0].body != std::string("\x0d\x01" "FCGI_MAX_REQS1"))
+            FAIL_LOG("Manager reported the wrong FCGI_MAX_REQS")
+
+        if(manager.admission().rejected() != 1)
+            FAIL_LOG("Manager rejection count is wrong")
+
+        close(rejected);
+        close(held);
+        manager.terminate();
+        manager.join();
+    }
+
+    // Rejected requests still being swallowed don't take up places
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Held> manager(2);
+        manager.limit(2);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const std::string sent = request({}, 1, true);
+        const auto settle = [port] (const std::string& data)
+        {
+            const int fd = send(port, data);
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            return fd;
+        };
+
+        // Fill both places and reject one whose body never finishes
+        const int held = settle(sent);
+        const int leaving = settle(sent);
+        const int swallowed = settle(begin(1, true));
+        if(manager.admission().rejected() != 1)
+            FAIL_LOG("Manager didn't reject a request past its limit")
+
+        // A place frees up and is taken
+        close(leaving);
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const int admitted = settle(sent);
+        if(manager.admission().rejected() != 1)
+            FAIL_LOG("Manager counted a swallowed request against its limit")
+
+        close(admitted);
+        close(swallowed);
+        close(held);
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
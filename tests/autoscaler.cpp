@@ -0,0 +1,122 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/autoscaler.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fixture.hpp"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Blocks its thread for a while
+class Blocking: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        out << "Content-Type: text/plain\r\n\r\nblocked";
+        return true;
+    }
+};
+
+int main()
+{
+    using Clock = Fastcgipp::Autoscaler::Clock;
+    using std::chrono::milliseconds;
+
+    // Decisions
+    {
+        Fastcgipp::Autoscaler autoscaler;
+        const auto start = Clock::now();
+        if(autoscaler.grow(1, milliseconds(1000), start)
+                || autoscaler.shrink(10, start))
+            FAIL_LOG("Fastcgipp::Autoscaler scaled while disabled")
+
+        autoscaler.configure(2, 4, milliseconds(10), milliseconds(100));
+        if(autoscaler.grow(2, milliseconds(10), start))
+            FAIL_LOG("Fastcgipp::Autoscaler grew without a long wait")
+        if(!autoscaler.grow(2, milliseconds(20), start))
+            FAIL_LOG("Fastcgipp::Autoscaler didn't grow after a long wait")
+        if(autoscaler.grow(3, milliseconds(20), start+milliseconds(5)))
+            FAIL_LOG("Fastcgipp::Autoscaler grew twice in a row")
+        if(!autoscaler.grow(3, milliseconds(20), start+milliseconds(10)))
+            FAIL_LOG("Fastcgipp::Autoscaler didn't grow again")
+        if(autoscaler.grow(4, milliseconds(20), start+milliseconds(50)))
+            FAIL_LOG("Fastcgipp::Autoscaler went past its maximum")
+
+        if(autoscaler.shrink(4, start+milliseconds(50)))
+            FAIL_LOG("Fastcgipp::Autoscaler shrank straight after growing")
+        if(!autoscaler.shrink(4, start+milliseconds(110))
+                || !autoscaler.shrink(3, start+milliseconds(110)))
+            FAIL_LOG("Fastcgipp::Autoscaler didn't shrink")
+        if(autoscaler.shrink(2, start+milliseconds(110)))
+            FAIL_LOG("Fastcgipp::Autoscaler went past its minimum")
+
+        autoscaler.resized(3);
+        autoscaler.resized(2);
+        const auto metrics = autoscaler.metrics();
+        if(metrics.threads != 2
+                || metrics.peak != 3
+                || metrics.grown != 2
+                || metrics.shrunk != 2
+                || metrics.trigger != milliseconds(20))
+            FAIL_LOG("Fastcgipp::Autoscaler metrics are wrong")
+    }
+
+    // Blocked threads are added to and idle ones removed
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Blocking> manager(8);
+        manager.autoscale(1, 4, milliseconds(50), milliseconds(300));
+        if(manager.autoscaling().threads != 4)
+            FAIL_LOG("Manager didn't clamp its threads")
+        manager.resizeThreads(1);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const std::string records = request({});
+        std::vector<int> requests;
+        for(int i=0; i<6; ++i)
+        {
+            requests.push_back(send(port, records));
+            std::this_thread::sleep_for(milliseconds(100));
+        }
+        for(const int fd: requests)
+            if(drain(fd).find("\r\n\r\nblocked") == std::string::npos)
+                FAIL_LOG("Request wasn't answered")
+
+        auto metrics = manager.autoscaling();
+        if(metrics.grown == 0
+                || metrics.peak < 2
+                || metrics.peak > 4
+                || metrics.trigger <= milliseconds(50))
+            FAIL_LOG("Manager didn't add threads to a blocked pool")
+
+        std::this_thread::sleep_for(milliseconds(1500));
+        metrics = manager.autoscaling();
+        if(metrics.shrunk == 0 || metrics.threads != 1)
+            FAIL_LOG("Manager didn't remove idle threads: " \
+                    << metrics.threads)
+
+        // Resizing while running
+        manager.resizeThreads(3);
+        if(manager.autoscaling().threads != 3)
+            FAIL_LOG("Manager didn't resize while running")
+
+        // Still works after threads have come and gone
+        if(drain(send(port, records)).find("\r\n\r\nblocked")
+                == std::string::npos)
+            FAIL_LOG("Request wasn't answered after scaling")
+
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
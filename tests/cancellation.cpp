@@ -0,0 +1,74 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/cancellation.hpp"
+#include "fastcgi++/request.hpp"
+#include "fixture.hpp"
+
+#include <memory>
+
+//! Hands out its cancellation token and finishes on the first callback
+class Working: public Fastcgipp::Request<char>
+{
+public:
+    std::shared_ptr<Fastcgipp::Cancellation> token;
+
+private:
+    bool response()
+    {
+        token = cancellation();
+        return m_message.type != 0;
+    }
+};
+
+//! Run a request and return its token once it's destroyed
+std::shared_ptr<Fastcgipp::Cancellation> run(bool finish)
+{
+    Working request;
+    request.configure(
+            Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+            Fastcgipp::Protocol::Role::RESPONDER,
+            true,
+            [] (const Fastcgipp::Socket&, Fastcgipp::Block&&, bool) {},
+            [] (Fastcgipp::Message) {},
+            [] (const Fastcgipp::Socket&, bool) {});
+    request.push(message(Fastcgipp::Protocol::RecordType::PARAMS));
+    request.push(message(Fastcgipp::Protocol::RecordType::IN));
+    if(finish)
+        request.push(Fastcgipp::Message(1));
+    request.handler();
+    if(!request.token || request.token->cancelled())
+        FAIL_LOG("Request token is missing or cancelled too early")
+    return request.token;
+}
+
+int main()
+{
+    // Functions are called once and can be forgotten
+    {
+        Fastcgipp::Cancellation cancellation;
+        unsigned called = 0;
+        unsigned forgotten = 0;
+        cancellation.onCancel([&] () { ++called; });
+        const auto id = cancellation.onCancel([&] () { ++forgotten; });
+        if(id == 0)
+            FAIL_LOG("Fastcgipp::Cancellation called a function too early")
+        cancellation.forget(id);
+
+        cancellation.cancel();
+        cancellation.cancel();
+        if(!cancellation.cancelled() || called != 1 || forgotten != 0)
+            FAIL_LOG("Fastcgipp::Cancellation called the wrong functions")
+
+        if(cancellation.onCancel([&] () { ++called; }) != 0 || called != 2)
+            FAIL_LOG("Fastcgipp::Cancellation didn't call a late function")
+    }
+
+    // Requests cancel their token unless they finish
+    {
+        if(!run(false)->cancelled())
+            FAIL_LOG("Unfinished request didn't cancel its token")
+        if(run(true)->cancelled())
+            FAIL_LOG("Finished request cancelled its token")
+    }
+
+    return 0;
+}
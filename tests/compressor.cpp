@@ -0,0 +1,223 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/compressor.hpp"
+#include "fastcgi++/fcgistreambuf.hpp"
+
+#include <zlib.h>
+
+#include <ostream>
+#include <string>
+
+using Fastcgipp::Compressor;
+
+const Fastcgipp::Protocol::FcgiId FCGIID = 2006;
+
+const std::string headers("Status: 200 OK\nContent-Type: text/html\r\n\r\n");
+
+//! Inflate zlib/gzip data
+std::string inflate(const std::string& data, int windowBits)
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = Z_NULL;
+    stream.avail_in = 0;
+    if(inflateInit2(&stream, windowBits) != Z_OK)
+        FAIL_LOG("Unable to initialize inflate")
+
+    std::string result;
+    char buffer[4096];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    do
+    {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        const int status = inflate(&stream, Z_SYNC_FLUSH);
+        if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+            FAIL_LOG("Inflate failed")
+        result.append(buffer, sizeof(buffer)-stream.avail_out);
+        if(status != Z_OK)
+            break;
+    } while(stream.avail_out == 0 || stream.avail_in != 0);
+    inflateEnd(&stream);
+    return result;
+}
+
+std::string makeBody(size_t size)
+{
+    const std::string text(
+            "In botany, a tree is a perennial plant with an elongated stem, or "
+            "trunk, supporting branches and leaves in most species. ");
+    std::string body;
+    while(body.size() < size)
+        body += text;
+    body.resize(size);
+    return body;
+}
+
+int main()
+{
+    // Negotiation
+    {
+        const Compressor::Coding starred = Compressor::supported(
+                Compressor::Coding::ZSTD)?Compressor::Coding::ZSTD:
+            Compressor::supported(Compressor::Coding::BROTLI)?
+                Compressor::Coding::BROTLI:Compressor::Coding::GZIP;
+
+        const std::pair<std::string, Compressor::Coding> cases[] =
+        {
+            {"", Compressor::Coding::IDENTITY},
+            {"identity", Compressor::Coding::IDENTITY},
+            {"gzip, deflate", Compressor::Coding::GZIP},
+            {"GZip", Compressor::Coding::GZIP},
+            {"deflate;q=1, gzip;q=0.5", Compressor::Coding::DEFLATE},
+            {"gzip;q=0", Compressor::Coding::IDENTITY},
+            {"gzip;q=0.000, deflate;q=0.001", Compressor::Coding::DEFLATE},
+            {" gzip ; q=0.8 ,deflate;q=0.9", Compressor::Coding::DEFLATE},
+            {"*", starred},
+            {"*;q=0.1, gzip;q=0.5", Compressor::Coding::GZIP},
+            {"*;q=0", Compressor::Coding::IDENTITY},
+            {"compress, x-gzip", Compressor::Coding::IDENTITY},
+        };
+        for(const auto& test: cases)
+            if(Compressor::negotiate(test.first) != test.second)
+                FAIL_LOG("Compressor::negotiate() failed on \"" \
+                        << test.first.c_str() << '"')
+
+        if(Compressor::supported(Compressor::Coding::BROTLI)
+                && Compressor::negotiate("gzip, br")
+                    != Compressor::Coding::BROTLI)
+            FAIL_LOG("Compressor::negotiate() should prefer brotli")
+    }
+
+    std::string output;
+    const auto sink = [&output] (Fastcgipp::Block&& record, size_t size)
+    {
+        if(record.reserve() < Fastcgipp::Protocol::getRecordSize(size))
+            FAIL_LOG("Compressor record block is too small")
+        output.append(
+                record.begin()+sizeof(Fastcgipp::Protocol::Header),
+                size);
+    };
+
+    // Compressed streams with a flush point in the middle
+    for(const Compressor::Coding coding:
+            {Compressor::Coding::GZIP, Compressor::Coding::DEFLATE})
+    {
+        for(unsigned run=0; run<2; ++run)
+        {
+            output.clear();
+            const std::string body = makeBody(100000);
+            Compressor compressor(coding, 256, 0, sink);
+
+            // Split the header block across writes
+            compressor.write(headers.data(), headers.size()-3);
+            compressor.write(headers.data()+headers.size()-3, 3);
+            compressor.write(body.data(), 100);
+            if(!output.empty())
+                FAIL_LOG("Compressor sent something below the threshold")
+
+            compressor.write(body.data()+100, 50000);
+            compressor.flush();
+
+            const std::string expectedHeaders(
+                    std::string("Status: 200 OK\nContent-Type: text/html\r\n"
+                        "Content-Encoding: ")
+                    + Compressor::name(coding)
+                    + "\r\nVary: Accept-Encoding\r\n\r\n");
+            if(output.compare(0, expectedHeaders.size(), expectedHeaders))
+                FAIL_LOG("Compressor headers are wrong: " << output.c_str())
+
+            const int windowBits = coding==Compressor::Coding::GZIP?31:15;
+            if(inflate(output.substr(expectedHeaders.size()), windowBits)
+                    != body.substr(0, 50100))
+                FAIL_LOG("Compressor didn't honour the flush point")
+
+            compressor.write(body.data()+50100, body.size()-50100);
+            compressor.finish();
+            const std::string compressed(output.substr(expectedHeaders.size()));
+            if(compressed.size() >= body.size()/4)
+                FAIL_LOG("Compressor didn't compress much")
+            if(inflate(compressed, windowBits) != body)
+                FAIL_LOG("Compressor output doesn't match")
+        }
+    }
+
+    // Bodies under the threshold and responses with a length go out as is
+    {
+        const std::string responses[] =
+        {
+            headers + makeBody(255),
+            "Content-Length: 1000\n\n" + makeBody(1000),
+            "Content-type: text/plain\ncontent-encoding: br\r\n\r\n"
+                + makeBody(1000),
+            "Status: 304 Not Modified\r\n\r\n"
+        };
+        for(const auto& response: responses)
+        {
+            output.clear();
+            Compressor compressor(Compressor::Coding::GZIP, 256, 0, sink);
+            compressor.write(response.data(), response.size());
+            compressor.finish();
+            if(output != response)
+                FAIL_LOG("Compressor should have passed through: " << response.c_str())
+        }
+    }
+
+    // Through the stream buffer into a single tail block
+    {
+        const std::string body = makeBody(20000);
+        Fastcgipp::FcgiStreambuf<char> buffer;
+        std::string stream;
+        bool terminated = false;
+        const auto parse = [&] (const Fastcgipp::Block& block)
+        {
+            const char* position = block.begin();
+            while(position < block.end())
+            {
+                const Fastcgipp::Protocol::Header& header
+                    = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                            position);
+                if(header.fcgiId != FCGIID
+                        || header.type != Fastcgipp::Protocol::RecordType::OUT)
+                    FAIL_LOG("FcgiStreambuf record header is wrong")
+                if(terminated)
+                    FAIL_LOG("FcgiStreambuf sent data after terminating")
+                if(header.contentLength == 0)
+                    terminated = true;
+                stream.append(
+                        position+sizeof(header),
+                        header.contentLength);
+                position += sizeof(header)
+                    + header.contentLength
+                    + header.paddingLength;
+            }
+        };
+
+        buffer.configure(
+                Fastcgipp::Protocol::RequestId(FCGIID, Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& record)
+                {
+                    parse(record);
+                });
+        buffer.compress(Compressor::Coding::GZIP, 0);
+
+        std::ostream out(&buffer);
+        out << headers << body;
+        Fastcgipp::Block tail;
+        buffer.collect(tail, true);
+        parse(tail);
+
+        if(!terminated)
+            FAIL_LOG("FcgiStreambuf didn't terminate the stream")
+        const size_t bodyStart = stream.find("\r\n\r\n")+4;
+        if(stream.find("Content-Encoding: gzip") >= bodyStart)
+            FAIL_LOG("FcgiStreambuf didn't add the Content-Encoding header")
+        if(inflate(stream.substr(bodyStart), 31) != body)
+            FAIL_LOG("FcgiStreambuf compressed output doesn't match")
+    }
+
+    return 0;
+}
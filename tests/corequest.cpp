@@ -0,0 +1,155 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/corequest.hpp"
+#include "fixture.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const Fastcgipp::Protocol::FcgiId FCGIID = 2006;
+
+//! Callback of the operation currently in progress
+std::function<void(Fastcgipp::Message)> pending;
+
+class Waiting: public Fastcgipp::CoRequest<char>
+{
+    Task coResponse()
+    {
+        out << "Content-Type: text/plain\r\n\r\n";
+
+        // Completes later from the outside
+        Fastcgipp::Message message = co_await await(
+                [] (const std::function<void(Fastcgipp::Message)>& callback)
+                {
+                    pending = callback;
+                });
+        out << message.type << ' ';
+        out << std::string(message.data.begin(), message.data.end()) << ' ';
+
+        // Completes before we even suspend
+        message = co_await await(
+                [] (const std::function<void(Fastcgipp::Message)>& callback)
+                {
+                    callback(Fastcgipp::Message(8));
+                });
+        out << message.type << ' ';
+
+        // Fails to start
+        message = co_await await(
+                [] (const std::function<void(Fastcgipp::Message)>&)
+                {
+                    return false;
+                });
+        out << message.type;
+    }
+};
+
+class Throwing: public Fastcgipp::CoRequest<char>
+{
+    Task coResponse()
+    {
+        co_await await(
+                [] (const std::function<void(Fastcgipp::Message)>& callback)
+                {
+                    callback(Fastcgipp::Message(1));
+                });
+        throw std::runtime_error("thrown");
+    }
+};
+
+//! Configure a request and feed it the records to start responding
+template<class RequestT>
+void start(RequestT& request, std::string& out, bool& ended)
+{
+    request.configure(
+            Fastcgipp::Protocol::RequestId(FCGIID, Fastcgipp::Socket()),
+            Fastcgipp::Protocol::Role::RESPONDER,
+            true,
+            [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool)
+            {
+                const char* position = data.begin();
+                while(position < data.end())
+                {
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                                position);
+                    const char* const body = position+sizeof(header);
+                    if(header.type == Fastcgipp::Protocol::RecordType::OUT)
+                        out.append(body, header.contentLength);
+                    else if(header.type
+                            == Fastcgipp::Protocol::RecordType::END_REQUEST)
+                        ended = true;
+                    position = body+header.contentLength+header.paddingLength;
+                }
+            },
+            [&] (Fastcgipp::Message message)
+            {
+                request.push(std::move(message));
+            },
+            [] (const Fastcgipp::Socket&, bool) {});
+
+    request.push(message(Fastcgipp::Protocol::RecordType::PARAMS, FCGIID));
+    request.push(message(Fastcgipp::Protocol::RecordType::IN, FCGIID));
+}
+
+int main()
+{
+    // Suspending and resuming
+    {
+        std::string out;
+        bool ended = false;
+        Waiting request;
+        start(request, out, ended);
+        request.handler();
+
+        if(ended || !pending)
+            FAIL_LOG("Fastcgipp::CoRequest didn't suspend")
+
+        Fastcgipp::Message message(7);
+        static const char text[] = "resumed";
+        message.data.assign(text, sizeof(text)-1);
+        pending(std::move(message));
+        request.handler();
+
+        if(!ended)
+            FAIL_LOG("Fastcgipp::CoRequest didn't complete")
+        if(out != "Content-Type: text/plain\r\n\r\n7 resumed 8 0")
+            FAIL_LOG("Fastcgipp::CoRequest output is wrong: " << out.c_str())
+    }
+
+    // Destroyed while suspended
+    {
+        std::string out;
+        bool ended = false;
+        pending = std::function<void(Fastcgipp::Message)>();
+        {
+            Waiting request;
+            start(request, out, ended);
+            request.handler();
+        }
+        if(ended || !pending)
+            FAIL_LOG("Fastcgipp::CoRequest didn't suspend")
+    }
+
+    // Exceptions come out of handler()
+    {
+        std::string out;
+        bool ended = false;
+        Throwing request;
+        start(request, out, ended);
+        bool caught = false;
+        try
+        {
+            request.handler();
+        }
+        catch(const std::runtime_error& error)
+        {
+            caught = std::string(error.what()) == "thrown";
+        }
+        if(!caught)
+            FAIL_LOG("Fastcgipp::CoRequest swallowed an exception")
+    }
+
+    return 0;
+}
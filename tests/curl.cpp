@@ -46,8 +46,15 @@ unsigned int openfds()
 }
 #endif
 
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 std::condition_variable wake;
 std::mutex mutex;
@@ -80,6 +87,58 @@ int main()
     std::setlocale(LC_ALL, "en_US.utf8");
     const auto initialFds = openfds();
 
+    // Test cancellation against a server that never responds
+    {
+        const int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t size = sizeof(address);
+        if(bind(listener, reinterpret_cast<sockaddr*>(&address), size)
+                || ::listen(listener, 8)
+                || getsockname(
+                    listener,
+                    reinterpret_cast<sockaddr*>(&address),
+                    &size))
+            FAIL_LOG("Unable to listen for cancellation test")
+        const std::string url = "http://127.0.0.1:"
+            + std::to_string(ntohs(address.sin_port)) + "/";
+
+        Fastcgipp::Curler curler(2);
+        curler.start();
+        bool called = false;
+
+        // Cancelled before it's sent
+        auto cancellation = std::make_shared<Fastcgipp::Cancellation>();
+        cancellation->cancel();
+        Fastcgipp::Curl<char> queued;
+        queued.setUrl(url);
+        queued.setCallback([&] (Fastcgipp::Message) { called = true; });
+        queued.setCancellation(cancellation);
+        curler.queue(queued);
+
+        // Cancelled in flight
+        cancellation = std::make_shared<Fastcgipp::Cancellation>();
+        {
+            Fastcgipp::Curl<char> inFlight;
+            inFlight.setUrl(url);
+            inFlight.setCallback([&] (Fastcgipp::Message) { called = true; });
+            inFlight.setCancellation(cancellation);
+            curler.queue(inFlight);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        cancellation->cancel();
+
+        for(unsigned i=0; i<100 && curler.cancelled() < 2; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if(curler.cancelled() != 2 || called)
+            FAIL_LOG("Curler didn't abandon cancelled requests")
+
+        curler.terminate();
+        curler.join();
+        close(listener);
+    }
+
     {
         Fastcgipp::Curler curler(maxActive);
         curler.start();
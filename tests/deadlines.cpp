@@ -0,0 +1,265 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fixture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+
+const Fastcgipp::Protocol::FcgiId FCGIID = 2006;
+
+//! Waits on a callback before completing
+class Waiting: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        if(m_message.type == 0)
+        {
+            out << "Content-Type: text/plain\r\n\r\n";
+            return false;
+        }
+        out << "called back";
+        return true;
+    }
+};
+
+//! Answers straight away
+class Answering: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        out << "Content-Type: text/plain\r\n\r\nanswered";
+        return true;
+    }
+};
+
+int main()
+{
+    // Deadlines of a request on its own
+    {
+        struct Result
+        {
+            std::string out;
+            bool ended;
+        };
+
+        std::function<void(Fastcgipp::Message)> push;
+        Fastcgipp::Timers timers(
+                [&] (Fastcgipp::Protocol::RequestId, Fastcgipp::Message&& message)
+                {
+                    push(std::move(message));
+                });
+
+        const auto run = [&] (
+                const Fastcgipp::Deadlines& deadlines,
+                std::atomic_ullong* timedOut,
+                bool callback)
+        {
+            Result result{std::string(), false};
+            {
+                Waiting request;
+                request.configure(
+                        Fastcgipp::Protocol::RequestId(
+                            FCGIID,
+                            Fastcgipp::Socket()),
+                        Fastcgipp::Protocol::Role::RESPONDER,
+                        true,
+                        [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool)
+                        {
+                            const char* position = data.begin();
+                            while(position < data.end())
+                            {
+                                const Fastcgipp::Protocol::Header& header
+                                    = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                                            position);
+                                const char* const body = position+sizeof(header);
+                                if(header.type
+                                        == Fastcgipp::Protocol::RecordType::OUT)
+                                    result.out.append(body, header.contentLength);
+                                else if(header.type
+                                        == Fastcgipp::Protocol::RecordType::END_REQUEST)
+                                    result.ended = true;
+                                position = body
+                                    +header.contentLength
+                                    +header.paddingLength;
+                            }
+                        },
+                        [] (Fastcgipp::Message) {},
+                        [] (const Fastcgipp::Socket&, bool) {});
+                push = [&] (Fastcgipp::Message message)
+                {
+                    request.push(std::move(message));
+                };
+                request.timers(timers);
+                request.deadlines(
+                        Fastcgipp::Protocol::RequestId(
+                            FCGIID,
+                            Fastcgipp::Socket()),
+                        deadlines,
+                        timedOut,
+                        Fastcgipp::Timers::Clock::now());
+
+                if(deadlines.params == Fastcgipp::Timers::Clock::duration::zero())
+                {
+                    request.push(message(
+                                Fastcgipp::Protocol::RecordType::PARAMS,
+                                FCGIID));
+                    request.push(message(
+                                Fastcgipp::Protocol::RecordType::IN,
+                                FCGIID));
+                }
+                request.handler();
+
+                const auto giveUp = Fastcgipp::Timers::Clock::now()
+                    + std::chrono::seconds(10);
+                while(!result.ended)
+                {
+                    if(Fastcgipp::Timers::Clock::now() > giveUp)
+                        FAIL_LOG("Request deadline never passed")
+                    if(callback)
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                        request.push(Fastcgipp::Message(1));
+                    }
+                    else
+                    {
+                        pollfd fd = {timers.fd(), POLLIN, 0};
+                        ::poll(&fd, 1, 100);
+                        timers.expire();
+                    }
+                    request.handler();
+                }
+            }
+            if(timers.size() != 0)
+                FAIL_LOG("Request left deadline timers behind")
+            return result;
+        };
+
+        std::atomic_ullong timedOut[3];
+        for(auto& count: timedOut)
+            count = 0;
+
+        Fastcgipp::Deadlines deadlines;
+        deadlines.params = std::chrono::milliseconds(50);
+        Result result = run(deadlines, timedOut, false);
+        if(result.out.find("408 Request Timeout") == std::string::npos
+                || timedOut[0] != 1)
+            FAIL_LOG("Parameters deadline didn't pass: " << result.out.c_str())
+
+        deadlines = Fastcgipp::Deadlines();
+        deadlines.callback = std::chrono::milliseconds(50);
+        result = run(deadlines, timedOut, false);
+        if(result.out.find("504 Gateway Timeout") == std::string::npos
+                || timedOut[2] != 1)
+            FAIL_LOG("Callback deadline didn't pass: " << result.out.c_str())
+
+        deadlines = Fastcgipp::Deadlines();
+        deadlines.request = std::chrono::milliseconds(50);
+        result = run(deadlines, timedOut, false);
+        if(result.out.find("504 Gateway Timeout") == std::string::npos
+                || timedOut[1] != 1)
+            FAIL_LOG("Request deadline didn't pass: " << result.out.c_str())
+
+        // A callback in time beats the deadline
+        deadlines = Fastcgipp::Deadlines();
+        deadlines.callback = std::chrono::seconds(5);
+        deadlines.request = std::chrono::seconds(5);
+        result = run(deadlines, timedOut, true);
+        if(result.out != "Content-Type: text/plain\r\n\r\ncalled back"
+                || timedOut[0]+timedOut[1]+timedOut[2] != 3)
+            FAIL_LOG("Deadline passed early: " << result.out.c_str())
+    }
+
+    // Deadlines through the manager
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Waiting> manager(2);
+        Fastcgipp::Deadlines deadlines;
+        deadlines.params = std::chrono::milliseconds(100);
+        deadlines.callback = std::chrono::milliseconds(100);
+        deadlines.idle = std::chrono::milliseconds(300);
+        manager.deadlines(deadlines);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const Parameters params = {{"REQUEST_URI", "/"}};
+
+        // Parameters never finish
+        std::string received = drain(send(
+                    port,
+                    begin() + record(
+                        Fastcgipp::Protocol::RecordType::PARAMS,
+                        parameters(params))));
+        if(received.find("408 Request Timeout") == std::string::npos)
+            FAIL_LOG("Manager didn't enforce the parameters deadline")
+
+        // The callback never comes
+        received = drain(send(port, request(params)));
+        if(received.find("504 Gateway Timeout") == std::string::npos)
+            FAIL_LOG("Manager didn't enforce the callback deadline")
+
+        // Connections that say nothing are closed
+        const auto start = std::chrono::steady_clock::now();
+        received = drain(connect(port));
+        const auto waited = std::chrono::steady_clock::now()-start;
+        if(!received.empty()
+                || waited < std::chrono::milliseconds(300)
+                || waited > std::chrono::seconds(5))
+            FAIL_LOG("Manager didn't close the idle connection")
+
+        if(manager.timedOut(Fastcgipp::Deadline::PARAMS) != 1
+                || manager.timedOut(Fastcgipp::Deadline::CALLBACK) != 1
+                || manager.timedOut(Fastcgipp::Deadline::REQUEST) != 0
+                || manager.timedOut(Fastcgipp::Deadline::IDLE) != 1)
+            FAIL_LOG("Manager deadline metrics are wrong: " \
+                    << manager.timedOut(Fastcgipp::Deadline::PARAMS) << ' ' \
+                    << manager.timedOut(Fastcgipp::Deadline::REQUEST) << ' ' \
+                    << manager.timedOut(Fastcgipp::Deadline::CALLBACK) << ' ' \
+                    << manager.timedOut(Fastcgipp::Deadline::IDLE))
+
+        manager.terminate();
+        manager.join();
+    }
+
+    // Requests that waited on their parameters don't leave timers behind
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Answering> manager(1);
+        Fastcgipp::Deadlines deadlines;
+        deadlines.params = std::chrono::seconds(30);
+        manager.deadlines(deadlines);
+        manager.coalesce(true);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        for(unsigned i=0; i<20; ++i)
+            if(drain(send(port, request({}))).find("answered")
+                    == std::string::npos)
+                FAIL_LOG("Pending request wasn't answered")
+
+        if(manager.timers().size() != 0)
+            FAIL_LOG("Pending requests left " << manager.timers().size() \
+                    << " parameter deadlines behind")
+
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
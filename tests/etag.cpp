@@ -0,0 +1,203 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/etag.hpp"
+#include "fastcgi++/fcgistreambuf.hpp"
+#include "fastcgi++/http.hpp"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//! Run a response through a tagger and return what comes out
+std::string tag(
+        const std::vector<std::string>& pieces,
+        const std::vector<std::string>& ifNoneMatch,
+        std::unique_ptr<Fastcgipp::ETagger>& tagger,
+        Fastcgipp::Http::RequestMethod method
+            = Fastcgipp::Http::RequestMethod::GET)
+{
+    std::string output;
+    Fastcgipp::Http::Environment<char> environment;
+    environment.ifNoneMatch = ifNoneMatch;
+    environment.requestMethod = method;
+
+    tagger.reset(new Fastcgipp::ETagger(
+            [&environment] (const std::string& tag)
+            {
+                return environment.notModified(tag);
+            },
+            0,
+            [&output] (Fastcgipp::Block&& record, size_t contentLength)
+            {
+                const char* const body
+                    = record.begin()+sizeof(Fastcgipp::Protocol::Header);
+                output.append(body, contentLength);
+            }));
+
+    for(const auto& piece: pieces)
+        tagger->write(piece.data(), piece.size());
+    tagger->finish();
+    return output;
+}
+
+int main()
+{
+    // Hashing
+    {
+        const auto hash = [] (const std::string& data)
+        {
+            Fastcgipp::ETagger::Hash hash;
+            hash.update(data.data(), data.size());
+            return hash.digest();
+        };
+
+        if(hash("") != 0xef46db3751d8e999ULL
+                || hash("abc") != 0x44bc2cf5ad770999ULL
+                || hash("Hello World") != 0x6334d20719245bc2ULL
+                || hash(std::string(100, 'a')) != 0x375041e8b1decfb3ULL)
+            FAIL_LOG("Fastcgipp::ETagger::Hash doesn't match XXH64")
+
+        const std::string data(1000, 'x');
+        for(size_t split: {1, 7, 31, 32, 33, 500})
+        {
+            Fastcgipp::ETagger::Hash pieces;
+            pieces.update(data.data(), split);
+            pieces.update(data.data()+split, data.size()-split);
+            if(pieces.digest() != hash(data))
+                FAIL_LOG("Fastcgipp::ETagger::Hash isn't incremental")
+        }
+    }
+
+    // If-None-Match parsing
+    {
+        const std::string value("W/\"a,b\", \"c\",d ,*,  W/\"\"");
+        std::vector<std::string> tags;
+        Fastcgipp::Http::parseETags(
+                value.data(),
+                value.data()+value.size(),
+                tags);
+        const std::vector<std::string> expected =
+            {"\"a,b\"", "\"c\"", "\"d\"", "*", "\"\""};
+        if(tags != expected)
+            FAIL_LOG("Fastcgipp::Http::parseETags() is wrong")
+
+        Fastcgipp::Http::Environment<char> environment;
+        environment.ifNoneMatch = {"\"a\"", "\"b\""};
+        if(!environment.etagMatches("\"b\"")
+                || !environment.etagMatches("W/\"a\"")
+                || environment.etagMatches("\"c\"")
+                || environment.etagMatches("\"a"))
+            FAIL_LOG("Fastcgipp::Http::Environment::etagMatches() is wrong")
+        environment.ifNoneMatch = {"*"};
+        if(!environment.etagMatches("\"c\""))
+            FAIL_LOG("Fastcgipp::Http::Environment::etagMatches() wildcard")
+    }
+
+    const std::vector<std::string> response =
+    {
+        "Content-Type: text/plain\r\nCache-Con",
+        "trol: no-cache\r\n\r",
+        "\nHello World"
+    };
+    const std::string hashTag("\"6334d20719245bc2\"");
+
+    // Tagging
+    {
+        std::unique_ptr<Fastcgipp::ETagger> tagger;
+        const std::string output = tag(response, {"\"other\""}, tagger);
+        if(output != "Content-Type: text/plain\r\nCache-Control: no-cache\r\n"
+                "ETag: " + hashTag + "\r\n\r\nHello World")
+            FAIL_LOG("Fastcgipp::ETagger output is wrong: " << output.c_str())
+        if(tagger->tag() != hashTag || tagger->notModified())
+            FAIL_LOG("Fastcgipp::ETagger tag is wrong")
+    }
+
+    // Not modified
+    {
+        const std::string ifNoneMatch("\"other\", W/" + hashTag);
+        std::vector<std::string> tags;
+        Fastcgipp::Http::parseETags(
+                ifNoneMatch.data(),
+                ifNoneMatch.data()+ifNoneMatch.size(),
+                tags);
+
+        std::unique_ptr<Fastcgipp::ETagger> tagger;
+        const std::string output = tag(response, tags, tagger);
+        if(output != "Status: 304 Not Modified\r\nCache-Control: no-cache\r\n"
+                "ETag: " + hashTag + "\r\n\r\n")
+            FAIL_LOG("Fastcgipp::ETagger 304 is wrong: " << output.c_str())
+        if(!tagger->notModified())
+            FAIL_LOG("Fastcgipp::ETagger didn't flag 304")
+    }
+
+    // Only GET and HEAD get a 304
+    {
+        std::unique_ptr<Fastcgipp::ETagger> tagger;
+        const std::string output = tag(
+                response,
+                {hashTag},
+                tagger,
+                Fastcgipp::Http::RequestMethod::POST);
+        if(output != "Content-Type: text/plain\r\nCache-Control: no-cache\r\n"
+                "ETag: " + hashTag + "\r\n\r\nHello World"
+                || tagger->notModified())
+            FAIL_LOG("Fastcgipp::ETagger sent a 304 to a POST: " \
+                    << output.c_str())
+
+        tag(response, {hashTag}, tagger, Fastcgipp::Http::RequestMethod::HEAD);
+        if(!tagger->notModified())
+            FAIL_LOG("Fastcgipp::ETagger didn't send a 304 to a HEAD")
+    }
+
+    // The application's own tag
+    {
+        std::unique_ptr<Fastcgipp::ETagger> tagger;
+        const std::string output = tag(
+                {"ETag: \"mine\"\nContent-Type: text/plain\n\nbody"},
+                {"\"mine\""},
+                tagger);
+        if(output != "Status: 304 Not Modified\r\nETag: \"mine\"\n\r\n")
+            FAIL_LOG("Fastcgipp::ETagger didn't use the existing tag: " \
+                    << output.c_str())
+    }
+
+    // Errors pass through
+    {
+        std::unique_ptr<Fastcgipp::ETagger> tagger;
+        const std::string error("Status: 404 Not Found\r\n\r\nGone");
+        if(tag({error}, {"*"}, tagger) != error || !tagger->tag().empty())
+            FAIL_LOG("Fastcgipp::ETagger didn't pass through an error")
+    }
+
+    // Through the stream buffer flush points are held back
+    {
+        unsigned sent = 0;
+        Fastcgipp::FcgiStreambuf<char> streambuf;
+        streambuf.configure(
+                Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [&sent] (const Fastcgipp::Socket&, Fastcgipp::Block&&)
+                {
+                    ++sent;
+                });
+        streambuf.etag([] (const std::string&) { return false; });
+
+        std::ostream stream(&streambuf);
+        stream << response[0] << response[1] << response[2] << std::flush;
+        if(sent != 0)
+            FAIL_LOG("Fastcgipp::FcgiStreambuf sent a tagged response early")
+
+        Fastcgipp::Block tail;
+        streambuf.collect(tail, true);
+        if(sent != 0 || streambuf.etagger()->tag() != hashTag)
+            FAIL_LOG("Fastcgipp::FcgiStreambuf didn't tag the response")
+        const std::string output(
+                tail.begin()+sizeof(Fastcgipp::Protocol::Header),
+                tail.end()-sizeof(Fastcgipp::Protocol::Header));
+        if(output.find("ETag: " + hashTag) == std::string::npos
+                || output.find("Hello World") == std::string::npos)
+            FAIL_LOG("Fastcgipp::FcgiStreambuf tagged output is wrong")
+    }
+
+    return 0;
+}
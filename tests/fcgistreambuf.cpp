@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
 unsigned called;
 
@@ -388,5 +389,146 @@ int main()
 
     if(called != 5)
         FAIL_LOG("Our checker() was not called as many times as it should have")
+
+    // Testing with a custom buffer size
+    {
+        std::vector<std::string> bodies;
+        Fastcgipp::FcgiStreambuf<char> streambuf;
+        streambuf.configure(
+                Fastcgipp::Protocol::RequestId(
+                    FCGIID,
+                    Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [&bodies] (const Fastcgipp::Socket&, Fastcgipp::Block&& record)
+                {
+                    if(record.size() % Fastcgipp::Protocol::chunkSize)
+                        FAIL_LOG("Our custom record is not sized properly");
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(
+                                record.begin());
+                    if(record.size() != sizeof(header)+header.contentLength
+                            +header.paddingLength)
+                        FAIL_LOG("Our custom record padding is wrong");
+                    bodies.emplace_back(
+                            record.begin()+sizeof(header),
+                            header.contentLength);
+                });
+
+        streambuf.bufferSize(100000);
+        if(streambuf.bufferSize() != 0xffff)
+            FAIL_LOG("FcgiStreambuf buffer size wasn't limited")
+
+        streambuf.bufferSize(20);
+        std::basic_ostream<char> out(&streambuf);
+        const std::string text(
+                "Trees have been in existence for 370 million years.");
+        out << text;
+        out.flush();
+
+        if(bodies.size() != 3
+                || bodies[0].size() != 20
+                || bodies[1].size() != 20
+                || bodies[0]+bodies[1]+bodies[2] != text)
+            FAIL_LOG("FcgiStreambuf with custom buffer size didn't record "\
+                    "properly")
+    }
+
+    // Testing escaped characters through the smallest buffer
+    {
+        std::string received;
+        Fastcgipp::FcgiStreambuf<char> streambuf;
+        streambuf.configure(
+                Fastcgipp::Protocol::RequestId(
+                    FCGIID,
+                    Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [&received] (
+                    const Fastcgipp::Socket&,
+                    Fastcgipp::Block&& record)
+                {
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(
+                                record.begin());
+                    received.append(
+                            record.begin()+sizeof(header),
+                            header.contentLength);
+                });
+
+        streambuf.bufferSize(1);
+        if(streambuf.bufferSize() != 8)
+            FAIL_LOG("FcgiStreambuf buffer size wasn't floored")
+
+        std::basic_ostream<char> out(&streambuf);
+        out << Fastcgipp::Encoding::HTML << "a\"'<&>" \
+            << Fastcgipp::Encoding::URL << "a b/";
+        out.flush();
+
+        if(received != "a&quot;&apos;&lt;&amp;&gt;a%20b%2F")
+            FAIL_LOG("FcgiStreambuf didn't escape through the smallest "\
+                    "buffer properly")
+    }
+
+    // Testing that a flushed buffer isn't reallocated to collect nothing
+    {
+        struct Streambuf: public Fastcgipp::FcgiStreambuf<char>
+        {
+            using Fastcgipp::FcgiStreambuf<char>::pbase;
+        } streambuf;
+        streambuf.configure(
+                Fastcgipp::Protocol::RequestId(
+                    FCGIID,
+                    Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [] (const Fastcgipp::Socket&, Fastcgipp::Block&&) {});
+
+        std::basic_ostream<char> out(&streambuf);
+        out << "Trees";
+        out.flush();
+        Fastcgipp::Block tail;
+        streambuf.collect(tail, true);
+
+        if(streambuf.pbase() != nullptr)
+            FAIL_LOG("FcgiStreambuf reallocated its buffer to collect nothing")
+        if(tail.size() != sizeof(Fastcgipp::Protocol::Header))
+            FAIL_LOG("FcgiStreambuf didn't collect just the terminator")
+    }
+
+    // Testing multibyte characters with the largest buffer
+    {
+        std::string received;
+        Fastcgipp::FcgiStreambuf<wchar_t> streambuf;
+        streambuf.configure(
+                Fastcgipp::Protocol::RequestId(
+                    FCGIID,
+                    Fastcgipp::Socket()),
+                Fastcgipp::Protocol::RecordType::OUT,
+                [&received] (
+                    const Fastcgipp::Socket&,
+                    Fastcgipp::Block&& record)
+                {
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(
+                                record.begin());
+                    if(record.size() != sizeof(header)+header.contentLength
+                            +header.paddingLength
+                            || record.size() % Fastcgipp::Protocol::chunkSize)
+                        FAIL_LOG("Our multibyte record is not sized properly");
+                    received.append(
+                            record.begin()+sizeof(header),
+                            header.contentLength);
+                });
+
+        streambuf.bufferSize(0xffff);
+        std::basic_ostream<wchar_t> out(&streambuf);
+        out << std::wstring(60000, L'é');
+        out.flush();
+
+        std::string expected;
+        for(unsigned i=0; i<60000; ++i)
+            expected += "é";
+        if(received != expected)
+            FAIL_LOG("FcgiStreambuf didn't split multibyte characters "\
+                    "properly")
+    }
     return 0;
 }
@@ -0,0 +1,179 @@
+#ifndef FASTCGIPP_TESTS_FIXTURE_HPP
+#define FASTCGIPP_TESTS_FIXTURE_HPP
+
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/message.hpp"
+#include "fastcgi++/protocol.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+//! Name and value pairs of a PARAMS stream
+typedef std::vector<std::pair<std::string, std::string>> Parameters;
+
+//! Build a record with a header and body
+inline std::string record(
+        Fastcgipp::Protocol::RecordType type,
+        const std::string& body,
+        Fastcgipp::Protocol::FcgiId id=1)
+{
+    std::string record(Fastcgipp::Protocol::getRecordSize(body.size()), 0);
+    Fastcgipp::Protocol::Header& header
+        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(&record[0]);
+    header.version = Fastcgipp::Protocol::version;
+    header.type = type;
+    header.fcgiId = id;
+    header.contentLength = body.size();
+    header.paddingLength = record.size()-body.size()-sizeof(header);
+    std::copy(body.cbegin(), body.cend(), record.begin()+sizeof(header));
+    return record;
+}
+
+//! Encode name and value pairs shorter than 128 bytes
+inline std::string parameters(const Parameters& pairs)
+{
+    std::string encoded;
+    for(const auto& pair: pairs)
+    {
+        encoded += char(pair.first.size());
+        encoded += char(pair.second.size());
+        encoded += pair.first + pair.second;
+    }
+    return encoded;
+}
+
+//! The BEGIN_REQUEST record of a responder request
+inline std::string begin(Fastcgipp::Protocol::FcgiId id=1, bool keep=false)
+{
+    std::string body(sizeof(Fastcgipp::Protocol::BeginRequest), 0);
+    Fastcgipp::Protocol::BeginRequest& begin
+        = *reinterpret_cast<Fastcgipp::Protocol::BeginRequest*>(&body[0]);
+    begin.role = Fastcgipp::Protocol::Role::RESPONDER;
+    if(keep)
+        begin.flags = Fastcgipp::Protocol::BeginRequest::keepConnBit;
+    return record(Fastcgipp::Protocol::RecordType::BEGIN_REQUEST, body, id);
+}
+
+//! Every record of a responder request with nothing posted
+inline std::string request(
+        const Parameters& pairs,
+        Fastcgipp::Protocol::FcgiId id=1,
+        bool keep=false)
+{
+    using Fastcgipp::Protocol::RecordType;
+    std::string records = begin(id, keep);
+    if(!pairs.empty())
+        records += record(RecordType::PARAMS, parameters(pairs), id);
+    return records
+        + record(RecordType::PARAMS, "", id)
+        + record(RecordType::IN, "", id);
+}
+
+//! An empty record as a message for a request
+inline Fastcgipp::Message message(
+        Fastcgipp::Protocol::RecordType type,
+        Fastcgipp::Protocol::FcgiId id=1)
+{
+    Fastcgipp::Message message;
+    message.data.size(sizeof(Fastcgipp::Protocol::Header));
+    Fastcgipp::Protocol::Header& header
+        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(
+                message.data.begin());
+    header.version = Fastcgipp::Protocol::version;
+    header.type = type;
+    header.fcgiId = id;
+    header.contentLength = 0;
+    header.paddingLength = 0;
+    return message;
+}
+
+//! Connect to the manager
+inline int connect(unsigned short port)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    timeval timeout = {10, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)))
+        FAIL_LOG("Couldn't connect")
+    return fd;
+}
+
+//! Connect to the manager and send it some records
+inline int send(unsigned short port, const std::string& records)
+{
+    const int fd = connect(port);
+    if(write(fd, records.data(), records.size()) != ssize_t(records.size()))
+        FAIL_LOG("Unable to write request")
+    return fd;
+}
+
+//! Read everything until the other side closes the connection
+inline std::string drain(int fd)
+{
+    std::string received;
+    while(true)
+    {
+        char chunk[4096];
+        const ssize_t size = read(fd, chunk, sizeof(chunk));
+        if(size <= 0)
+            break;
+        received.append(chunk, size);
+    }
+    close(fd);
+    return received;
+}
+
+//! The body of the response in some received records
+/*!
+ * @return The body or an empty string if the request never ended
+ */
+inline std::string body(const std::string& received)
+{
+    std::string out;
+    size_t position = 0;
+    while(received.size()-position >= sizeof(Fastcgipp::Protocol::Header))
+    {
+        const Fastcgipp::Protocol::Header& header
+            = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                    received.data()+position);
+        const size_t length = sizeof(header)
+            + header.contentLength
+            + header.paddingLength;
+        if(received.size()-position < length)
+            break;
+        if(header.type == Fastcgipp::Protocol::RecordType::OUT)
+            out.append(received, position+sizeof(header), header.contentLength);
+        else if(header.type == Fastcgipp::Protocol::RecordType::END_REQUEST)
+        {
+            const auto body = out.find("\r\n\r\n");
+            return body==std::string::npos?"":out.substr(body+4);
+        }
+        position += length;
+    }
+    return std::string();
+}
+
+//! Do a GET request on a fresh connection
+/*!
+ * @return The body of the response or an empty string if the connection was
+ *         lost
+ */
+inline std::string get(unsigned short port, const std::string& uri)
+{
+    const Parameters pairs = {{"REQUEST_METHOD", "GET"}, {"REQUEST_URI", uri}};
+    return body(drain(send(port, request(pairs))));
+}
+
+#endif
@@ -0,0 +1,304 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/flight.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Build a record with a header and body
+Fastcgipp::Block record(
+        Fastcgipp::Protocol::RecordType type,
+        Fastcgipp::Protocol::FcgiId id,
+        const std::string& body)
+{
+    Fastcgipp::Block block(Fastcgipp::Protocol::getRecordSize(body.size()));
+    Fastcgipp::Protocol::Header& header
+        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(block.begin());
+    header.version = Fastcgipp::Protocol::version;
+    header.type = type;
+    header.fcgiId = id;
+    header.contentLength = body.size();
+    header.paddingLength = block.size()-body.size()-sizeof(header);
+    std::copy(body.cbegin(), body.cend(), block.begin()+sizeof(header));
+    return block;
+}
+
+//! Encode name value pairs
+std::string params(const std::vector<std::pair<std::string, std::string>>& x)
+{
+    std::string body;
+    for(const auto& pair: x)
+    {
+        body += char(pair.first.size());
+        body += char(pair.second.size());
+        body += pair.first;
+        body += pair.second;
+    }
+    return body;
+}
+
+//! What a request ID has received
+struct Received
+{
+    std::string out;
+    bool ended;
+    bool kill;
+    int appStatus;
+
+    Received():
+        ended(false),
+        kill(false),
+        appStatus(-1)
+    {}
+};
+
+//! Split records up by request ID
+void parse(
+        const char* data,
+        const char* const end,
+        bool kill,
+        std::map<Fastcgipp::Protocol::FcgiId, Received>& received)
+{
+    while(data < end)
+    {
+        const Fastcgipp::Protocol::Header& header
+            = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(data);
+        const char* const body = data+sizeof(header);
+        Received& x = received[header.fcgiId];
+        if(header.type == Fastcgipp::Protocol::RecordType::OUT)
+            x.out.append(body, header.contentLength);
+        else if(header.type == Fastcgipp::Protocol::RecordType::END_REQUEST)
+        {
+            x.ended = true;
+            x.kill = kill;
+            x.appStatus = reinterpret_cast<
+                const Fastcgipp::Protocol::EndRequest*>(body)->appStatus;
+        }
+        data = body+header.contentLength+header.paddingLength;
+    }
+}
+
+std::atomic_uint requests(0);
+std::atomic_bool release(false);
+
+class Slow: public Fastcgipp::Request<char>
+{
+public:
+    Slow()
+    {
+        ++requests;
+    }
+
+private:
+    bool response()
+    {
+        out << "Content-Type: text/plain\r\n\r\nfirst" << std::flush;
+        while(!release)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        out << " second";
+        return true;
+    }
+};
+
+int main()
+{
+    using Fastcgipp::Protocol::RecordType;
+
+    // Relaying to followers
+    {
+        std::map<Fastcgipp::Protocol::FcgiId, Received> received;
+        bool landed = false;
+        Fastcgipp::Flight flight(
+                [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool kill)
+                {
+                    parse(data.begin(), data.end(), kill, received);
+                },
+                [&] ()
+                {
+                    landed = true;
+                });
+
+        const Fastcgipp::Socket socket;
+        if(!flight.join(Fastcgipp::Protocol::RequestId(2, socket), false))
+            FAIL_LOG("Fastcgipp::Flight refused a follower")
+        flight.relay(record(RecordType::OUT, 1, "abc"), false);
+        if(received[2].out != "abc" || received.count(1))
+            FAIL_LOG("Fastcgipp::Flight didn't relay with the follower's id")
+
+        // A late follower gets everything sent so far
+        flight.join(Fastcgipp::Protocol::RequestId(3, socket), true);
+        if(received[3].out != "abc")
+            FAIL_LOG("Fastcgipp::Flight didn't replay history")
+
+        Fastcgipp::Block last(record(RecordType::OUT, 1, "def"));
+        {
+            const Fastcgipp::Block end(record(RecordType::END_REQUEST, 1,
+                        std::string(sizeof(Fastcgipp::Protocol::EndRequest), 0)));
+            const size_t size = last.size();
+            last.size(size+end.size());
+            std::copy(end.begin(), end.end(), last.begin()+size);
+        }
+        flight.relay(last, true);
+
+        if(received[2].out != "abcdef" || received[3].out != "abcdef")
+            FAIL_LOG("Fastcgipp::Flight followers got the wrong data")
+        if(!received[2].ended || received[2].kill
+                || !received[3].ended || !received[3].kill)
+            FAIL_LOG("Fastcgipp::Flight didn't end the followers properly")
+        if(!landed || !flight.landed())
+            FAIL_LOG("Fastcgipp::Flight didn't land")
+        if(flight.join(Fastcgipp::Protocol::RequestId(4, socket), false))
+            FAIL_LOG("Fastcgipp::Flight accepted a follower after landing")
+    }
+
+    // Aborting
+    {
+        std::map<Fastcgipp::Protocol::FcgiId, Received> received;
+        Fastcgipp::Flight flight(
+                [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool kill)
+                {
+                    parse(data.begin(), data.end(), kill, received);
+                },
+                std::function<void()>());
+        flight.join(Fastcgipp::Protocol::RequestId(5, Fastcgipp::Socket()), false);
+        flight.abort();
+        if(!received[5].ended || received[5].appStatus != 1)
+            FAIL_LOG("Fastcgipp::Flight::abort() didn't end the followers")
+    }
+
+    // An aborted follower is no longer relayed to
+    {
+        std::map<Fastcgipp::Protocol::FcgiId, Received> received;
+        Fastcgipp::Flight flight(
+                [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool kill)
+                {
+                    parse(data.begin(), data.end(), kill, received);
+                },
+                std::function<void()>());
+        const Fastcgipp::Socket socket;
+        flight.join(Fastcgipp::Protocol::RequestId(6, socket), false);
+        flight.join(Fastcgipp::Protocol::RequestId(7, socket), false);
+        flight.relay(record(RecordType::OUT, 1, "abc"), false);
+        flight.leave(Fastcgipp::Protocol::RequestId(6, socket));
+        if(!received[6].ended || received[6].appStatus != 1)
+            FAIL_LOG("Fastcgipp::Flight::leave() didn't end the follower")
+
+        flight.relay(record(RecordType::OUT, 1, "def"), false);
+        flight.abort();
+        if(received[6].out != "abc" || received[7].out != "abcdef")
+            FAIL_LOG("Fastcgipp::Flight relayed to a follower that left")
+    }
+
+    // Identical requests are coalesced by the manager
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const std::string port = std::to_string(portDist(trueRand));
+
+        Fastcgipp::Manager<Slow> manager(2);
+        manager.coalesce(true);
+        if(!manager.listen("127.0.0.1", port.c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        Fastcgipp::SocketGroup group;
+        const auto socket = group.connect("127.0.0.1", port.c_str());
+        if(!socket.valid())
+            FAIL_LOG("Couldn't connect")
+
+        const auto request = [&] (Fastcgipp::Protocol::FcgiId id)
+        {
+            std::string begin(sizeof(Fastcgipp::Protocol::BeginRequest), 0);
+            Fastcgipp::Protocol::BeginRequest& body
+                = *reinterpret_cast<Fastcgipp::Protocol::BeginRequest*>(
+                        &begin[0]);
+            body.role = Fastcgipp::Protocol::Role::RESPONDER;
+            body.flags = Fastcgipp::Protocol::BeginRequest::keepConnBit;
+
+            const Fastcgipp::Block records[] =
+            {
+                record(RecordType::BEGIN_REQUEST, id, begin),
+                record(RecordType::PARAMS, id, params({
+                            {"REQUEST_METHOD", "GET"},
+                            {"REQUEST_URI", "/slow"}})),
+                record(RecordType::PARAMS, id, ""),
+                record(RecordType::IN, id, "")
+            };
+            for(const auto& x: records)
+                if(socket.write(x.begin(), x.size()) != ssize_t(x.size()))
+                    FAIL_LOG("Unable to write request")
+        };
+
+        std::map<Fastcgipp::Protocol::FcgiId, Received> received;
+        std::string buffer;
+        const auto wait = [&] (const std::function<bool()>& done)
+        {
+            while(!done())
+            {
+                char chunk[4096];
+                const auto ready = group.poll(true);
+                if(!ready.valid())
+                    continue;
+                const ssize_t size = ready.read(chunk, sizeof(chunk));
+                if(size < 0)
+                    FAIL_LOG("Connection lost")
+                buffer.append(chunk, size);
+
+                // Only parse complete records
+                size_t position = 0;
+                while(buffer.size()-position
+                        >= sizeof(Fastcgipp::Protocol::Header))
+                {
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                                buffer.data()+position);
+                    const size_t length = sizeof(header)
+                        + header.contentLength
+                        + header.paddingLength;
+                    if(buffer.size()-position < length)
+                        break;
+                    position += length;
+                }
+                parse(buffer.data(), buffer.data()+position, false, received);
+                buffer.erase(0, position);
+            }
+        };
+
+        const std::string partial("Content-Type: text/plain\r\n\r\nfirst");
+        const std::string expected(partial + " second");
+
+        request(1);
+        wait([&] () { return received[1].out == partial; });
+        request(2);
+        wait([&] () { return received[2].out == partial; });
+
+        if(requests != 1)
+            FAIL_LOG("A request was built for a coalesced request")
+        if(manager.coalesced() != 1)
+            FAIL_LOG("Manager coalesced count is wrong")
+
+        release = true;
+        wait([&] () { return received[1].ended && received[2].ended; });
+        if(received[1].out != expected || received[2].out != expected)
+            FAIL_LOG("Coalesced responses are wrong")
+
+        // Once landed, a new request is built again
+        received.clear();
+        request(3);
+        wait([&] () { return received[3].ended; });
+        if(received[3].out != expected || requests != 2)
+            FAIL_LOG("Request after landing wasn't built")
+
+        socket.close();
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
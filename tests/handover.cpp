@@ -0,0 +1,134 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fixture.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//! Responds with the pid of the process
+class Pid: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        out << "Content-Type: text/plain\r\n\r\n" << getpid();
+        return true;
+    }
+};
+
+//! Run a manager in a child process
+/*!
+ * @param[in] control Control socket to take over from and then accept hot
+ *                    restarts on
+ * @param[in] port Port to listen on if there is nothing to take over
+ */
+pid_t spawn(const char* control, unsigned short port)
+{
+    const pid_t child = fork();
+    if(child == 0)
+    {
+        Fastcgipp::Manager<Pid> manager(1);
+        if(!manager.takeover(control)
+                && !manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            _exit(EXIT_FAILURE);
+        if(!manager.control(control))
+            _exit(EXIT_FAILURE);
+        manager.start();
+        manager.join();
+        _exit(EXIT_SUCCESS);
+    }
+    return child;
+}
+
+//! Wait for a file to exist
+void await(const char* name)
+{
+    struct stat info;
+    for(unsigned i=0; stat(name, &info) != 0; ++i)
+    {
+        if(i == 1000)
+            FAIL_LOG("Timed out waiting for " << name)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+int main()
+{
+    std::random_device trueRand;
+    std::uniform_int_distribution<> portDist(2048, 65534);
+    const unsigned short port = portDist(trueRand);
+    const std::string control(
+            "/tmp/fastcgipp-handover-" + std::to_string(getpid()));
+
+    // Start the old process
+    const pid_t old = spawn(control.c_str(), port);
+    await(control.c_str());
+    if(get(port, "/") != std::to_string(old))
+        FAIL_LOG("Old process didn't respond")
+
+    // An abandoned takeover leaves the old process and its control socket
+    {
+        Fastcgipp::SocketGroup group;
+        if(group.takeover(control.c_str()) != 1)
+            FAIL_LOG("Fastcgipp::SocketGroup didn't take over the listener")
+        if(!group.control(control.c_str(), [] () {}))
+            FAIL_LOG("Fastcgipp::SocketGroup didn't bind a control socket")
+    }
+    for(unsigned i=0; i<3; ++i)
+        if(get(port, "/") != std::to_string(old))
+            FAIL_LOG("Old process stopped after an abandoned takeover")
+
+    // Hot restart
+    const pid_t current = spawn(control.c_str(), port);
+    int status;
+    if(waitpid(old, &status, 0) != old
+            || !WIFEXITED(status)
+            || WEXITSTATUS(status) != EXIT_SUCCESS)
+        FAIL_LOG("Old process didn't stop after being taken over")
+    for(unsigned i=0; i<3; ++i)
+        if(get(port, "/") != std::to_string(current))
+            FAIL_LOG("New process didn't take over")
+
+    kill(current, SIGKILL);
+    waitpid(current, &status, 0);
+    std::remove(control.c_str());
+
+    // systemd socket activation
+    const pid_t child = fork();
+    if(child == 0)
+    {
+        const int listener = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if(listener == -1
+                || bind(listener, reinterpret_cast<sockaddr*>(&address),
+                    sizeof(address))
+                || listen(listener, 1)
+                || dup2(listener, 3) != 3)
+            _exit(2);
+        setenv("LISTEN_PID", std::to_string(getpid()).c_str(), 1);
+        setenv("LISTEN_FDS", "1", 1);
+
+        Fastcgipp::SocketGroup group;
+        if(group.inherit() != 1
+                || group.listeners().count(3) != 1
+                || std::getenv("LISTEN_FDS") != nullptr)
+            _exit(EXIT_FAILURE);
+        _exit(EXIT_SUCCESS);
+    }
+    if(waitpid(child, &status, 0) != child
+            || !WIFEXITED(status)
+            || WEXITSTATUS(status) != EXIT_SUCCESS)
+        FAIL_LOG("Fastcgipp::SocketGroup didn't inherit the systemd listener")
+
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/request.hpp"
+#include "fixture.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+
+//! Everything the requests have sent
+std::string sent;
+
+//! Waits for a callback and writes something once it comes
+template<class charT>
+class Polling: public Fastcgipp::Request<charT>
+{
+    bool response()
+    {
+        if(this->m_message.type == 0)
+            return false;
+        this->out << "Content-Type: text/plain\r\n\r\nwoken";
+        return true;
+    }
+};
+
+//! Start a request and leave it waiting on a callback
+template<class charT>
+std::unique_ptr<Polling<charT>> idle(bool hibernate)
+{
+    std::unique_ptr<Polling<charT>> request(new Polling<charT>);
+    request->configure(
+            Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+            Fastcgipp::Protocol::Role::RESPONDER,
+            true,
+            [] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool)
+            {
+                sent.append(data.begin(), data.end());
+            },
+            [] (Fastcgipp::Message) {},
+            [] (const Fastcgipp::Socket&, bool) {});
+    request->hibernate(hibernate);
+    request->push(message(Fastcgipp::Protocol::RecordType::PARAMS));
+    request->push(message(Fastcgipp::Protocol::RecordType::IN));
+    request->handler();
+    return request;
+}
+
+//! Heap bytes held by each of a bunch of idle requests
+template<class charT>
+size_t footprint(bool hibernate)
+{
+    const unsigned count = 1000;
+    std::vector<std::unique_ptr<Polling<charT>>> requests;
+    requests.reserve(count);
+    const size_t before = mallinfo2().uordblks;
+    for(unsigned i=0; i<count; ++i)
+        requests.push_back(idle<charT>(hibernate));
+    const size_t after = mallinfo2().uordblks;
+    return (after-before)/count;
+}
+
+int main()
+{
+    // Idle requests let go of their buffers
+    {
+        const size_t charAwake = footprint<char>(false);
+        const size_t charAsleep = footprint<char>(true);
+        const size_t wcharAwake = footprint<wchar_t>(false);
+        const size_t wcharAsleep = footprint<wchar_t>(true);
+        INFO_LOG("Idle char request: " << charAwake << " bytes awake and " \
+                << charAsleep << " bytes hibernating")
+        INFO_LOG("Idle wchar_t request: " << wcharAwake \
+                << " bytes awake and " << wcharAsleep << " bytes hibernating")
+        if(charAsleep*2 > charAwake || wcharAsleep*2 > wcharAwake)
+            FAIL_LOG("Hibernating requests didn't release their buffers")
+    }
+
+    // And get them back when they wake up
+    for(bool hibernate: {false, true})
+    {
+        sent.clear();
+        auto narrow = idle<char>(hibernate);
+        narrow->push(Fastcgipp::Message(1));
+        narrow->handler();
+        if(sent.find("\r\n\r\nwoken") == std::string::npos)
+            FAIL_LOG("Woken char request didn't write its response")
+
+        sent.clear();
+        auto wide = idle<wchar_t>(hibernate);
+        wide->push(Fastcgipp::Message(1));
+        wide->handler();
+        if(sent.find("\r\n\r\nwoken") == std::string::npos)
+            FAIL_LOG("Woken wchar_t request didn't write its response")
+    }
+
+    return 0;
+}
@@ -3,12 +3,15 @@
 
 #include <list>
 #include <array>
+#include <atomic>
+#include <vector>
 #include <sstream>
 #include <algorithm>
 #include <string>
 #include <map>
 #include <thread>
 #include <chrono>
+#include <limits>
 #include <random>
 #include <cstring>
 
@@ -628,6 +631,128 @@ int main()
             }
         }
 
+        // Doing test with multipart POST in small chunks spooled out of memory
+        {
+            Fastcgipp::Http::Environment<wchar_t> environment;
+            environment.spoolThreshold(1024);
+            {
+                const unsigned char parms[] = 
+#include "multipartParam.hpp"
+                environment.fill(
+                        reinterpret_cast<const char*>(parms),
+                        reinterpret_cast<const char*>(parms+sizeof(parms)-1));
+            }
+
+            {
+                static const unsigned char data[] = 
+#include "multipartPost.hpp"
+                static const char* const dataEnd =
+                    reinterpret_cast<const char*>(data+sizeof(data));
+                const char* chunk = reinterpret_cast<const char*>(data);
+                while(chunk != dataEnd)
+                {
+                    const char* const chunkEnd =
+                        std::min(chunk+7, dataEnd);
+                    environment.fillPostBuffer(chunk, chunkEnd);
+                    chunk = chunkEnd;
+                }
+                environment.parsePostBuffer();
+            }
+
+            if(properPosts != environment.posts)
+                FAIL_LOG("Fastcgipp::Http::Environment chunked multipart "\
+                        "posts didn't decode properly")
+
+            static const unsigned char gnu_png[] = 
+#include "gnu.png.hpp"
+            if(environment.files.size() != 1)
+                FAIL_LOG("Fastcgipp::Http::Environment chunked multipart "\
+                        "files didn't decode properly")
+            const auto& file = environment.files.begin()->second;
+            if(
+                    file.filename != L"gnu.png" ||
+                    file.contentType != L"image/png" ||
+                    file.size != 58587 ||
+                    file.fd == -1 ||
+                    file.data ||
+                    file.map() == nullptr ||
+                    !std::equal(
+                        reinterpret_cast<const char*>(gnu_png),
+                        reinterpret_cast<const char*>(gnu_png)
+                            +sizeof(gnu_png),
+                        file.map(),
+                        file.map()+file.size))
+                FAIL_LOG("Fastcgipp::Http::Environment chunked multipart "\
+                        "files didn't spool properly")
+        }
+
+        // Doing test with a multipart parameter that merely ends in name=
+        {
+            Fastcgipp::Http::Environment<wchar_t> environment;
+            {
+                const unsigned char parms[] = 
+#include "multipartParam.hpp"
+                environment.fill(
+                        reinterpret_cast<const char*>(parms),
+                        reinterpret_cast<const char*>(parms+sizeof(parms)-1));
+            }
+
+            const std::string delimiter(
+                    "-----------------------------"
+                    "85519944211986842431581027365");
+            const std::string data = delimiter + "\r\n"
+                "Content-Disposition: form-data; xname=\"decoy\"; "
+                "name=\"real\"\r\n\r\nvalue\r\n" + delimiter + "--\r\n";
+            environment.fillPostBuffer(data.data(), data.data()+data.size());
+            environment.parsePostBuffer();
+
+            if(environment.posts.size() != 1
+                    || environment.posts.begin()->first != L"real"
+                    || environment.posts.begin()->second != L"value")
+                FAIL_LOG("Fastcgipp::Http::Environment multipart name "\
+                        "wasn't anchored to a parameter boundary")
+        }
+
+        // Benchmark multipart throughput
+        {
+            static const unsigned char parms[] = 
+#include "multipartParam.hpp"
+            static const unsigned char data[] = 
+#include "multipartPost.hpp"
+            static const char* const dataEnd =
+                reinterpret_cast<const char*>(data+sizeof(data));
+            const unsigned iterations = 200;
+            const size_t chunkSize = 0xffff;
+
+            const auto start = std::chrono::steady_clock::now();
+            for(unsigned i=0; i<iterations; ++i)
+            {
+                Fastcgipp::Http::Environment<wchar_t> environment;
+                environment.spoolThreshold(std::numeric_limits<size_t>::max());
+                environment.fill(
+                        reinterpret_cast<const char*>(parms),
+                        reinterpret_cast<const char*>(parms+sizeof(parms)-1));
+                const char* chunk = reinterpret_cast<const char*>(data);
+                while(chunk != dataEnd)
+                {
+                    const char* const chunkEnd =
+                        std::min(chunk+chunkSize, dataEnd);
+                    environment.fillPostBuffer(chunk, chunkEnd);
+                    chunk = chunkEnd;
+                }
+                environment.parsePostBuffer();
+                if(environment.files.size() != 1)
+                    FAIL_LOG("Fastcgipp::Http::Environment multipart "\
+                            "benchmark didn't decode properly")
+            }
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now()-start;
+
+            INFO_LOG("Multipart parsing throughput: " \
+                    << sizeof(data)*iterations/elapsed.count()/1048576 \
+                    << " MiB/s")
+        }
+
         // Doing test with urlencoded POST
         {
             Fastcgipp::Http::Environment<wchar_t> environment;
@@ -735,6 +860,25 @@ int main()
             FAIL_LOG("Fastcgipp::Http::SessionId")
     }
 
+    // Testing wider session IDs
+    {
+        typedef Fastcgipp::Http::BasicSessionId<30> Id;
+        const Id session1;
+        std::wostringstream ss;
+        ss << session1;
+        if(ss.str().size() != Id::stringLength || Id::stringLength != 40)
+            FAIL_LOG("Fastcgipp::Http::BasicSessionId string is wrong size")
+        const Id session2(ss.str());
+        if(!(session2 == session1) || Id() == session1)
+            FAIL_LOG("Fastcgipp::Http::BasicSessionId")
+
+        Fastcgipp::Http::Sessions<int, 30> sessions(60);
+        const Id id = sessions.generate(std::make_shared<int>(7));
+        const auto data = sessions.get(id);
+        if(!data || *data != 7)
+            FAIL_LOG("Fastcgipp::Http::Sessions with wide IDs")
+    }
+
     // Testing Fastcgipp::Http::Sessions
     {
         char properExpiration[30];
@@ -840,5 +984,56 @@ int main()
             FAIL_LOG("Fastcgipp::Http::Sessions::erase() didn't work");
     }
 
+    // Benchmark Fastcgipp::Http::Sessions under contention
+    {
+        const unsigned threadCount = std::max(
+                16U,
+                std::thread::hardware_concurrency());
+        const unsigned sessionCount = 20000;
+        const unsigned operations = 20000;
+
+        for(const size_t shards: {size_t(1), size_t(64)})
+        {
+            Fastcgipp::Http::Sessions<int> sessions(3600, shards);
+            std::vector<Fastcgipp::Http::SessionId> ids;
+            ids.reserve(sessionCount);
+            for(unsigned i=0; i<sessionCount; ++i)
+                ids.push_back(sessions.generate(std::make_shared<int>(i)));
+
+            std::atomic_uint missing(0);
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for(unsigned i=0; i<threadCount; ++i)
+                threads.emplace_back([&, i] ()
+                {
+                    std::minstd_rand random(i);
+                    for(unsigned j=0; j<operations; ++j)
+                    {
+                        // One in sixty four operations starts a new session
+                        if(j%64 == 0)
+                            sessions.generate(std::make_shared<int>(j));
+                        else if(!sessions.get(ids[random()%sessionCount]))
+                            ++missing;
+                    }
+                });
+            for(auto& thread: threads)
+                thread.join();
+            const std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now()-start;
+
+            if(missing != 0)
+                FAIL_LOG("Fastcgipp::Http::Sessions lost sessions under "\
+                        "contention")
+            if(sessions.size() != sessionCount+threadCount*((operations+63)/64))
+                FAIL_LOG("Fastcgipp::Http::Sessions size is wrong after "\
+                        "contention")
+
+            INFO_LOG("Sessions throughput with " << threadCount \
+                    << " threads and " << shards << " shard(s): " \
+                    << threadCount*operations/elapsed.count()/1e6 \
+                    << " Mops/s")
+        }
+    }
+
     return 0;
 }
@@ -0,0 +1,176 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/offload.hpp"
+#include "fixture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+//! Defers blocking work and reports how it went
+class Deferring: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        const std::string& script = environment().scriptName;
+        switch(m_message.type)
+        {
+            case 0:
+            {
+                if(script == "/plain")
+                    break;
+                const auto sleep = std::chrono::milliseconds(
+                        script == "/slow"?2000:600);
+                if(!defer(
+                            [sleep] ()
+                            {
+                                std::this_thread::sleep_for(sleep);
+                                return Fastcgipp::Message(1);
+                            },
+                            Fastcgipp::Message(Fastcgipp::Offload::expired),
+                            std::chrono::milliseconds(
+                                script == "/slow"?200:0)))
+                {
+                    out << "Content-Type: text/plain\r\n\r\nrejected";
+                    return true;
+                }
+                return false;
+            }
+            case 1:
+            {
+                out << "Content-Type: text/plain\r\n\r\ndone";
+                return true;
+            }
+            case Fastcgipp::Offload::expired:
+            {
+                out << "Content-Type: text/plain\r\n\r\nexpired";
+                return true;
+            }
+        }
+        out << "Content-Type: text/plain\r\n\r\nplain";
+        return true;
+    }
+};
+
+int main()
+{
+    using std::chrono::milliseconds;
+
+    // Queue limits and cancellation
+    {
+        Fastcgipp::Timers timers(
+                [] (Fastcgipp::Protocol::RequestId, Fastcgipp::Message&&) {});
+        Fastcgipp::Offload offload(timers);
+        std::atomic_uint delivered(0);
+        const auto deliver = [&delivered] (Fastcgipp::Message message)
+        {
+            if(message.type == 1)
+                ++delivered;
+        };
+        const auto work = [] () { return Fastcgipp::Message(1); };
+
+        if(offload.run(work, deliver, Fastcgipp::Timers::Id(), nullptr))
+            FAIL_LOG("Fastcgipp::Offload accepted work while disabled")
+
+        offload.configure(1, 1, Fastcgipp::Offload::Clock::duration::zero());
+        offload.start();
+
+        // Hold the only thread
+        std::atomic_bool started(false);
+        std::atomic_bool release(false);
+        if(!offload.run(
+                    [&] ()
+                    {
+                        started = true;
+                        while(!release)
+                            std::this_thread::sleep_for(milliseconds(1));
+                        return Fastcgipp::Message(1);
+                    },
+                    deliver,
+                    Fastcgipp::Timers::Id(),
+                    nullptr))
+            FAIL_LOG("Fastcgipp::Offload rejected work")
+        while(!started)
+            std::this_thread::sleep_for(milliseconds(1));
+
+        const auto token = std::make_shared<Fastcgipp::Cancellation>();
+        if(!offload.run(work, deliver, Fastcgipp::Timers::Id(), token))
+            FAIL_LOG("Fastcgipp::Offload rejected queued work")
+        if(offload.run(work, deliver, Fastcgipp::Timers::Id(), nullptr))
+            FAIL_LOG("Fastcgipp::Offload went past its queue limit")
+        token->cancel();
+        release = true;
+
+        for(int i=0; i<5000 && offload.metrics().cancelled == 0; ++i)
+            std::this_thread::sleep_for(milliseconds(1));
+        offload.terminate();
+        offload.join();
+
+        const auto metrics = offload.metrics();
+        if(delivered != 1
+                || metrics.completed != 1
+                || metrics.rejected != 2
+                || metrics.cancelled != 1
+                || metrics.queued != 0
+                || metrics.ran < milliseconds(0))
+            FAIL_LOG("Fastcgipp::Offload metrics are wrong")
+    }
+
+    // Blocking work doesn't pin the manager and times out
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Deferring> manager(1);
+        manager.offload(2, 1);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const auto script = [port] (const char* name)
+        {
+            return send(port, request({{"SCRIPT_NAME", name}}));
+        };
+
+        const auto begun = std::chrono::steady_clock::now();
+        const int slow = script("/slow");
+        const int fast = script("/fast");
+        std::this_thread::sleep_for(milliseconds(100));
+        const int queued = script("/fast");
+        std::this_thread::sleep_for(milliseconds(100));
+
+        // Both offload threads are busy and one is queued
+        if(drain(script("/fast")).find("\r\n\r\nrejected")
+                == std::string::npos)
+            FAIL_LOG("Manager didn't reject work past the offload queue")
+
+        // The manager's only thread is free
+        if(drain(script("/plain")).find("\r\n\r\nplain")
+                == std::string::npos
+                || std::chrono::steady_clock::now()-begun > milliseconds(500))
+            FAIL_LOG("Blocking work pinned the manager's thread")
+
+        if(drain(slow).find("\r\n\r\nexpired") == std::string::npos
+                || std::chrono::steady_clock::now()-begun > milliseconds(1000))
+            FAIL_LOG("Deferred work didn't time out")
+        if(drain(fast).find("\r\n\r\ndone") == std::string::npos
+                || drain(queued).find("\r\n\r\ndone") == std::string::npos)
+            FAIL_LOG("Deferred work wasn't delivered")
+
+        manager.terminate();
+        manager.join();
+
+        const auto metrics = manager.offload().metrics();
+        if(metrics.completed != 2
+                || metrics.rejected != 1
+                || metrics.timedOut != 1
+                || metrics.longest < milliseconds(50))
+            FAIL_LOG("Manager offload metrics are wrong")
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/pools.hpp"
+#include "fixture.hpp"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+
+//! Threads each script name was handled in
+std::map<std::string, std::set<std::thread::id>> threads;
+std::mutex threadsMutex;
+
+//! Slow for the slow script and quick for everything else
+class Classified: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        {
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            threads[environment().scriptName].insert(
+                    std::this_thread::get_id());
+        }
+        if(environment().scriptName == "/slow")
+            std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        out << "Content-Type: text/plain\r\n\r\n" \
+            << environment().scriptName;
+        return true;
+    }
+};
+
+int main()
+{
+    // Configuration and classification
+    {
+        Fastcgipp::Pools pools;
+        const unsigned reports = pools.add("reports", 2, 0);
+        const unsigned api = pools.add("api", 0, 10);
+        pools.classify("/reports", "reports");
+        pools.classify("/api", "api");
+        pools.classify("/api/reports", "reports");
+
+        if(pools.size() != 3
+                || pools.find("api") != api
+                || pools.find("") != 0
+                || pools.find("nothing") != 0
+                || pools.add("api", 0, 20) != api
+                || pools.priority(api) != 20)
+            FAIL_LOG("Fastcgipp::Pools configuration is wrong")
+
+        if(pools.match(std::string("/api/users")) != "api"
+                || pools.match(std::string("/api/reports/1")) != "reports"
+                || pools.match(std::wstring(L"/reports")) != "reports"
+                || pools.match(std::string("/index")) != ""
+                || pools.match(std::string("/ap")) != "")
+            FAIL_LOG("Fastcgipp::Pools classified a path wrong")
+
+        pools.queued(reports);
+        pools.queued(reports);
+        if(pools.admit(reports) || !pools.admit(api))
+            FAIL_LOG("Fastcgipp::Pools didn't enforce a queue limit")
+        pools.dequeued(reports, std::chrono::milliseconds(3));
+        pools.dequeued(reports, std::chrono::milliseconds(1));
+        if(!pools.admit(reports))
+            FAIL_LOG("Fastcgipp::Pools didn't free up its queue")
+
+        const auto metrics = pools.metrics("reports");
+        if(metrics.tasks != 2
+                || metrics.waited != std::chrono::milliseconds(4)
+                || metrics.longest != std::chrono::milliseconds(3)
+                || metrics.queued != 0
+                || metrics.rejected != 1)
+            FAIL_LOG("Fastcgipp::Pools metrics are wrong")
+    }
+
+    // Slow requests can't starve the others
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Classified> manager(1);
+        manager.pool("slow", 1, 1);
+        manager.pool("api", 1, 0, 10);
+        manager.classify("/slow", "slow");
+        manager.classify("/api", "api");
+        manager.steal(true);
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const auto script = [port] (const std::string& name)
+        {
+            return send(port, request({{"SCRIPT_NAME", name}}));
+        };
+
+        // One runs and one waits in the queue
+        const int running = script("/slow");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        const int waiting = script("/slow");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        // So the queue is full
+        std::string received = drain(script("/slow"));
+        if(received.find("Status: 503 Service Unavailable") == std::string::npos)
+            FAIL_LOG("Full pool didn't reject a request")
+
+        // Others are still handled straight away
+        for(const char* name: {"/api", "/index"})
+        {
+            const auto start = std::chrono::steady_clock::now();
+            received = drain(script(name));
+            if(received.find(std::string("\r\n\r\n")+name)
+                    == std::string::npos
+                    || std::chrono::steady_clock::now()-start
+                        > std::chrono::milliseconds(500))
+                FAIL_LOG("Request was starved by the slow pool: " << name)
+        }
+
+        if(drain(running).find("\r\n\r\n/slow") == std::string::npos
+                || drain(waiting).find("\r\n\r\n/slow") == std::string::npos)
+            FAIL_LOG("Slow requests weren't answered")
+
+        {
+            std::lock_guard<std::mutex> lock(threadsMutex);
+            if(threads["/slow"].size() != 1
+                    || threads["/api"].size() != 1
+                    || threads["/slow"] == threads["/api"]
+                    || threads["/index"] == threads["/slow"])
+                FAIL_LOG("Requests weren't handled in their pools")
+        }
+
+        const auto slow = manager.pools().metrics("slow");
+        if(slow.tasks < 2 || slow.rejected != 1
+                || slow.longest < std::chrono::milliseconds(500))
+            FAIL_LOG("Slow pool metrics are wrong")
+        if(manager.pools().metrics("api").tasks < 1)
+            FAIL_LOG("Api pool metrics are wrong")
+
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
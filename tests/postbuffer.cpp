@@ -0,0 +1,71 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/postbuffer.hpp"
+
+#include <algorithm>
+#include <istream>
+#include <iterator>
+#include <string>
+
+int main()
+{
+    const std::string text(
+            "In botany, a tree is a perennial plant with an elongated stem, or "
+            "trunk, supporting branches and leaves in most species.");
+
+    // Build a post buffer out of blocks with a fake header and padding
+    Fastcgipp::PostBuffer buffer;
+    {
+        const size_t pieces[] = {7, 1, 30, 0, 45};
+        size_t position = 0;
+        for(const size_t piece: pieces)
+        {
+            Fastcgipp::Block block(piece+16);
+            std::copy(
+                    text.cbegin()+position,
+                    text.cbegin()+position+piece,
+                    block.begin()+8);
+            const char* const begin = block.begin()+8;
+            buffer.append(std::move(block), begin, begin+piece);
+            position += piece;
+        }
+        buffer.append(text.data()+position, text.data()+text.size());
+    }
+
+    if(buffer.size() != text.size())
+        FAIL_LOG("Fastcgipp::PostBuffer size is wrong")
+    if(buffer.chunks().size() != 5)
+        FAIL_LOG("Fastcgipp::PostBuffer should not store empty chunks")
+
+    // Iterators
+    if(!std::equal(buffer.begin(), buffer.end(), text.cbegin(), text.cend()))
+        FAIL_LOG("Fastcgipp::PostBuffer iterators don't match data")
+
+    // Streambuf
+    {
+        Fastcgipp::PostBuffer::Streambuf streambuf(buffer);
+        std::istream stream(&streambuf);
+        const std::string result(
+                (std::istreambuf_iterator<char>(stream)),
+                std::istreambuf_iterator<char>());
+        if(result != text)
+            FAIL_LOG("Fastcgipp::PostBuffer::Streambuf doesn't match data")
+    }
+
+    // Contiguous view
+    {
+        const char* const data = buffer.data();
+        if(buffer.chunks().size() != 1)
+            FAIL_LOG("Fastcgipp::PostBuffer data() didn't consolidate")
+        if(!std::equal(data, data+buffer.size(), text.cbegin(), text.cend()))
+            FAIL_LOG("Fastcgipp::PostBuffer data() doesn't match data")
+        if(buffer.data() != data)
+            FAIL_LOG("Fastcgipp::PostBuffer data() consolidated twice")
+    }
+
+    buffer.clear();
+    if(!buffer.empty() || buffer.data() != nullptr
+            || buffer.begin() != buffer.end())
+        FAIL_LOG("Fastcgipp::PostBuffer didn't clear")
+
+    return 0;
+}
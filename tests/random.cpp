@@ -0,0 +1,112 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/random.hpp"
+
+#include <algorithm>
+#include <array>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main()
+{
+    // RFC 8439 section 2.3.2 test vector
+    {
+        uint32_t key[8];
+        for(unsigned i=0; i<8; ++i)
+            key[i] = (4*i) | (4*i+1) << 8 | (4*i+2) << 16 | (4*i+3) << 24;
+        const uint32_t nonce[3] = {0x09000000, 0x4a000000, 0};
+
+        const unsigned char expected[64] =
+        {
+            0x10, 0xf1, 0xe7, 0xe4, 0xd1, 0x3b, 0x59, 0x15,
+            0x50, 0x0f, 0xdd, 0x1f, 0xa3, 0x20, 0x71, 0xc4,
+            0xc7, 0xd1, 0xf4, 0xc7, 0x33, 0xc0, 0x68, 0x03,
+            0x04, 0x22, 0xaa, 0x9a, 0xc3, 0xd4, 0x6c, 0x4e,
+            0xd2, 0x82, 0x64, 0x46, 0x07, 0x9f, 0xaa, 0x09,
+            0x14, 0xc2, 0xd7, 0x05, 0xd9, 0x8b, 0x02, 0xa2,
+            0xb5, 0x12, 0x9c, 0xd1, 0xde, 0x16, 0x4e, 0xb9,
+            0xcb, 0xd0, 0x83, 0xe8, 0xa2, 0x50, 0x3c, 0x4e
+        };
+
+        unsigned char output[64];
+        Fastcgipp::Random::chacha20(key, 1, nonce, output);
+        if(!std::equal(output, output+64, expected))
+            FAIL_LOG("Fastcgipp::Random::chacha20() doesn't match RFC 8439")
+    }
+
+    // Output spanning several buffers never repeats and is balanced
+    {
+        const size_t size = 3*Fastcgipp::Random::s_bufferSize+100;
+        std::vector<unsigned char> data(size);
+        Fastcgipp::Random::fill(data.data(), 7);
+        Fastcgipp::Random::fill(data.data()+7, size-7);
+
+        std::set<std::array<unsigned char, 16>> blocks;
+        for(size_t i=0; i+16<=size; i+=16)
+        {
+            std::array<unsigned char, 16> block;
+            std::copy(data.begin()+i, data.begin()+i+16, block.begin());
+            if(!blocks.insert(block).second)
+                FAIL_LOG("Fastcgipp::Random repeated itself")
+        }
+
+        size_t bits = 0;
+        for(const unsigned char byte: data)
+            bits += __builtin_popcount(byte);
+        const double ratio = double(bits)/(size*8);
+        if(ratio < 0.48 || ratio > 0.52)
+            FAIL_LOG("Fastcgipp::Random is biased: " << ratio)
+    }
+
+    // Threads have their own generators
+    {
+        std::array<unsigned char, 32> first;
+        std::array<unsigned char, 32> second;
+        std::thread thread([&first] ()
+        {
+            Fastcgipp::Random::fill(first.data(), first.size());
+        });
+        Fastcgipp::Random::fill(second.data(), second.size());
+        thread.join();
+        if(first == second)
+            FAIL_LOG("Fastcgipp::Random threads produced the same output")
+    }
+
+    // A forked child doesn't hand out what its parent has buffered
+    {
+        std::array<unsigned char, 32> parent;
+        std::array<unsigned char, 32> child;
+        Fastcgipp::Random::fill(parent.data(), 1);
+
+        int pipes[2];
+        if(pipe(pipes) != 0)
+            FAIL_LOG("Unable to create a pipe")
+        const pid_t pid = fork();
+        if(pid == 0)
+        {
+            Fastcgipp::Random::fill(child.data(), child.size());
+            const bool written = write(pipes[1], child.data(), child.size())
+                == ssize_t(child.size());
+            _exit(written?0:1);
+        }
+        close(pipes[1]);
+        Fastcgipp::Random::fill(parent.data(), parent.size());
+
+        int status;
+        if(pid < 0
+                || read(pipes[0], child.data(), child.size())
+                    != ssize_t(child.size())
+                || waitpid(pid, &status, 0) != pid
+                || !WIFEXITED(status)
+                || WEXITSTATUS(status) != 0)
+            FAIL_LOG("Fastcgipp::Random fork test child failed")
+        close(pipes[0]);
+        if(parent == child)
+            FAIL_LOG("Fastcgipp::Random child repeated its parent's output")
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/request.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+const Fastcgipp::Protocol::FcgiId FCGIID = 2006;
+
+const std::string body("Content-Type: text/plain\r\n\r\nHello World!");
+
+class HelloWorld: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        out << body;
+        return true;
+    }
+};
+
+Fastcgipp::Message record(Fastcgipp::Protocol::RecordType type)
+{
+    Fastcgipp::Message message;
+    message.data.size(sizeof(Fastcgipp::Protocol::Header));
+    Fastcgipp::Protocol::Header& header
+        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(
+                message.data.begin());
+    header.version = Fastcgipp::Protocol::version;
+    header.type = type;
+    header.fcgiId = FCGIID;
+    header.contentLength = 0;
+    header.paddingLength = 0;
+    return message;
+}
+
+int main()
+{
+    // A complete response should be handed off as one transmit unit
+    {
+        std::vector<Fastcgipp::Block> sent;
+        bool kill = false;
+
+        HelloWorld request;
+        request.configure(
+                Fastcgipp::Protocol::RequestId(FCGIID, Fastcgipp::Socket()),
+                Fastcgipp::Protocol::Role::RESPONDER,
+                true,
+                [&] (const Fastcgipp::Socket&, Fastcgipp::Block&& data, bool k)
+                {
+                    sent.push_back(std::move(data));
+                    kill = k;
+                },
+                [] (Fastcgipp::Message) {},
+                [] (const Fastcgipp::Socket&, bool) {});
+
+        request.push(record(Fastcgipp::Protocol::RecordType::PARAMS));
+        request.push(record(Fastcgipp::Protocol::RecordType::IN));
+        request.handler();
+
+        if(sent.size() != 1)
+            FAIL_LOG("Hello world was sent in " << sent.size() << " blocks")
+        if(!kill)
+            FAIL_LOG("Kill flag wasn't passed along")
+
+        const Fastcgipp::Block& block = sent.front();
+        const char* position = block.begin();
+        const auto next = [&] () -> const Fastcgipp::Protocol::Header&
+        {
+            if(position+sizeof(Fastcgipp::Protocol::Header) > block.end())
+                FAIL_LOG("Block ended before all records were found")
+            const Fastcgipp::Protocol::Header& header
+                = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                        position);
+            if(header.version != Fastcgipp::Protocol::version)
+                FAIL_LOG("FastCGI version not set properly")
+            if(header.fcgiId != FCGIID)
+                FAIL_LOG("Our FcgiId doesn't match")
+            position += sizeof(header)
+                + header.contentLength
+                + header.paddingLength;
+            if(position > block.end())
+                FAIL_LOG("Record overruns the block")
+            return header;
+        };
+
+        const Fastcgipp::Protocol::Header& out = next();
+        if(out.type != Fastcgipp::Protocol::RecordType::OUT
+                || out.contentLength != body.size()
+                || std::memcmp(
+                    reinterpret_cast<const char*>(&out)+sizeof(out),
+                    body.data(),
+                    body.size()) != 0)
+            FAIL_LOG("OUT record is wrong")
+
+        const Fastcgipp::Protocol::Header& terminator = next();
+        if(terminator.type != Fastcgipp::Protocol::RecordType::OUT
+                || terminator.contentLength != 0)
+            FAIL_LOG("OUT stream wasn't terminated")
+
+        const Fastcgipp::Protocol::Header& end = next();
+        if(end.type != Fastcgipp::Protocol::RecordType::END_REQUEST
+                || end.contentLength != sizeof(Fastcgipp::Protocol::EndRequest))
+            FAIL_LOG("END_REQUEST record is wrong")
+        const Fastcgipp::Protocol::EndRequest& endBody
+            = *reinterpret_cast<const Fastcgipp::Protocol::EndRequest*>(
+                    reinterpret_cast<const char*>(&end)+sizeof(end));
+        if(endBody.protocolStatus
+                != Fastcgipp::Protocol::ProtocolStatus::REQUEST_COMPLETE)
+            FAIL_LOG("END_REQUEST status is wrong")
+
+        if(position != block.end())
+            FAIL_LOG("Trailing data after END_REQUEST")
+    }
+
+    return 0;
+}
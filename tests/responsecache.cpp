@@ -0,0 +1,266 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/responsecache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Build a record with a header and body
+Fastcgipp::Block record(
+        Fastcgipp::Protocol::RecordType type,
+        Fastcgipp::Protocol::FcgiId id,
+        const std::string& body)
+{
+    Fastcgipp::Block block(Fastcgipp::Protocol::getRecordSize(body.size()));
+    Fastcgipp::Protocol::Header& header
+        = *reinterpret_cast<Fastcgipp::Protocol::Header*>(block.begin());
+    header.version = Fastcgipp::Protocol::version;
+    header.type = type;
+    header.fcgiId = id;
+    header.contentLength = body.size();
+    header.paddingLength = block.size()-body.size()-sizeof(header);
+    std::copy(body.cbegin(), body.cend(), block.begin()+sizeof(header));
+    return block;
+}
+
+//! Encode name value pairs
+std::string params(const std::vector<std::pair<std::string, std::string>>& x)
+{
+    std::string body;
+    for(const auto& pair: x)
+    {
+        body += char(pair.first.size());
+        body += char(pair.second.size());
+        body += pair.first;
+        body += pair.second;
+    }
+    return body;
+}
+
+Fastcgipp::Message paramsMessage(
+        const std::vector<std::pair<std::string, std::string>>& x)
+{
+    Fastcgipp::Message message;
+    message.data = record(Fastcgipp::Protocol::RecordType::PARAMS, 1, params(x));
+    return message;
+}
+
+std::atomic_uint requests(0);
+
+class Cached: public Fastcgipp::Request<char>
+{
+public:
+    Cached()
+    {
+        ++requests;
+    }
+
+private:
+    bool response()
+    {
+        if(!cache(std::chrono::seconds(60)))
+            FAIL_LOG("Request::cache() refused")
+        out << "Content-Type: text/plain\r\n\r\n" \
+            << environment().requestUri << " response";
+        return true;
+    }
+};
+
+int main()
+{
+    using Fastcgipp::ResponseCache;
+
+    // Keys
+    {
+        ResponseCache cache;
+        cache.configure(1000, {"HTTP_ACCEPT_ENCODING"});
+
+        std::vector<Fastcgipp::Message> get;
+        get.push_back(paramsMessage({{"REQUEST_METHOD", "GET"}}));
+        get.push_back(paramsMessage({
+                    {"REQUEST_URI", "/a?b=c"},
+                    {"HTTP_ACCEPT_ENCODING", "gzip"},
+                    {"HTTP_COOKIE", "d=e"}}));
+        const std::string key = cache.key(get);
+        if(key != std::string("GET\0/a?b=c\0gzip", 15))
+            FAIL_LOG("ResponseCache::key() is wrong")
+
+        std::vector<Fastcgipp::Message> other;
+        other.push_back(paramsMessage({
+                    {"REQUEST_METHOD", "GET"},
+                    {"REQUEST_URI", "/a?b=c"}}));
+        if(cache.key(other) == key || cache.key(other).empty())
+            FAIL_LOG("ResponseCache::key() didn't vary")
+
+        std::vector<Fastcgipp::Message> post;
+        post.push_back(paramsMessage({
+                    {"REQUEST_METHOD", "POST"},
+                    {"REQUEST_URI", "/a?b=c"}}));
+        if(!cache.key(post).empty())
+            FAIL_LOG("ResponseCache::key() should refuse POST")
+    }
+
+    // Storage, expiry and eviction
+    {
+        ResponseCache cache;
+        cache.configure(100, std::vector<std::string>());
+
+        const auto response = [] (size_t size)
+        {
+            return record(
+                    Fastcgipp::Protocol::RecordType::OUT,
+                    7,
+                    std::string(size-sizeof(Fastcgipp::Protocol::Header), 'x'));
+        };
+
+        if(cache.find("a"))
+            FAIL_LOG("ResponseCache found something in an empty cache")
+        cache.store("a", response(40), std::chrono::seconds(60));
+        cache.store("b", response(40), std::chrono::seconds(60));
+        if(!cache.find("a") || cache.find("a")->size() != 40)
+            FAIL_LOG("ResponseCache didn't find a stored entry")
+        if(cache.size() != 82 || cache.entries() != 2)
+            FAIL_LOG("ResponseCache size is wrong")
+
+        // "a" was used more recently so "b" should be evicted
+        cache.store("c", response(40), std::chrono::seconds(60));
+        if(cache.find("b") || !cache.find("a") || !cache.find("c"))
+            FAIL_LOG("ResponseCache didn't evict the least recently used")
+        if(cache.evictions() != 1)
+            FAIL_LOG("ResponseCache eviction count is wrong")
+
+        // Too big to ever fit
+        cache.store("d", response(200), std::chrono::seconds(60));
+        if(cache.find("d") || cache.entries() != 2)
+            FAIL_LOG("ResponseCache stored an oversized entry")
+
+        cache.store("e", response(8), std::chrono::seconds(0));
+        if(cache.find("e"))
+            FAIL_LOG("ResponseCache returned a stale entry")
+
+        if(cache.hits() != 4 || cache.misses() != 4)
+            FAIL_LOG("ResponseCache counters are wrong: " << cache.hits() \
+                    << '/' << cache.misses())
+
+        const auto cached = cache.find("c");
+        const Fastcgipp::Block copy = ResponseCache::rewrite(*cached, 9);
+        if(reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                    copy.begin())->fcgiId != 9
+                || reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                    cached->begin())->fcgiId != 7
+                || !std::equal(
+                    copy.begin()+sizeof(Fastcgipp::Protocol::Header),
+                    copy.end(),
+                    cached->begin()+sizeof(Fastcgipp::Protocol::Header)))
+            FAIL_LOG("ResponseCache::rewrite() is wrong")
+    }
+
+    // Hits are served by the manager without building a request
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const std::string port = std::to_string(portDist(trueRand));
+
+        Fastcgipp::Manager<Cached> manager(2);
+        manager.cache(1<<20);
+        if(!manager.listen("127.0.0.1", port.c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        Fastcgipp::SocketGroup group;
+        const auto socket = group.connect("127.0.0.1", port.c_str());
+        if(!socket.valid())
+            FAIL_LOG("Couldn't connect")
+
+        const auto request = [&] (Fastcgipp::Protocol::FcgiId id)
+        {
+            std::string begin(sizeof(Fastcgipp::Protocol::BeginRequest), 0);
+            Fastcgipp::Protocol::BeginRequest& body
+                = *reinterpret_cast<Fastcgipp::Protocol::BeginRequest*>(
+                        &begin[0]);
+            body.role = Fastcgipp::Protocol::Role::RESPONDER;
+            body.flags = Fastcgipp::Protocol::BeginRequest::keepConnBit;
+
+            const Fastcgipp::Block records[] =
+            {
+                record(Fastcgipp::Protocol::RecordType::BEGIN_REQUEST, id, begin),
+                record(Fastcgipp::Protocol::RecordType::PARAMS, id, params({
+                            {"REQUEST_METHOD", "GET"},
+                            {"REQUEST_URI", "/cached"}})),
+                record(Fastcgipp::Protocol::RecordType::PARAMS, id, ""),
+                record(Fastcgipp::Protocol::RecordType::IN, id, "")
+            };
+            for(const auto& x: records)
+                if(socket.write(x.begin(), x.size()) != ssize_t(x.size()))
+                    FAIL_LOG("Unable to write request")
+
+            // Read until END_REQUEST
+            std::string response;
+            std::string received;
+            while(true)
+            {
+                char buffer[4096];
+                const auto ready = group.poll(true);
+                if(!ready.valid())
+                    continue;
+                const ssize_t size = ready.read(buffer, sizeof(buffer));
+                if(size < 0)
+                    FAIL_LOG("Connection lost")
+                received.append(buffer, size);
+
+                size_t position = 0;
+                bool ended = false;
+                while(received.size()-position
+                        >= sizeof(Fastcgipp::Protocol::Header))
+                {
+                    const Fastcgipp::Protocol::Header& header
+                        = *reinterpret_cast<const Fastcgipp::Protocol::Header*>(
+                                received.data()+position);
+                    const size_t length = sizeof(header)
+                        + header.contentLength
+                        + header.paddingLength;
+                    if(received.size()-position < length)
+                        break;
+                    if(header.fcgiId != id)
+                        FAIL_LOG("Response has the wrong request id")
+                    if(header.type == Fastcgipp::Protocol::RecordType::OUT)
+                        response.append(
+                                received.data()+position+sizeof(header),
+                                header.contentLength);
+                    else if(header.type
+                            == Fastcgipp::Protocol::RecordType::END_REQUEST)
+                        ended = true;
+                    position += length;
+                }
+                received.erase(0, position);
+                if(ended)
+                    break;
+            }
+            return response;
+        };
+
+        const std::string expected(
+                "Content-Type: text/plain\r\n\r\n/cached response");
+        if(request(1) != expected)
+            FAIL_LOG("First response is wrong")
+        if(request(1) != expected)
+            FAIL_LOG("Cached response is wrong")
+        if(request(2) != expected)
+            FAIL_LOG("Cached response with a new request id is wrong")
+
+        if(requests != 1)
+            FAIL_LOG("Requests were built for cache hits: " << requests.load())
+        if(manager.cache().hits() != 2 || manager.cache().misses() != 1)
+            FAIL_LOG("Manager cache counters are wrong")
+
+        socket.close();
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/manager.hpp"
+#include "fastcgi++/router.hpp"
+#include "fixture.hpp"
+
+#include <array>
+#include <random>
+#include <string>
+#include <string_view>
+
+//! A route table checked at compile time
+constexpr std::array<std::string_view, 3> table = {
+    "/users/:id",
+    "/users/:id/files/*path",
+    "/static/*"
+};
+
+static_assert(Fastcgipp::Router::valid(table[0])
+        && Fastcgipp::Router::valid(table[1])
+        && Fastcgipp::Router::valid(table[2]));
+static_assert(!Fastcgipp::Router::valid("users")
+        && !Fastcgipp::Router::valid("/users/:")
+        && !Fastcgipp::Router::valid("/users/x:id")
+        && !Fastcgipp::Router::valid("/files/*path/more")
+        && !Fastcgipp::Router::valid("/:a/:b/:c/:d/:e/:f/:g/:h/:i"));
+
+//! Requests matching no route
+class Fallback: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        out << "Content-Type: text/plain\r\n\r\nfallback";
+        return true;
+    }
+};
+
+//! Requests for a user
+class User: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        out << "Content-Type: text/plain\r\n\r\nuser " << parameters()["id"];
+        return true;
+    }
+};
+
+//! Requests for a user's file
+class File: public Fastcgipp::Request<wchar_t>
+{
+    bool response()
+    {
+        out << L"Content-Type: text/plain\r\n\r\nfile " \
+            << parameters()["id"] << L' ' << parameters()["path"];
+        return true;
+    }
+};
+
+int main()
+{
+    using Fastcgipp::Router;
+
+    // Matching
+    {
+        Router router;
+        for(const auto& pattern: table)
+            router.add(pattern);
+        const unsigned user = 0;
+        const unsigned file = 1;
+        const unsigned statics = 2;
+        const unsigned me = router.add("/users/me");
+        const unsigned root = router.add("/");
+        const unsigned userlist = router.add("/users");
+
+        if(router.size() != 6
+                || me != 3
+                || router.add("/users/:id") != Router::none
+                || router.add("/users/:name/x") != Router::none
+                || router.add("bad") != Router::none
+                || router.size() != 6)
+            FAIL_LOG("Fastcgipp::Router accepted a bad pattern")
+
+        Router::Parameters<char> parameters;
+        if(router.match(std::string_view("/users/42"), parameters) != user
+                || parameters.size() != 1
+                || parameters["id"] != "42"
+                || parameters["nothing"] != "")
+            FAIL_LOG("Fastcgipp::Router didn't capture a parameter")
+
+        if(router.match(std::string_view("/users/me"), parameters) != me
+                || parameters.size() != 0)
+            FAIL_LOG("Fastcgipp::Router didn't prefer literal text")
+
+        // Backtracks out of the literal me
+        if(router.match(std::string_view("/users/meat"), parameters) != user
+                || parameters["id"] != "meat")
+            FAIL_LOG("Fastcgipp::Router didn't backtrack to a parameter")
+
+        if(router.match(
+                    std::string_view("/users/me/files/a/b.txt"),
+                    parameters) != file
+                || parameters.size() != 2
+                || parameters["id"] != "me"
+                || parameters["path"] != "a/b.txt")
+            FAIL_LOG("Fastcgipp::Router didn't capture a wildcard")
+
+        if(router.match(std::string_view("/static/css/x.css"), parameters)
+                    != statics
+                || parameters[""] != "css/x.css"
+                || router.match(std::string_view("/"), parameters) != root
+                || router.match(std::string_view("/users"), parameters)
+                    != userlist)
+            FAIL_LOG("Fastcgipp::Router matched the wrong route")
+
+        if(router.match(std::string_view("/users/"), parameters)
+                    != Router::none
+                || router.match(std::string_view("/users/42/x"), parameters)
+                    != Router::none
+                || router.match(std::string_view("/nothing"), parameters)
+                    != Router::none
+                || router.match(std::string_view(""), parameters)
+                    != Router::none)
+            FAIL_LOG("Fastcgipp::Router matched a path it shouldn't have")
+
+        Router::Parameters<wchar_t> wide;
+        if(router.match(std::wstring_view(L"/users/é/files/x"), wide) != file
+                || wide["id"] != L"é"
+                || wide["path"] != L"x")
+            FAIL_LOG("Fastcgipp::Router didn't match a wide path")
+
+        if(Router::path<char>("/a/b?c=d", "/x") != "/a/b"
+                || Router::path<char>("", "/x") != "/x")
+            FAIL_LOG("Fastcgipp::Router::path() is wrong")
+    }
+
+    // The manager builds each route's request type
+    {
+        std::random_device trueRand;
+        std::uniform_int_distribution<> portDist(2048, 65534);
+        const unsigned short port = portDist(trueRand);
+
+        Fastcgipp::Manager<Fallback> manager(2);
+        if(!manager.route<User>("/users/:id")
+                || !manager.route<File>("/users/:id/files/*path")
+                || manager.route<User>("/users/:id"))
+            FAIL_LOG("Manager didn't add its routes properly")
+        manager.reuseAddress(true);
+        if(!manager.listen("127.0.0.1", std::to_string(port).c_str()))
+            FAIL_LOG("Unable to listen")
+        manager.start();
+
+        const struct
+        {
+            const char* uri;
+            const char* body;
+        } expected[] = {
+            {"/users/42?x=y", "\r\n\r\nuser 42"},
+            {"/users/7/files/a/b", "\r\n\r\nfile 7 a/b"},
+            {"/index", "\r\n\r\nfallback"}
+        };
+        for(const auto& test: expected)
+            if(drain(send(port, request({{"REQUEST_URI", test.uri}})))
+                    .find(test.body) == std::string::npos)
+                FAIL_LOG("Manager routed " << test.uri << " wrong")
+
+        manager.terminate();
+        manager.join();
+    }
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/sharedsessions.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+int main()
+{
+    char path[] = "/tmp/fastcgi++sessionsXXXXXX";
+    const int fd = mkstemp(path);
+    if(fd == -1)
+        FAIL_LOG("Unable to create a temporary file")
+    close(fd);
+
+    typedef Fastcgipp::Http::SharedSessions<std::string> Sessions;
+    std::string id;
+
+    // Storing and finding
+    {
+        Sessions sessions(path, 60, 1024, 64);
+        if(sessions.table().reused())
+            FAIL_LOG("SharedSessions reused an empty file")
+
+        const Sessions::Id sid = sessions.generate(
+                std::make_shared<std::string>("persistent"));
+        std::ostringstream ss;
+        ss << sid;
+        id = ss.str();
+
+        const auto data = sessions.get(sid);
+        if(!data || *data != "persistent")
+            FAIL_LOG("SharedSessions didn't find a session")
+        if(sessions.get(Sessions::Id()))
+            FAIL_LOG("SharedSessions found a session that doesn't exist")
+
+        const Sessions::Id oversized = sessions.generate(
+                std::make_shared<std::string>(100, 'x'));
+        if(sessions.get(oversized) || sessions.size() != 1)
+            FAIL_LOG("SharedSessions stored oversized session data")
+    }
+
+    // Surviving a restart
+    {
+        Sessions sessions(path, 60, 1024, 64);
+        if(!sessions.table().reused())
+            FAIL_LOG("SharedSessions didn't reuse the table")
+        const auto data = sessions.get(Sessions::Id(id));
+        if(!data || *data != "persistent" || sessions.size() != 1)
+            FAIL_LOG("SharedSessions session didn't survive a restart")
+    }
+
+    // A different geometry is refused and the table is left alone
+    {
+        const pid_t child = fork();
+        if(child == 0)
+        {
+            std::wostringstream discard;
+            Fastcgipp::Logging::logstream = &discard;
+            Sessions sessions(path, 60, 2048, 64);
+            _exit(0);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_FAILURE)
+            FAIL_LOG("SharedSessions used a table of a different size")
+
+        Sessions sessions(path, 60, 1024, 64);
+        const auto data = sessions.get(Sessions::Id(id));
+        if(!sessions.table().reused() || !data || *data != "persistent")
+            FAIL_LOG("SharedSessions touched a table of a different size")
+        sessions.erase(Sessions::Id(id));
+    }
+
+    // Sharing between processes
+    {
+        Sessions sessions(path, 60, 1024, 64);
+        const Sessions::Id sid = sessions.generate(
+                std::make_shared<std::string>("parent"));
+        std::ostringstream ss;
+        ss << sid;
+
+        int pipes[2];
+        if(pipe(pipes) == -1)
+            FAIL_LOG("Unable to create a pipe")
+
+        const pid_t child = fork();
+        if(child == 0)
+        {
+            close(pipes[0]);
+            Sessions childSessions(path, 60, 1024, 64);
+            const auto data = childSessions.get(Sessions::Id(ss.str()));
+            if(!data || *data != "parent")
+                _exit(1);
+            childSessions.erase(Sessions::Id(ss.str()));
+
+            const Sessions::Id childSid = childSessions.generate(
+                    std::make_shared<std::string>("child"));
+            std::ostringstream childId;
+            childId << childSid;
+            const std::string id = childId.str();
+            if(write(pipes[1], id.data(), id.size()) != ssize_t(id.size()))
+                _exit(2);
+            _exit(0);
+        }
+        close(pipes[1]);
+
+        char childId[Sessions::Id::stringLength];
+        const ssize_t size = read(pipes[0], childId, sizeof(childId));
+        close(pipes[0]);
+        int status;
+        waitpid(child, &status, 0);
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0
+                || size != sizeof(childId))
+            FAIL_LOG("SharedSessions child process couldn't see the session")
+
+        if(sessions.get(sid))
+            FAIL_LOG("SharedSessions erase in another process didn't show")
+        const auto data = sessions.get(
+                Sessions::Id(std::string(childId, sizeof(childId))));
+        if(!data || *data != "child" || sessions.size() != 1)
+            FAIL_LOG("SharedSessions session from another process is missing")
+    }
+
+    // Expiry and eviction in a table of its own
+    unlink(path);
+    {
+        Sessions sessions(path, 1, 32, 64);
+        const Sessions::Id first = sessions.generate(
+                std::make_shared<std::string>("first"));
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        if(sessions.get(first))
+            FAIL_LOG("SharedSessions returned an expired session")
+
+        // The table only has one window so it fills up
+        for(unsigned i=0; i<100; ++i)
+            sessions.generate(std::make_shared<std::string>("filler"));
+        if(sessions.size() != sessions.table().slots())
+            FAIL_LOG("SharedSessions didn't evict when full")
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/request.hpp"
+#include "fastcgi++/supervisor.hpp"
+#include "fixture.hpp"
+
+#include <random>
+#include <set>
+#include <string>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//! Responds with the pid of the worker and crashes on request
+class Pid: public Fastcgipp::Request<char>
+{
+    bool response()
+    {
+        if(environment().requestUri == "/crash")
+            kill(getpid(), SIGKILL);
+        out << "Content-Type: text/plain\r\n\r\n" << getpid();
+        return true;
+    }
+};
+
+int main()
+{
+    std::random_device trueRand;
+    std::uniform_int_distribution<> portDist(2048, 65534);
+    const unsigned short port = portDist(trueRand);
+
+    Fastcgipp::Supervisor supervisor(2);
+    supervisor.reuseAddress(true);
+    if(!supervisor.listen("127.0.0.1", std::to_string(port).c_str()))
+        FAIL_LOG("Unable to listen")
+    supervisor.recycle(2);
+
+    const pid_t child = fork();
+    if(child == 0)
+    {
+        supervisor.run<Pid>(1);
+        return 0;
+    }
+
+    // Workers are recycled after two requests
+    std::set<std::string> pids;
+    for(unsigned i=0; i<10; ++i)
+    {
+        const std::string pid = get(port, "/");
+        if(pid.empty())
+            FAIL_LOG("Fastcgipp::Supervisor worker didn't respond")
+        pids.insert(pid);
+    }
+    if(pids.size() < 3)
+        FAIL_LOG("Fastcgipp::Supervisor didn't recycle workers")
+
+    // Crashed workers are replaced
+    if(!get(port, "/crash").empty())
+        FAIL_LOG("Fastcgipp::Supervisor worker didn't crash")
+    std::string last;
+    for(unsigned i=0; i<4; ++i)
+    {
+        last = get(port, "/");
+        if(last.empty())
+            FAIL_LOG("Fastcgipp::Supervisor didn't survive a crashed worker")
+    }
+
+    // Stop gracefully
+    kill(child, SIGUSR1);
+    int status;
+    if(waitpid(child, &status, 0) != child
+            || !WIFEXITED(status)
+            || WEXITSTATUS(status) != 0)
+        FAIL_LOG("Fastcgipp::Supervisor didn't exit cleanly")
+    if(kill(std::stoi(last), 0) == 0)
+        FAIL_LOG("Fastcgipp::Supervisor left a worker running")
+
+    return 0;
+}
@@ -0,0 +1,232 @@
+#include "fastcgi++/log.hpp"
+#include "fastcgi++/timers.hpp"
+#include "fastcgi++/request.hpp"
+#include "fixture.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/timerfd.h>
+
+//! A delivered message
+struct Delivered
+{
+    Fastcgipp::Protocol::FcgiId id;
+    int type;
+    Fastcgipp::Timers::Clock::time_point time;
+};
+
+//! Expire timers until we have enough or give up
+void wait(Fastcgipp::Timers& timers, const std::function<bool()>& done)
+{
+    const auto giveUp
+        = Fastcgipp::Timers::Clock::now()+std::chrono::seconds(10);
+    while(!done())
+    {
+        if(Fastcgipp::Timers::Clock::now() > giveUp)
+            FAIL_LOG("Fastcgipp::Timers took too long")
+        pollfd fd = {timers.fd(), POLLIN, 0};
+        ::poll(&fd, 1, 100);
+        timers.expire();
+    }
+}
+
+class Delayed: public Fastcgipp::Request<char>
+{
+public:
+    std::vector<int> received;
+
+    Fastcgipp::Timers::Id schedule(int delay, int type)
+    {
+        return after(std::chrono::milliseconds(delay), Fastcgipp::Message(type));
+    }
+
+    bool cancel(Fastcgipp::Timers::Id id)
+    {
+        return Fastcgipp::Request<char>::cancel(id);
+    }
+
+private:
+    bool response()
+    {
+        received.push_back(m_message.type);
+        return false;
+    }
+};
+
+int main()
+{
+    std::vector<Delivered> delivered;
+    Fastcgipp::Timers timers(
+            [&] (Fastcgipp::Protocol::RequestId id, Fastcgipp::Message&& message)
+            {
+                delivered.push_back({
+                        id.m_id,
+                        message.type,
+                        Fastcgipp::Timers::Clock::now()});
+            });
+
+    // Never early and in order, including across cascades
+    {
+        std::mt19937 generator(2026);
+        std::uniform_int_distribution<> delays(0, 700);
+        // Each timer is due somewhere between the clock before and after it
+        // was added
+        std::vector<std::pair<
+            Fastcgipp::Timers::Clock::time_point,
+            Fastcgipp::Timers::Clock::time_point>> scheduled;
+        for(int i=0; i<200; ++i)
+        {
+            const std::chrono::milliseconds delay(delays(generator));
+            const auto before = Fastcgipp::Timers::Clock::now();
+            timers.after(
+                    delay,
+                    Fastcgipp::Protocol::RequestId(i+1, Fastcgipp::Socket()),
+                    Fastcgipp::Message(i+1));
+            scheduled.emplace_back(
+                    before+delay,
+                    Fastcgipp::Timers::Clock::now()+delay);
+        }
+
+        // Cancelling
+        const auto cancelled = timers.after(
+                std::chrono::milliseconds(1),
+                Fastcgipp::Protocol::RequestId(1000, Fastcgipp::Socket()),
+                Fastcgipp::Message(1000));
+        if(!timers.pending(cancelled) || !timers.cancel(cancelled))
+            FAIL_LOG("Fastcgipp::Timers couldn't cancel a timer")
+        if(timers.pending(cancelled) || timers.cancel(cancelled))
+            FAIL_LOG("Fastcgipp::Timers cancelled a timer twice")
+        if(timers.size() != scheduled.size())
+            FAIL_LOG("Fastcgipp::Timers size is wrong")
+
+        wait(timers, [&] () { return delivered.size() >= scheduled.size(); });
+        if(delivered.size() != scheduled.size())
+            FAIL_LOG("Fastcgipp::Timers delivered too many messages")
+
+        // Timers due within the same tick can go in any order
+        Fastcgipp::Timers::Clock::time_point last;
+        for(const auto& message: delivered)
+        {
+            if(message.id != message.type)
+                FAIL_LOG("Fastcgipp::Timers delivered to the wrong request")
+            const auto& due = scheduled[message.type-1];
+            if(message.time < due.first)
+                FAIL_LOG("Fastcgipp::Timers delivered a message early")
+            if(due.second+Fastcgipp::Timers::resolution <= last)
+                FAIL_LOG("Fastcgipp::Timers delivered out of order")
+            last = std::max(last, due.first);
+        }
+        if(timers.size() != 0)
+            FAIL_LOG("Fastcgipp::Timers has timers left over")
+    }
+
+    // A million pending timers
+    {
+        const unsigned count = 1000000;
+        std::mt19937 generator(2006);
+        // Far beyond how long adding them could take
+        std::uniform_int_distribution<long long> delays(3600000, 100000000);
+        std::vector<Fastcgipp::Timers::Id> ids;
+        ids.reserve(count);
+
+        const auto start = std::chrono::steady_clock::now();
+        for(unsigned i=0; i<count; ++i)
+            ids.push_back(timers.after(
+                    std::chrono::milliseconds(delays(generator)),
+                    Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+                    Fastcgipp::Message(1)));
+        const auto added = std::chrono::steady_clock::now();
+        timers.expire();
+        for(const auto& id: ids)
+            if(!timers.cancel(id))
+                FAIL_LOG("Fastcgipp::Timers lost a pending timer")
+        const auto cancelled = std::chrono::steady_clock::now();
+
+        if(timers.size() != 0)
+            FAIL_LOG("Fastcgipp::Timers has timers left over")
+        INFO_LOG("Fastcgipp::Timers added " << count << " timers in " \
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    added-start).count() << "ms and cancelled them in " \
+                << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    cancelled-added).count() << "ms")
+    }
+
+    // A distant timer doesn't wake us until it is close
+    {
+        Fastcgipp::Timers distant(
+                [] (Fastcgipp::Protocol::RequestId, Fastcgipp::Message&&) {});
+        distant.after(
+                std::chrono::seconds(10),
+                Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+                Fastcgipp::Message(1));
+        itimerspec armed;
+        if(timerfd_gettime(distant.fd(), &armed) == -1
+                || armed.it_value.tv_sec < 9)
+            FAIL_LOG("Fastcgipp::Timers woke up long before a timer was due")
+    }
+
+    // Requests get their messages and cancel their timers when destroyed
+    {
+        std::function<void(Fastcgipp::Message)> push;
+        Fastcgipp::Timers requestTimers(
+                [&] (Fastcgipp::Protocol::RequestId, Fastcgipp::Message&& message)
+                {
+                    push(std::move(message));
+                });
+        {
+            Delayed request;
+            request.configure(
+                    Fastcgipp::Protocol::RequestId(1, Fastcgipp::Socket()),
+                    Fastcgipp::Protocol::Role::RESPONDER,
+                    true,
+                    [] (const Fastcgipp::Socket&, Fastcgipp::Block&&, bool) {},
+                    [&] (Fastcgipp::Message message)
+                    {
+                        request.push(std::move(message));
+                    },
+                    [] (const Fastcgipp::Socket&, bool) {});
+            request.timers(requestTimers);
+            push = [&] (Fastcgipp::Message message)
+            {
+                request.push(std::move(message));
+            };
+            request.push(message(Fastcgipp::Protocol::RecordType::PARAMS));
+            request.push(message(Fastcgipp::Protocol::RecordType::IN));
+            request.handler();
+
+            for(int i=0; i<40; ++i)
+                request.schedule(1, 2);
+            const auto cancelled = request.schedule(1, 3);
+            if(!request.cancel(cancelled))
+                FAIL_LOG("Request couldn't cancel a timer")
+
+            wait(requestTimers, [&] () { return requestTimers.size() == 0; });
+            request.handler();
+            if(std::count(
+                        request.received.cbegin(),
+                        request.received.cend(),
+                        2) != 40)
+                FAIL_LOG("Request didn't receive its delayed messages")
+            if(std::count(
+                        request.received.cbegin(),
+                        request.received.cend(),
+                        3) != 0)
+                FAIL_LOG("Request received a cancelled message")
+
+            request.schedule(60000, 4);
+            request.schedule(60000, 4);
+            if(requestTimers.size() != 2)
+                FAIL_LOG("Request timers weren't scheduled")
+        }
+        if(requestTimers.size() != 0)
+            FAIL_LOG("Request timers weren't cancelled with the request")
+    }
+
+    return 0;
+}
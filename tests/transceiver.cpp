@@ -51,11 +51,29 @@ std::atomic_bool echoTerminate;
 
 std::vector<std::pair<size_t, Fastcgipp::Protocol::FcgiId>> sizes;
 
+std::atomic_bool throttling(false);
+std::mutex throttleMutex;
+std::condition_variable throttleCv;
+unsigned throttledRecords = 0;
+Fastcgipp::Socket throttledSocket;
+
 void receive(
         Fastcgipp::Protocol::RequestId id,
         Fastcgipp::Message&& message)
 {
-    if(id.m_id != Fastcgipp::Protocol::badFcgiId)
+    if(throttling)
+    {
+        if(id.m_id != Fastcgipp::Protocol::badFcgiId)
+        {
+            {
+                std::lock_guard<std::mutex> lock(throttleMutex);
+                throttledSocket = id.m_socket;
+                ++throttledRecords;
+            }
+            throttleCv.notify_all();
+        }
+    }
+    else if(id.m_id != Fastcgipp::Protocol::badFcgiId)
     {
         {
             std::lock_guard<std::mutex> lock(echoMutex);
@@ -385,6 +403,67 @@ int main()
 
     client();
 
+    // Test throttling
+    {
+        throttling = true;
+        Fastcgipp::SocketGroup group;
+        const auto socket = group.connect("127.0.0.1", port.c_str());
+        if(!socket.valid())
+            FAIL_LOG("Couldn't connect for throttle test")
+
+        // Receiving is given plenty of time but not receiving can only be
+        // waited on for so long
+        const std::chrono::seconds deadline(10);
+        const std::chrono::milliseconds quiet(200);
+        const auto waitFor = [] (
+                unsigned records,
+                std::chrono::milliseconds timeout)
+        {
+            std::unique_lock<std::mutex> lock(throttleMutex);
+            return throttleCv.wait_for(lock, timeout, [records] ()
+            {
+                return throttledRecords >= records;
+            });
+        };
+        const auto received = [] ()
+        {
+            std::lock_guard<std::mutex> lock(throttleMutex);
+            return throttledSocket;
+        };
+
+        FullMessage message;
+        message.header.version = Fastcgipp::Protocol::version;
+        message.header.type = Fastcgipp::Protocol::RecordType::IN;
+        message.header.fcgiId = 1;
+        message.header.contentLength = 64;
+        message.header.paddingLength = 0;
+        const size_t size = sizeof(message.header)+64;
+
+        if(socket.write(reinterpret_cast<const char*>(&message), size)
+                != ssize_t(size))
+            FAIL_LOG("Unable to write first record in throttle test")
+        if(!waitFor(1, deadline))
+            FAIL_LOG("First record in throttle test not received")
+
+        transceiver.throttle(received(), true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(socket.write(reinterpret_cast<const char*>(&message), size)
+                != ssize_t(size))
+            FAIL_LOG("Unable to write second record in throttle test")
+        if(waitFor(2, quiet))
+            FAIL_LOG("Record received on a throttled socket")
+
+        transceiver.throttle(received(), false);
+        if(!waitFor(2, deadline))
+            FAIL_LOG("Record not received after throttled socket resumed")
+
+        {
+            std::lock_guard<std::mutex> lock(throttleMutex);
+            throttledSocket = Fastcgipp::Socket();
+        }
+        socket.close();
+    }
+
     transceiver.stop();
     transceiver.join();
 